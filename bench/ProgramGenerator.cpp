@@ -0,0 +1,142 @@
+#include "ProgramGenerator.h"
+
+namespace {
+    const char* const ARITHMETIC[] = {" + ", " - ", " * ", " / ", " % "};
+    const char* const COMPARISON[] = {" < ", " <= ", " > ", " >= ", " == ", " != "};
+}
+
+ProgramGenerator::ProgramGenerator(const ProgramShape& s) : shape(s), state(s.seed * 0x9E3779B97F4A7C15ULL + 1) {
+    if (shape.declarationWidth < 1) shape.declarationWidth = 1;
+    if (shape.arraySize < 1) shape.arraySize = 1;
+    if (shape.expressionLength < 1) shape.expressionLength = 1;
+    if (shape.matrixSize < 1) shape.matrixSize = 1;
+}
+
+// xorshift64*: fast and reproducible across platforms
+uint64_t ProgramGenerator::next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+int ProgramGenerator::pick(int bound) {
+    return (int)(next() % (uint64_t)bound);
+}
+
+string ProgramGenerator::variable() {
+    return "v" + to_string(pick(shape.declarationWidth)) + suffix;
+}
+
+string ProgramGenerator::operand() {
+    int choice = pick(shape.arrays > 0 ? 4 : 3);
+    if (choice == 0) return to_string(1 + pick(99));
+    if (choice == 3) {
+        return "arr" + to_string(pick(shape.arrays)) + suffix + "[" + to_string(pick(shape.arraySize)) + "]";
+    }
+    if (choice == 1 && shape.dynamicArrays > 0 && pick(2) == 0) {
+        return "dyn" + to_string(pick(shape.dynamicArrays)) + suffix + "[" + variable() + " % p" + suffix + "]";
+    }
+    return choice == 1 ? "p" + suffix : variable();
+}
+
+string ProgramGenerator::expression(int length) {
+    string text = operand();
+    for (int i = 1; i < length; i++) {
+        // Parenthesise now and then so the chain also nests
+        if (pick(8) == 0) {
+            text = "(" + text + ")";
+        }
+        text += ARITHMETIC[pick(5)];
+        text += operand();
+    }
+    return text;
+}
+
+void ProgramGenerator::statement(string& out, int depth, const string& indent) {
+    if (depth > 0) {
+        // Alternate if/while so both block forms appear at every level
+        out += indent + (depth % 2 ? "if (" : "while (") + variable() + COMPARISON[pick(6)] +
+               operand() + ") {\n";
+        // Cap the indentation so deep cases measure tokens, not whitespace
+        statement(out, depth - 1, indent.size() < 16 ? indent + "  " : indent);
+        out += indent + "}\n";
+        return;
+    }
+
+    if (shape.arrays > 0 && pick(4) == 0) {
+        out += indent + "arr" + to_string(pick(shape.arrays)) + suffix + "[" + variable() + " % " +
+               to_string(shape.arraySize) + "] = " + expression(shape.expressionLength) + ";\n";
+    } else {
+        out += indent + variable() + " = " + expression(shape.expressionLength) + ";\n";
+    }
+}
+
+// c = a * b, one row of c at a time, with the inner product in a scalar
+void ProgramGenerator::matrixMultiply(string& out) {
+    string n = to_string(shape.matrixSize);
+    out += "  i = 0;\n"
+           "  while (i < " + n + ") {\n"
+           "    j = 0;\n"
+           "    while (j < " + n + ") {\n"
+           "      sum = 0;\n"
+           "      k = 0;\n"
+           "      while (k < " + n + ") {\n"
+           "        sum = sum + ma[i][k] * mb[k][j];\n"
+           "        k = k + 1;\n"
+           "      }\n"
+           "      mc[i][j] = sum;\n"
+           "      j = j + 1;\n"
+           "    }\n"
+           "    i = i + 1;\n"
+           "  }\n";
+}
+
+void ProgramGenerator::appendFunction(string& out, int index) {
+    suffix = shape.distinctLocals ? "f" + to_string(index) : "";
+    string parameter = "p" + suffix;
+    out += "int f" + to_string(index) + "(int " + parameter + ")\n{\n";
+
+    out += "  int";
+    for (int i = 0; i < shape.declarationWidth; i++) {
+        out += (i ? ", v" : " v") + to_string(i) + suffix;
+    }
+    out += ";\n";
+    for (int i = 0; i < shape.arrays; i++) {
+        out += "  int arr" + to_string(i) + suffix + "[" + to_string(shape.arraySize) + "];\n";
+    }
+    if (shape.dynamicArrays > 0) {
+        out += "  int";
+        for (int i = 0; i < shape.dynamicArrays; i++) {
+            out += (i ? ", dyn" : " dyn") + to_string(i) + suffix + "[" + parameter + "]";
+        }
+        string scratch = "scratch" + suffix;
+        out += ", " + scratch + "[];\n  allocate(" + scratch + ", " + parameter + " * 2);\n";
+    }
+    if (shape.matrices > 0) {
+        string extent = "[" + to_string(shape.matrixSize) + "]";
+        out += "  int ma" + extent + extent + ", mb" + extent + extent + ", mc" + extent + extent +
+               ", i, j, k, sum;\n";
+    }
+    for (int m = 0; m < shape.matrices; m++) {
+        matrixMultiply(out);
+    }
+
+    for (int s = 0; s < shape.statementsPerFunction; s++) {
+        statement(out, s == 0 ? shape.nestingDepth : 0, "  ");
+    }
+    out += "  return v0" + suffix + ";\n}\n\n";
+}
+
+string ProgramGenerator::mainFunction() {
+    return "int main()\n{\n  int result;\n  result = 0;\n  return result;\n}\n";
+}
+
+string ProgramGenerator::generate() {
+    string out;
+    for (int f = 0; f < shape.functions; f++) {
+        appendFunction(out, f);
+    }
+    out += mainFunction();
+    return out;
+}
@@ -0,0 +1,69 @@
+#ifndef PROGRAMGENERATOR_H
+#define PROGRAMGENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Shape of a synthetic Tiny C program. Each knob stresses one part of the
+// front end: many functions (symbol table churn), deep nesting (parser
+// recursion), long expression chains (the precedence chain), wide
+// declarations (declaration checks), large arrays (array accesses),
+// matrix multiplications (multi-dimensional subscripts in nested loops)
+// and arrays sized at run time.
+struct ProgramShape {
+    int functions;
+    int statementsPerFunction;
+    int nestingDepth;
+    int expressionLength;
+    int declarationWidth;
+    int arrays;
+    int arraySize;
+    // Matrix-multiply loop nests per function, over matrixSize-square
+    // matrices
+    int matrices;
+    int matrixSize;
+    // Arrays per function sized by its parameter, plus one given its
+    // storage by allocate()
+    int dynamicArrays;
+    // Whether each function's parameter, variables and arrays are named
+    // after the function (v0f12 in f12), so no two functions share a
+    // local name; the matrix multiplications keep theirs
+    bool distinctLocals;
+    uint64_t seed;
+
+    ProgramShape()
+        : functions(100), statementsPerFunction(8), nestingDepth(2), expressionLength(4),
+          declarationWidth(4), arrays(1), arraySize(16), matrices(0), matrixSize(64), dynamicArrays(0),
+          distinctLocals(false), seed(1) {}
+};
+
+// Produces valid programs only, so every benchmark run exercises the whole
+// pipeline. Output is deterministic for a given shape.
+class ProgramGenerator {
+private:
+    ProgramShape shape;
+    uint64_t state;
+    // Appended to local names in the function being generated
+    string suffix;
+
+    uint64_t next();
+    int pick(int bound);
+    string variable();
+    string operand();
+    string expression(int length);
+    void statement(string& out, int depth, const string& indent);
+    void matrixMultiply(string& out);
+
+public:
+    explicit ProgramGenerator(const ProgramShape& shape);
+    string generate();
+
+    // Pieces of generate(), for producing a program as a stream: any
+    // number of functions with distinct indices, then the main function
+    void appendFunction(string& out, int index);
+    static string mainFunction();
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "RegressionGate.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    // Metrics the gate checks, one per phase plus end-to-end time; the
+    // tokens/s variants of the lexer and pipeline figures are redundant
+    const char* const GATED_METRICS[] = {"lexer_mb_per_s", "parser_tokens_per_s", "semantic_lookups_per_s",
+                                         "pipeline_ms"};
+
+    // Scales a MAD to a standard-deviation estimate for normal noise
+    const double MAD_TO_SIGMA = 1.4826;
+
+    // Standard error of a median of n samples, from the samples' MAD
+    double medianError(const JsonValue& metric) {
+        double samples = metric.get("samples").size();
+        if (samples < 1) samples = 1;
+        return 1.2533 * MAD_TO_SIGMA * metric.get("mad").asNumber() / sqrt(samples);
+    }
+}
+
+RegressionGate::RegressionGate(double tolerance, double noise) : tolerancePercent(tolerance), noiseFactor(noise) {}
+
+bool RegressionGate::lowerIsBetter(const string& metric) {
+    return metric == "peak_kb" || (metric.size() > 3 && metric.compare(metric.size() - 3, 3, "_ms") == 0);
+}
+
+bool RegressionGate::compatible(const JsonValue& baseline, const JsonValue& current, string& reason) const {
+    if (!baseline.has("cases") || !current.has("cases")) {
+        reason = "missing \"cases\" object";
+        return false;
+    }
+    // Program sizes scale with --scale, so throughput is not comparable across it
+    if (baseline.get("scale").asNumber() != current.get("scale").asNumber()) {
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer), "baseline used --scale=%g, this run --scale=%g",
+                 baseline.get("scale").asNumber(), current.get("scale").asNumber());
+        reason = buffer;
+        return false;
+    }
+    return true;
+}
+
+MetricComparison RegressionGate::compareMetric(const string& caseName, const string& metric,
+                                               const JsonValue& baseline, const JsonValue& current) const {
+    MetricComparison comparison;
+    comparison.caseName = caseName;
+    comparison.metric = metric;
+    comparison.baseline = baseline.get("median").asNumber();
+    comparison.current = current.get("median").asNumber();
+
+    double difference = comparison.current - comparison.baseline;
+    if (!lowerIsBetter(metric)) difference = -difference;
+    comparison.change = comparison.baseline != 0 ? 100.0 * difference / fabs(comparison.baseline) : 0;
+
+    double baselineError = medianError(baseline);
+    double currentError = medianError(current);
+    double noise = noiseFactor * sqrt(baselineError * baselineError + currentError * currentError);
+    double noisePercent = comparison.baseline != 0 ? 100.0 * noise / fabs(comparison.baseline) : 0;
+    comparison.allowed = noisePercent > tolerancePercent ? noisePercent : tolerancePercent;
+    comparison.regressed = comparison.change > comparison.allowed;
+    return comparison;
+}
+
+vector<MetricComparison> RegressionGate::compare(const JsonValue& baseline, const JsonValue& current) const {
+    vector<MetricComparison> comparisons;
+    const JsonValue& baselineCases = baseline.get("cases");
+    const JsonValue& currentCases = current.get("cases");
+
+    // Cases missing from either side are skipped, so --cases=... runs can
+    // still be checked against a full baseline
+    for (const string& name : currentCases.keys()) {
+        if (!baselineCases.has(name)) continue;
+        const JsonValue& before = baselineCases.get(name);
+        const JsonValue& after = currentCases.get(name);
+
+        for (const char* metric : GATED_METRICS) {
+            if (!before.get("metrics").has(metric) || !after.get("metrics").has(metric)) continue;
+            comparisons.push_back(compareMetric(name, metric, before.get("metrics").get(metric),
+                                                after.get("metrics").get(metric)));
+        }
+
+        // Memory is one figure per case, without samples, so only the
+        // tolerance applies
+        if (before.has("peak_kb") && after.has("peak_kb")) {
+            JsonValue beforePeak = JsonValue::object(), afterPeak = JsonValue::object();
+            beforePeak["median"] = before.get("peak_kb").asNumber();
+            afterPeak["median"] = after.get("peak_kb").asNumber();
+            comparisons.push_back(compareMetric(name, "peak_kb", beforePeak, afterPeak));
+        }
+    }
+    return comparisons;
+}
+
+vector<string> RegressionGate::uncheckedCases(const JsonValue& baseline, const JsonValue& current) {
+    vector<string> names;
+    for (const string& name : current.get("cases").keys()) {
+        if (!baseline.get("cases").has(name)) names.push_back(name);
+    }
+    return names;
+}
+
+int RegressionGate::countRegressions(const vector<MetricComparison>& comparisons) {
+    int count = 0;
+    for (const MetricComparison& comparison : comparisons) {
+        if (comparison.regressed) count++;
+    }
+    return count;
+}
+
+void RegressionGate::printReport(ostream& os, const vector<MetricComparison>& comparisons) {
+    os << "=== Regression Check ===" << endl;
+    char line[160];
+    snprintf(line, sizeof(line), "%-13s %-23s %14s %14s %8s %8s  %s", "Case", "Metric", "Baseline", "Current",
+             "Worse by", "Allowed", "Status");
+    os << line << endl;
+    for (const MetricComparison& comparison : comparisons) {
+        snprintf(line, sizeof(line), "%-13s %-23s %14.2f %14.2f %7.1f%% %7.1f%%  %s", comparison.caseName.c_str(),
+                 comparison.metric.c_str(), comparison.baseline, comparison.current, comparison.change,
+                 comparison.allowed, comparison.regressed ? "REGRESSED" : "ok");
+        os << line << endl;
+    }
+
+    int regressions = countRegressions(comparisons);
+    if (regressions == 0) {
+        os << "No regressions (" << comparisons.size() << " metrics checked)" << endl;
+    } else {
+        os << regressions << " of " << comparisons.size() << " metrics regressed" << endl;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef REGRESSIONGATE_H
+#define REGRESSIONGATE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Json.h"
+
+using namespace std;
+
+// One metric of one case, baseline against current run
+struct MetricComparison {
+    string caseName;
+    string metric;
+    double baseline;
+    double current;
+    double change;      // Percent, positive when the metric got worse
+    double allowed;     // Percent of slowdown tolerated for this metric
+    bool regressed;
+};
+
+// Compares two benchmark result files (as written by bench/benchmark).
+//
+// A metric regresses when its median moves in the bad direction by more
+// than the larger of a fixed tolerance and a noise band: noiseFactor times
+// the combined standard error of the two medians, estimated from each
+// run's MAD and sample count. Noisy metrics need a bigger shift to fail.
+class RegressionGate {
+private:
+    double tolerancePercent;
+    double noiseFactor;
+
+    MetricComparison compareMetric(const string& caseName, const string& metric,
+                                   const JsonValue& baseline, const JsonValue& current) const;
+
+public:
+    RegressionGate(double tolerancePercent = 10.0, double noiseFactor = 3.0);
+
+    // Fails (returning false with a reason) when the runs are not comparable
+    bool compatible(const JsonValue& baseline, const JsonValue& current, string& reason) const;
+    vector<MetricComparison> compare(const JsonValue& baseline, const JsonValue& current) const;
+    // Cases of the current run the baseline has no figures for, which
+    // compare() skips; a baseline older than a new case lists it here
+    static vector<string> uncheckedCases(const JsonValue& baseline, const JsonValue& current);
+
+    static int countRegressions(const vector<MetricComparison>& comparisons);
+    static void printReport(ostream& os, const vector<MetricComparison>& comparisons);
+
+    // Metrics where a smaller value is better (times, memory)
+    static bool lowerIsBetter(const string& metric);
+};
+
+#endif
@@ -0,0 +1,1453 @@
+// Throughput benchmarks for the compiler front end.
+//
+// Each case generates a synthetic program and measures, separately:
+//   - the lexer on its own (MB/s and tokens/s), hand-written and DFA,
+//   - the whole pipeline (wall time and tokens/s),
+//   - parser tokens/s and semantic lookups/s from the phase timers,
+//   - the same pipeline and parser figures with the table-driven parser,
+//     head to head with the recursive descent one,
+//   - peak memory of one compilation, measured in fresh processes.
+// Every timing runs after warm-up for a number of repetitions and is
+// summarised by median, MAD, mean, standard deviation and range.
+//
+// With --compare=FILE the run is then checked against a baseline results
+// file (see RegressionGate) and the exit status is 3 if anything regressed.
+//
+// --embedding instead measures compiles per second of a small program
+// through the library API (TinyC::compile), on one thread and on every
+// core at once, against spawning the compiler once per file.
+//
+// --pipeline times each case compiled with the lexer on a thread of its
+// own (PipelinedLexer) against the usual single thread, and reports how
+// often either side of the token queue had to wait.
+//
+// --streaming=SIZE pipes a generated program of SIZE bytes into the
+// compiler's standard input and samples its resident memory as it goes,
+// which should stay flat however much has been streamed.
+//
+// --interface=N compiles a file that shares N functions with others,
+// once with the shared functions written out in the file and once with
+// them imported from a binary module interface (ModuleInterface).
+//
+// --includes=DEPTH preprocesses a file that includes a graph of headers
+// DEPTH layers deep, every header including the whole next layer, with
+// the header cache cold and warm, against the same code pasted into the
+// file.
+//
+// --allocation=CALLS runs the allocations CALLS calls of allocation-heavy
+// programs make for their run-time sized arrays, through the arena
+// runtime (runtime/Arena.h) and through one malloc() and free() per
+// array.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Arena.h"
+#include "Json.h"
+#include "LexicalAnalyzer.h"
+#include "ModuleInterface.h"
+#include "Preprocessor.h"
+#include "ProgramGenerator.h"
+#include "RegressionGate.h"
+#include "Statistics.h"
+#include "SyntaxAnalyzer.h"
+#include "TableParser.h"
+#include "TinyC.h"
+#include "TokenPipeline.h"
+#include "Version.h"
+
+using namespace std;
+
+namespace {
+    typedef chrono::steady_clock Clock;
+
+    struct BenchmarkCase {
+        string name;
+        string description;
+        ProgramShape shape;
+    };
+
+    struct BenchmarkOptions {
+        int repetitions;
+        int warmup;
+        double scale;
+        string output;
+        string label;
+        vector<string> only;
+        bool quiet;
+        string baseline;      // --compare: results to check this run against
+        string results;       // --results: compare these instead of running
+        double tolerance;
+        double noise;
+        bool embedding;
+        bool pipeline;
+        string compiler;      // --embedding, --streaming: binary spawned
+        uint64_t streaming;   // --streaming: bytes to pipe into the compiler
+        int interface;        // --interface: shared functions
+        int includes;         // --includes: layers of headers
+        int allocation;       // --allocation: simulated calls per pattern
+        string memoryChild;   // --memory-child: internal, see measureMemory()
+        bool memoryBaseline;
+
+        BenchmarkOptions()
+            : repetitions(10), warmup(2), scale(1.0), output("bench_results.json"), quiet(false),
+              tolerance(10.0), noise(3.0), embedding(false), pipeline(false), compiler("./compiler"),
+              streaming(0), interface(0), includes(0), allocation(0), memoryBaseline(false) {}
+    };
+
+    struct Summary {
+        double median, mad, mean, stddev, min, max;
+    };
+
+    // Lets the lexer read the generated program in place
+    class MemoryBuffer : public streambuf {
+    public:
+        MemoryBuffer(const string& text) {
+            char* begin = const_cast<char*>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    };
+
+    ostream sink(nullptr);
+
+    vector<BenchmarkCase> defaultCases() {
+        vector<BenchmarkCase> cases;
+        ProgramShape shape;
+
+        shape = ProgramShape();
+        shape.functions = 4000;
+        shape.statementsPerFunction = 6;
+        shape.nestingDepth = 1;
+        shape.expressionLength = 3;
+        cases.push_back({"functions", "many small functions", shape});
+
+        shape = ProgramShape();
+        shape.functions = 200;
+        shape.statementsPerFunction = 4;
+        shape.nestingDepth = 150;
+        shape.expressionLength = 3;
+        shape.arrays = 0;
+        cases.push_back({"nesting", "deeply nested if/while blocks", shape});
+
+        shape = ProgramShape();
+        shape.functions = 50;
+        shape.statementsPerFunction = 20;
+        shape.nestingDepth = 0;
+        shape.expressionLength = 150;
+        shape.declarationWidth = 8;
+        shape.arraySize = 64;
+        cases.push_back({"expressions", "long arithmetic expression chains", shape});
+
+        shape = ProgramShape();
+        shape.functions = 300;
+        shape.statementsPerFunction = 10;
+        shape.nestingDepth = 0;
+        shape.declarationWidth = 400;
+        shape.arrays = 0;
+        cases.push_back({"declarations", "wide declaration lists", shape});
+
+        shape = ProgramShape();
+        shape.functions = 1000;
+        shape.statementsPerFunction = 12;
+        shape.nestingDepth = 1;
+        shape.arrays = 16;
+        shape.arraySize = 100000;
+        cases.push_back({"arrays", "large arrays and indexed accesses", shape});
+
+        shape = ProgramShape();
+        shape.functions = 1000;
+        shape.statementsPerFunction = 2;
+        shape.nestingDepth = 0;
+        shape.arrays = 0;
+        shape.matrices = 2;
+        shape.matrixSize = 64;
+        cases.push_back({"matrices", "matrix multiplications over 2-D arrays", shape});
+
+        shape = ProgramShape();
+        shape.functions = 2000;
+        shape.statementsPerFunction = 12;
+        shape.nestingDepth = 1;
+        shape.arrays = 0;
+        shape.dynamicArrays = 8;
+        cases.push_back({"dynamic", "arrays sized at run time", shape});
+
+        return cases;
+    }
+
+    double secondsSince(Clock::time_point start) {
+        return chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Returns the number of tokens, including the end-of-input token
+    uint64_t lexOnly(const string& source, bool dfa = false) {
+        MemoryBuffer buffer(source);
+        istream stream(&buffer);
+        LexicalAnalyzer lexer(&stream, sink);
+        LexicalAnalyzer::useDfa = dfa;
+        uint64_t tokens = 0;
+        while (true) {
+            Token* token = lexer.getNextToken();
+            bool done = token->getTokenCode() == EOI;
+            delete token;
+            tokens++;
+            if (done) {
+                LexicalAnalyzer::useDfa = false;
+                return tokens;
+            }
+        }
+    }
+
+    bool parse(LexicalAnalyzer& lexer, bool table) {
+        try {
+            if (table) {
+                TableParser parser(&lexer, sink);
+                parser.Program();
+                return !parser.getSemanticAnalyzer()->hasErrors();
+            }
+            SyntaxAnalyzer parser(&lexer, sink);
+            parser.Program();
+            return !parser.getSemanticAnalyzer()->hasErrors();
+        } catch (const SyntaxError&) {
+            return false;
+        }
+    }
+
+    bool compile(const string& source, bool table = false) {
+        MemoryBuffer buffer(source);
+        istream stream(&buffer);
+        LexicalAnalyzer lexer(&stream, sink);
+        return parse(lexer, table);
+    }
+
+    struct QueueFigures {
+        uint64_t batches, producerWaits, consumerWaits;
+    };
+
+    // As compile(), with the lexer a queue ahead on its own thread
+    bool compilePipelined(const string& source, QueueFigures& figures) {
+        MemoryBuffer buffer(source);
+        istream stream(&buffer);
+        PipelinedLexer lexer(&stream, sink);
+        bool succeeded = parse(lexer, false);
+        figures.batches = lexer.getQueue().getBatches();
+        figures.producerWaits = lexer.getQueue().getProducerWaits();
+        figures.consumerWaits = lexer.getQueue().getConsumerWaits();
+        return succeeded;
+    }
+
+    // Compiles with the phase hooks on; the returned statistics are only
+    // valid until the next instrumented compilation
+    const CompileStatistics& instrumentedCompile(const string& source, bool table) {
+        CompileStatistics::enabled = true;
+        CompileStatistics& statistics = CompileStatistics::current();
+        statistics.beginCompile();
+        compile(source, table);
+        statistics.endCompile();
+        CompileStatistics::enabled = false;
+        return statistics;
+    }
+
+    // Reads a "Name:  1234 kB" field of /proc/self/status (or of another
+    // process's status file), or -1
+    long statusKilobytes(const char* field, const string& path = "/proc/self/status") {
+        ifstream status(path);
+        string line;
+        size_t length = strlen(field);
+        while (getline(status, line)) {
+            if (line.compare(0, length, field) == 0) return atol(line.c_str() + length);
+        }
+        return -1;
+    }
+
+    // The --memory-child mode: reads the program at path and, unless
+    // baseline, compiles it, in a process that has done nothing else, then
+    // prints its peak resident set in kilobytes
+    int runMemoryChild(const string& path, bool baseline) {
+        ifstream file(path, ios::in | ios::binary | ios::ate);
+        if (!file.is_open()) return 1;
+        string source(file.tellg(), '\0');
+        file.seekg(0);
+        if (!file.read(&source[0], source.size())) return 1;
+        if (!baseline && !compile(source)) return 1;
+        cout << statusKilobytes("VmHWM:") << endl;
+        return 0;
+    }
+
+    // Peak resident set of this binary run in --memory-child mode on path,
+    // in kilobytes, or -1. The child reports it itself: its ru_maxrss
+    // would include the parent's, which exec() carries over.
+    long childPeakKilobytes(const string& path, bool baseline) {
+        int channel[2];
+        if (pipe(channel) != 0) return -1;
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, channel[1], 1);
+        posix_spawn_file_actions_addclose(&actions, channel[0]);
+        posix_spawn_file_actions_addclose(&actions, channel[1]);
+        string mode = (baseline ? "--memory-child-baseline=" : "--memory-child=") + path;
+        char* arguments[] = {const_cast<char*>("benchmark"), const_cast<char*>(mode.c_str()), nullptr};
+        pid_t child;
+        int error = posix_spawn(&child, "/proc/self/exe", &actions, nullptr, arguments, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(channel[1]);
+        if (error != 0) {
+            close(channel[0]);
+            return -1;
+        }
+
+        string reply;
+        char buffer[64];
+        ssize_t received;
+        while ((received = read(channel[0], buffer, sizeof(buffer))) > 0) reply.append(buffer, received);
+        close(channel[0]);
+        int status;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || reply.empty()) return -1;
+        return atol(reply.c_str());
+    }
+
+    // Memory one compilation adds to a process at its peak, in kilobytes:
+    // the peak of a fresh process that reads the program and compiles it,
+    // less that of one that only reads it, the median of a few such pairs.
+    // A forked child would not do, as the compiler would reuse heap pages
+    // the parent's earlier runs left resident instead of growing.
+    bool measureMemory(const string& source, long& peakKilobytes) {
+        const int PAIRS = 5;
+        char path[] = "/tmp/tinyc-memory-XXXXXX.c";
+        int fd = mkstemps(path, 2);
+        if (fd < 0) return false;
+        bool written = write(fd, source.data(), source.size()) == (ssize_t)source.size();
+        close(fd);
+
+        vector<long> growth;
+        for (int i = 0; written && i < PAIRS; i++) {
+            long baseline = childPeakKilobytes(path, true);
+            long compiled = baseline >= 0 ? childPeakKilobytes(path, false) : -1;
+            if (compiled < 0) break;
+            growth.push_back(max(0L, compiled - baseline));
+        }
+        unlink(path);
+        if ((int)growth.size() < PAIRS) return false;
+        sort(growth.begin(), growth.end());
+        peakKilobytes = growth[PAIRS / 2];
+        return true;
+    }
+
+    Summary summarize(vector<double> samples) {
+        Summary summary = {0, 0, 0, 0, 0, 0};
+        if (samples.empty()) return summary;
+
+        sort(samples.begin(), samples.end());
+        size_t n = samples.size();
+        auto median = [](const vector<double>& sorted) {
+            size_t size = sorted.size();
+            return size % 2 ? sorted[size / 2] : (sorted[size / 2 - 1] + sorted[size / 2]) / 2;
+        };
+
+        summary.median = median(samples);
+        summary.min = samples.front();
+        summary.max = samples.back();
+        double sum = 0;
+        for (double sample : samples) sum += sample;
+        summary.mean = sum / n;
+        double squares = 0;
+        for (double sample : samples) squares += (sample - summary.mean) * (sample - summary.mean);
+        summary.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+
+        vector<double> deviations;
+        for (double sample : samples) deviations.push_back(fabs(sample - summary.median));
+        sort(deviations.begin(), deviations.end());
+        summary.mad = median(deviations);
+        return summary;
+    }
+
+    JsonValue toJson(const Summary& summary, const vector<double>& samples) {
+        JsonValue value = JsonValue::object();
+        value["median"] = summary.median;
+        value["mad"] = summary.mad;
+        value["mean"] = summary.mean;
+        value["stddev"] = summary.stddev;
+        value["min"] = summary.min;
+        value["max"] = summary.max;
+        JsonValue raw = JsonValue::array();
+        for (double sample : samples) raw.push(sample);
+        value["samples"] = raw;
+        return value;
+    }
+
+    JsonValue runCase(const BenchmarkCase& benchmark, const BenchmarkOptions& options) {
+        ProgramShape shape = benchmark.shape;
+        shape.functions = max(1, (int)lround(shape.functions * options.scale));
+        string source = ProgramGenerator(shape).generate();
+        double megabytes = source.size() / 1e6;
+
+        JsonValue result = JsonValue::object();
+        result["description"] = benchmark.description;
+        result["bytes"] = (long long)source.size();
+        result["lines"] = (long long)count(source.begin(), source.end(), '\n');
+        result["functions"] = shape.functions;
+
+        if (!compile(source) || !compile(source, true)) {
+            result["error"] = "generated program did not compile cleanly";
+            return result;
+        }
+
+        long peak = 0;
+        if (measureMemory(source, peak)) {
+            result["peak_kb"] = (long long)peak;
+        }
+
+        vector<double> lexerMegabytes, lexerTokens, pipelineMilliseconds, pipelineTokens;
+        vector<double> parserTokens, semanticLookups;
+        vector<double> dfaLexerMegabytes, dfaLexerTokens;
+        vector<double> tablePipelineMilliseconds, tablePipelineTokens, tableParserTokens;
+        uint64_t tokens = 0, lookups = 0;
+
+        for (int run = 0; run < options.warmup + options.repetitions; run++) {
+            bool measured = run >= options.warmup;
+
+            Clock::time_point start = Clock::now();
+            tokens = lexOnly(source);
+            double lexSeconds = secondsSince(start);
+
+            start = Clock::now();
+            lexOnly(source, true);
+            double dfaLexSeconds = secondsSince(start);
+
+            start = Clock::now();
+            compile(source);
+            double compileSeconds = secondsSince(start);
+
+            start = Clock::now();
+            compile(source, true);
+            double tableCompileSeconds = secondsSince(start);
+
+            // Separate instrumented runs, so the clock reads in the phase
+            // hooks do not slow the end-to-end figures above
+            double tableParserSeconds = instrumentedCompile(source, true).phaseNanos[(int)Phase::PARSER] / 1e9;
+            const CompileStatistics& statistics = instrumentedCompile(source, false);
+
+            double parserSeconds = statistics.phaseNanos[(int)Phase::PARSER] / 1e9;
+            double semanticSeconds = (statistics.phaseNanos[(int)Phase::SEMANTIC] +
+                                      statistics.phaseNanos[(int)Phase::SYMBOL_TABLE]) / 1e9;
+            lookups = statistics.counters[(int)Counter::SYMBOL_LOOKUPS];
+
+            if (!measured) continue;
+            lexerMegabytes.push_back(megabytes / lexSeconds);
+            lexerTokens.push_back(tokens / lexSeconds);
+            dfaLexerMegabytes.push_back(megabytes / dfaLexSeconds);
+            dfaLexerTokens.push_back(tokens / dfaLexSeconds);
+            pipelineMilliseconds.push_back(compileSeconds * 1e3);
+            pipelineTokens.push_back(tokens / compileSeconds);
+            parserTokens.push_back(parserSeconds > 0 ? tokens / parserSeconds : 0);
+            semanticLookups.push_back(semanticSeconds > 0 ? lookups / semanticSeconds : 0);
+            tablePipelineMilliseconds.push_back(tableCompileSeconds * 1e3);
+            tablePipelineTokens.push_back(tokens / tableCompileSeconds);
+            tableParserTokens.push_back(tableParserSeconds > 0 ? tokens / tableParserSeconds : 0);
+        }
+
+        result["tokens"] = (long long)tokens;
+        result["symbol_lookups"] = (long long)lookups;
+
+        JsonValue metrics = JsonValue::object();
+        metrics["lexer_mb_per_s"] = toJson(summarize(lexerMegabytes), lexerMegabytes);
+        metrics["lexer_tokens_per_s"] = toJson(summarize(lexerTokens), lexerTokens);
+        metrics["dfa_lexer_mb_per_s"] = toJson(summarize(dfaLexerMegabytes), dfaLexerMegabytes);
+        metrics["dfa_lexer_tokens_per_s"] = toJson(summarize(dfaLexerTokens), dfaLexerTokens);
+        metrics["parser_tokens_per_s"] = toJson(summarize(parserTokens), parserTokens);
+        metrics["semantic_lookups_per_s"] = toJson(summarize(semanticLookups), semanticLookups);
+        metrics["pipeline_ms"] = toJson(summarize(pipelineMilliseconds), pipelineMilliseconds);
+        metrics["pipeline_tokens_per_s"] = toJson(summarize(pipelineTokens), pipelineTokens);
+        metrics["table_parser_tokens_per_s"] = toJson(summarize(tableParserTokens), tableParserTokens);
+        metrics["table_pipeline_ms"] = toJson(summarize(tablePipelineMilliseconds), tablePipelineMilliseconds);
+        metrics["table_pipeline_tokens_per_s"] = toJson(summarize(tablePipelineTokens), tablePipelineTokens);
+        result["metrics"] = metrics;
+        return result;
+    }
+
+    void printCase(const string& name, const JsonValue& result) {
+        const JsonValue& metrics = result.get("metrics");
+        if (result.has("error")) {
+            printf("%-13s ERROR: %s\n", name.c_str(), result.get("error").asString().c_str());
+            return;
+        }
+        auto median = [&](const char* metric) { return metrics.get(metric).get("median").asNumber(); };
+        auto mad = [&](const char* metric) { return metrics.get(metric).get("mad").asNumber(); };
+        printf("%-13s %8.2f %6.1f%% %8.2f %11.0f %11.0f %11.0f %10.2f %6.1f%% %9.2f %9lld\n", name.c_str(),
+               median("lexer_mb_per_s"),
+               median("lexer_mb_per_s") > 0 ? 100 * mad("lexer_mb_per_s") / median("lexer_mb_per_s") : 0.0,
+               median("dfa_lexer_mb_per_s"),
+               median("parser_tokens_per_s") / 1e3, median("table_parser_tokens_per_s") / 1e3,
+               median("semantic_lookups_per_s") / 1e3, median("pipeline_ms"),
+               median("pipeline_ms") > 0 ? 100 * mad("pipeline_ms") / median("pipeline_ms") : 0.0,
+               median("table_pipeline_ms"), result.has("peak_kb") ? result.get("peak_kb").asInteger() : -1LL);
+    }
+
+    void printUsage(const char* program) {
+        cout << "Usage: " << program << " [options]" << endl;
+        cout << "  --repetitions=N   Timed runs per case (default 10)" << endl;
+        cout << "  --warmup=N        Untimed runs before measuring (default 2)" << endl;
+        cout << "  --scale=F         Multiply the number of generated functions by F" << endl;
+        cout << "  --cases=a,b       Run only the named cases" << endl;
+        cout << "  --output=FILE     Write results as JSON (default bench_results.json)" << endl;
+        cout << "  --label=TEXT      Free-form label stored with the results (e.g. a commit)" << endl;
+        cout << "  --quiet           Do not print the summary table" << endl;
+        cout << "  --compare=FILE    Check the results against a baseline; exit 3 on regression" << endl;
+        cout << "  --results=FILE    With --compare, check an earlier results file instead of running" << endl;
+        cout << "  --tolerance=PCT   Slowdown always tolerated, in percent (default 10)" << endl;
+        cout << "  --noise=K         Also tolerate K times the combined MAD-based spread (default 3)" << endl;
+        cout << "  --embedding       Compare in-process compiles/s with spawning the compiler" << endl;
+        cout << "  --pipeline        Compare each case compiled with a pipelined lexer against one thread"
+             << endl;
+        cout << "  --streaming=SIZE  Pipe SIZE bytes (K/M/G suffixes) into the compiler and sample its memory" << endl;
+        cout << "  --interface=N     Compare N shared functions written in the file with importing them" << endl;
+        cout << "  --includes=DEPTH  Preprocess a graph of headers DEPTH layers deep, header cache cold and warm"
+             << endl;
+        cout << "  --allocation=N    Compare the arena runtime with malloc() over N calls of allocation-heavy programs"
+             << endl;
+        cout << "  --compiler=PATH   Compiler binary spawned by --embedding and --streaming (default ./compiler)"
+             << endl;
+        cout << "Cases:";
+        for (const BenchmarkCase& benchmark : defaultCases()) cout << " " << benchmark.name;
+        cout << endl;
+    }
+
+    bool parseArguments(int argc, char* argv[], BenchmarkOptions& options) {
+        for (int i = 1; i < argc; i++) {
+            string argument = argv[i];
+            if (argument.compare(0, 14, "--repetitions=") == 0) {
+                options.repetitions = atoi(argument.c_str() + 14);
+            } else if (argument.compare(0, 9, "--warmup=") == 0) {
+                options.warmup = atoi(argument.c_str() + 9);
+            } else if (argument.compare(0, 8, "--scale=") == 0) {
+                options.scale = atof(argument.c_str() + 8);
+            } else if (argument.compare(0, 9, "--output=") == 0) {
+                options.output = argument.substr(9);
+            } else if (argument.compare(0, 8, "--label=") == 0) {
+                options.label = argument.substr(8);
+            } else if (argument.compare(0, 8, "--cases=") == 0) {
+                string list = argument.substr(8);
+                size_t begin = 0;
+                while (begin <= list.size()) {
+                    size_t comma = list.find(',', begin);
+                    if (comma == string::npos) comma = list.size();
+                    if (comma > begin) options.only.push_back(list.substr(begin, comma - begin));
+                    begin = comma + 1;
+                }
+            } else if (argument.compare(0, 10, "--compare=") == 0) {
+                options.baseline = argument.substr(10);
+            } else if (argument.compare(0, 10, "--results=") == 0) {
+                options.results = argument.substr(10);
+            } else if (argument.compare(0, 12, "--tolerance=") == 0) {
+                options.tolerance = atof(argument.c_str() + 12);
+            } else if (argument.compare(0, 8, "--noise=") == 0) {
+                options.noise = atof(argument.c_str() + 8);
+            } else if (argument == "--quiet") {
+                options.quiet = true;
+            } else if (argument == "--embedding") {
+                options.embedding = true;
+            } else if (argument == "--pipeline") {
+                options.pipeline = true;
+            } else if (argument.compare(0, 12, "--interface=") == 0) {
+                options.interface = atoi(argument.c_str() + 12);
+                if (options.interface <= 0) return false;
+            } else if (argument.compare(0, 11, "--includes=") == 0) {
+                options.includes = atoi(argument.c_str() + 11);
+                if (options.includes <= 0) return false;
+            } else if (argument.compare(0, 13, "--allocation=") == 0) {
+                options.allocation = atoi(argument.c_str() + 13);
+                if (options.allocation <= 0) return false;
+            } else if (argument.compare(0, 15, "--memory-child=") == 0) {
+                options.memoryChild = argument.substr(15);
+            } else if (argument.compare(0, 24, "--memory-child-baseline=") == 0) {
+                options.memoryChild = argument.substr(24);
+                options.memoryBaseline = true;
+            } else if (argument.compare(0, 11, "--compiler=") == 0) {
+                options.compiler = argument.substr(11);
+            } else if (argument.compare(0, 12, "--streaming=") == 0) {
+                char* end = nullptr;
+                options.streaming = strtoull(argument.c_str() + 12, &end, 10);
+                if (*end == 'K' || *end == 'k') options.streaming <<= 10;
+                else if (*end == 'M' || *end == 'm') options.streaming <<= 20;
+                else if (*end == 'G' || *end == 'g') options.streaming <<= 30;
+                else if (*end != '\0') return false;
+                if (options.streaming == 0) return false;
+            } else {
+                return false;
+            }
+        }
+        if (!options.results.empty() && options.baseline.empty()) return false;
+        return options.repetitions > 0 && options.warmup >= 0 && options.scale > 0 && options.tolerance >= 0 &&
+               options.noise >= 0;
+    }
+
+    bool readResults(const string& path, JsonValue& value) {
+        ifstream file(path, ios::in | ios::binary);
+        if (!file.is_open()) {
+            cerr << "ERROR - cannot read " << path << endl;
+            return false;
+        }
+        string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        if (!JsonValue::parse(text, value)) {
+            cerr << "ERROR - " << path << " is not valid JSON" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Runs the compiler binary on path with its output discarded; returns
+    // false if it could not be started
+    bool spawnCompiler(const string& compiler, const string& path) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+        char* arguments[] = {const_cast<char*>(compiler.c_str()), const_cast<char*>(path.c_str()), nullptr};
+        pid_t child;
+        int error = posix_spawn(&child, compiler.c_str(), &actions, nullptr, arguments, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (error != 0) return false;
+        int status;
+        waitpid(child, &status, 0);
+        return WIFEXITED(status);
+    }
+
+    // Compiles batch copies of source on each of threads threads at once,
+    // every other one with the alternative options when given, and checks
+    // every result against expected. Returns false on any difference.
+    bool compileConcurrently(const string& source, int threads, int batch, const TinyC::CompileResult& expected,
+                             const TinyC::CompileOptions* alternative) {
+        vector<int> mismatches(threads, 0);
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (int i = 0; i < batch; i++) {
+                    bool alternate = alternative && (i + t) % 2;
+                    TinyC::CompileResult result =
+                        TinyC::compile(source, alternate ? *alternative : TinyC::CompileOptions());
+                    if (result.status != expected.status || result.output != expected.output) mismatches[t]++;
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+        for (int count : mismatches) {
+            if (count > 0) return false;
+        }
+        return true;
+    }
+
+    // Compiles per second of a small program: through TinyC::compile() on
+    // this thread, on every core at once, and by spawning the compiler
+    // binary. Beforehand, threads compiling with different parser and lexer
+    // engines at the same time must all produce the serial output.
+    JsonValue runEmbedding(const BenchmarkOptions& options, bool& failed) {
+        ProgramShape shape;
+        shape.functions = max(1, (int)lround(20 * options.scale));
+        string source = ProgramGenerator(shape).generate();
+        const int batch = 200;
+        const int spawnBatch = 20;
+        int threads = max(1u, thread::hardware_concurrency());
+
+        JsonValue report = JsonValue::object();
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        report["bytes"] = (long long)source.size();
+        report["threads"] = threads;
+        failed = false;
+
+        TinyC::CompileResult expected = TinyC::compile(source);
+        if (!expected.succeeded()) {
+            report["error"] = "generated program did not compile cleanly";
+            failed = true;
+            return report;
+        }
+        TinyC::CompileOptions alternative;
+        alternative.tableParser = true;
+        alternative.dfaLexer = true;
+        bool mismatch = !compileConcurrently(source, max(threads, 4), batch / 4, expected, &alternative);
+
+        char path[] = "/tmp/tinyc-embedding-XXXXXX.c";
+        int fd = mkstemps(path, 2);
+        bool canSpawn = fd >= 0 && write(fd, source.data(), source.size()) == (ssize_t)source.size();
+        if (fd >= 0) close(fd);
+        canSpawn = canSpawn && access(options.compiler.c_str(), X_OK) == 0;
+
+        vector<double> inProcess, parallel, spawned;
+        for (int run = 0; run < options.warmup + options.repetitions; run++) {
+            bool measured = run >= options.warmup;
+
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < batch; i++) TinyC::compile(source);
+            double serialSeconds = secondsSince(start);
+
+            start = Clock::now();
+            mismatch = !compileConcurrently(source, threads, batch, expected, nullptr) || mismatch;
+            double parallelSeconds = secondsSince(start);
+
+            double spawnSeconds = 0;
+            if (canSpawn) {
+                start = Clock::now();
+                for (int i = 0; i < spawnBatch && canSpawn; i++) canSpawn = spawnCompiler(options.compiler, path);
+                spawnSeconds = secondsSince(start);
+            }
+
+            if (!measured) continue;
+            inProcess.push_back(batch / serialSeconds);
+            parallel.push_back((double)batch * threads / parallelSeconds);
+            if (canSpawn) spawned.push_back(spawnBatch / spawnSeconds);
+        }
+        unlink(path);
+
+        if (mismatch) {
+            report["error"] = "concurrent compilations produced different output";
+            failed = true;
+        }
+        JsonValue metrics = JsonValue::object();
+        metrics["in_process_compiles_per_s"] = toJson(summarize(inProcess), inProcess);
+        metrics["parallel_compiles_per_s"] = toJson(summarize(parallel), parallel);
+        if (canSpawn) metrics["spawn_compiles_per_s"] = toJson(summarize(spawned), spawned);
+        report["metrics"] = metrics;
+
+        if (!options.quiet) {
+            printf("Program: %d functions, %zu bytes; %d threads\n", shape.functions, source.size(), threads);
+            printf("%-24s %12s %7s\n", "Mode", "Compiles/s", "MAD");
+            auto row = [](const char* mode, const vector<double>& samples) {
+                Summary summary = summarize(samples);
+                printf("%-24s %12.0f %6.1f%%\n", mode, summary.median,
+                       summary.median > 0 ? 100 * summary.mad / summary.median : 0.0);
+            };
+            row("in-process", inProcess);
+            row("in-process, all cores", parallel);
+            if (canSpawn) {
+                row("process spawn", spawned);
+            } else {
+                printf("%-24s cannot run %s\n", "process spawn", options.compiler.c_str());
+            }
+            if (mismatch) printf("ERROR: concurrent compilations produced different output\n");
+        }
+        return report;
+    }
+
+    // Writes all of text to fd; false once the reader has gone away
+    bool writeAll(int fd, const string& text) {
+        size_t done = 0;
+        while (done < text.size()) {
+            ssize_t written = write(fd, text.data() + done, text.size() - done);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+            done += written;
+        }
+        return true;
+    }
+
+    // Memory the compiler may keep per streamed function: its entry in
+    // the function table. A local name kept past its function would add
+    // about 40 bytes for each of the 35 in every streamed function.
+    const double MAX_STREAMED_BYTES_PER_FUNCTION = 1024;
+
+    // Streams a program of options.streaming bytes into the compiler's
+    // standard input through a pipe, as a code generator would, and reads
+    // the compiler's resident memory after every tenth of it. Functions
+    // are large so the part of memory that does grow with the input, one
+    // symbol table entry per function, stays small next to the rest. No
+    // two functions share a local name, and the run fails if memory grew
+    // by more than MAX_STREAMED_BYTES_PER_FUNCTION per function between
+    // the first sample and the last.
+    JsonValue runStreaming(const BenchmarkOptions& options, bool& failed) {
+        ProgramShape shape;
+        shape.statementsPerFunction = 4000;
+        shape.nestingDepth = 1;
+        shape.expressionLength = 6;
+        shape.declarationWidth = 32;
+        shape.arrays = 2;
+        shape.arraySize = 1000;
+        shape.distinctLocals = true;
+        ProgramGenerator generator(shape);
+
+        JsonValue report = JsonValue::object();
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        failed = true;
+
+        int channel[2];
+        if (pipe(channel) != 0) {
+            report["error"] = "cannot create a pipe";
+            return report;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, channel[0], 0);
+        posix_spawn_file_actions_addclose(&actions, channel[0]);
+        posix_spawn_file_actions_addclose(&actions, channel[1]);
+        posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+        // The DFA lexer gets through gigabytes six times sooner than the
+        // hand-written one; memory does not depend on the choice
+        char* arguments[] = {const_cast<char*>(options.compiler.c_str()), const_cast<char*>("--lexer=dfa"),
+                             const_cast<char*>("-"), nullptr};
+        pid_t child;
+        int error = posix_spawn(&child, options.compiler.c_str(), &actions, nullptr, arguments, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(channel[0]);
+        if (error != 0) {
+            close(channel[1]);
+            report["error"] = "cannot run " + options.compiler;
+            return report;
+        }
+
+        // A compiler that stops reading early shows up as a failed write
+        signal(SIGPIPE, SIG_IGN);
+        string status = "/proc/" + to_string(child) + "/status";
+        vector<double> streamedMegabytes, residentMegabytes;
+        vector<int> sampledFunctions;
+        uint64_t streamed = 0;
+        uint64_t nextSample = options.streaming / 10;
+        int functions = 0;
+        bool delivered = true;
+        string text;
+        Clock::time_point start = Clock::now();
+        while (streamed < options.streaming && delivered) {
+            text.clear();
+            generator.appendFunction(text, functions++);
+            delivered = writeAll(channel[1], text);
+            streamed += text.size();
+            if (streamed >= nextSample) {
+                streamedMegabytes.push_back(streamed / 1e6);
+                residentMegabytes.push_back(statusKilobytes("VmRSS:", status) / 1e3);
+                sampledFunctions.push_back(functions);
+                nextSample += options.streaming / 10;
+            }
+        }
+        delivered = delivered && writeAll(channel[1], ProgramGenerator::mainFunction());
+        close(channel[1]);
+
+        int exitStatus = 0;
+        rusage usage;
+        wait4(child, &exitStatus, 0, &usage);
+        double seconds = secondsSince(start);
+        bool succeeded = delivered && WIFEXITED(exitStatus) && WEXITSTATUS(exitStatus) == 0;
+
+        report["bytes"] = (long long)streamed;
+        report["functions"] = functions + 1;
+        JsonValue samples = JsonValue::array();
+        for (size_t i = 0; i < streamedMegabytes.size(); i++) {
+            JsonValue sample = JsonValue::object();
+            sample["streamed_mb"] = streamedMegabytes[i];
+            sample["rss_mb"] = residentMegabytes[i];
+            samples.push(sample);
+        }
+        report["rss_samples"] = samples;
+        JsonValue metrics = JsonValue::object();
+        metrics["peak_rss_mb"] = usage.ru_maxrss / 1e3;
+        metrics["mb_per_s"] = streamed / 1e6 / seconds;
+        double bytesPerFunction = 0;
+        if (sampledFunctions.size() > 1 && sampledFunctions.back() > sampledFunctions.front()) {
+            bytesPerFunction = (residentMegabytes.back() - residentMegabytes.front()) * 1e6 /
+                               (sampledFunctions.back() - sampledFunctions.front());
+            metrics["rss_bytes_per_function"] = bytesPerFunction;
+        }
+        report["metrics"] = metrics;
+        bool bounded = bytesPerFunction <= MAX_STREAMED_BYTES_PER_FUNCTION;
+        if (!succeeded) {
+            report["error"] = "the compiler did not compile the streamed program cleanly";
+        } else if (!bounded) {
+            report["error"] = "resident memory grew by more than " + to_string((int)MAX_STREAMED_BYTES_PER_FUNCTION) +
+                              " bytes per streamed function";
+        }
+        failed = !succeeded || !bounded;
+
+        if (!options.quiet) {
+            printf("Streamed %.1f MB (%d functions) into %s - in %.1f s, %.1f MB/s\n", streamed / 1e6,
+                   functions + 1, options.compiler.c_str(), seconds, streamed / 1e6 / seconds);
+            printf("%12s %10s\n", "Streamed MB", "RSS MB");
+            for (size_t i = 0; i < streamedMegabytes.size(); i++) {
+                printf("%12.0f %10.1f\n", streamedMegabytes[i], residentMegabytes[i]);
+            }
+            printf("Peak RSS: %.1f MB, growing %.0f bytes per function\n", usage.ru_maxrss / 1e3,
+                   bytesPerFunction);
+            if (!succeeded) {
+                printf("ERROR: the compiler did not compile the streamed program cleanly\n");
+            } else if (!bounded) {
+                printf("ERROR: resident memory grew by more than %.0f bytes per streamed function\n",
+                       MAX_STREAMED_BYTES_PER_FUNCTION);
+            }
+        }
+        return report;
+    }
+
+    // End-to-end time of every case on one thread and pipelined, with the
+    // queue's contention averaged over the pipelined runs
+    JsonValue runPipeline(const BenchmarkOptions& options, bool& failed) {
+        JsonValue report = JsonValue::object();
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        report["threads"] = (int)thread::hardware_concurrency();
+        report["repetitions"] = options.repetitions;
+        report["scale"] = options.scale;
+
+        if (!options.quiet) {
+            printf("%-13s %10s %12s %8s %9s %12s %12s\n", "Case", "Serial ms", "Pipelined ms", "Speedup",
+                   "Batches", "Lexer waits", "Parser waits");
+        }
+
+        JsonValue results = JsonValue::object();
+        failed = false;
+        for (const BenchmarkCase& benchmark : defaultCases()) {
+            if (!options.only.empty() &&
+                find(options.only.begin(), options.only.end(), benchmark.name) == options.only.end()) {
+                continue;
+            }
+            ProgramShape shape = benchmark.shape;
+            shape.functions = max(1, (int)lround(shape.functions * options.scale));
+            string source = ProgramGenerator(shape).generate();
+
+            JsonValue result = JsonValue::object();
+            result["bytes"] = (long long)source.size();
+            QueueFigures figures = {0, 0, 0};
+            if (!compile(source) || !compilePipelined(source, figures)) {
+                result["error"] = "generated program did not compile cleanly";
+                failed = true;
+                results[benchmark.name] = result;
+                continue;
+            }
+
+            vector<double> serial, pipelined;
+            QueueFigures total = {0, 0, 0};
+            for (int run = 0; run < options.warmup + options.repetitions; run++) {
+                Clock::time_point start = Clock::now();
+                compile(source);
+                double serialSeconds = secondsSince(start);
+
+                start = Clock::now();
+                compilePipelined(source, figures);
+                double pipelinedSeconds = secondsSince(start);
+
+                if (run < options.warmup) continue;
+                serial.push_back(serialSeconds * 1e3);
+                pipelined.push_back(pipelinedSeconds * 1e3);
+                total.batches += figures.batches;
+                total.producerWaits += figures.producerWaits;
+                total.consumerWaits += figures.consumerWaits;
+            }
+
+            Summary serialSummary = summarize(serial);
+            Summary pipelinedSummary = summarize(pipelined);
+            double speedup = pipelinedSummary.median > 0 ? serialSummary.median / pipelinedSummary.median : 0;
+            double runs = options.repetitions;
+            JsonValue metrics = JsonValue::object();
+            metrics["serial_ms"] = toJson(serialSummary, serial);
+            metrics["pipelined_ms"] = toJson(pipelinedSummary, pipelined);
+            result["metrics"] = metrics;
+            result["speedup"] = speedup;
+            result["queue_batches"] = total.batches / runs;
+            result["queue_producer_waits"] = total.producerWaits / runs;
+            result["queue_consumer_waits"] = total.consumerWaits / runs;
+            results[benchmark.name] = result;
+
+            if (!options.quiet) {
+                printf("%-13s %10.2f %12.2f %7.2fx %9.0f %12.1f %12.1f\n", benchmark.name.c_str(),
+                       serialSummary.median, pipelinedSummary.median, speedup, total.batches / runs,
+                       total.producerWaits / runs, total.consumerWaits / runs);
+                fflush(stdout);
+            }
+        }
+        report["cases"] = results;
+        return report;
+    }
+
+    // A file of 100 functions of its own, compiled with options.interface
+    // shared functions either written in front of it or imported. The
+    // imported time includes mapping the interface.
+    JsonValue runInterface(const BenchmarkOptions& options, bool& failed) {
+        const int ownFunctions = 100;
+        JsonValue report = JsonValue::object();
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        report["repetitions"] = options.repetitions;
+        report["shared_functions"] = options.interface;
+        report["own_functions"] = ownFunctions;
+        failed = false;
+
+        ProgramShape shape;
+        ProgramGenerator generator(shape);
+        string shared, own;
+        for (int i = 0; i < options.interface; i++) generator.appendFunction(shared, i);
+        for (int i = 0; i < ownFunctions; i++) generator.appendFunction(own, options.interface + i);
+        own += ProgramGenerator::mainFunction();
+        string textual = shared + own;
+
+        char path[] = "/tmp/tinyc-interface-XXXXXX.tci";
+        int fd = mkstemps(path, 4);
+        if (fd >= 0) close(fd);
+        string error;
+        TinyC::CompileResult sharedResult = TinyC::compile(shared);
+        if (fd < 0 || !sharedResult.succeeded() || !ModuleInterface::write(path, sharedResult.globals, error)) {
+            report["error"] = "cannot write the shared interface " + error;
+            failed = true;
+            if (fd >= 0) unlink(path);
+            return report;
+        }
+        struct stat status;
+        long long interfaceBytes = stat(path, &status) == 0 ? (long long)status.st_size : 0;
+
+        vector<double> textualTimes, importedTimes, openTimes;
+        for (int run = 0; run < options.warmup + options.repetitions && !failed; run++) {
+            Clock::time_point start = Clock::now();
+            bool textualOk = TinyC::compile(textual).succeeded();
+            double textualSeconds = secondsSince(start);
+
+            start = Clock::now();
+            TinyC::CompileOptions importing;
+            shared_ptr<const ModuleInterface> module = ModuleInterface::open(path, error);
+            double openSeconds = secondsSince(start);
+            if (module) importing.imports.push_back(module);
+            bool importedOk = module && TinyC::compile(own, importing).succeeded();
+            double importedSeconds = secondsSince(start);
+
+            failed = !textualOk || !importedOk;
+            if (run < options.warmup) continue;
+            textualTimes.push_back(textualSeconds * 1e3);
+            importedTimes.push_back(importedSeconds * 1e3);
+            openTimes.push_back(openSeconds * 1e3);
+        }
+        unlink(path);
+        if (failed) {
+            report["error"] = "generated program did not compile cleanly " + error;
+            return report;
+        }
+
+        Summary textualSummary = summarize(textualTimes);
+        Summary importedSummary = summarize(importedTimes);
+        double speedup = importedSummary.median > 0 ? textualSummary.median / importedSummary.median : 0;
+        JsonValue metrics = JsonValue::object();
+        metrics["textual_ms"] = toJson(textualSummary, textualTimes);
+        metrics["imported_ms"] = toJson(importedSummary, importedTimes);
+        metrics["open_ms"] = toJson(summarize(openTimes), openTimes);
+        report["metrics"] = metrics;
+        report["speedup"] = speedup;
+        report["interface_bytes"] = interfaceBytes;
+        report["textual_bytes"] = (long long)shared.size();
+
+        if (!options.quiet) {
+            printf("Shared: %d functions, %zu bytes of source, %lld bytes of interface\n", options.interface,
+                   shared.size(), interfaceBytes);
+            printf("%-22s %10s %7s\n", "Mode", "Median ms", "MAD");
+            auto row = [](const char* mode, const vector<double>& samples) {
+                Summary summary = summarize(samples);
+                printf("%-22s %10.3f %6.1f%%\n", mode, summary.median,
+                       summary.median > 0 ? 100 * summary.mad / summary.median : 0.0);
+            };
+            row("declared in the file", textualTimes);
+            row("imported", importedTimes);
+            row("  of which mapping", openTimes);
+            printf("Speedup: %.1fx\n", speedup);
+        }
+        return report;
+    }
+
+    // Layer d of the graph has four headers; each defines a macro and a
+    // few functions and includes all four of layer d + 1, so every header
+    // below the first layer is reached four times and skipped three by its
+    // guard. Half the headers use #pragma once, half #ifndef guards.
+    JsonValue runIncludes(const BenchmarkOptions& options, bool& failed) {
+        const int width = 4;
+        const int functionsPerHeader = 5;
+        JsonValue report = JsonValue::object();
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        report["repetitions"] = options.repetitions;
+        report["depth"] = options.includes;
+        report["headers"] = options.includes * width;
+        failed = false;
+
+        char directory[] = "/tmp/tinyc-includes-XXXXXX";
+        if (!mkdtemp(directory)) {
+            report["error"] = string("cannot create a temporary directory: ") + strerror(errno);
+            failed = true;
+            return report;
+        }
+        auto headerName = [](int layer, int index) {
+            return "layer" + to_string(layer) + "_" + to_string(index) + ".h";
+        };
+
+        ProgramShape shape;
+        ProgramGenerator generator(shape);
+        string textual;
+        vector<string> files;
+        int function = 0;
+        for (int layer = 0; layer < options.includes && !failed; layer++) {
+            for (int index = 0; index < width; index++) {
+                // Tiny C identifiers have no underscores
+                string suffix = "L" + to_string(layer) + "I" + to_string(index);
+                string guard = "LAYER" + suffix + "H";
+                string macro = "WEIGHT" + suffix;
+                string code = "int weight" + suffix + "() {\n    return " + macro + ";\n}\n";
+                for (int i = 0; i < functionsPerHeader; i++) generator.appendFunction(code, function++);
+
+                bool once = index % 2 == 0;
+                string text = once ? "#pragma once\n" : "#ifndef " + guard + "\n#define " + guard + "\n";
+                text += "#define " + macro + " " + to_string(layer * width + index) + "\n";
+                for (int next = 0; layer + 1 < options.includes && next < width; next++) {
+                    text += "#include \"" + headerName(layer + 1, next) + "\"\n";
+                }
+                text += code;
+                if (!once) text += "#endif\n";
+
+                string textualCode = code;
+                size_t at = textualCode.find(macro);
+                textualCode.replace(at, macro.size(), to_string(layer * width + index));
+                textual += textualCode;
+
+                string path = string(directory) + "/" + headerName(layer, index);
+                ofstream file(path, ios::out | ios::trunc);
+                file << text;
+                files.push_back(path);
+                failed = !file.good();
+            }
+        }
+        string source;
+        for (int index = 0; index < width; index++) source += "#include \"" + headerName(0, index) + "\"\n";
+        source += ProgramGenerator::mainFunction();
+        textual += ProgramGenerator::mainFunction();
+
+        TinyC::CompileOptions preprocessing;
+        preprocessing.preprocess = true;
+        preprocessing.includePaths.push_back(directory);
+
+        vector<double> coldTimes, warmTimes, textualTimes;
+        for (int run = 0; run < options.warmup + options.repetitions && !failed; run++) {
+            HeaderCache::instance().clear();
+            Clock::time_point start = Clock::now();
+            bool coldOk = TinyC::compile(source, preprocessing).succeeded();
+            double coldSeconds = secondsSince(start);
+
+            start = Clock::now();
+            bool warmOk = TinyC::compile(source, preprocessing).succeeded();
+            double warmSeconds = secondsSince(start);
+
+            start = Clock::now();
+            bool textualOk = TinyC::compile(textual).succeeded();
+            double textualSeconds = secondsSince(start);
+
+            failed = !coldOk || !warmOk || !textualOk;
+            if (run < options.warmup) continue;
+            coldTimes.push_back(coldSeconds * 1e3);
+            warmTimes.push_back(warmSeconds * 1e3);
+            textualTimes.push_back(textualSeconds * 1e3);
+        }
+        HeaderCache::instance().clear();
+        for (const string& path : files) unlink(path.c_str());
+        rmdir(directory);
+        if (failed) {
+            report["error"] = "generated headers did not compile cleanly";
+            return report;
+        }
+
+        Summary coldSummary = summarize(coldTimes);
+        Summary warmSummary = summarize(warmTimes);
+        double speedup = warmSummary.median > 0 ? coldSummary.median / warmSummary.median : 0;
+        JsonValue metrics = JsonValue::object();
+        metrics["cold_ms"] = toJson(coldSummary, coldTimes);
+        metrics["warm_ms"] = toJson(warmSummary, warmTimes);
+        metrics["textual_ms"] = toJson(summarize(textualTimes), textualTimes);
+        report["metrics"] = metrics;
+        report["speedup"] = speedup;
+        report["functions"] = function;
+        report["textual_bytes"] = (long long)textual.size();
+
+        if (!options.quiet) {
+            printf("Headers: %d layers of %d, %d includes, %d functions, %zu bytes once pasted\n",
+                   options.includes, width, (options.includes - 1) * width * width + width, function,
+                   textual.size());
+            printf("%-22s %10s %7s\n", "Mode", "Median ms", "MAD");
+            auto row = [](const char* mode, const vector<double>& samples) {
+                Summary summary = summarize(samples);
+                printf("%-22s %10.3f %6.1f%%\n", mode, summary.median,
+                       summary.median > 0 ? 100 * summary.mad / summary.median : 0.0);
+            };
+            row("header cache cold", coldTimes);
+            row("header cache warm", warmTimes);
+            row("pasted into the file", textualTimes);
+            printf("Warm over cold: %.1fx\n", speedup);
+        }
+        return report;
+    }
+
+    // How the calls of one allocation-heavy program use run-time sized
+    // arrays: each call declares arraysPerCall int arrays with lengths
+    // spread evenly in log scale over [shortest, longest], and calls
+    // nested in each other depth deep release theirs innermost first
+    struct AllocationPattern {
+        const char* name;
+        const char* description;
+        int arraysPerCall;
+        int shortest;
+        int longest;
+        int depth;
+    };
+
+    const AllocationPattern ALLOCATION_PATTERNS[] = {
+        {"small", "8 arrays of 4 to 256 ints per call", 8, 4, 256, 1},
+        {"mixed", "4 arrays of 16 to 65,536 ints per call", 4, 16, 65536, 1},
+        {"recursive", "2 arrays of 16 to 1,024 ints per call, 64 calls deep", 2, 16, 1024, 64},
+    };
+
+    // Run-time sized arrays as compiled code gets them from the runtime
+    struct ArenaArrays {
+        void* enter() { return tinyc_enter(); }
+        int32_t* allocate(int32_t length) { return static_cast<int32_t*>(tinyc_allocate(length, sizeof(int32_t))); }
+        void leave(void* mark) { tinyc_leave(mark); }
+    };
+
+    // The baseline: one malloc() per array, each freed as its function
+    // returns
+    struct MallocArrays {
+        vector<void*> live;
+
+        MallocArrays() { live.reserve(4096); }
+        size_t enter() { return live.size(); }
+        int32_t* allocate(int32_t length) {
+            void* block = malloc((size_t)length * sizeof(int32_t));
+            if (!block) abort();
+            live.push_back(block);
+            return static_cast<int32_t*>(block);
+        }
+        void leave(size_t mark) {
+            while (live.size() > mark) {
+                free(live.back());
+                live.pop_back();
+            }
+        }
+    };
+
+    // One call of the pattern and those nested in it. Writes the ends of
+    // every array and sums them back, so no allocation can be elided.
+    template <typename Arrays>
+    uint64_t allocatingCall(Arrays& arrays, const AllocationPattern& pattern, const vector<int32_t>& lengths,
+                            size_t& next, int depth) {
+        auto mark = arrays.enter();
+        uint64_t sum = 0;
+        for (int i = 0; i < pattern.arraysPerCall; i++) {
+            int32_t length = lengths[next++ & (lengths.size() - 1)];
+            int32_t* array = arrays.allocate(length);
+            array[0] = i;
+            array[length - 1] = length;
+            sum += (uint64_t)array[0] + (uint64_t)array[length - 1];
+        }
+        if (depth > 1) sum += allocatingCall(arrays, pattern, lengths, next, depth - 1);
+        arrays.leave(mark);
+        return sum;
+    }
+
+    template <typename Arrays>
+    double allocatingCalls(Arrays& arrays, const AllocationPattern& pattern, const vector<int32_t>& lengths,
+                           int calls, uint64_t& sum) {
+        size_t next = 0;
+        Clock::time_point start = Clock::now();
+        for (int call = 0; call + pattern.depth <= calls; call += pattern.depth) {
+            sum += allocatingCall(arrays, pattern, lengths, next, pattern.depth);
+        }
+        return secondsSince(start);
+    }
+
+    // Both sides see the same lengths, from a fixed seed, and the same
+    // total of options.allocation calls per pattern
+    JsonValue runAllocation(const BenchmarkOptions& options, bool& failed) {
+        JsonValue report = JsonValue::object();
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        report["repetitions"] = options.repetitions;
+        report["calls"] = options.allocation;
+        failed = false;
+
+        if (!options.quiet) {
+            printf("%-10s %14s %7s %14s %7s %8s %10s\n", "Pattern", "Arena alloc/s", "MAD", "Malloc alloc/s",
+                   "MAD", "Speedup", "Arena KB");
+        }
+
+        JsonValue results = JsonValue::object();
+        for (const AllocationPattern& pattern : ALLOCATION_PATTERNS) {
+            uint64_t state = 0x9E3779B97F4A7C15ULL;
+            vector<int32_t> lengths(1 << 16);
+            double range = log((double)pattern.longest / pattern.shortest);
+            for (int32_t& length : lengths) {
+                // xorshift64*, as the program generator uses
+                state ^= state >> 12;
+                state ^= state << 25;
+                state ^= state >> 27;
+                double unit = (double)((state * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+                length = (int32_t)lround(pattern.shortest * exp(unit * range));
+            }
+
+            int calls = max(options.allocation, pattern.depth);
+            uint64_t allocations = (uint64_t)calls / pattern.depth * pattern.depth * pattern.arraysPerCall;
+            ArenaArrays arena;
+            MallocArrays heap;
+            uint64_t arenaSum = 0, heapSum = 0;
+            vector<double> arenaRates, heapRates;
+            for (int run = 0; run < options.warmup + options.repetitions; run++) {
+                double arenaSeconds = allocatingCalls(arena, pattern, lengths, calls, arenaSum);
+                double heapSeconds = allocatingCalls(heap, pattern, lengths, calls, heapSum);
+                if (run < options.warmup) continue;
+                arenaRates.push_back(allocations / arenaSeconds);
+                heapRates.push_back(allocations / heapSeconds);
+            }
+            failed = failed || arenaSum != heapSum;
+
+            Summary arenaSummary = summarize(arenaRates);
+            Summary heapSummary = summarize(heapRates);
+            double speedup = heapSummary.median > 0 ? arenaSummary.median / heapSummary.median : 0;
+            JsonValue result = JsonValue::object();
+            result["description"] = pattern.description;
+            result["allocations"] = (long long)allocations;
+            // The thread's arena keeps its chunks from one pattern to the
+            // next, so these are the most any pattern so far has needed
+            result["arena_chunks"] = (long long)Arena::current().chunkCount();
+            result["arena_kb"] = (long long)(Arena::current().reservedBytes() / 1024);
+            JsonValue metrics = JsonValue::object();
+            metrics["arena_allocations_per_s"] = toJson(arenaSummary, arenaRates);
+            metrics["malloc_allocations_per_s"] = toJson(heapSummary, heapRates);
+            result["metrics"] = metrics;
+            result["speedup"] = speedup;
+            results[pattern.name] = result;
+
+            if (!options.quiet) {
+                printf("%-10s %14.0f %6.1f%% %14.0f %6.1f%% %7.1fx %10lld\n", pattern.name, arenaSummary.median,
+                       arenaSummary.median > 0 ? 100 * arenaSummary.mad / arenaSummary.median : 0.0,
+                       heapSummary.median, heapSummary.median > 0 ? 100 * heapSummary.mad / heapSummary.median : 0.0,
+                       speedup, result.get("arena_kb").asInteger());
+                fflush(stdout);
+            }
+        }
+        report["cases"] = results;
+        if (failed) report["error"] = "the arena and malloc() runs disagree";
+        return report;
+    }
+
+    JsonValue runBenchmarks(const BenchmarkOptions& options, bool& failed) {
+        JsonValue report = JsonValue::object();
+        utsname host;
+        if (uname(&host) == 0) {
+            report["host"] = string(host.nodename) + " " + host.sysname + " " + host.release + " " + host.machine;
+        }
+        report["compiler_version"] = TINYC_VERSION;
+        report["label"] = options.label;
+        report["timestamp"] = (long long)time(nullptr);
+        report["repetitions"] = options.repetitions;
+        report["warmup"] = options.warmup;
+        report["scale"] = options.scale;
+
+        if (!options.quiet) {
+            printf("%-13s %8s %7s %8s %11s %11s %11s %10s %7s %9s %9s\n", "Case", "Lex MB/s", "MAD", "DFA MB/s",
+                   "Parse Kt/s", "Table Kt/s", "Lookups K/s", "Total ms", "MAD", "Table ms", "Peak KB");
+        }
+
+        JsonValue results = JsonValue::object();
+        failed = false;
+        for (const BenchmarkCase& benchmark : defaultCases()) {
+            if (!options.only.empty() &&
+                find(options.only.begin(), options.only.end(), benchmark.name) == options.only.end()) {
+                continue;
+            }
+            JsonValue result = runCase(benchmark, options);
+            failed = failed || result.has("error");
+            if (!options.quiet) {
+                printCase(benchmark.name, result);
+                fflush(stdout);
+            }
+            results[benchmark.name] = result;
+        }
+        report["cases"] = results;
+        return report;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (!options.memoryChild.empty()) return runMemoryChild(options.memoryChild, options.memoryBaseline);
+
+    JsonValue report;
+    bool failed = false;
+    if (!options.results.empty()) {
+        if (!readResults(options.results, report)) return 1;
+    } else {
+        if (options.streaming > 0) {
+            report = runStreaming(options, failed);
+        } else if (options.pipeline) {
+            report = runPipeline(options, failed);
+        } else if (options.interface > 0) {
+            report = runInterface(options, failed);
+        } else if (options.includes > 0) {
+            report = runIncludes(options, failed);
+        } else if (options.allocation > 0) {
+            report = runAllocation(options, failed);
+        } else {
+            report = options.embedding ? runEmbedding(options, failed) : runBenchmarks(options, failed);
+        }
+        ofstream file(options.output, ios::out | ios::trunc);
+        file << report.serialize() << endl;
+        if (!file.good()) {
+            cerr << "ERROR - cannot write " << options.output << endl;
+            return 1;
+        }
+        if (!options.quiet) {
+            cout << "Results written to " << options.output << endl;
+        }
+    }
+    if (failed) return 1;
+    if (options.baseline.empty() || options.embedding || options.pipeline || options.streaming > 0 ||
+        options.interface > 0 || options.includes > 0 || options.allocation > 0) {
+        return 0;
+    }
+
+    JsonValue baseline;
+    if (!readResults(options.baseline, baseline)) return 1;
+    RegressionGate gate(options.tolerance, options.noise);
+    string reason;
+    if (!gate.compatible(baseline, report, reason)) {
+        cerr << "ERROR - cannot compare with " << options.baseline << ": " << reason << endl;
+        return 1;
+    }
+
+    vector<MetricComparison> comparisons = gate.compare(baseline, report);
+    cout << endl;
+    RegressionGate::printReport(cout, comparisons);
+    vector<string> unchecked = RegressionGate::uncheckedCases(baseline, report);
+    if (!unchecked.empty()) {
+        cout << "Not in the baseline, so unchecked:";
+        for (const string& name : unchecked) cout << " " << name;
+        cout << " (refresh " << options.baseline << ")" << endl;
+    }
+    return RegressionGate::countRegressions(comparisons) > 0 ? 3 : 0;
+}
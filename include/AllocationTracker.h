@@ -0,0 +1,49 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include "Statistics.h"
+
+using namespace std;
+
+// Heap allocation counters, filled in by replacement global operator
+// new/delete. The replacements are only built with -DTINYC_TRACK_ALLOCATIONS,
+// so a normal build keeps the C++ runtime's allocator untouched.
+//
+// Each allocation is charged to the innermost compiler phase active on the
+// allocating thread (see CompileStatistics), or to "other" outside any
+// phase. Nothing is counted while CompileStatistics::enabled is false.
+class AllocationTracker {
+public:
+    static const int SIZE_CLASSES = 8;
+
+    struct Counters {
+        uint64_t allocations[(int)Phase::COUNT + 1];
+        uint64_t bytes[(int)Phase::COUNT + 1];
+        uint64_t sizeClasses[SIZE_CLASSES];
+        uint64_t frees;
+        uint64_t freedBytes;
+        int64_t liveBytes;
+        int64_t peakLiveBytes;
+    };
+
+    static bool compiledIn();
+
+    // Counters of the calling thread
+    static Counters& current();
+    static void reset();
+
+    static void recordAllocation(size_t requested, size_t usable);
+    static void recordFree(size_t usable);
+
+    static int sizeClass(size_t bytes);
+    static const char* sizeClassName(int sizeClass);
+
+    // Per-phase bytes, size-class histogram and bytes per token/symbol,
+    // using the statistics' counters as denominators
+    static void printReport(ostream& os, bool json, const CompileStatistics& statistics);
+};
+
+#endif
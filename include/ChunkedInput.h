@@ -0,0 +1,37 @@
+#ifndef CHUNKEDINPUT_H
+#define CHUNKEDINPUT_H
+
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+using namespace std;
+
+// Reads a file descriptor (a pipe, a terminal, standard input) through a
+// fixed buffer that is refilled as the lexer drains it, so input of any
+// size is compiled in constant memory and nothing needs to seek.
+//
+// The lexers only ever look one character ahead, through sgetc()/snextc()
+// or get()/peek(), and build each lexeme in a string of their own. A token
+// that straddles two chunks is therefore read like any other: the refill
+// happens between two of its characters.
+class ChunkedInputBuffer : public streambuf {
+public:
+    static const size_t DEFAULT_CHUNK_BYTES = 64 * 1024;
+
+private:
+    int descriptor;
+    vector<char> chunk;
+    bool failed;
+
+protected:
+    int_type underflow() override;
+
+public:
+    explicit ChunkedInputBuffer(int descriptor, size_t chunkBytes = DEFAULT_CHUNK_BYTES);
+
+    // Whether reading stopped on an error rather than at end of input
+    bool readFailed() const;
+};
+
+#endif
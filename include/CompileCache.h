@@ -0,0 +1,65 @@
+#ifndef COMPILECACHE_H
+#define COMPILECACHE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Persistent statistics shared by every process using a cache directory
+struct CacheStatistics {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t storedBytes;
+
+    CacheStatistics() : hits(0), misses(0), evictions(0), storedBytes(0) {}
+};
+
+// Content-addressed on-disk store for compilation results.
+//
+// Entries are written to a temporary file and renamed into place, so a
+// reader in another process sees either a complete entry or none at all.
+// Each entry carries a checksum; damaged entries are dropped and reported
+// as misses. Hits refresh the entry's modification time, and once the
+// directory grows past its size limit the least recently used entries are
+// evicted by whichever process holds the eviction lock. The directory size
+// is tracked in the shared statistics file so that stores only rescan the
+// directory when the limit has actually been crossed.
+class CompileCache {
+private:
+    string directory;
+    uint64_t maxBytes;
+    bool usable;
+    CacheStatistics pending;
+
+    string entryPath(uint64_t key) const;
+    string temporaryPath() const;
+    void evict();
+    CacheStatistics updateStatistics(const CacheStatistics& delta, bool resetStoredBytes = false);
+
+public:
+    static const uint64_t DEFAULT_MAX_BYTES = 64ULL * 1024 * 1024;
+
+    CompileCache(const string& directory, uint64_t maxBytes = DEFAULT_MAX_BYTES);
+    ~CompileCache();
+
+    bool isUsable() const;
+    const string& getDirectory() const;
+
+    // Payload operations
+    bool lookup(uint64_t key, string& payload);
+    bool store(uint64_t key, const string& payload);
+
+    // Statistics and maintenance
+    void flushStatistics();
+    CacheStatistics readStatistics() const;
+    uint64_t totalSize(uint64_t* entryCount = nullptr) const;
+    void printStatistics(ostream& os) const;
+
+    // Key derivation: source bytes plus everything else that affects output
+    static uint64_t computeKey(const string& source, const string& options);
+};
+
+#endif
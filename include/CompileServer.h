@@ -0,0 +1,92 @@
+#ifndef COMPILESERVER_H
+#define COMPILESERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "IncrementalCompiler.h"
+#include "TinyC.h"
+
+using namespace std;
+
+// A compile request names a file on the server's filesystem or carries the
+// source text itself. Options mirror the driver's command-line flags.
+struct CompileRequest {
+    string path;
+    string source;
+    bool hasSource;
+    bool incremental;
+    // Installed on the worker for this request only. Mapped interfaces do
+    // not cross the socket: the server opens importPaths in their place, so
+    // they and any include paths must be paths the server can open.
+    TinyC::CompileOptions options;
+    vector<string> importPaths;
+
+    CompileRequest() : hasSource(false), incremental(false) {}
+};
+
+struct CompileResponse {
+    int status;
+    string output;
+
+    CompileResponse() : status(0) {}
+};
+
+// Long-lived compiler process listening on a Unix domain socket.
+//
+// Connections are handed to a fixed pool of worker threads. Each worker
+// keeps its own IncrementalCompiler, so unchanged functions of files it has
+// compiled before are replayed from memory. Each request is compiled with
+// the options it carries, whatever the server's own command line was. A
+// connection may carry any number of requests; each request and response
+// is one length-prefixed message.
+class CompileServer {
+private:
+    string socketPath;
+    int workerCount;
+    int listenFd;
+    queue<int> pendingClients;
+    mutex queueMutex;
+    condition_variable queueReady;
+    atomic<bool> stopping;
+    atomic<uint64_t> requestsServed;
+
+    void workerLoop();
+    void serveClient(int clientFd, IncrementalCompiler& incremental);
+
+public:
+    CompileServer(const string& socketPath, int workerCount = 0);
+    ~CompileServer();
+
+    // Serves requests until SIGINT or SIGTERM; returns the exit status
+    int run();
+
+    static CompileResponse execute(const CompileRequest& request, IncrementalCompiler* incremental);
+
+    // Wire format
+    static string encodeRequest(const CompileRequest& request);
+    static bool decodeRequest(const string& payload, CompileRequest& request);
+    static string encodeResponse(const CompileResponse& response);
+    static bool decodeResponse(const string& payload, CompileResponse& response);
+};
+
+// Client side of the protocol, used by the driver's --connect mode
+class CompileClient {
+private:
+    int fd;
+
+public:
+    CompileClient();
+    ~CompileClient();
+
+    bool connectTo(const string& socketPath);
+    bool send(const CompileRequest& request, CompileResponse& response);
+    void disconnect();
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DATALAYOUT_H
+#define DATALAYOUT_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DataType.h"
+
+using namespace std;
+
+enum class DataSection {
+    // Globals with a nonzero initializer, stored in the executable
+    DATA,
+    // Everything else, zero-filled by the loader and taking no file space
+    BSS
+};
+
+// One global variable or array placed in static data
+struct DataObject {
+    // Interned name (see StringInterner)
+    uint32_t name;
+    DataType type;
+    bool isArray;
+    // Array extents, outermost first; elements is their product
+    vector<int> dimensions;
+    int elements;
+    int line;
+    DataSection section;
+    uint32_t alignment;
+    // From the start of the section
+    uint64_t offset;
+    uint64_t bytes;
+    // Initial element values in order; elements past the end are zero
+    vector<double> values;
+};
+
+// Static layout of the program's globals, in declaration order within
+// each section. Arrays of int and float start on a 32-byte boundary, so a
+// loop over a table can use aligned 256-bit vector loads from its first
+// element; scalars and bool arrays are aligned to their element size.
+class DataLayout {
+public:
+    static const uint32_t VECTOR_ALIGNMENT = 32;
+
+    DataLayout();
+
+    // Places a global after the others of its section; no dimensions
+    // places a scalar. Values are already checked against the type, in
+    // row-major order; they may be fewer than the elements.
+    void place(uint32_t name, DataType type, const vector<int>& dimensions, const vector<double>& values, int line);
+
+    const vector<DataObject>& getObjects() const;
+    // Bytes the section spans, padding included
+    uint64_t sectionBytes(DataSection section) const;
+    bool empty() const;
+
+    // The layout as GNU assembler source (x86-64 and AArch64 ELF alike):
+    // one .data and one .bss section, every global exported under its
+    // own name. source names the compiled file in the header comment.
+    void writeAssembly(ostream& out, const string& source) const;
+
+    static uint32_t elementBytes(DataType type);
+
+private:
+    vector<DataObject> objects;
+    uint64_t sectionEnd[2];
+};
+
+#endif
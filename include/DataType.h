@@ -0,0 +1,13 @@
+#ifndef DATATYPE_H
+#define DATATYPE_H
+
+// Types of values, shared by the symbol table and literal tokens
+enum class DataType {
+    INT,
+    FLOAT,
+    BOOL,
+    VOID,
+    UNKNOWN
+};
+
+#endif
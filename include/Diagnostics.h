@@ -0,0 +1,155 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DataType.h"
+
+using namespace std;
+
+// Every diagnostic the compiler can report. The command line and the
+// machine-readable reports name them by their id in DIAGNOSTIC_INFO.
+enum class DiagnosticCode : uint8_t {
+    INVALID_VARIABLE_TYPE,
+    VOID_VARIABLE,
+    INVALID_ARRAY_TYPE,
+    VOID_ARRAY,
+    NONPOSITIVE_ARRAY_SIZE,
+    INVALID_RETURN_TYPE,
+    INVALID_SIGNATURE_PARAMETER_TYPE,
+    VOID_SIGNATURE_PARAMETER,
+    INVALID_PARAMETER_TYPE,
+    VOID_PARAMETER,
+    UNDECLARED_VARIABLE,
+    FUNCTION_AS_VARIABLE,
+    UNDECLARED_ARRAY,
+    SYMBOL_NOT_FOUND,
+    FUNCTION_AS_ARRAY,
+    NOT_AN_ARRAY,
+    INTEGER_LITERAL_RANGE,
+    FLOAT_LITERAL_RANGE,
+    UNDECLARED_FUNCTION,
+    NOT_A_FUNCTION,
+    ARGUMENT_COUNT,
+    ASSIGNMENT_TYPE_MISMATCH,
+    ASSIGNMENT_CONVERSION,
+    RETURN_TYPE_MISMATCH,
+    RETURN_CONVERSION,
+    ARITHMETIC_OPERANDS,
+    COMPARISON_OPERANDS,
+    EQUALITY_OPERANDS,
+    LOGICAL_OPERANDS,
+    NOT_OPERAND,
+    NEGATION_OPERAND,
+    TOO_MANY_INITIALIZERS,
+    ARRAY_TOO_LARGE,
+    SUBSCRIPT_COUNT,
+    ARRAY_ARGUMENT,
+    SCALAR_ARGUMENT,
+    ARRAY_ARGUMENT_TYPE,
+    ARRAY_ARGUMENT_SHAPE,
+    GLOBAL_ARRAY_LENGTH,
+    ARRAY_LENGTH_TYPE,
+    ALLOCATE_TARGET,
+    // Only in machine-readable reports; the text report prints its own
+    SYNTAX_ERROR,
+    COUNT
+};
+
+enum class Severity : uint8_t { ERROR, WARNING };
+
+// In a message, %0 stands for the symbol, %1 and %2 for the two types and
+// %3 and %4 for the two numbers of the diagnostic
+struct DiagnosticInfo {
+    const char* id;
+    Severity severity;
+    const char* message;
+};
+
+extern const DiagnosticInfo DIAGNOSTIC_INFO[(int)DiagnosticCode::COUNT];
+
+// One reported diagnostic: what and where, with its arguments kept as
+// values. The symbol is a StringInterner id, EMPTY when there is none.
+struct Diagnostic {
+    DiagnosticCode code;
+    DataType types[2];
+    int line;
+    uint32_t symbol;
+    int numbers[2];
+
+    bool operator==(const Diagnostic& other) const;
+    uint64_t hash() const;
+};
+
+// Settings of the compilations on one thread
+struct DiagnosticOptions {
+    // Drop a diagnostic identical to one already reported (same code, line
+    // and arguments)
+    bool deduplicate;
+    // Errors printed before the rest are only counted; 0 prints them all
+    int maxErrors;
+    bitset<(int)DiagnosticCode::COUNT> suppressed;
+
+    DiagnosticOptions() : deduplicate(true), maxErrors(0) {}
+};
+
+// Collects diagnostics as compact records and formats them only when they
+// are printed, so a compilation that reports thousands of errors does not
+// build thousands of strings it may never show.
+class DiagnosticEngine {
+public:
+    static thread_local DiagnosticOptions options;
+
+private:
+    vector<Diagnostic> records;
+    // Open-addressed set of records for deduplication: each slot holds a
+    // record index plus one, or 0 when empty
+    vector<uint32_t> slots;
+    int errorCount;
+    int warningCount;
+
+    bool insertUnique(const Diagnostic& diagnostic);
+
+public:
+    DiagnosticEngine();
+
+    // Records a diagnostic unless its code is suppressed or it duplicates
+    // an earlier one. Returns whether it was recorded.
+    bool report(DiagnosticCode code, int line, uint32_t symbol = 0,
+                DataType first = DataType::UNKNOWN, DataType second = DataType::UNKNOWN,
+                int firstNumber = 0, int secondNumber = 0);
+    // As above, interning symbol first
+    bool report(DiagnosticCode code, int line, string_view symbol,
+                DataType first = DataType::UNKNOWN, DataType second = DataType::UNKNOWN,
+                int firstNumber = 0, int secondNumber = 0);
+    // Reports the records of other from index first on, in order, each
+    // lineDelta lines further down
+    void append(const DiagnosticEngine& other, size_t first = 0, int lineDelta = 0);
+
+    size_t size() const;
+    const Diagnostic& at(size_t index) const;
+    string_view symbol(const Diagnostic& diagnostic) const;
+    int getErrorCount() const;
+    int getWarningCount() const;
+
+    // "message", and "Error (line N): message" as the text report prints it
+    string message(const Diagnostic& diagnostic) const;
+    void print(ostream& out, const Diagnostic& diagnostic) const;
+
+    // Machine-readable reports of every diagnostic within the error cap.
+    // path names the compiled file in SARIF locations.
+    string toJson() const;
+    string toSarif(const string& path) const;
+
+    // Option helpers for the command line and cache keys
+    static bool findCode(const string& id, DiagnosticCode& code);
+    static string optionsKey();
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <iostream>
+#include <vector>
+
+#include "DataLayout.h"
+#include "Diagnostics.h"
+#include "IncrementalCompiler.h"
+#include "SymbolTable.h"
+
+using namespace std;
+
+// Runs lexing, parsing and semantic analysis over source. Everything the
+// phases print goes to out, so the caller may capture it; the return value
+// is the process exit status for this compilation. With an incremental
+// compiler, functions analysed by an earlier run are replayed instead.
+// When diagnostics is given it receives every diagnostic of the
+// compilation, the syntax error included, for machine-readable reports.
+// When globals is given it receives the global scope in declaration
+// order, for writing a module interface. When data is given it receives
+// the static data layout of the global variables; an incremental
+// compilation leaves it empty.
+int compileSource(istream &source, ostream &out, IncrementalCompiler *incremental = nullptr,
+                  DiagnosticEngine *diagnostics = nullptr, vector<SymbolInfo> *globals = nullptr,
+                  DataLayout *data = nullptr);
+
+#endif
@@ -0,0 +1,539 @@
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+#include <cstdint>
+#include <initializer_list>
+#include "TokenCodes.h"
+
+using namespace std;
+
+// LL(1) description of the language accepted by SyntaxAnalyzer, used by
+// TableParser. The parse table, with its FIRST and FOLLOW sets, is computed
+// at compile time from the productions below; a grammar that is not LL(1)
+// fails the build (see CheckConflicts at the end of this file).
+//
+// Keep the productions in step with SyntaxAnalyzer.cpp. Each one mirrors
+// a branch of the recursive descent parser, including where it reports
+// errors and where it calls the semantic analyzer, so both engines print
+// the same output for the same input.
+namespace Grammar {
+    // Terminals are token codes; nonterminals and actions follow them in
+    // one number space, so a parse stack entry fits in a byte
+    const int TERMINALS = NAL + 1;
+    const int FIRST_NONTERMINAL = 64;
+    const int FIRST_ACTION = 128;
+
+    enum Nonterminal {
+        PROGRAM = FIRST_NONTERMINAL,
+        FUNCTIONS,
+        FUNCTION,
+        EXTERNAL_REST,
+        RETURN_TYPE,
+        PARAMLIST,
+        PARAMETER_REST,
+        PARAMETER,
+        PARAMETER_TYPE,
+        PARAMETER_NAME,
+        PARAMETER_SUFFIX,
+        PARAMETER_EXTENT,
+        PARAMETER_DIMENSIONS,
+        PARAMETER_SIZE,
+        FUNCTION_CLOSE,
+        GLOBAL_SUFFIX,
+        GLOBAL_REST,
+        ARRAY_INITIALIZER,
+        SCALAR_INITIALIZER,
+        CONSTANT,
+        CONSTANT_REST,
+        NUMBER,
+        COMPSTMT,
+        SEQOFSTMT,
+        STATEMENT,
+        STATEMENT_BODY,
+        DECLARATION_TYPE,
+        IDENTLIST,
+        IDENT_SUFFIX,
+        ARRAY_SIZE,
+        ARRAY_DIMENSIONS,
+        ARRAY_EXTENT,
+        IDENT_REST,
+        IDENT_STATEMENT,
+        ELSE_PART,
+        BLOCK,
+        EXPRESSION,
+        OR_TAIL,
+        AND_EXPRESSION,
+        AND_TAIL,
+        EQUALITY,
+        EQUALITY_TAIL,
+        RELATIONAL,
+        RELATIONAL_TAIL,
+        TERM,
+        TERM_TAIL,
+        FACTOR,
+        FACTOR_TAIL,
+        UNARY,
+        PRIMARY,
+        IDENT_PRIMARY,
+        SUBSCRIPTS,
+        MORE_SUBSCRIPTS,
+        CALL,
+        ARGUMENTS,
+        ARGUMENT_REST,
+        ARGUMENT,
+        CALL_CLOSE,
+        NONTERMINALS_END
+    };
+    const int NONTERMINALS = NONTERMINALS_END - FIRST_NONTERMINAL;
+
+    // Semantic actions run when popped. "Save" actions read the token just
+    // matched; the others see the lookahead, as the recursive descent
+    // parser does at the same point.
+    enum Action {
+        SAVE_RETURN_TYPE = FIRST_ACTION,
+        SAVE_FUNCTION_NAME,
+        SAVE_TYPE,
+        SAVE_NAME,
+        ENTER_SCOPE,
+        EXIT_SCOPE,
+        DECLARE_FUNCTION,
+        DECLARE_PARAMETER,
+        DECLARE_VARIABLE,
+        PARSE_ARRAY_SIZE,
+        UNSIZED_EXTENT,
+        SAVE_LENGTH,
+        CHECK_LITERAL,
+        DECLARE_ARRAY,
+        CHECK_VARIABLE,
+        CHECK_ARRAY,
+        ADD_SUBSCRIPT,
+        CHECK_SUBSCRIPTS,
+        START_CALL,
+        START_ARGUMENT,
+        ADD_ARGUMENT,
+        CHECK_CALL,
+        SAVE_OPERAND,
+        SAVE_OPERATOR,
+        APPLY_OPERATOR,
+        DROP_OPERANDS,
+        START_GLOBAL,
+        DEFINE_GLOBAL,
+        NEGATE,
+        ADD_CONSTANT,
+        NEST,
+        UNNEST,
+        ACTIONS_END
+    };
+
+    constexpr bool isTerminal(int symbol) { return symbol < FIRST_NONTERMINAL; }
+    constexpr bool isNonterminal(int symbol) { return symbol >= FIRST_NONTERMINAL && symbol < FIRST_ACTION; }
+    constexpr bool isAction(int symbol) { return symbol >= FIRST_ACTION; }
+
+    const int MAX_RHS = 10;
+
+    struct Production {
+        int lhs;
+        // Chosen when the lookahead has no table entry, like the final
+        // "else" of a recursive descent branch
+        bool fallback;
+        int length;
+        int rhs[MAX_RHS];
+    };
+
+    constexpr Production rule(int lhs, initializer_list<int> symbols, bool fallback = false) {
+        Production production{lhs, fallback, 0, {}};
+        for (int symbol : symbols) production.rhs[production.length++] = symbol;
+        return production;
+    }
+
+    constexpr Production otherwise(int lhs, initializer_list<int> symbols) {
+        return rule(lhs, symbols, true);
+    }
+
+    constexpr Production PRODUCTIONS[] = {
+        otherwise(PROGRAM, {FUNCTIONS}),
+
+        // Functions and globals loop until end of input; anything else
+        // starts one. After the name, '(' begins a function and '[', '=',
+        // ',' or ';' a list of globals.
+        rule(FUNCTIONS, {}),
+        otherwise(FUNCTIONS, {FUNCTION, FUNCTIONS}),
+        otherwise(FUNCTION, {RETURN_TYPE, IDENT, SAVE_FUNCTION_NAME, EXTERNAL_REST}),
+        rule(EXTERNAL_REST, {LPAREN, ENTER_SCOPE, PARAMLIST, FUNCTION_CLOSE, COMPSTMT, EXIT_SCOPE}),
+        rule(EXTERNAL_REST, {START_GLOBAL, GLOBAL_SUFFIX, GLOBAL_REST, SEMICOLON}),
+        rule(RETURN_TYPE, {BOOLSYM, SAVE_RETURN_TYPE}),
+        rule(RETURN_TYPE, {FLOATSYM, SAVE_RETURN_TYPE}),
+        rule(RETURN_TYPE, {INTSYM, SAVE_RETURN_TYPE}),
+        rule(RETURN_TYPE, {VOIDSYM, SAVE_RETURN_TYPE}),
+
+        rule(PARAMLIST, {PARAMETER, PARAMETER_REST}),
+        otherwise(PARAMLIST, {}),
+        rule(PARAMETER_REST, {COMMA, PARAMETER, PARAMETER_REST}),
+        otherwise(PARAMETER_REST, {}),
+        otherwise(PARAMETER, {PARAMETER_TYPE, PARAMETER_NAME}),
+        rule(PARAMETER_TYPE, {BOOLSYM, SAVE_TYPE}),
+        rule(PARAMETER_TYPE, {FLOATSYM, SAVE_TYPE}),
+        rule(PARAMETER_TYPE, {INTSYM, SAVE_TYPE}),
+        // A parameter is declared once its dimensions are known; an array
+        // parameter may leave its first extent out
+        rule(PARAMETER_NAME, {IDENT, SAVE_NAME, PARAMETER_SUFFIX}),
+        rule(PARAMETER_SUFFIX, {LBRACKET, PARAMETER_EXTENT}),
+        otherwise(PARAMETER_SUFFIX, {DECLARE_PARAMETER}),
+        rule(PARAMETER_EXTENT, {PARSE_ARRAY_SIZE, NUMLIT, RBRACKET, PARAMETER_DIMENSIONS}),
+        rule(PARAMETER_EXTENT, {UNSIZED_EXTENT, RBRACKET, PARAMETER_DIMENSIONS}),
+        rule(PARAMETER_DIMENSIONS, {LBRACKET, PARAMETER_SIZE}),
+        otherwise(PARAMETER_DIMENSIONS, {DECLARE_PARAMETER}),
+        rule(PARAMETER_SIZE, {PARSE_ARRAY_SIZE, NUMLIT, RBRACKET, PARAMETER_DIMENSIONS}),
+        // The function is declared before its ')' is consumed
+        rule(FUNCTION_CLOSE, {DECLARE_FUNCTION, RPAREN}),
+
+        // Globals are declared as locals are, then placed in static data
+        // with their constant initializer
+        rule(GLOBAL_SUFFIX, {LBRACKET, ARRAY_SIZE, ARRAY_INITIALIZER, DEFINE_GLOBAL}),
+        otherwise(GLOBAL_SUFFIX, {DECLARE_VARIABLE, SCALAR_INITIALIZER, DEFINE_GLOBAL}),
+        rule(GLOBAL_REST, {COMMA, IDENT, SAVE_NAME, GLOBAL_SUFFIX, GLOBAL_REST}),
+        rule(GLOBAL_REST, {}),
+        rule(ARRAY_INITIALIZER, {ASSIGN, LBRACE, CONSTANT, CONSTANT_REST, RBRACE}),
+        rule(ARRAY_INITIALIZER, {}),
+        rule(SCALAR_INITIALIZER, {ASSIGN, CONSTANT}),
+        rule(SCALAR_INITIALIZER, {}),
+        rule(CONSTANT, {MINUS, NEGATE, NUMBER}),
+        rule(CONSTANT, {NUMBER}),
+        rule(CONSTANT, {ADD_CONSTANT, TRUESYM}),
+        rule(CONSTANT, {ADD_CONSTANT, FALSESYM}),
+        rule(CONSTANT_REST, {COMMA, CONSTANT, CONSTANT_REST}),
+        rule(CONSTANT_REST, {}),
+        rule(NUMBER, {CHECK_LITERAL, ADD_CONSTANT, NUMLIT}),
+
+        otherwise(COMPSTMT, {LBRACE, SEQOFSTMT, RBRACE}),
+        rule(SEQOFSTMT, {}),
+        otherwise(SEQOFSTMT, {STATEMENT, SEQOFSTMT}),
+
+        // Types of the operands read are stacked as the expression is
+        // parsed, and dropped after each statement
+        otherwise(STATEMENT, {NEST, STATEMENT_BODY, UNNEST, DROP_OPERANDS}),
+        rule(STATEMENT_BODY, {DECLARATION_TYPE, IDENTLIST, SEMICOLON}),
+        rule(STATEMENT_BODY, {DOSYM, BLOCK, WHILESYM, LPAREN, EXPRESSION, RPAREN, SEMICOLON}),
+        rule(STATEMENT_BODY, {FORSYM, LPAREN, EXPRESSION, SEMICOLON, EXPRESSION, SEMICOLON, EXPRESSION,
+                              RPAREN, BLOCK}),
+        rule(STATEMENT_BODY, {IFSYM, LPAREN, EXPRESSION, RPAREN, BLOCK, ELSE_PART}),
+        rule(STATEMENT_BODY, {PRINTFSYM, LPAREN, RPAREN, SEMICOLON}),
+        rule(STATEMENT_BODY, {RETURNSYM, EXPRESSION, SEMICOLON}),
+        rule(STATEMENT_BODY, {SCANFSYM, LPAREN, RPAREN, SEMICOLON}),
+        rule(STATEMENT_BODY, {WHILESYM, LPAREN, EXPRESSION, RPAREN, BLOCK}),
+        rule(STATEMENT_BODY, {IDENT, SAVE_NAME, IDENT_STATEMENT, SEMICOLON}),
+
+        rule(DECLARATION_TYPE, {BOOLSYM, SAVE_TYPE}),
+        rule(DECLARATION_TYPE, {FLOATSYM, SAVE_TYPE}),
+        rule(DECLARATION_TYPE, {INTSYM, SAVE_TYPE}),
+        rule(IDENTLIST, {IDENT, SAVE_NAME, IDENT_SUFFIX, IDENT_REST}),
+        rule(IDENTLIST, {}),
+        rule(IDENT_SUFFIX, {LBRACKET, ARRAY_SIZE}),
+        otherwise(IDENT_SUFFIX, {DECLARE_VARIABLE}),
+        // An array is declared once its last dimension is known, with the
+        // token after the last ']' as lookahead. Its first extent may be a
+        // variable or left out, sizing it at run time.
+        rule(ARRAY_SIZE, {PARSE_ARRAY_SIZE, NUMLIT, RBRACKET, ARRAY_DIMENSIONS}),
+        rule(ARRAY_SIZE, {IDENT, SAVE_LENGTH, RBRACKET, ARRAY_DIMENSIONS}),
+        rule(ARRAY_SIZE, {UNSIZED_EXTENT, RBRACKET, ARRAY_DIMENSIONS}),
+        rule(ARRAY_DIMENSIONS, {LBRACKET, ARRAY_EXTENT}),
+        otherwise(ARRAY_DIMENSIONS, {DECLARE_ARRAY}),
+        rule(ARRAY_EXTENT, {PARSE_ARRAY_SIZE, NUMLIT, RBRACKET, ARRAY_DIMENSIONS}),
+        rule(IDENT_REST, {}),
+        rule(IDENT_REST, {COMMA, IDENTLIST}),
+
+        // After an identifier: array assignment, assignment, or the rest of
+        // an expression whose first operand is the identifier or a call
+        rule(IDENT_STATEMENT, {CHECK_ARRAY, SUBSCRIPTS, ASSIGN, EXPRESSION}),
+        rule(IDENT_STATEMENT, {CALL, FACTOR_TAIL, TERM_TAIL, RELATIONAL_TAIL, EQUALITY_TAIL, AND_TAIL, OR_TAIL}),
+        rule(IDENT_STATEMENT, {CHECK_VARIABLE, ASSIGN, EXPRESSION}),
+        otherwise(IDENT_STATEMENT, {CHECK_VARIABLE, FACTOR_TAIL, TERM_TAIL, RELATIONAL_TAIL, EQUALITY_TAIL,
+                                    AND_TAIL, OR_TAIL}),
+
+        rule(ELSE_PART, {ELSESYM, BLOCK}),
+        otherwise(ELSE_PART, {}),
+        rule(BLOCK, {COMPSTMT}),
+        otherwise(BLOCK, {STATEMENT}),
+
+        // One nonterminal pair per precedence level, loosest first. An
+        // operator is applied to the types of its operands once its right
+        // operand has been read.
+        otherwise(EXPRESSION, {AND_EXPRESSION, OR_TAIL}),
+        rule(OR_TAIL, {OR, SAVE_OPERATOR, AND_EXPRESSION, APPLY_OPERATOR, OR_TAIL}),
+        otherwise(OR_TAIL, {}),
+        otherwise(AND_EXPRESSION, {EQUALITY, AND_TAIL}),
+        rule(AND_TAIL, {AND, SAVE_OPERATOR, EQUALITY, APPLY_OPERATOR, AND_TAIL}),
+        otherwise(AND_TAIL, {}),
+        otherwise(EQUALITY, {RELATIONAL, EQUALITY_TAIL}),
+        rule(EQUALITY_TAIL, {EQL, SAVE_OPERATOR, RELATIONAL, APPLY_OPERATOR, EQUALITY_TAIL}),
+        rule(EQUALITY_TAIL, {NEQ, SAVE_OPERATOR, RELATIONAL, APPLY_OPERATOR, EQUALITY_TAIL}),
+        otherwise(EQUALITY_TAIL, {}),
+        otherwise(RELATIONAL, {TERM, RELATIONAL_TAIL}),
+        rule(RELATIONAL_TAIL, {LSS, SAVE_OPERATOR, TERM, APPLY_OPERATOR, RELATIONAL_TAIL}),
+        rule(RELATIONAL_TAIL, {LEQ, SAVE_OPERATOR, TERM, APPLY_OPERATOR, RELATIONAL_TAIL}),
+        rule(RELATIONAL_TAIL, {GTR, SAVE_OPERATOR, TERM, APPLY_OPERATOR, RELATIONAL_TAIL}),
+        rule(RELATIONAL_TAIL, {GEQ, SAVE_OPERATOR, TERM, APPLY_OPERATOR, RELATIONAL_TAIL}),
+        otherwise(RELATIONAL_TAIL, {}),
+        otherwise(TERM, {FACTOR, TERM_TAIL}),
+        rule(TERM_TAIL, {PLUS, SAVE_OPERATOR, FACTOR, APPLY_OPERATOR, TERM_TAIL}),
+        rule(TERM_TAIL, {MINUS, SAVE_OPERATOR, FACTOR, APPLY_OPERATOR, TERM_TAIL}),
+        otherwise(TERM_TAIL, {}),
+        otherwise(FACTOR, {UNARY, FACTOR_TAIL}),
+        rule(FACTOR_TAIL, {TIMES, SAVE_OPERATOR, UNARY, APPLY_OPERATOR, FACTOR_TAIL}),
+        rule(FACTOR_TAIL, {SLASH, SAVE_OPERATOR, UNARY, APPLY_OPERATOR, FACTOR_TAIL}),
+        rule(FACTOR_TAIL, {MOD, SAVE_OPERATOR, UNARY, APPLY_OPERATOR, FACTOR_TAIL}),
+        otherwise(FACTOR_TAIL, {}),
+        rule(UNARY, {NOT, SAVE_OPERATOR, PRIMARY, APPLY_OPERATOR}),
+        otherwise(UNARY, {PRIMARY}),
+        rule(PRIMARY, {NEST, LPAREN, EXPRESSION, RPAREN, UNNEST}),
+        rule(PRIMARY, {IDENT, SAVE_NAME, IDENT_PRIMARY}),
+        rule(PRIMARY, {CHECK_LITERAL, NUMLIT, SAVE_OPERAND}),
+        rule(PRIMARY, {TRUESYM, SAVE_OPERAND}),
+        rule(PRIMARY, {FALSESYM, SAVE_OPERAND}),
+        rule(IDENT_PRIMARY, {CHECK_ARRAY, NEST, SUBSCRIPTS, UNNEST}),
+        rule(IDENT_PRIMARY, {CALL}),
+        otherwise(IDENT_PRIMARY, {CHECK_VARIABLE}),
+        // Counted as they are read and checked after the last one
+        rule(SUBSCRIPTS, {LBRACKET, EXPRESSION, RBRACKET, ADD_SUBSCRIPT, MORE_SUBSCRIPTS}),
+        rule(MORE_SUBSCRIPTS, {SUBSCRIPTS}),
+        otherwise(MORE_SUBSCRIPTS, {CHECK_SUBSCRIPTS}),
+        // An argument that turns out to be a lone identifier is recorded
+        // by name, since it may pass an array. The call is checked before
+        // its ')' is consumed.
+        rule(CALL, {START_CALL, NEST, LPAREN, ARGUMENTS, CALL_CLOSE, UNNEST}),
+        rule(ARGUMENTS, {}),
+        otherwise(ARGUMENTS, {ARGUMENT, ARGUMENT_REST}),
+        rule(ARGUMENT_REST, {COMMA, ARGUMENT, ARGUMENT_REST}),
+        otherwise(ARGUMENT_REST, {}),
+        otherwise(ARGUMENT, {START_ARGUMENT, EXPRESSION, ADD_ARGUMENT}),
+        rule(CALL_CLOSE, {CHECK_CALL, RPAREN}),
+    };
+    const int PRODUCTION_COUNT = sizeof(PRODUCTIONS) / sizeof(PRODUCTIONS[0]);
+
+    struct NonterminalInfo {
+        int symbol;
+        // Reported as "Expected: ..." when the lookahead has neither a table
+        // entry nor a fallback production
+        TokenCodes errorToken;
+        // Resolve FIRST/FOLLOW conflicts in favour of FIRST (the dangling else)
+        bool greedy;
+    };
+
+    constexpr NonterminalInfo NONTERMINAL_INFO[NONTERMINALS] = {
+        {PROGRAM, EOI, false},
+        {FUNCTIONS, BOOLSYM, false},
+        {FUNCTION, BOOLSYM, false},
+        {EXTERNAL_REST, LPAREN, false},
+        {RETURN_TYPE, BOOLSYM, false},
+        {PARAMLIST, RPAREN, false},
+        {PARAMETER_REST, RPAREN, false},
+        {PARAMETER, BOOLSYM, false},
+        {PARAMETER_TYPE, BOOLSYM, false},
+        {PARAMETER_NAME, IDENT, false},
+        {PARAMETER_SUFFIX, RPAREN, false},
+        {PARAMETER_EXTENT, RBRACKET, false},
+        {PARAMETER_DIMENSIONS, RPAREN, false},
+        {PARAMETER_SIZE, NUMLIT, false},
+        {FUNCTION_CLOSE, RPAREN, false},
+        {GLOBAL_SUFFIX, COMMA, false},
+        {GLOBAL_REST, COMMA, false},
+        {ARRAY_INITIALIZER, COMMA, false},
+        {SCALAR_INITIALIZER, COMMA, false},
+        {CONSTANT, NUMLIT, false},
+        {CONSTANT_REST, RBRACE, false},
+        {NUMBER, NUMLIT, false},
+        {COMPSTMT, LBRACE, false},
+        {SEQOFSTMT, RBRACE, false},
+        {STATEMENT, IDENT, false},
+        {STATEMENT_BODY, IDENT, false},
+        {DECLARATION_TYPE, BOOLSYM, false},
+        {IDENTLIST, IDENT, false},
+        {IDENT_SUFFIX, COMMA, false},
+        {ARRAY_SIZE, NUMLIT, false},
+        {ARRAY_DIMENSIONS, COMMA, false},
+        {ARRAY_EXTENT, NUMLIT, false},
+        {IDENT_REST, COMMA, false},
+        {IDENT_STATEMENT, SEMICOLON, false},
+        {ELSE_PART, ELSESYM, true},
+        {BLOCK, LBRACE, false},
+        {EXPRESSION, IDENT, false},
+        {OR_TAIL, OR, false},
+        {AND_EXPRESSION, IDENT, false},
+        {AND_TAIL, AND, false},
+        {EQUALITY, IDENT, false},
+        {EQUALITY_TAIL, EQL, false},
+        {RELATIONAL, IDENT, false},
+        {RELATIONAL_TAIL, LSS, false},
+        {TERM, IDENT, false},
+        {TERM_TAIL, PLUS, false},
+        {FACTOR, IDENT, false},
+        {FACTOR_TAIL, TIMES, false},
+        {UNARY, IDENT, false},
+        {PRIMARY, IDENT, false},
+        {IDENT_PRIMARY, IDENT, false},
+        {SUBSCRIPTS, LBRACKET, false},
+        {MORE_SUBSCRIPTS, RBRACKET, false},
+        {CALL, LPAREN, false},
+        {ARGUMENTS, RPAREN, false},
+        {ARGUMENT_REST, RPAREN, false},
+        {ARGUMENT, IDENT, false},
+        {CALL_CLOSE, RPAREN, false},
+    };
+
+    constexpr uint64_t bit(int terminal) { return (uint64_t)1 << terminal; }
+
+    struct ParseTable {
+        uint64_t first[NONTERMINALS];
+        bool nullable[NONTERMINALS];
+        uint64_t follow[NONTERMINALS];
+        // Production to expand for (nonterminal, lookahead), or -1
+        int16_t entry[NONTERMINALS][TERMINALS];
+        int16_t fallback[NONTERMINALS];
+        int conflicts;
+        int conflictNonterminal;
+        int conflictTerminal;
+        bool infoInOrder;
+    };
+
+    // FIRST of rhs[from...]; nullable reports whether all of it can vanish
+    constexpr uint64_t firstOfSequence(const ParseTable& table, const Production& production, int from,
+                                       bool& nullable) {
+        uint64_t set = 0;
+        for (int i = from; i < production.length; i++) {
+            int symbol = production.rhs[i];
+            if (isAction(symbol)) continue;
+            if (isTerminal(symbol)) {
+                nullable = false;
+                return set | bit(symbol);
+            }
+            int index = symbol - FIRST_NONTERMINAL;
+            set |= table.first[index];
+            if (!table.nullable[index]) {
+                nullable = false;
+                return set;
+            }
+        }
+        nullable = true;
+        return set;
+    }
+
+    constexpr void recordConflict(ParseTable& table, int nonterminal, int terminal) {
+        if (table.conflicts++ == 0) {
+            table.conflictNonterminal = nonterminal + FIRST_NONTERMINAL;
+            table.conflictTerminal = terminal;
+        }
+    }
+
+    constexpr ParseTable buildParseTable() {
+        ParseTable table{};
+        table.conflictNonterminal = -1;
+        table.conflictTerminal = -1;
+        table.infoInOrder = true;
+        for (int n = 0; n < NONTERMINALS; n++) {
+            if (NONTERMINAL_INFO[n].symbol != n + FIRST_NONTERMINAL) table.infoInOrder = false;
+        }
+
+        // FIRST sets and nullability, to a fixed point
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const Production& production : PRODUCTIONS) {
+                int lhs = production.lhs - FIRST_NONTERMINAL;
+                bool nullable = false;
+                uint64_t first = firstOfSequence(table, production, 0, nullable);
+                if ((table.first[lhs] | first) != table.first[lhs]) {
+                    table.first[lhs] |= first;
+                    changed = true;
+                }
+                if (nullable && !table.nullable[lhs]) {
+                    table.nullable[lhs] = true;
+                    changed = true;
+                }
+            }
+        }
+
+        // FOLLOW sets; the program is followed by end of input
+        table.follow[PROGRAM - FIRST_NONTERMINAL] = bit(EOI);
+        changed = true;
+        while (changed) {
+            changed = false;
+            for (const Production& production : PRODUCTIONS) {
+                for (int i = 0; i < production.length; i++) {
+                    if (!isNonterminal(production.rhs[i])) continue;
+                    int index = production.rhs[i] - FIRST_NONTERMINAL;
+                    bool nullable = false;
+                    uint64_t follow = firstOfSequence(table, production, i + 1, nullable);
+                    if (nullable) follow |= table.follow[production.lhs - FIRST_NONTERMINAL];
+                    if ((table.follow[index] | follow) != table.follow[index]) {
+                        table.follow[index] |= follow;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        for (int n = 0; n < NONTERMINALS; n++) {
+            table.fallback[n] = -1;
+            for (int t = 0; t < TERMINALS; t++) table.entry[n][t] = -1;
+        }
+
+        // FIRST entries; two productions starting with one token conflict
+        int nullableProductions[NONTERMINALS] = {};
+        for (int p = 0; p < PRODUCTION_COUNT; p++) {
+            const Production& production = PRODUCTIONS[p];
+            int lhs = production.lhs - FIRST_NONTERMINAL;
+            bool nullable = false;
+            uint64_t first = firstOfSequence(table, production, 0, nullable);
+            if (nullable) nullableProductions[lhs]++;
+            if (production.fallback) {
+                if (table.fallback[lhs] >= 0) recordConflict(table, lhs, NAL);
+                table.fallback[lhs] = p;
+            }
+            for (int t = 0; t < TERMINALS; t++) {
+                if (!(first & bit(t))) continue;
+                if (table.entry[lhs][t] >= 0) recordConflict(table, lhs, t);
+                table.entry[lhs][t] = p;
+            }
+        }
+
+        // FOLLOW entries for the empty production. Where FOLLOW meets the
+        // FIRST of another production the grammar is not LL(1), unless the
+        // nonterminal is greedy and that production simply wins.
+        for (int p = 0; p < PRODUCTION_COUNT; p++) {
+            const Production& production = PRODUCTIONS[p];
+            int lhs = production.lhs - FIRST_NONTERMINAL;
+            bool nullable = false;
+            firstOfSequence(table, production, 0, nullable);
+            if (!nullable) continue;
+            if (nullableProductions[lhs] > 1) recordConflict(table, lhs, NAL);
+            for (int t = 0; t < TERMINALS; t++) {
+                if (!(table.follow[lhs] & bit(t))) continue;
+                if (table.entry[lhs][t] >= 0 && table.entry[lhs][t] != p) {
+                    if (!NONTERMINAL_INFO[lhs].greedy) recordConflict(table, lhs, t);
+                } else if (!production.fallback) {
+                    table.entry[lhs][t] = p;
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr ParseTable PARSE_TABLE = buildParseTable();
+
+    static_assert(PARSE_TABLE.infoInOrder, "NONTERMINAL_INFO must list the nonterminals in enum order");
+
+    // Fails the build on a conflict; the compiler's message shows the
+    // nonterminal (see the enum above) and token code involved
+    template <bool HasConflict, int Nonterminal, int Terminal>
+    struct CheckConflicts {};
+
+    template <int Nonterminal, int Terminal>
+    struct CheckConflicts<true, Nonterminal, Terminal> {
+        static_assert(Nonterminal < 0, "grammar is not LL(1): see the template arguments");
+    };
+
+    const int CONFLICT_CHECK = sizeof(CheckConflicts<(PARSE_TABLE.conflicts > 0), PARSE_TABLE.conflictNonterminal,
+                                                     PARSE_TABLE.conflictTerminal>);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Streaming implementation of the XXH64 algorithm (xxHash, 64-bit variant).
+// Used to key on-disk cache entries by source content; it is not a
+// cryptographic hash.
+class Hash64
+{
+private:
+    uint64_t accumulators[4];
+    uint64_t seed;
+    uint64_t totalLength;
+    unsigned char buffer[32];
+    size_t bufferSize;
+
+    static uint64_t round(uint64_t accumulator, uint64_t input);
+    static uint64_t mergeRound(uint64_t accumulator, uint64_t value);
+
+public:
+    Hash64(uint64_t seed = 0);
+    void reset(uint64_t seed = 0);
+    void update(const void* data, size_t length);
+    void update(const string& text);
+    uint64_t digest() const;
+
+    static uint64_t hash(const void* data, size_t length, uint64_t seed = 0);
+    static uint64_t hash(const string& text, uint64_t seed = 0);
+    static string toHex(uint64_t value);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef INCREMENTALCOMPILER_H
+#define INCREMENTALCOMPILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CompileCache.h"
+#include "Diagnostics.h"
+#include "SymbolTable.h"
+
+using namespace std;
+
+class SemanticAnalyzer;
+
+// Byte range of one top-level function in the source text
+struct FunctionChunk {
+    size_t begin;
+    size_t end;
+    int startLine;
+    uint64_t bodyHash;
+};
+
+// Everything a function's analysis contributed to the compilation, enough
+// to replay it without lexing, parsing or checking the function again.
+// Lines are those of the function when it was analysed, starting at
+// startLine; lineOffsets are where line numbers were printed in output.
+struct FunctionResult {
+    bool syntaxError;
+    string syntaxMessage;
+    int syntaxLine;
+    int startLine;
+    string output;
+    vector<size_t> lineOffsets;
+    DiagnosticEngine diagnostics;
+    vector<SymbolInfo> globals;
+    vector<SymbolInfo> declarations;
+
+    FunctionResult() : syntaxError(false), syntaxLine(0), startLine(1) {}
+};
+
+// Where each function of the last compilation lives and what it declares.
+// The result's lines are lineDelta lines above the function's.
+struct FunctionOutline {
+    FunctionChunk chunk;
+    const FunctionResult* result;
+    int lineDelta;
+};
+
+// Re-analyses a program one function at a time, reusing the results of
+// functions whose text and visible global declarations are unchanged.
+//
+// A function's key combines the hash of its source text with a hash of
+// the global symbols declared before it, so editing a body invalidates
+// only that function while changing a signature also invalidates every
+// function after it. Neither depends on line numbers: a function that
+// only moved is replayed with its lines shifted. Results are kept in
+// memory for the lifetime of the object and, when a cache is supplied,
+// on disk across compiler runs.
+class IncrementalCompiler {
+private:
+    map<uint64_t, FunctionResult> results;
+    vector<FunctionOutline> outline;
+    CompileCache* cache;
+    int functionsAnalyzed;
+    int functionsReused;
+
+    const FunctionResult* findResult(uint64_t key);
+    const FunctionResult* saveResult(uint64_t key, const FunctionResult& result);
+    FunctionResult analyzeChunk(const string& text, const FunctionChunk& chunk, SemanticAnalyzer& analyzer, ostringstream& output);
+    void replayChunk(const FunctionResult& result, int lineDelta, SemanticAnalyzer& analyzer, ostream& output);
+
+    static string serialize(const FunctionResult& result);
+    static bool deserialize(const string& payload, FunctionResult& result);
+    static uint64_t hashGlobals(uint64_t previous, const vector<SymbolInfo>& globals);
+
+public:
+    static const size_t MAX_RESULTS_IN_MEMORY = 65536;
+
+    IncrementalCompiler(CompileCache* cache = nullptr);
+
+    // Analyses source and prints the same report as SyntaxAnalyzer::Program().
+    // Returns true when semantic errors were found; throws SyntaxError after
+    // printing the report of the first syntax error. When diagnostics is
+    // given it receives the semantic diagnostics found either way.
+    bool compile(const string& source, ostream& out, DiagnosticEngine* diagnostics = nullptr);
+
+    int getFunctionsAnalyzed() const;
+    int getFunctionsReused() const;
+    // Functions of the most recent compile(); valid until the next one
+    const vector<FunctionOutline>& getOutline() const;
+    void printStatistics(ostream& os) const;
+
+    static vector<FunctionChunk> splitFunctions(const string& source);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Minimal JSON document model for the editor protocol and machine-readable
+// reports. Objects keep their keys sorted, which makes output deterministic.
+class JsonValue {
+public:
+    enum Kind { NULL_VALUE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+private:
+    Kind kind;
+    bool booleanValue;
+    double numberValue;
+    string stringValue;
+    vector<JsonValue> items;
+    map<string, JsonValue> members;
+
+    static bool parseValue(const string& text, size_t& pos, JsonValue& value, int depth);
+    static bool parseString(const string& text, size_t& pos, string& value);
+    static void writeString(string& out, const string& value);
+    void write(string& out) const;
+
+public:
+    JsonValue();
+    JsonValue(bool value);
+    JsonValue(int value);
+    JsonValue(long long value);
+    JsonValue(double value);
+    JsonValue(const char* value);
+    JsonValue(const string& value);
+
+    static JsonValue array();
+    static JsonValue object();
+
+    Kind getKind() const;
+    bool isNull() const;
+    bool asBool() const;
+    double asNumber() const;
+    long long asInteger() const;
+    const string& asString() const;
+
+    // Arrays
+    size_t size() const;
+    const JsonValue& at(size_t index) const;
+    void push(const JsonValue& value);
+
+    // Objects; missing members read as null
+    bool has(const string& key) const;
+    const JsonValue& get(const string& key) const;
+    JsonValue& operator[](const string& key);
+    vector<string> keys() const;
+
+    string serialize() const;
+    static bool parse(const string& text, JsonValue& value);
+
+    // Appends value as a quoted JSON string, for writers that stream output
+    static void appendQuoted(string& out, const string& value);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef LANGUAGESERVER_H
+#define LANGUAGESERVER_H
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IncrementalCompiler.h"
+#include "Json.h"
+#include "TokenCodes.h"
+
+using namespace std;
+
+// One token of an open document, positioned in the current text
+struct IndexedToken {
+    int offset;
+    int line;
+    TokenCodes code;
+    string lexeme;
+};
+
+// An open editor buffer. The token index is patched in place on every edit
+// and the incremental compiler keeps the analysis of unchanged functions.
+struct OpenDocument {
+    string text;
+    int version;
+    vector<int> lineStarts;
+    vector<IndexedToken> tokens;
+    IncrementalCompiler compiler;
+
+    OpenDocument() : version(0) {}
+};
+
+// Language Server Protocol over stdin/stdout.
+//
+// Supports incremental text synchronisation, publishes diagnostics after
+// every change and answers go-to-definition from the line numbers recorded
+// in the symbol table. Edits relex the token index, which go-to-definition
+// searches, only from the token in front of the change until the new
+// tokens line up with the old ones again; everything after that point is
+// shifted rather than rescanned. Diagnostics do not use the index: the
+// incremental compiler splits the whole text into functions again and
+// reparses those whose text changed. Positions are counted in bytes, which
+// matches UTF-16 columns for this ASCII-only language.
+class LanguageServer {
+private:
+    istream& in;
+    ostream& out;
+    map<string, unique_ptr<OpenDocument>> documents;
+    bool shutdownRequested;
+    bool exitRequested;
+    long long tokensRelexed;
+
+    bool readMessage(string& payload);
+    void sendMessage(const JsonValue& message);
+    void respond(const JsonValue& id, const JsonValue& result);
+    void respondError(const JsonValue& id, int code, const string& message);
+    void handleMessage(const JsonValue& message);
+
+    void didOpen(const JsonValue& params);
+    void didChange(const JsonValue& params);
+    void didClose(const JsonValue& params);
+    JsonValue definition(const JsonValue& params);
+
+    void analyze(const string& uri, OpenDocument& document);
+    void indexLines(OpenDocument& document);
+    void relex(OpenDocument& document, int start, int removedLength, int insertedLength, int lineDelta);
+    int positionToOffset(const OpenDocument& document, const JsonValue& position) const;
+    JsonValue makePosition(const OpenDocument& document, int offset) const;
+    JsonValue makeRange(const OpenDocument& document, int begin, int end) const;
+    JsonValue lineRange(const OpenDocument& document, int line) const;
+
+public:
+    LanguageServer(istream& input = cin, ostream& output = cout);
+
+    // Serves the session; returns 0 after shutdown and exit, 1 otherwise
+    int run();
+
+    // Replaces a byte range of the document and patches its token index
+    void applyEdit(OpenDocument& document, int start, int removedLength, const string& insertedText);
+    static void tokenize(OpenDocument& document);
+    long long getTokensRelexed() const;
+};
+
+#endif
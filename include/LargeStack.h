@@ -0,0 +1,19 @@
+#ifndef LARGESTACK_H
+#define LARGESTACK_H
+
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+// Runs body to completion on a freshly mapped stack of stackBytes, on the
+// calling thread (so thread-local statistics and trace buffers still see
+// it). The stack is reserved, not committed: only the pages a deep parse
+// actually touches use memory. A guard page below it turns an overflow
+// into a fault instead of silent corruption.
+//
+// Exceptions thrown by body are rethrown on the caller's stack. Returns
+// false, without running body, if the stack cannot be mapped.
+bool runOnLargeStack(size_t stackBytes, const function<void()>& body);
+
+#endif
@@ -1,7 +1,7 @@
 #ifndef LEXICALANALYZER_H
 #define LEXICALANALYZER_H
 
-#include <fstream>
+#include <iostream>
 #include <string>
 
 #include "Token.h"
@@ -13,25 +13,45 @@ class LexicalAnalyzer
 {
 private:
     static const int LEXEME_COUNT = 37;
-    string lexemes[LEXEME_COUNT] = {"+", "-", "*", "/", "%", "(", ")", "{", "}", ",", ";", "||", "&&",
-                        "=", "==", "!", "!=", "<", "<=", ">", ">=", "bool", "do", "else", "false", "float", "for",
-                        "if", "int", "printf", "return", "scanf", "true", "void", "while", "[", "]"};
-  ifstream *sourceCodeFile;
-  bool validLexeme(string &, char, string[]);
+    // Shared by every instance, so creating a lexer allocates no strings
+    static const string lexemes[LEXEME_COUNT];
+  istream *sourceCodeFile;
+  ostream &out;
+  bool validLexeme(string &, char, const string[]);
   bool checkLongLexeme(string &, string &);
-  TokenCodes tokenCodeSolver(string &, string[]);
-  bool checkNextCharacter(string &, string &, string[]);
+  TokenCodes tokenCodeSolver(string &, const string[]);
+  bool checkNextCharacter(string &, string &, const string[]);
   int currentTokenPosition;
+  int currentLine;
+  int offset;
+  bool readCharacter(char &);
   
   // Helper functions for better code organization
   bool isAlpha(char c) const;
   bool isDigit(char c) const;
   bool isWhitespace(char c) const;
 
+  // Scanner driven by the automaton generated from TokenPatterns.h
+  Token *scanToken();
+  // Sets the value of a number token, or makes a malformed one NAL
+  void decodeNumber(Token *, const string &);
+
 public:
-  LexicalAnalyzer(ifstream *);
-  Token *getNextToken();
+  // Scan with the generated DFA instead of the hand-written rules; both
+  // produce the same tokens. Set per thread, like the other compile
+  // options (see TinyC::CompileOptions).
+  static thread_local bool useDfa;
+
+  LexicalAnalyzer(istream *, ostream &output = cout);
+  virtual ~LexicalAnalyzer() {}
+  // Overridden by PipelinedLexer, which hands out tokens scanned ahead on
+  // another thread
+  virtual Token *getNextToken();
+  // Offset of the most recent token's first character from the start of input
   int getCurrentTokenPosition();
+  int getCurrentLine();
+  // Continue numbering from a position inside a larger document
+  void setStartPosition(int startOffset, int startLine);
 };
 
 #endif
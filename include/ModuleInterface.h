@@ -0,0 +1,109 @@
+#ifndef MODULEINTERFACE_H
+#define MODULEINTERFACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SymbolTable.h"
+
+using namespace std;
+
+// Binary module interface (.tci): the global scope of a compiled file, so
+// other files can import its declarations instead of repeating them.
+//
+// The file is mapped read-only and used where it lies. Opening it checks
+// only the header and section sizes; a symbol is decoded into a
+// SymbolInfo the first time a lookup asks for it, so importing a large
+// interface costs the same as importing a small one until it is used.
+//
+// Layout, in host byte order (the header records it), every section
+// following the last:
+//   Header
+//   Record[symbolCount]        in declaration order
+//   uint32_t[bucketCount]      open-addressed name index: record + 1, 0 empty
+//   Parameter[parameterCount]  parameter types of every record, in order
+//   int32_t[extentCount]       array dimensions of records and parameters
+//   char[poolBytes]            names, not terminated
+class ModuleInterface {
+public:
+    static const uint16_t VERSION = 3;
+
+    // Writes globals to path, replacing any file there atomically
+    static bool write(const string& path, const vector<SymbolInfo>& globals, string& error);
+    // Maps the interface at path; null with error set if it is not one
+    static shared_ptr<const ModuleInterface> open(const string& path, string& error);
+
+    ~ModuleInterface();
+    ModuleInterface(const ModuleInterface&) = delete;
+    ModuleInterface& operator=(const ModuleInterface&) = delete;
+
+    // Decodes the symbol called name. False if there is none, or if its
+    // record is malformed.
+    bool find(string_view name, SymbolInfo& symbol) const;
+
+    size_t size() const;
+    const string& getPath() const;
+    // XXH64 of everything after the header, as written; keys cached results
+    uint64_t getContentHash() const;
+
+private:
+    struct Header {
+        char magic[4];
+        uint16_t version;
+        uint16_t byteOrder;
+        uint32_t symbolCount;
+        uint32_t bucketCount;
+        uint32_t parameterCount;
+        uint32_t poolBytes;
+        uint32_t extentCount;
+        uint32_t reserved;
+        uint64_t contentHash;
+        uint64_t fileBytes;
+    };
+
+    struct Record {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t hash;
+        uint8_t dataType;
+        uint8_t symbolType;
+        uint8_t isArray;
+        uint8_t dimensionCount;
+        int32_t lineNumber;
+        int32_t arraySize;
+        uint32_t firstExtent;
+        uint32_t firstParameter;
+        uint32_t parameterCount;
+    };
+
+    struct Parameter {
+        uint8_t dataType;
+        uint8_t dimensionCount;
+        uint16_t reserved;
+        uint32_t firstExtent;
+    };
+
+    string path;
+    const char* mapping;
+    size_t mappedBytes;
+    const Header* header;
+    const Record* records;
+    const uint32_t* buckets;
+    const Parameter* parameters;
+    const int32_t* extents;
+    const char* pool;
+
+    ModuleInterface();
+
+    static uint32_t hashName(string_view name);
+    bool decode(const Record& record, SymbolInfo& symbol) const;
+    // Extents at first, all positive but the first of a parameter's,
+    // which may be 0
+    bool decodeDimensions(uint32_t first, uint32_t count, bool parameter, vector<int>& dimensions) const;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "LexicalAnalyzer.h"
+#include "Token.h"
+
+using namespace std;
+
+// One preprocessing directive, parsed from its line. A line that cannot
+// be parsed becomes an ERROR directive, reported only if it is reached
+// outside a skipped #ifdef group.
+struct Directive {
+    enum Kind { INCLUDE, DEFINE, UNDEF, IFDEF, IFNDEF, ELSE, ENDIF, PRAGMA_ONCE, IGNORED, ERROR };
+
+    Kind kind;
+    int line;
+    // INCLUDE: the file; DEFINE, UNDEF, IFDEF, IFNDEF: the macro name;
+    // ERROR: the message
+    string argument;
+    // INCLUDE: <file> rather than "file"
+    bool system;
+    // DEFINE: the replacement tokens
+    vector<Token> body;
+    // Headers: number of the header's tokens that come before it
+    size_t position;
+
+    Directive() : kind(IGNORED), line(0), system(false), position(0) {}
+};
+
+// A header as the preprocessor replays it: its tokens, lexed once, with
+// its directives between them to be applied at every inclusion
+struct TokenizedHeader {
+    string path;
+    string directory;
+    vector<Token> tokens;
+    vector<Directive> directives;
+};
+
+// Process-wide cache of tokenized headers keyed by path, modification
+// time and size, so a header included by many files, or by the same file
+// compiled again, is read and lexed once. Safe to use from any thread.
+class HeaderCache {
+public:
+    static HeaderCache& instance();
+
+    // The header at path (already canonical), lexed now unless the cached
+    // copy is of the file as it is on disk. Null with error set if the
+    // file cannot be read.
+    shared_ptr<const TokenizedHeader> load(const string& path, string& error);
+    size_t size() const;
+    void clear();
+
+private:
+    struct Entry {
+        int64_t modified;
+        int64_t bytes;
+        shared_ptr<const TokenizedHeader> header;
+    };
+
+    mutable mutex lock;
+    unordered_map<string, Entry> entries;
+
+    HeaderCache() {}
+};
+
+// Turns each directive line of a source into an empty line, so the lexer
+// never sees it and line numbers still hold, and queues the directive.
+// Reads one line at a time, so streamed input stays in constant memory.
+class DirectiveFilter : public streambuf {
+private:
+    streambuf* source;
+    deque<Directive>& directives;
+    string line;
+    int lineNumber;
+
+protected:
+    int_type underflow() override;
+
+public:
+    DirectiveFilter(streambuf* source, deque<Directive>& directives);
+
+    static Directive parse(const string& text, int line);
+};
+
+// Preprocessor ahead of the lexer, for --preprocess: #include "file" and
+// <file>, object-like #define and #undef, #ifdef, #ifndef, #else, #endif
+// and #pragma once. Other #pragma lines are ignored.
+//
+// Hands out the tokens of the source and its headers with macros
+// expanded and skipped groups dropped, echoing each one as the lexer
+// would. Tokens from a header carry the header's line numbers.
+class Preprocessor : public LexicalAnalyzer {
+public:
+    // Set per thread, like the other compile options (see
+    // TinyC::CompileOptions). Quoted includes search the including
+    // header's directory, then includePaths; <file> searches only
+    // includePaths. The command line puts the source's own directory
+    // first.
+    static thread_local bool enabled;
+    static thread_local vector<string> includePaths;
+
+    static const int MAX_INCLUDE_DEPTH = 200;
+
+private:
+    // A header being replayed, or a macro being expanded (body set)
+    struct Frame {
+        shared_ptr<const TokenizedHeader> header;
+        size_t nextToken;
+        size_t nextDirective;
+        size_t conditionalDepth;
+        const vector<Token>* body;
+        uint32_t macro;
+        int line;
+    };
+
+    struct Conditional {
+        bool taken;
+        bool enclosingActive;
+        bool sawElse;
+        int line;
+
+        bool active() const { return enclosingActive && (sawElse ? !taken : taken); }
+    };
+
+    ostream discard;
+    deque<Directive> pending;
+    DirectiveFilter filter;
+    istream filtered;
+    LexicalAnalyzer scanner;
+    ostream& echo;
+    Token* lookahead;
+    vector<Frame> frames;
+    int headerDepth;
+    vector<Conditional> conditionals;
+    unordered_map<uint32_t, vector<Token>> macros;
+    unordered_set<string> onceFiles;
+
+    Token* nextRawToken();
+    bool skipping() const;
+    bool expanding(uint32_t macro) const;
+    void apply(const Directive& directive, const TokenizedHeader* file);
+    void include(const Directive& directive, const TokenizedHeader* file);
+    void endOfFile(size_t conditionalDepth);
+    [[noreturn]] void fail(const string& message, int line);
+
+public:
+    Preprocessor(istream* source, ostream& output = cout);
+    ~Preprocessor() override;
+
+    Token* getNextToken() override;
+
+    // Lexes text (a header's contents) into tokens and directives
+    static void tokenize(const string& text, TokenizedHeader& header);
+};
+
+#endif
@@ -1,64 +1,120 @@
 #ifndef SEMANTICANALYZER_H
 #define SEMANTICANALYZER_H
 
+#include "DataLayout.h"
+#include "Diagnostics.h"
 #include "SymbolTable.h"
 #include "TokenCodes.h"
+#include <iostream>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 using namespace std;
 
+// A constant in the initializer of a global: a literal, negated if it
+// followed a '-', or true or false (1 and 0, typed BOOL)
+struct InitialValue {
+    DataType type;
+    double value;
+};
+
+// A parameter as the parser reads it: its type, and for an array its
+// extents with the first 0 if it was left out
+struct ParameterDeclaration {
+    TokenCodes type;
+    vector<int> dimensions;
+};
+
+// An argument as the parser reads it: its name if it is a lone
+// identifier, which may pass an array, else StringInterner::EMPTY; and
+// the type of its value, UNKNOWN where that is not known
+struct CallArgument {
+    uint32_t name;
+    DataType type;
+};
+
 class SemanticAnalyzer {
 private:
     SymbolTable* symbolTable;
-    vector<string> errors;
-    vector<string> warnings;
+    DiagnosticEngine diagnostics;
+    DataLayout dataLayout;
     int currentLine;
+    ostream& out;
     
 public:
-    SemanticAnalyzer();
+    SemanticAnalyzer(ostream& output = cout);
     ~SemanticAnalyzer();
     
     // Symbol table operations
     void enterScope();
     void exitScope();
-    bool declareVariable(const string& name, TokenCodes type, int line);
-    bool declareArray(const string& name, TokenCodes type, int size, int line);
-    bool declareFunction(const string& name, TokenCodes returnType, const vector<TokenCodes>& paramTypes, int line);
-    bool declareParameter(const string& name, TokenCodes type, int line);
+    // The ID for a name the parser has read; inside a function it is
+    // local to the function (see StringInterner::internLocal)
+    uint32_t internName(const string& text);
+    bool declareVariable(uint32_t name, TokenCodes type, int line);
+    // Extents outermost first: {64, 64} for m[64][64]
+    bool declareArray(uint32_t name, TokenCodes type, const vector<int>& dimensions, int line);
+    // A local array whose length is only known at run time: the first
+    // extent is 0, and length names the int variable it was declared
+    // with (a[n]), or is StringInterner::EMPTY for one left to allocate()
+    bool declareDynamicArray(uint32_t name, TokenCodes type, const vector<int>& dimensions, uint32_t length,
+                             int line);
+    bool declareFunction(uint32_t name, TokenCodes returnType, const vector<ParameterDeclaration>& parameters,
+                         int line);
+    // No dimensions declares a scalar
+    bool declareParameter(uint32_t name, TokenCodes type, const vector<int>& dimensions, int line);
+    // Checks the initializer of a global just declared with
+    // declareVariable() or declareArray() and places it in static data
+    bool defineGlobal(uint32_t name, const vector<InitialValue>& values, int line);
     
-    // Semantic checks
-    bool checkVariableUsage(const string& name, int line);
-    bool checkArrayAccess(const string& name, int line);
-    bool checkFunctionCall(const string& name, int paramCount, int line);
-    bool checkAssignment(const string& varName, DataType expressionType, int line);
+    // Semantic checks. Those of an operand return its type, or UNKNOWN
+    // where an error was reported.
+    DataType checkVariableUsage(uint32_t name, int line);
+    bool checkArrayAccess(uint32_t name, int line);
+    // After the subscripts of an access that checkArrayAccess() allowed:
+    // there must be one per dimension
+    DataType checkSubscripts(uint32_t name, int subscripts, int line);
+    bool checkLiteral(const string& text, DataType type, bool outOfRange, int line);
+    // allocate(a, n) is built in unless the program declares its own
+    // allocate; it returns VOID
+    DataType checkFunctionCall(uint32_t name, const vector<CallArgument>& arguments, int line);
+    bool checkAssignment(uint32_t varName, DataType expressionType, int line);
     bool checkReturnType(DataType returnType, DataType expectedType, int line);
     
     // Type checking
-    DataType getVariableType(const string& name);
+    DataType getVariableType(uint32_t name);
     DataType checkBinaryOperation(DataType left, DataType right, TokenCodes op, int line);
     DataType checkUnaryOperation(DataType operand, TokenCodes op, int line);
+    // The result of an operation, without reporting: UNKNOWN where the
+    // checks above would report an error
+    DataType operationType(DataType left, DataType right, TokenCodes op);
+    DataType operationType(DataType operand, TokenCodes op);
     
     // Error and warning management
-    void addError(const string& message);
-    void addWarning(const string& message);
+    void report(DiagnosticCode code, uint32_t symbol = 0, DataType first = DataType::UNKNOWN,
+                DataType second = DataType::UNKNOWN, int firstNumber = 0, int secondNumber = 0);
     bool hasErrors() const;
     bool hasWarnings() const;
     void printErrors() const;
     void printWarnings() const;
     void printSemanticReport() const;
+    const DiagnosticEngine& getDiagnostics() const;
+    void restoreDiagnostics(const DiagnosticEngine& previous, int lineDelta = 0);
     
     // Utility functions
     void setCurrentLine(int line);
     void printSymbolTable() const;
+    SymbolTable* getSymbolTable() const;
+    const DataLayout& getDataLayout() const;
     
 private:
     // Helper functions
+    bool checkDimensions(uint32_t name, const vector<int>& dimensions, bool unsizedFirst);
+    bool checkAllocate(uint32_t name, const vector<CallArgument>& arguments);
     bool isNumericType(DataType type);
     bool isCompatibleTypes(DataType type1, DataType type2);
     DataType getPromotedType(DataType type1, DataType type2);
-    string formatError(const string& message, int line);
-    string formatWarning(const string& message, int line);
 };
 
 #endif
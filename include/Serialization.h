@@ -0,0 +1,21 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Length-prefixed "<length>:<bytes>" fields used for cache payloads and the
+// compile-server protocol. Readers advance pos and return false on
+// truncated or malformed input.
+void putField(string& out, const string& value);
+void putNumber(string& out, long long value);
+void putStrings(string& out, const vector<string>& values);
+
+bool getField(const string& in, size_t& pos, string& value);
+bool getNumber(const string& in, size_t& pos, long long& value);
+bool getStrings(const string& in, size_t& pos, vector<string>& values);
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+
+// Compiler phases that are timed separately. The phases call each other
+// (the parser pulls tokens and drives semantic checks, which consult the
+// symbol table), so each phase is charged only for its own time: entering
+// a nested phase pauses the enclosing one.
+enum class Phase {
+    LEXER,
+    PARSER,
+    SEMANTIC,
+    SYMBOL_TABLE,
+    COUNT
+};
+
+enum class Counter {
+    TOKENS_LEXED,
+    SCOPES_ENTERED,
+    SYMBOLS_DECLARED,
+    SYMBOL_LOOKUPS,
+    LOOKUP_SCOPES_SEARCHED,
+    DIAGNOSTICS,
+    // Identifiers hashed by the string interner, once per occurrence
+    IDENTIFIER_HASHES,
+    // Symbols decoded from imported module interfaces
+    IMPORTED_SYMBOLS,
+    // --preprocess: headers lexed, headers replayed from the header
+    // cache, and macro names replaced
+    HEADERS_LEXED,
+    HEADERS_REUSED,
+    MACRO_EXPANSIONS,
+    // --incremental: functions parsed and checked, and functions whose
+    // earlier results were replayed
+    FUNCTIONS_ANALYZED,
+    FUNCTIONS_REPLAYED,
+    // Token batches through the --pipeline queue, and how often the lexer
+    // found it full or the parser found it empty
+    QUEUE_BATCHES,
+    QUEUE_PRODUCER_WAITS,
+    QUEUE_CONSUMER_WAITS,
+    COUNT
+};
+
+// Per-thread timing and counters for one compilation.
+//
+// Collection is off unless the driver enables it, and compiling with
+// TINYC_NO_STATS removes every hook from the build. Phase times come from
+// the monotonic clock; CPU time is sampled once per compilation, because a
+// thread CPU clock read costs several times more than the work between
+// two phase transitions.
+class CompileStatistics {
+private:
+    static const int MAX_NESTING = 32;
+    typedef chrono::steady_clock Clock;
+
+    Phase stack[MAX_NESTING];
+    int depth;
+    Clock::time_point mark;
+    Clock::time_point compileStart;
+    uint64_t cpuStartNanos;
+
+public:
+    static bool enabled;
+
+    uint64_t phaseNanos[(int)Phase::COUNT];
+    uint64_t phaseEntries[(int)Phase::COUNT];
+    uint64_t counters[(int)Counter::COUNT];
+    uint64_t maxLookupDepth;
+    uint64_t totalNanos;
+    uint64_t cpuNanos;
+
+    CompileStatistics();
+    static CompileStatistics& current();
+
+    void reset();
+    void beginCompile();
+    void endCompile();
+    void enter(Phase phase);
+    void leave();
+    void recordLookup(int scopesSearched);
+    // Adds the phases, counters and CPU time of a compilation stage that
+    // ran on another thread; wall time stays this thread's
+    void merge(const CompileStatistics& other);
+
+    // Innermost active phase, or Phase::COUNT outside every phase
+    Phase currentPhase() const {
+        if (depth == 0) return Phase::COUNT;
+        return stack[depth < MAX_NESTING ? depth - 1 : MAX_NESTING - 1];
+    }
+
+    // High-water mark of the process's resident set, in kilobytes
+    static long peakResidentKilobytes();
+
+    void printTimeReport(ostream& os, bool json) const;
+    void printCounters(ostream& os, bool json) const;
+
+    static const char* phaseName(Phase phase);
+    static const char* counterName(Counter counter);
+};
+
+// Charges the enclosing block to a phase
+class PhaseScope {
+private:
+    bool active;
+
+public:
+    explicit PhaseScope(Phase phase) : active(CompileStatistics::enabled) {
+        if (active) CompileStatistics::current().enter(phase);
+    }
+    ~PhaseScope() {
+        if (active) CompileStatistics::current().leave();
+    }
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+};
+
+#ifdef TINYC_NO_STATS
+#define TINYC_PHASE(phase) ((void)0)
+#define TINYC_COUNT(counter, amount) ((void)0)
+#define TINYC_RECORD_LOOKUP(scopes) ((void)0)
+#else
+#define TINYC_PHASE(phase) PhaseScope phaseScope(phase)
+#define TINYC_COUNT(counter, amount) \
+    do { \
+        if (CompileStatistics::enabled) CompileStatistics::current().counters[(int)(counter)] += (amount); \
+    } while (0)
+#define TINYC_RECORD_LOOKUP(scopes) \
+    do { \
+        if (CompileStatistics::enabled) CompileStatistics::current().recordLookup(scopes); \
+    } while (0)
+#endif
+
+#endif
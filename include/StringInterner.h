@@ -0,0 +1,109 @@
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Process-wide table of identifier spellings. Each distinct string is
+// stored once, in an arena that never moves, and named by a 32-bit ID:
+// the parser interns every identifier as it reads it, and from then on
+// symbol tables and diagnostics compare and hash IDs instead of strings.
+// ID 0 is the empty string.
+//
+// Any number of threads may intern at once. Strings a thread has seen
+// recently are found in a small per-thread cache without locking; the
+// rest go to one of 16 shards, chosen by hash, each with its own lock and
+// arena. Looking up the text of an ID never locks.
+//
+// Entries are never removed, so only global and function names go in
+// the shared table. A name first seen inside a function body gets a
+// local ID from a per-thread table instead (internLocal), which the
+// semantic analyzer empties when the function ends. Memory then grows
+// with the number of functions and globals, not with the size of the
+// input. Anything that keeps a name past its function, such as a
+// diagnostic, calls globalize() first.
+class StringInterner {
+public:
+    static const uint32_t EMPTY = 0;
+
+    static StringInterner& instance();
+
+    uint32_t intern(string_view text);
+    // The ID of text if it is already interned, EMPTY if not
+    uint32_t find(string_view text);
+    // The global ID of text if there is one, else an ID local to this
+    // thread, valid until releaseLocals()
+    uint32_t internLocal(string_view text);
+    void releaseLocals();
+    // A global ID for the same text as id
+    uint32_t globalize(uint32_t id);
+    static bool isLocal(uint32_t id) { return (id & LOCAL_BIT) != 0; }
+    // A local ID may only be viewed on the thread that interned it
+    string_view view(uint32_t id) const;
+
+    size_t size() const;
+    // Arena, entry and hash table bytes held by the table
+    uint64_t memoryBytes() const;
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+private:
+    static const uint32_t LOCAL_BIT = 1u << 31;
+    static const int SHARD_BITS = 4;
+    static const int SHARDS = 1 << SHARD_BITS;
+    static const int BLOCK_BITS = 12;
+    static const uint32_t BLOCK_SIZE = 1u << BLOCK_BITS;
+    static const uint32_t MAX_BLOCKS = 1u << 16;
+    // Arena chunks double from the first size to the largest
+    static const size_t FIRST_CHUNK = 4 * 1024;
+    static const size_t ARENA_CHUNK = 64 * 1024;
+
+    struct Entry {
+        const char* text;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    // Open-addressed set of IDs (0 marks an empty slot, since the empty
+    // string never reaches a shard) with the arena that backs their text
+    struct alignas(64) Shard {
+        mutex lock;
+        vector<uint32_t> slots;
+        size_t count;
+        vector<unique_ptr<char[]>> chunks;
+        char* cursor;
+        size_t remaining;
+        uint64_t arenaBytes;
+
+        Shard() : count(0), cursor(nullptr), remaining(0), arenaBytes(0) {}
+    };
+
+    Shard shards[SHARDS];
+    // Entries in fixed blocks, so an ID's entry stays put as the table
+    // grows and readers need no lock
+    unique_ptr<atomic<Entry*>[]> blocks;
+    mutex blockLock;
+    atomic<uint32_t> nextId;
+
+    StringInterner();
+    ~StringInterner();
+
+    static uint32_t hashOf(string_view text);
+    const Entry& entry(uint32_t id) const;
+    bool matches(uint32_t id, string_view text, uint32_t hash) const;
+    uint32_t search(string_view text, uint32_t hash, bool add);
+    uint32_t insert(Shard& shard, string_view text, uint32_t hash);
+    const char* store(Shard& shard, string_view text);
+    void grow(Shard& shard);
+};
+
+#endif
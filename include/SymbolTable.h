@@ -1,61 +1,104 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
+#include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 #include <iostream>
+#include "DataType.h"
 #include "TokenCodes.h"
 
 using namespace std;
 
-enum class DataType {
-    INT,
-    FLOAT,
-    BOOL,
-    VOID,
-    UNKNOWN
-};
-
 enum class SymbolType {
     VARIABLE,
     FUNCTION,
     PARAMETER
 };
 
+// A function parameter's type. An array parameter is passed by reference:
+// the callee gets the caller's block, never a copy. Its extents are
+// outermost first, and the first is 0 where the declaration leaves it out
+// (int a[]); the length then travels with each call.
+struct ParameterType {
+    DataType type;
+    vector<int> dimensions;
+};
+
 struct SymbolInfo {
-    string name;
+    // Interned name (see StringInterner)
+    uint32_t name;
     DataType dataType;
     SymbolType symbolType;
     int scopeLevel;
     int lineNumber;
     bool isInitialized;
     
-    // Array-specific information
+    // Array-specific information. An array is one contiguous block in
+    // row-major order: element m[i][j] of int m[R][C] is number
+    // i * strides[0] + j * strides[1] of arraySize, with strides[0] == C.
+    // The strides are fixed at compile time and the last is always 1, so
+    // an access costs one multiply-add per dimension but the last. An
+    // array parameter of unknown length, and a local array whose length
+    // is only known at run time, have arraySize 0.
     bool isArray;
     int arraySize;
+    vector<int> dimensions;
+    vector<int> strides;
     
     // Function-specific information
-    vector<DataType> parameterTypes;
+    vector<ParameterType> parameterTypes;
     int parameterCount;
     
-    SymbolInfo() : dataType(DataType::UNKNOWN), symbolType(SymbolType::VARIABLE), 
+    SymbolInfo() : name(0), dataType(DataType::UNKNOWN), symbolType(SymbolType::VARIABLE), 
                    scopeLevel(0), lineNumber(0), isInitialized(false), 
                    isArray(false), arraySize(0), parameterCount(0) {}
     
-    SymbolInfo(string n, DataType dt, SymbolType st, int scope, int line) 
+    SymbolInfo(uint32_t n, DataType dt, SymbolType st, int scope, int line) 
         : name(n), dataType(dt), symbolType(st), scopeLevel(scope), 
           lineNumber(line), isInitialized(false), isArray(false), 
           arraySize(0), parameterCount(0) {}
+
+    // Makes this an array of the given extents, outermost first, whose
+    // product must fit an int
+    void setDimensions(const vector<int>& extents);
 };
 
+class ModuleInterface;
+
+// Scopes are keyed by interned name, so a lookup compares integers and
+// never touches the text of a name
 class SymbolTable {
+public:
+    // Module interfaces (--import) searched after every scope, kept per
+    // thread like the other compile options
+    static thread_local vector<shared_ptr<const ModuleInterface>> imports;
+
 private:
-    vector<map<string, SymbolInfo>> scopes;
+    vector<map<uint32_t, SymbolInfo>> scopes;
+    vector<uint32_t> globalOrder;
+    vector<SymbolInfo>* declarationLog;
+    vector<size_t>* lineMarks;
     int currentScope;
+    ostream& out;
+    // Imported symbols decoded so far; they are not part of any scope
+    map<uint32_t, SymbolInfo> imported;
+
+    SymbolInfo* lookupImport(uint32_t name);
+    void logDeclaration(const SymbolInfo& symbol);
+
+    // A line number for the trace, noted in lineMarks as it is printed
+    struct MarkedLine {
+        int lineNumber;
+        vector<size_t>* marks;
+    };
+    MarkedLine markedLine(int lineNumber) const;
+    friend ostream& operator<<(ostream& out, const MarkedLine& line);
     
 public:
-    SymbolTable();
+    SymbolTable(ostream& output = cout);
     ~SymbolTable();
     
     // Scope management
@@ -64,16 +107,29 @@ public:
     int getCurrentScope() const;
     
     // Symbol operations
-    bool insertSymbol(const string& name, DataType type, SymbolType symbolType, int lineNumber);
-    bool insertArray(const string& name, DataType type, int size, int lineNumber);
-    bool insertFunction(const string& name, DataType returnType, const vector<DataType>& paramTypes, int lineNumber);
-    SymbolInfo* lookupSymbol(const string& name);
-    SymbolInfo* lookupInCurrentScope(const string& name);
+    bool insertSymbol(uint32_t name, DataType type, SymbolType symbolType, int lineNumber);
+    bool insertArray(uint32_t name, DataType type, SymbolType symbolType, const vector<int>& dimensions,
+                     int lineNumber);
+    bool insertFunction(uint32_t name, DataType returnType, const vector<ParameterType>& paramTypes, int lineNumber);
+    SymbolInfo* lookupSymbol(uint32_t name);
+    SymbolInfo* lookupInCurrentScope(uint32_t name);
     
     // Utility functions
-    bool isDeclared(const string& name);
-    bool isDeclaredInCurrentScope(const string& name);
-    DataType getSymbolType(const string& name);
+    bool isDeclared(uint32_t name);
+    bool isDeclaredInCurrentScope(uint32_t name);
+    DataType getSymbolType(uint32_t name);
+    
+    // Global scope access for restoring previously analysed functions
+    const map<uint32_t, SymbolInfo>& getGlobalScope() const;
+    const vector<uint32_t>& getGlobalInsertionOrder() const;
+    
+    // Record a copy of every successful declaration, including locals that
+    // are discarded when their scope exits (nullptr stops recording)
+    void setDeclarationLog(vector<SymbolInfo>* log);
+    // Record the output offset of every line number printed, so a
+    // replayed trace can be renumbered (nullptr stops recording)
+    void setLineMarks(vector<size_t>* marks);
+    void restoreGlobalSymbol(const SymbolInfo& symbol);
     
     // Debug and display
     void printSymbolTable() const;
@@ -83,6 +139,14 @@ public:
     static DataType tokenToDataType(TokenCodes token);
     static string dataTypeToString(DataType type);
     static string symbolTypeToString(SymbolType type);
+    // "[64][64]" for an array, "[][64]" for one of unknown length, empty
+    // for a scalar
+    static string dimensionsToString(const vector<int>& dimensions);
+    // Identifies the imports for cache keys; empty when there are none
+    static string importsKey();
+
+private:
+    static vector<const SymbolInfo*> sortedByName(const map<uint32_t, SymbolInfo>& scope);
 };
 
 #endif
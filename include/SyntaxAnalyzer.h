@@ -1,6 +1,7 @@
 #ifndef SYNTAXANALYZER_H
 #define SYNTAXANALYZER_H
 
+#include <stdexcept>
 #include <vector>
 #include "LexicalAnalyzer.h"
 #include "Token.h"
@@ -9,56 +10,111 @@
 
 using namespace std;
 
+// Thrown by SyntaxAnalyzer::error() once the diagnostic has been printed,
+// so the driver decides how to terminate instead of the parser.
+class SyntaxError : public runtime_error
+{
+  private:
+    int line;
+
+  public:
+    SyntaxError(const string &message, int l = 0) : runtime_error(message), line(l) {}
+    int getLine() const { return line; }
+};
+
 class SyntaxAnalyzer
 {
+  public:
+    // Blocks and parentheses nested deeper than this are rejected with a
+    // syntax error instead of exhausting the stack
+    static const int DEFAULT_MAX_NESTING = 100000;
+    static thread_local int maxNesting;
+
+    // Stack a parse needs to reach maxNesting, with room for the rest of
+    // the pipeline; see runOnLargeStack()
+    static size_t requiredStackBytes();
+
   private:
     LexicalAnalyzer *la;
     Token *nextToken;
     TokenCodes nextTokenCode;
     SemanticAnalyzer *semanticAnalyzer;
+    bool ownsSemanticAnalyzer;
     int currentLine;
+    int nestingDepth;
+    ostream &out;
+
+    // Counts one level of recursion towards maxNesting
+    class NestingScope
+    {
+      private:
+        SyntaxAnalyzer &parser;
+
+      public:
+        NestingScope(SyntaxAnalyzer &p) : parser(p)
+        {
+          if (++parser.nestingDepth > maxNesting)
+            parser.nestingError();
+        }
+        ~NestingScope() { parser.nestingDepth--; }
+    };
 
   public:
-    SyntaxAnalyzer(LexicalAnalyzer*);
+    SyntaxAnalyzer(LexicalAnalyzer*, ostream &output = cout);
+    SyntaxAnalyzer(LexicalAnalyzer*, SemanticAnalyzer*, ostream &output = cout);
     ~SyntaxAnalyzer();
-    void Unary();
-    void FactorPrime();
-    void Relational();
-    void RelationalPrime();
-    void Equality();
-    void EqualityPrime();
-    void And();
-    void AndPrime();
-    void Or();
-    void OrPrime();
-    void Parameter();
-    void Parameters();
+    DataType Unary();
+    DataType BinaryExpression(int minPrecedence);
+    DataType BinaryTail(DataType left, int minPrecedence);
+    void Parameter(vector<ParameterDeclaration>& paramTypes);
+    void Parameters(vector<ParameterDeclaration>& paramTypes);
     void Functions();
     void Function();
-    void Paramlist(vector<TokenCodes>& paramTypes);
+    void GlobalDeclarations(TokenCodes varType, uint32_t firstName);
+    void Global(TokenCodes varType, uint32_t name);
+    void Constant(vector<InitialValue>& values);
+    void Paramlist(vector<ParameterDeclaration>& paramTypes);
     void error(TokenCodes);
     void Program();
     void Declarations();
     void Declaration();
     void Identlist(TokenCodes varType);
-    void ArrayDeclaration(TokenCodes varType, const string& arrayName);
+    bool ArrayDeclaration(TokenCodes varType, uint32_t arrayName);
+    void Extents(vector<int>& dimensions);
+    int ArraySize();
+    DataType Subscripts(uint32_t arrayName);
     void Compstmt();
     void Seqofstmt();
     void Block();
     void Statement();
-    void Expression();
-    void Term();
-    void Factor();
-    void Primary();
-    void TermPrime();
+    // Expressions return the type of their value, UNKNOWN where it is
+    // not known
+    DataType Expression();
+    DataType Primary();
+    DataType IdentPrimary(uint32_t varName);
+    DataType Call(uint32_t functionName);
+    void Argument(vector<CallArgument>& arguments);
     
     // Semantic analysis methods
     SemanticAnalyzer* getSemanticAnalyzer() const;
     void printSemanticReport() const;
+
+    // Print the syntax error report and throw SyntaxError; shared with
+    // TableParser so both engines report errors identically
+    [[noreturn]] static void reportSyntaxError(ostream &out, TokenCodes expectedToken, Token *nextToken,
+                                               int currentLine);
+    [[noreturn]] static void reportNestingError(ostream &out, int currentLine);
+    [[noreturn]] static void reportInvalidArraySize(ostream &out, const string &sizeStr, int currentLine);
+
+    // Helper method for better error messages
+    static string getTokenDescription(TokenCodes token);
     
 private:
-    // Helper method for better error messages
-    string getTokenDescription(TokenCodes token);
+    void advance();
+    void nestingError();
+
+    // Binding strength of a binary operator token, or 0 for other tokens
+    static int binaryPrecedence(TokenCodes token);
 };
 
 #endif
@@ -0,0 +1,82 @@
+#ifndef TABLEPARSER_H
+#define TABLEPARSER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LexicalAnalyzer.h"
+#include "SemanticAnalyzer.h"
+#include "Token.h"
+#include "TokenCodes.h"
+
+using namespace std;
+
+// Table-driven LL(1) parser, an alternative engine to SyntaxAnalyzer. It
+// runs one loop over an explicit stack of grammar symbols using the parse
+// table built at compile time in Grammar.h, and accepts, rejects and
+// reports exactly as the recursive descent parser does. Selected with
+// --parser=table.
+class TableParser
+{
+  public:
+    static thread_local bool enabled;
+
+  private:
+    LexicalAnalyzer *la;
+    Token *nextToken;
+    Token *previousToken;
+    TokenCodes nextTokenCode;
+    int currentLine;
+    int nestingDepth;
+    SemanticAnalyzer *semanticAnalyzer;
+    ostream &out;
+    vector<uint8_t> stack;
+
+    // Values carried from "save" actions to the declarations that use them
+    TokenCodes returnType;
+    TokenCodes type;
+    uint32_t functionName;
+    uint32_t name;
+    // Extents of the array being declared, and whether its first is only
+    // known at run time, from the variable arrayLength if there is one
+    vector<int> dimensions;
+    bool sizedAtRunTime;
+    uint32_t arrayLength;
+    // Arrays whose subscripts are being read, innermost access last, with
+    // the number read so far
+    vector<pair<uint32_t, int>> accesses;
+    // Parameters of the function being declared
+    vector<ParameterDeclaration> parameters;
+    // Types of the operands and operators of the expressions being read,
+    // innermost last
+    vector<DataType> operands;
+    vector<TokenCodes> operators;
+    // Calls whose arguments are being read, innermost last
+    struct PendingCall {
+        uint32_t function;
+        vector<CallArgument> arguments;
+        // tokensRead when the current argument began
+        uint64_t argumentStart;
+    };
+    vector<PendingCall> calls;
+    uint64_t tokensRead;
+    // The global being declared: whether its declaration succeeded, and
+    // its initializer so far
+    bool declared;
+    bool negate;
+    vector<InitialValue> initialValues;
+
+    void advance();
+    void performAction(int action);
+    void parse();
+
+  public:
+    TableParser(LexicalAnalyzer*, ostream &output = cout);
+    ~TableParser();
+    void Program();
+
+    SemanticAnalyzer* getSemanticAnalyzer() const;
+};
+
+#endif
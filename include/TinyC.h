@@ -0,0 +1,80 @@
+#ifndef TINYC_H
+#define TINYC_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DataLayout.h"
+#include "Diagnostics.h"
+#include "ModuleInterface.h"
+
+using namespace std;
+
+// Embedding API: compiles Tiny C held in memory, for programs that link
+// the compiler (every source file but main.cpp) instead of running it.
+//
+// compile() is reentrant and may run on any number of threads at once.
+// It never exits the process or writes to the standard streams: whatever
+// the command line would print is returned in the result, and failures,
+// syntax errors included, are reported through the status.
+namespace TinyC {
+    // The command line's --parser, --lexer, --pipeline, --max-nesting,
+    // --import, --preprocess, --include-path and diagnostics options. The
+    // compiler keeps them per thread; compile() installs them for the
+    // duration of the call.
+    struct CompileOptions {
+        bool tableParser;
+        bool dfaLexer;
+        bool pipelined;
+        int maxNesting;
+        DiagnosticOptions diagnostics;
+        // Opened with ModuleInterface::open(); may be shared between threads
+        vector<shared_ptr<const ModuleInterface>> imports;
+        bool preprocess;
+        // Searched by #include; relative paths are from the working directory
+        vector<string> includePaths;
+
+        CompileOptions();
+
+        // The options in effect on the calling thread
+        static CompileOptions current();
+        // Makes these the options of the calling thread
+        void apply() const;
+    };
+
+    // Installs options on the calling thread and restores the previous
+    // ones when it goes out of scope, however the scope is left
+    class ScopedOptions {
+    private:
+        CompileOptions saved;
+
+    public:
+        explicit ScopedOptions(const CompileOptions& options);
+        ~ScopedOptions();
+
+        ScopedOptions(const ScopedOptions&) = delete;
+        ScopedOptions& operator=(const ScopedOptions&) = delete;
+    };
+
+    struct CompileResult {
+        // The command line's exit status: 0 on success, 1 for semantic
+        // errors or an internal failure, -1 for a syntax error
+        int status;
+        // Lexer echo and reports, as printed after "Tokens: "
+        string output;
+        DiagnosticEngine diagnostics;
+        // The global scope in declaration order, for ModuleInterface::write()
+        vector<SymbolInfo> globals;
+        // Where the global variables live in static data
+        DataLayout data;
+
+        CompileResult() : status(0) {}
+        bool succeeded() const { return status == 0; }
+    };
+
+    CompileResult compile(string_view source, const CompileOptions& options = CompileOptions());
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 
+#include "DataType.h"
 #include "TokenCodes.h"
 
 using namespace std;
@@ -13,6 +14,14 @@ class Token
   private:
     string lexemeString;
     TokenCodes tokenCode;
+    int lineNumber;
+
+    // Value of a NUMLIT token, decoded once by the lexer; literalType is
+    // INT or FLOAT for literals and UNKNOWN for every other token
+    DataType literalType;
+    int intValue;
+    double floatValue;
+    bool outOfRange;
 
   public:
     Token();
@@ -21,6 +30,15 @@ class Token
     void setLexemeString(string);
     TokenCodes getTokenCode();
     void setTokenCode(TokenCodes);
+    int getLineNumber();
+    void setLineNumber(int);
+    DataType getLiteralType();
+    int getIntValue();
+    double getFloatValue();
+    // Whether the literal does not fit its type; its value is then 0
+    bool isOutOfRange();
+    void setIntValue(int, bool outOfRange = false);
+    void setFloatValue(double, bool outOfRange = false);
     friend ostream& operator<<(ostream& os, const Token& t);
 };
 
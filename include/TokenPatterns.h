@@ -0,0 +1,290 @@
+#ifndef TOKENPATTERNS_H
+#define TOKENPATTERNS_H
+
+#include <cstdint>
+#include <initializer_list>
+#include "TokenCodes.h"
+
+using namespace std;
+
+// Token definitions for the DFA scanner (LexicalAnalyzer::useDfa). The
+// patterns below are turned into a deterministic automaton over byte
+// classes at compile time: bytes that no pattern tells apart share a
+// class, so the transition table has a column per class rather than per
+// byte. The scanner takes the longest match; among patterns matching the
+// same text the first listed wins.
+//
+// The patterns reproduce the hand-written lexer exactly, quirks included:
+// a number absorbs any letters and dots that follow it, and one exponent
+// sign (LexicalAnalyzer::decodeNumber() then rejects malformed ones), "<>"
+// and ":=" are read as one unknown token, and bytes outside ASCII separate
+// tokens like whitespace.
+namespace TokenPatterns {
+    struct ByteSet {
+        uint64_t words[4];
+
+        constexpr bool has(int byte) const { return (words[byte >> 6] >> (byte & 63)) & 1; }
+        constexpr void add(int byte) { words[byte >> 6] |= (uint64_t)1 << (byte & 63); }
+    };
+
+    constexpr ByteSet range(int first, int last) {
+        ByteSet set{};
+        for (int byte = first; byte <= last; byte++) set.add(byte);
+        return set;
+    }
+
+    constexpr ByteSet chars(const char* text) {
+        ByteSet set{};
+        for (; *text; text++) set.add((unsigned char)*text);
+        return set;
+    }
+
+    constexpr ByteSet operator|(ByteSet left, const ByteSet& right) {
+        for (int i = 0; i < 4; i++) left.words[i] |= right.words[i];
+        return left;
+    }
+
+    constexpr ByteSet operator~(ByteSet set) {
+        for (int i = 0; i < 4; i++) set.words[i] = ~set.words[i];
+        return set;
+    }
+
+    // Control characters, space and every byte the lexer reads as a
+    // negative char except 0xFF, which compares equal to EOF
+    constexpr ByteSet WHITESPACE = range(0, 32) | range(128, 254);
+    constexpr ByteSet LETTER = range('a', 'z') | range('A', 'Z');
+    constexpr ByteSet DIGIT = range('0', '9');
+
+    const int MAX_STEPS = 8;
+
+    // One byte from set, or with repeat any number of them (including none)
+    struct Step {
+        ByteSet set;
+        bool repeat;
+    };
+
+    struct Pattern {
+        TokenCodes code;
+        int length;
+        Step steps[MAX_STEPS];
+    };
+
+    constexpr Step one(ByteSet set) { return Step{set, false}; }
+    constexpr Step many(ByteSet set) { return Step{set, true}; }
+
+    constexpr Pattern literal(const char* text, TokenCodes code) {
+        Pattern pattern{code, 0, {}};
+        for (; *text; text++) {
+            ByteSet set{};
+            set.add((unsigned char)*text);
+            pattern.steps[pattern.length++] = one(set);
+        }
+        return pattern;
+    }
+
+    constexpr Pattern sequence(TokenCodes code, initializer_list<Step> steps) {
+        Pattern pattern{code, 0, {}};
+        for (const Step& step : steps) pattern.steps[pattern.length++] = step;
+        return pattern;
+    }
+
+    constexpr Pattern PATTERNS[] = {
+        literal("+", PLUS), literal("-", MINUS), literal("*", TIMES), literal("/", SLASH), literal("%", MOD),
+        literal("(", LPAREN), literal(")", RPAREN), literal("{", LBRACE), literal("}", RBRACE),
+        literal("[", LBRACKET), literal("]", RBRACKET), literal(",", COMMA), literal(";", SEMICOLON),
+        literal("||", OR), literal("&&", AND), literal("=", ASSIGN), literal("==", EQL), literal("!", NOT),
+        literal("!=", NEQ), literal("<", LSS), literal("<=", LEQ), literal(">", GTR), literal(">=", GEQ),
+        literal("bool", BOOLSYM), literal("do", DOSYM), literal("else", ELSESYM), literal("false", FALSESYM),
+        literal("float", FLOATSYM), literal("for", FORSYM), literal("if", IFSYM), literal("int", INTSYM),
+        literal("printf", PRINTFSYM), literal("return", RETURNSYM), literal("scanf", SCANFSYM),
+        literal("true", TRUESYM), literal("void", VOIDSYM), literal("while", WHILESYM),
+        // Two-character operators the language does not have
+        literal("<>", NAL), literal(":=", NAL),
+
+        sequence(IDENT, {one(LETTER), many(LETTER | DIGIT)}),
+        sequence(NUMLIT, {one(DIGIT), many(LETTER | DIGIT | chars("."))}),
+        sequence(NUMLIT, {one(DIGIT), many(LETTER | DIGIT | chars(".")), one(chars("eE")), one(chars("+-")),
+                          many(LETTER | DIGIT | chars("."))}),
+        // Anything else is a one-byte unknown token
+        sequence(NAL, {one(~WHITESPACE)}),
+    };
+    const int PATTERN_COUNT = sizeof(PATTERNS) / sizeof(PATTERNS[0]);
+
+    // NFA positions: (pattern, steps matched so far), numbered pattern by
+    // pattern, so one position past a step is always the next number
+    const int MAX_POSITIONS = 256;
+    const int POSITION_WORDS = MAX_POSITIONS / 64;
+
+    struct PositionSet {
+        uint64_t words[POSITION_WORDS];
+
+        constexpr bool has(int position) const { return (words[position >> 6] >> (position & 63)) & 1; }
+        constexpr void add(int position) { words[position >> 6] |= (uint64_t)1 << (position & 63); }
+        constexpr bool empty() const {
+            for (uint64_t word : words) if (word) return false;
+            return true;
+        }
+        constexpr bool operator==(const PositionSet& other) const {
+            for (int i = 0; i < POSITION_WORDS; i++) if (words[i] != other.words[i]) return false;
+            return true;
+        }
+        constexpr PositionSet operator&(const PositionSet& other) const {
+            PositionSet result{};
+            for (int i = 0; i < POSITION_WORDS; i++) result.words[i] = words[i] & other.words[i];
+            return result;
+        }
+        constexpr PositionSet operator|(const PositionSet& other) const {
+            PositionSet result{};
+            for (int i = 0; i < POSITION_WORDS; i++) result.words[i] = words[i] | other.words[i];
+            return result;
+        }
+        constexpr PositionSet operator~() const {
+            PositionSet result{};
+            for (int i = 0; i < POSITION_WORDS; i++) result.words[i] = ~words[i];
+            return result;
+        }
+        // Every position moved on by one
+        constexpr PositionSet advanced() const {
+            PositionSet result{};
+            for (int i = 0; i < POSITION_WORDS; i++) {
+                result.words[i] = (words[i] << 1) | (i > 0 ? words[i - 1] >> 63 : 0);
+            }
+            return result;
+        }
+    };
+
+    struct Positions {
+        int first[PATTERN_COUNT];
+        int count;
+        // Positions at a repeated step, and for each byte the positions
+        // whose step accepts it
+        PositionSet repeat;
+        PositionSet accepting[256];
+    };
+
+    constexpr Positions numberPositions() {
+        Positions positions{};
+        for (int p = 0; p < PATTERN_COUNT; p++) {
+            positions.first[p] = positions.count;
+            for (int i = 0; i < PATTERNS[p].length && positions.count + i < MAX_POSITIONS; i++) {
+                const Step& s = PATTERNS[p].steps[i];
+                if (s.repeat) positions.repeat.add(positions.count + i);
+                for (int byte = 0; byte < 256; byte++) {
+                    if (s.set.has(byte)) positions.accepting[byte].add(positions.count + i);
+                }
+            }
+            positions.count += PATTERNS[p].length + 1;
+        }
+        return positions;
+    }
+
+    constexpr Positions POSITIONS = numberPositions();
+    static_assert(POSITIONS.count <= MAX_POSITIONS, "too many pattern steps; raise MAX_POSITIONS");
+
+    // State 0 is the dead state; scanning starts in state 1
+    const int MAX_STATES = 160;
+    const int MAX_CLASSES = 64;
+    const int DEAD = 0;
+    const int START = 1;
+
+    struct Automaton {
+        // Byte to class; WHITESPACE bytes are class 0
+        uint8_t byteClass[256];
+        int classCount;
+        uint8_t next[MAX_STATES][MAX_CLASSES];
+        // Token code of the text scanned so far, or NAL + 1 if none
+        uint8_t accept[MAX_STATES];
+        int stateCount;
+        bool overflow;
+        // Whether every state but the start accepts, so the scanner can
+        // stop at the first byte without a transition and never back up
+        bool acceptsEverywhere;
+    };
+
+    // Follows repeated steps, which may match nothing
+    constexpr PositionSet closure(PositionSet set) {
+        while (true) {
+            PositionSet grown = set | (set & POSITIONS.repeat).advanced();
+            if (grown == set) return set;
+            set = grown;
+        }
+    }
+
+    // A repeated step stays put on a match; any other moves on by one
+    constexpr PositionSet step(const PositionSet& set, int byte) {
+        PositionSet matched = set & POSITIONS.accepting[byte];
+        return closure((matched & POSITIONS.repeat) | (matched & ~POSITIONS.repeat).advanced());
+    }
+
+    constexpr Automaton buildAutomaton() {
+        Automaton automaton{};
+
+        // Byte classes: bytes every step treats alike
+        int representative[MAX_CLASSES] = {};
+        automaton.classCount = 0;
+        for (int byte = 0; byte < 256; byte++) {
+            int found = -1;
+            for (int c = 0; c < automaton.classCount && found < 0; c++) {
+                if (POSITIONS.accepting[byte] == POSITIONS.accepting[representative[c]] &&
+                    WHITESPACE.has(byte) == WHITESPACE.has(representative[c])) {
+                    found = c;
+                }
+            }
+            if (found < 0) {
+                if (automaton.classCount == MAX_CLASSES) {
+                    automaton.overflow = true;
+                    return automaton;
+                }
+                found = automaton.classCount++;
+                representative[found] = byte;
+            }
+            automaton.byteClass[byte] = (uint8_t)found;
+        }
+
+        // Subset construction, one column per byte class
+        PositionSet states[MAX_STATES] = {};
+        PositionSet start{};
+        for (int p = 0; p < PATTERN_COUNT; p++) start.add(POSITIONS.first[p]);
+        states[START] = closure(start);
+        automaton.stateCount = START + 1;
+        for (int s = START; s < automaton.stateCount; s++) {
+            for (int c = 0; c < automaton.classCount; c++) {
+                PositionSet target = step(states[s], representative[c]);
+                int found = DEAD;
+                if (!target.empty()) {
+                    for (int t = START; t < automaton.stateCount && found == DEAD; t++) {
+                        if (states[t] == target) found = t;
+                    }
+                    if (found == DEAD) {
+                        if (automaton.stateCount == MAX_STATES) {
+                            automaton.overflow = true;
+                            return automaton;
+                        }
+                        found = automaton.stateCount++;
+                        states[found] = target;
+                    }
+                }
+                automaton.next[s][c] = (uint8_t)found;
+            }
+        }
+
+        // The first listed pattern that has matched decides the token
+        automaton.acceptsEverywhere = true;
+        for (int s = 0; s < automaton.stateCount; s++) {
+            automaton.accept[s] = NAL + 1;
+            for (int p = PATTERN_COUNT - 1; p >= 0; p--) {
+                if (states[s].has(POSITIONS.first[p] + PATTERNS[p].length)) automaton.accept[s] = PATTERNS[p].code;
+            }
+            if (s > START && automaton.accept[s] == NAL + 1) automaton.acceptsEverywhere = false;
+        }
+        return automaton;
+    }
+
+    constexpr Automaton AUTOMATON = buildAutomaton();
+
+    static_assert(!AUTOMATON.overflow, "token patterns need more DFA states or byte classes; raise the limits");
+    static_assert(AUTOMATON.acceptsEverywhere, "every partial token must be a token; the scanner does not back up");
+    static_assert(AUTOMATON.byteClass[' '] == 0, "whitespace must be byte class 0");
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef TOKENPIPELINE_H
+#define TOKENPIPELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+#include "LexicalAnalyzer.h"
+#include "Statistics.h"
+#include "Token.h"
+
+using namespace std;
+
+// Tokens travel between threads in batches, so the queue's indices are
+// touched once per batch rather than once per token
+struct TokenBatch {
+    static const int CAPACITY = 256;
+
+    Token* tokens[CAPACITY];
+    int count;
+};
+
+// Lock-free single-producer, single-consumer ring of token batches. Each
+// side's index sits on its own cache line together with the copy of the
+// other index it last read, so neither side touches the other's line
+// until its copy says the ring is full (or empty). A side that finds it
+// so spins briefly, then yields, then sleeps: the thread it is waiting
+// for may need the same core.
+class TokenQueue {
+public:
+    static const size_t SLOTS = 64;
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    TokenBatch slots[SLOTS];
+
+    // Consumer side
+    alignas(CACHE_LINE) atomic<size_t> head;
+    size_t cachedTail;
+    uint64_t consumerWaits;
+
+    // Producer side
+    alignas(CACHE_LINE) atomic<size_t> tail;
+    size_t cachedHead;
+    uint64_t producerWaits;
+
+    // Set when the consumer gives up early, so the producer stops waiting
+    alignas(CACHE_LINE) atomic<bool> abandoned;
+
+public:
+    TokenQueue();
+
+    // Producer: the slot to fill next, or nullptr once abandoned
+    TokenBatch* reserve();
+    void publish();
+
+    // Consumer: the oldest filled slot, waiting for one if need be
+    TokenBatch* front();
+    void pop();
+    void abandon();
+
+    // Once the producer has stopped: batches published but not popped
+    size_t pending() const;
+    TokenBatch* pendingAt(size_t offset);
+
+    // Times the ring was found full by the producer and empty by the
+    // consumer; each is exact once its side has finished
+    uint64_t getProducerWaits() const;
+    uint64_t getConsumerWaits() const;
+    uint64_t getBatches() const;
+};
+
+// Scans on a thread of its own, a queue ahead of the parser. The parser
+// receives the same tokens in the same order as from LexicalAnalyzer, and
+// each lexeme is echoed when the parser takes its token, so the output
+// interleaves with the semantic messages exactly as before.
+//
+// The scanning thread uses the creating thread's lexer engine. With
+// statistics on, its lexer time and counters are added to the creating
+// thread's, along with the queue's, once end of input has been reached.
+class PipelinedLexer : public LexicalAnalyzer {
+public:
+    // Set per thread, like the other compile options (see
+    // TinyC::CompileOptions)
+    static thread_local bool enabled;
+
+private:
+    ostream discard;
+    LexicalAnalyzer scanner;
+    ostream& echo;
+    TokenQueue queue;
+    TokenBatch* current;
+    int nextIndex;
+    bool finished;
+    int lastLine;
+    exception_ptr failure;
+    CompileStatistics scanStatistics;
+    thread producer;
+
+    void produce(bool dfa, bool collectStatistics);
+    void finish();
+
+public:
+    PipelinedLexer(istream* source, ostream& output = cout);
+    ~PipelinedLexer() override;
+
+    Token* getNextToken() override;
+
+    const TokenQueue& getQueue() const;
+};
+
+#endif
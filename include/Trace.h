@@ -0,0 +1,84 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+// One completed span. Names are string literals; the detail (a function
+// name, say) is copied into the event so recording never allocates.
+struct TraceEvent {
+    const char* name;
+    uint64_t startNanos;
+    uint64_t durationNanos;
+    int line;
+    char detail[20];
+};
+
+// Fixed-size ring owned by one thread. Only that thread writes to it, so
+// recording needs no locks or atomics; once full, the oldest events are
+// overwritten and counted as dropped.
+struct TraceBuffer {
+    TraceEvent* events;
+    uint64_t capacity;
+    uint64_t written;
+    int threadId;  // OS thread id, as shown by the trace viewer
+};
+
+// Chrome trace-event recorder (loadable in chrome://tracing and Perfetto).
+//
+// Buffers are registered on a thread's first span and kept until the trace
+// is written, so spans from worker threads that have already exited still
+// appear. The file is written once, at exit.
+class Tracer {
+public:
+    static const uint64_t DEFAULT_CAPACITY = 1 << 18;
+
+    static bool enabled;
+
+    // Starts recording; the trace is written to path when the process exits
+    static void start(const string& path, uint64_t capacityPerThread = DEFAULT_CAPACITY);
+    static bool writeChromeTrace(const string& path);
+
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, int line, const char* detail);
+};
+
+// Records the enclosing block as a complete ("X") event. While tracing is
+// off the constructor's test of Tracer::enabled is the only cost.
+class TraceSpan {
+private:
+    const char* name;
+    uint64_t start;
+    int line;
+    bool active;
+    char detail[20];
+
+public:
+    TraceSpan(const char* spanName, int spanLine = 0) : active(Tracer::enabled) {
+        if (active) {
+            name = spanName;
+            line = spanLine;
+            detail[0] = '\0';
+            start = Tracer::now();
+        }
+    }
+    ~TraceSpan() {
+        if (active) Tracer::record(name, start, line, detail);
+    }
+
+    void setDetail(const string& text) {
+        if (active) {
+            size_t length = text.size() < sizeof(detail) - 1 ? text.size() : sizeof(detail) - 1;
+            memcpy(detail, text.data(), length);
+            detail[length] = '\0';
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+// Bumped whenever compiler output changes, which also invalidates caches
+#define TINYC_VERSION "1.6.0"
+
+#endif
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Throughput benchmarks for Tiny C Compiler
+# Builds bench/benchmark and runs it; arguments are passed through
+# (e.g. ./run_benchmarks.sh --repetitions=20 --cases=functions,nesting)
+
+cd "$(dirname "$0")"
+
+CXX=${CXX:-g++}
+SOURCES="bench/*.cpp runtime/*.cpp $(ls src/*.cpp | grep -v main.cpp)"
+
+echo "Building bench/benchmark..."
+if ! $CXX -std=c++17 -O2 -pthread -Iinclude -Ibench -Iruntime $SOURCES -o bench/benchmark; then
+    echo "Build failed"
+    exit 1
+fi
+
+exec ./bench/benchmark "$@"
@@ -25,10 +25,11 @@ run_test() {
     local test_file=$1
     local expected_result=$2  # "pass" or "fail"
     local test_name=$3
+    local options=$4          # extra compiler flags (optional)
     
     echo -n "Testing $test_name... "
     
-    if ./compiler "$test_file" > /dev/null 2>&1; then
+    if ./compiler $options "$test_file" > /dev/null 2>&1; then
         actual_result="pass"
     else
         actual_result="fail"
@@ -57,6 +58,17 @@ echo ""
 # Valid programs (should pass)
 echo -e "${YELLOW}Valid Programs:${NC}"
 run_test "tests/valid_programs.c" "pass" "Comprehensive valid program"
+run_test "tests/test_functions.c" "pass" "Multiple functions"
+run_test "tests/test_expressions.c" "pass" "Operator precedence and expression statements"
+run_test "tests/test_statements.c" "pass" "Every statement form"
+run_test "tests/test_literals.c" "pass" "Hexadecimal, octal and exponent literals"
+run_test "tests/test_globals.c" "pass" "Global variables and initialized tables"
+run_test "tests/test_matrices.c" "pass" "Multi-dimensional arrays"
+run_test "tests/test_matrices.c" "pass" "Multi-dimensional arrays (table parser)" "--parser=table"
+run_test "tests/test_array_parameters.c" "pass" "Function calls with array arguments"
+run_test "tests/test_array_parameters.c" "pass" "Array arguments (table parser)" "--parser=table"
+run_test "tests/test_dynamic_arrays.c" "pass" "Arrays sized at run time"
+run_test "tests/test_dynamic_arrays.c" "pass" "Arrays sized at run time (table parser)" "--parser=table"
 
 # Syntax errors (should fail)
 echo -e "${YELLOW}Syntax Errors:${NC}"
@@ -65,11 +77,448 @@ run_test "tests/syntax_errors.c" "fail" "Syntax error detection"
 # Semantic errors (should fail)
 echo -e "${YELLOW}Semantic Errors:${NC}"
 run_test "tests/semantic_errors.c" "fail" "Semantic error detection"
+run_test "tests/literal_errors.c" "fail" "Out-of-range literals"
+run_test "tests/global_errors.c" "fail" "Invalid globals and initializers"
+run_test "tests/matrix_errors.c" "fail" "Invalid multi-dimensional arrays"
+run_test "tests/argument_errors.c" "fail" "Mismatched call arguments"
+run_test "tests/dynamic_array_errors.c" "fail" "Invalid run-time array lengths"
 
 # Legacy tests (should pass)
 echo -e "${YELLOW}Legacy Tests:${NC}"
 run_test "tests/test1.c" "pass" "Basic test (legacy)"
 
+# Instrumentation (reports go to stderr and must not change the result)
+echo -e "${YELLOW}Instrumentation:${NC}"
+run_test "tests/valid_programs.c" "pass" "Time report and statistics" "--time-report --stats"
+run_test "tests/syntax_errors.c" "fail" "JSON reports after a syntax error" "--time-report=json --stats=json"
+trace_file=$(mktemp)
+run_test "tests/test_functions.c" "pass" "Chrome trace output" "--trace=$trace_file"
+echo -n "Testing Trace contains function spans... "
+total_tests=$((total_tests + 1))
+if grep -q '"name":"Function"' "$trace_file" && grep -q '"name":"square"' "$trace_file"; then
+    echo -e "${GREEN}✓ PASS${NC}"
+    passed_tests=$((passed_tests + 1))
+else
+    echo -e "${RED}✗ FAIL${NC} (no function spans in trace)"
+    failed_tests=$((failed_tests + 1))
+fi
+rm -f "$trace_file"
+
+# Table-driven parser (output must match recursive descent byte for byte)
+echo -e "${YELLOW}Table-Driven Parser:${NC}"
+for test_file in tests/*.c; do
+    echo -n "Testing Same output from both parsers ($(basename "$test_file"))... "
+    total_tests=$((total_tests + 1))
+    recursive_output=$(./compiler --parser=recursive "$test_file" 2>&1; echo "exit $?")
+    table_output=$(./compiler --parser=table "$test_file" 2>&1; echo "exit $?")
+    if [ "$recursive_output" = "$table_output" ]; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        passed_tests=$((passed_tests + 1))
+    else
+        echo -e "${RED}✗ FAIL${NC} (outputs differ)"
+        failed_tests=$((failed_tests + 1))
+    fi
+done
+
+# DFA scanner (token stream must match the hand-written lexer exactly)
+echo -e "${YELLOW}DFA Scanner:${NC}"
+odd_input=$(mktemp)
+printf 'int x1; 12ab 1.2.3 1. a_b <> := & | && || @ . ! != ==\n\tif iff printf\r\n\x80\xc3\xa9x\xff 007 9' > "$odd_input"
+for test_file in tests/*.c "$odd_input"; do
+    test_label=$(basename "$test_file")
+    [ "$test_file" = "$odd_input" ] && test_label="malformed input"
+    echo -n "Testing Same tokens from both scanners ($test_label)... "
+    total_tests=$((total_tests + 1))
+    if [ "$(./compiler --tokens "$test_file")" = "$(./compiler --tokens --lexer=dfa "$test_file")" ]; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        passed_tests=$((passed_tests + 1))
+    else
+        echo -e "${RED}✗ FAIL${NC} (token streams differ)"
+        failed_tests=$((failed_tests + 1))
+    fi
+done
+rm -f "$odd_input"
+run_test "tests/valid_programs.c" "pass" "Full compilation with the DFA scanner" "--lexer=dfa"
+run_test "tests/syntax_errors.c" "fail" "Syntax errors with the DFA scanner" "--lexer=dfa"
+
+# Deep nesting (generated; the parser runs on its own large stack)
+echo -e "${YELLOW}Deep Nesting:${NC}"
+stress_dir=$(mktemp -d)
+{
+    printf 'int main()\n{\n  int x;\n'
+    printf 'if (x < 1) {\n%.0s' $(seq 20000)
+    printf 'x = 1;\n'
+    printf '}\n%.0s' $(seq 20000)
+    printf '  return x;\n}\n'
+} > "$stress_dir/blocks.c"
+{
+    printf 'int main()\n{\n  int x;\n  x = '
+    printf '(%.0s' $(seq 20000)
+    printf 'x'
+    printf ')%.0s' $(seq 20000)
+    printf ';\n  return x;\n}\n'
+} > "$stress_dir/parens.c"
+run_test "$stress_dir/blocks.c" "pass" "20,000 nested blocks"
+run_test "$stress_dir/parens.c" "pass" "20,000 nested parentheses"
+run_test "$stress_dir/blocks.c" "fail" "Nesting limit" "--max-nesting=10000"
+run_test "$stress_dir/parens.c" "pass" "20,000 nested parentheses (table parser)" "--parser=table"
+run_test "$stress_dir/blocks.c" "fail" "Nesting limit (table parser)" "--parser=table --max-nesting=10000"
+echo -n "Testing Nesting limit diagnostic... "
+total_tests=$((total_tests + 1))
+if ./compiler --max-nesting=10000 "$stress_dir/parens.c" 2>/dev/null | grep -q "Nesting too deep"; then
+    echo -e "${GREEN}✓ PASS${NC}"
+    passed_tests=$((passed_tests + 1))
+else
+    echo -e "${RED}✗ FAIL${NC} (no nesting diagnostic)"
+    failed_tests=$((failed_tests + 1))
+fi
+rm -rf "$stress_dir"
+
+# Diagnostics options and machine-readable reports
+echo -e "${YELLOW}Diagnostics:${NC}"
+run_output_test() {
+    local test_name=$1
+    local expected_text=$2
+    shift 2
+
+    echo -n "Testing $test_name... "
+    total_tests=$((total_tests + 1))
+    if "$@" 2>&1 | grep -qF -- "$expected_text"; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        passed_tests=$((passed_tests + 1))
+    else
+        echo -e "${RED}✗ FAIL${NC} (output lacks $expected_text)"
+        failed_tests=$((failed_tests + 1))
+    fi
+}
+run_output_test "Repeated diagnostics reported once" "Errors: 2" ./compiler tests/repeated_errors.c
+run_output_test "Repeated diagnostics kept" "Errors: 7" ./compiler --keep-duplicates tests/repeated_errors.c
+run_output_test "Error cap" "1 more errors not shown" ./compiler --max-errors=1 tests/repeated_errors.c
+run_output_test "Subscript per dimension" "Array 'm' has 2 dimensions, but 3 subscripts" \
+    ./compiler tests/matrix_errors.c
+run_output_test "Array argument shape" "Argument 1 of 'blend' does not match the dimensions of its parameter" \
+    ./compiler --parser=table tests/argument_errors.c
+run_output_test "Global array sized at run time" "Global array 'table' needs a constant size" \
+    ./compiler tests/dynamic_array_errors.c
+run_output_test "Run-time length not an int" "Length of array 'a' must be an int" \
+    ./compiler --parser=table tests/dynamic_array_errors.c
+run_output_test "Allocate into a fixed array" "Argument 1 of 'allocate' must be a local array of run-time length" \
+    ./compiler tests/dynamic_array_errors.c
+run_output_test "Allocated length not an int" "Length of array 'ok' must be an int" \
+    ./compiler --parser=table tests/dynamic_array_errors.c
+run_output_test "Allocated length a float expression" "Error (line 24): Length of array 'ok' must be an int" \
+    ./compiler tests/dynamic_array_errors.c
+run_output_test "Allocated length a bool" "Error (line 25): Length of array 'ok' must be an int" \
+    ./compiler --parser=table tests/dynamic_array_errors.c
+run_test "tests/repeated_errors.c" "pass" "Suppressed diagnostics" "--suppress=undeclared-variable"
+run_test "tests/literal_errors.c" "fail" "Partly suppressed diagnostics" "--suppress=float-literal-range"
+run_output_test "JSON diagnostics" '"errors":5' ./compiler --diagnostics=json tests/literal_errors.c
+run_output_test "SARIF diagnostics" '"ruleId":"syntax-error"' ./compiler --diagnostics=sarif tests/syntax_errors.c
+diagnostics_cache=$(mktemp -d)
+run_output_test "JSON diagnostics (incremental)" '"symbol":"y"' \
+    ./compiler --diagnostics=json --incremental --cache-dir="$diagnostics_cache" tests/repeated_errors.c
+rm -rf "$diagnostics_cache"
+
+# Standard input (read in chunks as it arrives; output must match the file's)
+echo -e "${YELLOW}Standard Input:${NC}"
+run_stdin_test() {
+    local test_file=$1
+    local test_name=$2
+    local options=$3
+
+    echo -n "Testing $test_name... "
+    total_tests=$((total_tests + 1))
+    # The first line names the input, so it is left out of the comparison
+    local expected actual
+    expected=$(./compiler $options "$test_file" 2>&1 | tail -n +2; echo "status ${PIPESTATUS[0]}")
+    actual=$(cat "$test_file" | ./compiler $options - 2>&1 | tail -n +2; echo "status ${PIPESTATUS[1]}")
+    if [ "$expected" = "$actual" ]; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        passed_tests=$((passed_tests + 1))
+    else
+        echo -e "${RED}✗ FAIL${NC} (output differs from compiling the file)"
+        failed_tests=$((failed_tests + 1))
+    fi
+}
+run_stdin_test "tests/valid_programs.c" "Piped valid program"
+run_stdin_test "tests/semantic_errors.c" "Piped semantic errors"
+run_stdin_test "tests/syntax_errors.c" "Piped syntax errors" "--lexer=dfa"
+stdin_dir=$(mktemp -d)
+# Identifiers longer than the 64 KiB read chunk, so tokens straddle chunks
+long_name=$(printf 'v%.0s' $(seq 100000))
+printf 'int main()\n{\n  int %s;\n  %s = 1;\n  return %s;\n}\n' \
+    "$long_name" "$long_name" "$long_name" > "$stdin_dir/long_tokens.c"
+run_stdin_test "$stdin_dir/long_tokens.c" "Tokens across read chunks"
+run_stdin_test "$stdin_dir/long_tokens.c" "Tokens across read chunks (DFA scanner)" "--lexer=dfa"
+rm -rf "$stdin_dir"
+
+# Pipelined lexer (output must match the single-threaded compiler's)
+echo -e "${YELLOW}Pipelined Lexer:${NC}"
+run_pipeline_test() {
+    local test_file=$1
+    local test_name=$2
+    local options=$3
+
+    echo -n "Testing $test_name... "
+    total_tests=$((total_tests + 1))
+    local expected actual
+    expected=$(./compiler $options "$test_file" 2>&1; echo "status $?")
+    actual=$(./compiler --pipeline $options "$test_file" 2>&1; echo "status $?")
+    if [ "$expected" = "$actual" ]; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        passed_tests=$((passed_tests + 1))
+    else
+        echo -e "${RED}✗ FAIL${NC} (output differs from the single-threaded compiler)"
+        failed_tests=$((failed_tests + 1))
+    fi
+}
+run_pipeline_test "tests/valid_programs.c" "Pipelined valid program"
+run_pipeline_test "tests/semantic_errors.c" "Pipelined semantic errors"
+run_pipeline_test "tests/syntax_errors.c" "Pipelined syntax errors (table parser)" "--parser=table"
+run_pipeline_test "tests/test_arrays.c" "Pipelined DFA scanner" "--lexer=dfa"
+run_output_test "Pipeline queue statistics" "Token batches queued" ./compiler --pipeline --stats tests/valid_programs.c
+
+# Module interfaces: declarations written by one compilation, imported by another
+echo -e "${YELLOW}Module Interfaces:${NC}"
+module_dir=$(mktemp -d)
+printf 'int square(int n)\n{\n  return n * n;\n}\n' > "$module_dir/shared.c"
+printf 'int main()\n{\n  int x;\n  square = 1;\n  return 0;\n}\n' > "$module_dir/uses.c"
+printf 'int square(int n)\n{\n  return n;\n}\n' > "$module_dir/redefines.c"
+run_test "$module_dir/shared.c" "pass" "Write an interface" "--emit-interface=$module_dir/functions.tci"
+run_output_test "Compile without the interface" "Undeclared variable 'square'" ./compiler "$module_dir/uses.c"
+run_test "$module_dir/uses.c" "fail" "Imported function used as a variable" "--import=$module_dir/functions.tci"
+run_test "$module_dir/uses.c" "fail" "Imported function (table parser)" "--parser=table --import=$module_dir/functions.tci"
+run_output_test "Imported function redefined" "Function 'square' already declared" \
+    ./compiler --import="$module_dir/functions.tci" "$module_dir/redefines.c"
+run_output_test "Imported symbols counted" "Imported symbols used: 1" \
+    ./compiler --stats --import="$module_dir/functions.tci" "$module_dir/uses.c"
+run_output_test "Not an interface" "is not a module interface" ./compiler --import=tests/test1.c tests/test1.c
+printf 'float grid[4][8];\n' > "$module_dir/grid.c"
+printf 'int main()\n{\n  grid[1] = 2;\n  return 0;\n}\n' > "$module_dir/rows.c"
+run_test "$module_dir/grid.c" "pass" "Write an interface with a matrix" "--emit-interface=$module_dir/grid.tci"
+run_output_test "Imported matrix keeps its dimensions" "Array 'grid' has 2 dimensions, but 1 subscripts" \
+    ./compiler --import="$module_dir/grid.tci" "$module_dir/rows.c"
+printf 'int sum(int values[], int count)\n{\n  return values[0] + count;\n}\n' > "$module_dir/sum.c"
+printf 'int main()\n{\n  float data[4];\n  return sum(data, 4);\n}\n' > "$module_dir/calls.c"
+run_test "$module_dir/sum.c" "pass" "Write an interface with an array parameter" "--emit-interface=$module_dir/sum.tci"
+run_output_test "Imported parameter keeps its type" "Argument 1 of 'sum' must be an array of int, not float" \
+    ./compiler --import="$module_dir/sum.tci" "$module_dir/calls.c"
+{ printf 'int deep'; printf '[1]%.0s' $(seq 256); printf ';\n'; } > "$module_dir/deep.c"
+run_output_test "Interface refuses 256 dimensions" "'deep' has an array of more than 255 dimensions" \
+    ./compiler --emit-interface="$module_dir/deep.tci" "$module_dir/deep.c"
+rm -rf "$module_dir"
+
+# Static data (--emit-data writes the globals' layout as assembler source)
+echo -e "${YELLOW}Static Data:${NC}"
+data_file=$(mktemp)
+run_test "tests/test_globals.c" "pass" "Write the data layout" "--emit-data=$data_file"
+echo -n "Testing Tables initialized in .data, 32-byte aligned... "
+total_tests=$((total_tests + 1))
+if grep -q '^squares:' "$data_file" && grep -q '\.long 0, 1, 4, 9, 16, 25, 36, 49' "$data_file" &&
+   grep -q '\.data+32: float\[4\]' "$data_file" && grep -q '\.bss+32: int\[1000\]' "$data_file"; then
+    echo -e "${GREEN}✓ PASS${NC}"
+    passed_tests=$((passed_tests + 1))
+else
+    echo -e "${RED}✗ FAIL${NC} (unexpected layout)"
+    failed_tests=$((failed_tests + 1))
+fi
+rm -f "$data_file"
+run_output_test "Too many initializers" "Array 'small' has 2 elements, but 3 initializers" \
+    ./compiler tests/global_errors.c
+run_output_test "Non-constant initializer" "Expected: number literal" \
+    sh -c "printf 'int x = y;\n' | ./compiler -"
+
+# Preprocessor (--preprocess; headers are written to a temporary directory)
+echo -e "${YELLOW}Preprocessor:${NC}"
+pp_dir=$(mktemp -d)
+mkdir "$pp_dir/include"
+printf '#pragma once\n#define SIZE 10\nint scale(int x)\n{\n  return x * SIZE;\n}\n' > "$pp_dir/include/sizes.h"
+printf '#ifndef COMMON_H\n#define COMMON_H\n#include <sizes.h>\n#endif\n' > "$pp_dir/common.h"
+printf '#include "common.h"\n#include "common.h"\n#define DEBUG\nint main()\n{\n  int a;\n#ifdef DEBUG\n  a = SIZE;\n#else\n  a = missing;\n#endif\n  return a;\n}\n' > "$pp_dir/main.c"
+printf '#include "absent.h"\nint main()\n{\n  return 0;\n}\n' > "$pp_dir/absent.c"
+printf '#warning hello\nint main()\n{\n  return 0;\n}\n' > "$pp_dir/unknown.c"
+run_test "$pp_dir/main.c" "pass" "Include, define and ifdef" "--preprocess --include-path=$pp_dir/include"
+run_test "$pp_dir/main.c" "pass" "Preprocessed (DFA lexer, table parser)" \
+    "--preprocess --lexer=dfa --parser=table --include-path=$pp_dir/include"
+run_test "$pp_dir/main.c" "fail" "Directives without --preprocess" ""
+run_output_test "Macro expanded" "a = 10 ;" ./compiler --preprocess --include-path="$pp_dir/include" "$pp_dir/main.c"
+run_output_test "Headers included once" "Headers: 2 lexed" \
+    ./compiler --stats --preprocess --include-path="$pp_dir/include" "$pp_dir/main.c"
+run_output_test "Missing include" "cannot find include file 'absent.h'" ./compiler --preprocess "$pp_dir/absent.c"
+run_output_test "Unknown directive" "unknown directive #warning" ./compiler --preprocess "$pp_dir/unknown.c"
+run_test "tests/valid_programs.c" "pass" "Program without directives" "--preprocess"
+rm -rf "$pp_dir"
+
+# Compilation cache (second run of each file is served from the cache)
+echo -e "${YELLOW}Compilation Cache:${NC}"
+cache_dir=$(mktemp -d)
+run_test "tests/valid_programs.c" "pass" "Cache miss (valid program)" "--cache --cache-dir=$cache_dir"
+run_test "tests/valid_programs.c" "pass" "Cache hit (valid program)" "--cache --cache-dir=$cache_dir"
+run_test "tests/syntax_errors.c" "fail" "Cache miss (syntax errors)" "--cache --cache-dir=$cache_dir"
+run_test "tests/syntax_errors.c" "fail" "Cache hit (syntax errors)" "--cache --cache-dir=$cache_dir"
+
+# Incremental analysis (second run replays every function)
+echo -e "${YELLOW}Incremental Analysis:${NC}"
+run_test "tests/test_functions.c" "pass" "Incremental first run" "--incremental --cache-dir=$cache_dir"
+run_test "tests/test_functions.c" "pass" "Incremental replay" "--incremental --cache-dir=$cache_dir"
+run_test "tests/semantic_errors.c" "fail" "Incremental replay keeps errors" "--incremental --cache-dir=$cache_dir"
+run_test "tests/semantic_errors.c" "fail" "Incremental replay keeps errors (cached)" "--incremental --cache-dir=$cache_dir"
+edited_source="$cache_dir/edited.c"
+printf 'int first(int a)\n{\n  return a;\n}\nint second(int a)\n{\n  return a;\n}\nint main()\n{\n  return first(1) + second(2);\n}\n' \
+    > "$edited_source"
+run_output_test "Incremental run before an edit" "Functions: 3 analyzed, 0 replayed" \
+    ./compiler --incremental --stats --cache-dir="$cache_dir" "$edited_source"
+# Line 7 is the body of second()
+sed -i '7s/return a;/return b;/' "$edited_source"
+run_output_test "Only the edited function re-analyzed" "Functions: 1 analyzed, 2 replayed" \
+    ./compiler --incremental --stats --cache-dir="$cache_dir" "$edited_source"
+run_output_test "Edited function's error reported" "Undeclared variable 'b'" \
+    ./compiler --incremental --cache-dir="$cache_dir" "$edited_source"
+# A line added to first() moves the two functions after it down
+sed -i '2a\  int c;' "$edited_source"
+run_output_test "Moved functions replayed" "Functions: 1 analyzed, 2 replayed" \
+    ./compiler --incremental --stats --cache-dir="$cache_dir" "$edited_source"
+run_output_test "Replayed error renumbered" "Error (line 8): Undeclared variable 'b'" \
+    ./compiler --incremental --cache-dir="$cache_dir" "$edited_source"
+echo -n "Testing Replayed output matches a fresh analysis... "
+total_tests=$((total_tests + 1))
+if [ "$(./compiler --incremental --cache-dir="$cache_dir" "$edited_source" 2>&1)" = \
+     "$(./compiler --incremental --cache-dir="$cache_dir/fresh" "$edited_source" 2>&1)" ]; then
+    echo -e "${GREEN}✓ PASS${NC}"
+    passed_tests=$((passed_tests + 1))
+else
+    echo -e "${RED}✗ FAIL${NC} (output differs from analysing every function again)"
+    failed_tests=$((failed_tests + 1))
+fi
+nested_source="$cache_dir/nested.c"
+{
+    printf 'int main()\n{\n  int x;\n'
+    printf 'if (x < 1) {\n%.0s' $(seq 20)
+    printf 'x = 1;\n'
+    printf '}\n%.0s' $(seq 20)
+    printf '  return x;\n}\n'
+} > "$nested_source"
+run_test "$nested_source" "pass" "Incremental run at the default nesting limit" "--incremental --cache-dir=$cache_dir"
+run_test "$nested_source" "fail" "Nesting limit not replayed from the cache" \
+    "--incremental --cache-dir=$cache_dir --max-nesting=10"
+rm -rf "$cache_dir"
+
+# Compile server (requests forwarded over a Unix socket)
+echo -e "${YELLOW}Compile Server:${NC}"
+server_socket=$(mktemp -u /tmp/tinyc-test.XXXXXX.sock)
+server_log=$(mktemp)
+./compiler --server="$server_socket" --workers=2 > "$server_log" 2>&1 &
+server_pid=$!
+for _ in 1 2 3 4 5 6 7 8 9 10; do [ -S "$server_socket" ] && break; sleep 0.1; done
+run_test "tests/valid_programs.c" "pass" "Server compile (valid program)" "--connect=$server_socket"
+run_test "tests/semantic_errors.c" "fail" "Server compile (semantic errors)" "--connect=$server_socket"
+run_test "tests/syntax_errors.c" "fail" "Server compile (syntax errors)" "--connect=$server_socket"
+server_nested=$(mktemp)
+{
+    printf 'int main()\n{\n  int x;\n'
+    printf 'if (x < 1) {\n%.0s' $(seq 20)
+    printf 'x = 1;\n'
+    printf '}\n%.0s' $(seq 20)
+    printf '  return x;\n}\n'
+} > "$server_nested"
+run_test "$server_nested" "fail" "Server compile keeps the nesting limit" "--connect=$server_socket --max-nesting=10"
+rm -f "$server_nested"
+run_test "tests/repeated_errors.c" "pass" "Server compile keeps suppressed diagnostics" \
+    "--connect=$server_socket --suppress=undeclared-variable"
+server_module=$(mktemp -d ./tinyc-module.XXXXXX)
+printf 'int square(int n)\n{\n  return n * n;\n}\n' > "$server_module/shared.c"
+printf 'int main()\n{\n  return square(3);\n}\n' > "$server_module/uses.c"
+./compiler --emit-interface="$server_module/shared.tci" "$server_module/shared.c" > /dev/null 2>&1
+run_test "$server_module/uses.c" "pass" "Server compile opens a relative import" \
+    "--connect=$server_socket --import=$server_module/shared.tci"
+rm -rf "$server_module"
+run_output_test "Statistics with --connect count a local compile" "Tokens lexed: 17" \
+    ./compiler --connect="$server_socket" --stats tests/test1.c
+server_trace=$(mktemp)
+./compiler --connect="$server_socket" --trace="$server_trace" tests/test_functions.c > /dev/null 2>&1
+run_output_test "Trace with --connect records a local compile" '"name":"Function"' cat "$server_trace"
+rm -f "$server_trace"
+kill -INT $server_pid 2>/dev/null
+wait $server_pid 2>/dev/null
+run_output_test "Server served every request" "stopped after 6 requests" cat "$server_log"
+rm -f "$server_log"
+
+# Language server (JSON-RPC messages framed by Content-Length headers)
+echo -e "${YELLOW}Language Server:${NC}"
+lsp_message() {
+    printf 'Content-Length: %d\r\n\r\n%s' "${#1}" "$1"
+}
+
+run_lsp_test() {
+    local test_file=$1
+    local expected_result=$2  # "pass" if no errors should be published
+    local test_name=$3
+
+    echo -n "Testing $test_name... "
+    local text
+    text=$(sed 's/\\/\\\\/g; s/"/\\"/g; s/\r$//' "$test_file" | awk '{printf "%s\\n", $0}')
+    local output
+    output=$({
+        lsp_message '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}'
+        lsp_message '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///test.c","version":1,"text":"'"$text"'"}}}'
+        lsp_message '{"jsonrpc":"2.0","id":2,"method":"shutdown"}'
+        lsp_message '{"jsonrpc":"2.0","method":"exit"}'
+    } | ./compiler --lsp 2>/dev/null)
+    local status=$?
+
+    if [ $status -ne 0 ] || ! echo "$output" | grep -q '"method":"textDocument/publishDiagnostics"'; then
+        actual_result="broken"
+    elif echo "$output" | grep -q '"severity":1'; then
+        actual_result="fail"
+    else
+        actual_result="pass"
+    fi
+
+    total_tests=$((total_tests + 1))
+    if [ "$actual_result" = "$expected_result" ]; then
+        echo -e "${GREEN}✓ PASS${NC}"
+        passed_tests=$((passed_tests + 1))
+    else
+        echo -e "${RED}✗ FAIL${NC} (expected $expected_result, got $actual_result)"
+        failed_tests=$((failed_tests + 1))
+    fi
+}
+run_lsp_test "tests/valid_programs.c" "pass" "LSP diagnostics (valid program)"
+run_lsp_test "tests/semantic_errors.c" "fail" "LSP diagnostics (semantic errors)"
+run_lsp_test "tests/syntax_errors.c" "fail" "LSP diagnostics (syntax errors)"
+# Edits: fix the undeclared 'y', then insert a line above 'return x;'
+lsp_edit_output=$({
+    lsp_message '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}'
+    lsp_message '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///edit.c","version":1,"text":"int main()\n{\n  int x;\n  y = 1;\n  return x;\n}\n"}}}'
+    lsp_message '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///edit.c","version":2},"contentChanges":[{"range":{"start":{"line":3,"character":2},"end":{"line":3,"character":3}},"text":"x"}]}}'
+    lsp_message '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///edit.c","version":3},"contentChanges":[{"range":{"start":{"line":3,"character":0},"end":{"line":3,"character":0}},"text":"  int z;\n"}]}}'
+    lsp_message '{"jsonrpc":"2.0","id":2,"method":"textDocument/definition","params":{"textDocument":{"uri":"file:///edit.c"},"position":{"line":5,"character":9}}}'
+    lsp_message '{"jsonrpc":"2.0","id":3,"method":"shutdown"}'
+    lsp_message '{"jsonrpc":"2.0","method":"exit"}'
+} | ./compiler --lsp 2>/dev/null)
+run_output_test "LSP didChange clears a fixed error" '"diagnostics":[],"uri":"file:///edit.c","version":2' \
+    printf '%s' "$lsp_edit_output"
+run_output_test "LSP definition after inserting a line" \
+    '"id":2,"jsonrpc":"2.0","result":{"range":{"end":{"character":7,"line":2},"start":{"character":6,"line":2}}' \
+    printf '%s' "$lsp_edit_output"
+# A line inserted in f() moves h(), which is replayed rather than analysed;
+# the global g is logged with f()
+lsp_move_output=$({
+    lsp_message '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}'
+    lsp_message '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///move.c","version":1,"text":"int g;\nint f()\n{\n  return 1;\n}\nint h()\n{\n  int x;\n  return x + g;\n}\n"}}}'
+    lsp_message '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///move.c","version":2},"contentChanges":[{"range":{"start":{"line":3,"character":0},"end":{"line":3,"character":0}},"text":"  int z;\n"}]}}'
+    lsp_message '{"jsonrpc":"2.0","id":2,"method":"textDocument/definition","params":{"textDocument":{"uri":"file:///move.c"},"position":{"line":9,"character":9}}}'
+    lsp_message '{"jsonrpc":"2.0","id":3,"method":"textDocument/definition","params":{"textDocument":{"uri":"file:///move.c"},"position":{"line":9,"character":13}}}'
+    lsp_message '{"jsonrpc":"2.0","id":4,"method":"shutdown"}'
+    lsp_message '{"jsonrpc":"2.0","method":"exit"}'
+} | ./compiler --lsp 2>/dev/null)
+run_output_test "LSP definition of a global" \
+    '"id":3,"jsonrpc":"2.0","result":{"range":{"end":{"character":5,"line":0},"start":{"character":4,"line":0}}' \
+    printf '%s' "$lsp_move_output"
+run_output_test "LSP definition in a moved function" \
+    '"id":2,"jsonrpc":"2.0","result":{"range":{"end":{"character":7,"line":8},"start":{"character":6,"line":8}}' \
+    printf '%s' "$lsp_move_output"
+
 # Summary
 echo ""
 echo "=============================================="
@@ -0,0 +1,92 @@
+#include "Arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+    [[noreturn]] void fail(const char* message, long long value) {
+        fprintf(stderr, "tinyc: %s (%lld)\n", message, value);
+        abort();
+    }
+}
+
+Arena::Arena() : chunk(nullptr), spare(nullptr), top(nullptr), limit(nullptr), chunks(0), reserved(0) {}
+
+Arena::~Arena() {
+    release(nullptr);
+    while (spare) {
+        Chunk* previous = spare->previous;
+        free(spare);
+        spare = previous;
+    }
+}
+
+Arena& Arena::current() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+void* Arena::grow(size_t bytes) {
+    if (bytes > SIZE_MAX - HEADER - ALIGNMENT) fail("run-time array too large, bytes", (long long)bytes);
+    size_t needed = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    // A released chunk that fits, else a new one
+    Chunk** link = &spare;
+    while (*link && (*link)->bytes < needed) link = &(*link)->previous;
+    Chunk* next = *link;
+    if (next) {
+        *link = next->previous;
+    } else {
+        size_t size = reserved < FIRST_CHUNK ? FIRST_CHUNK : reserved;
+        if (size > LARGEST_CHUNK) size = LARGEST_CHUNK;
+        if (size < needed) size = needed;
+        next = static_cast<Chunk*>(aligned_alloc(ALIGNMENT, HEADER + size));
+        if (!next) fail("out of memory for a run-time array, bytes", (long long)bytes);
+        next->bytes = size;
+        chunks++;
+        reserved += size;
+    }
+
+    next->previous = chunk;
+    chunk = next;
+    char* block = begin(chunk);
+    top = block + bytes;
+    limit = block + chunk->bytes;
+    return block;
+}
+
+void Arena::release(char* mark) {
+    // Chunks filled after the mark go back to the spare list; the mark is
+    // in the one left current, or null if it was taken before the first
+    while (chunk && !(mark >= begin(chunk) && mark <= begin(chunk) + chunk->bytes)) {
+        Chunk* released = chunk;
+        chunk = released->previous;
+        released->previous = spare;
+        spare = released;
+    }
+    top = chunk ? mark : nullptr;
+    limit = chunk ? begin(chunk) + chunk->bytes : nullptr;
+}
+
+size_t Arena::chunkCount() const {
+    return chunks;
+}
+
+size_t Arena::reservedBytes() const {
+    return reserved;
+}
+
+extern "C" {
+    void* tinyc_enter(void) {
+        return Arena::current().mark();
+    }
+
+    void* tinyc_allocate(int32_t count, uint32_t elementBytes) {
+        if (count < 0) fail("negative array length", count);
+        return Arena::current().allocate((size_t)count * elementBytes);
+    }
+
+    void tinyc_leave(void* mark) {
+        Arena::current().release(static_cast<char*>(mark));
+    }
+}
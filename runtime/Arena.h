@@ -0,0 +1,92 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Run-time storage for local arrays whose length is only known when the
+// program runs: int a[n]; and float b[]; given its storage by
+// allocate(b, n). Each thread has one arena. A function that declares
+// such arrays takes a mark of its arena on entry, every array it
+// allocates is a pointer bump, and on exit it releases everything
+// allocated since the mark at once. Chunks released that way are kept for
+// later calls, so a program in a steady state makes no system
+// allocations at all.
+//
+// Blocks are not zeroed, and a block given to an array that allocate()
+// then replaces stays in use until the function returns.
+class Arena {
+public:
+    // Every block starts on this boundary, as arrays in static data do
+    // (see DataLayout::VECTOR_ALIGNMENT)
+    static const size_t ALIGNMENT = 32;
+    // Chunks double from the first size to the largest; a larger block
+    // gets a chunk of its own
+    static const size_t FIRST_CHUNK = 64 * 1024;
+    static const size_t LARGEST_CHUNK = 4 * 1024 * 1024;
+
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // The calling thread's arena
+    static Arena& current();
+
+    // Where the next block goes; release() takes it back
+    char* mark() const { return top; }
+
+    // An uninitialized block of bytes. Null only for 0 bytes before
+    // anything has been allocated; aborts if memory runs out.
+    void* allocate(size_t bytes) {
+        // The limit is aligned, so the aligned top never passes it
+        char* block = top + (-(uintptr_t)top & (ALIGNMENT - 1));
+        if ((size_t)(limit - block) >= bytes) {
+            top = block + bytes;
+            return block;
+        }
+        return grow(bytes);
+    }
+
+    // Frees every block allocated since mark was taken
+    void release(char* mark);
+
+    // Chunks held, whether in use or kept for reuse, and their bytes
+    size_t chunkCount() const;
+    size_t reservedBytes() const;
+
+private:
+    // At the start of each chunk, padded to ALIGNMENT; its bytes follow
+    struct Chunk {
+        Chunk* previous;
+        size_t bytes;
+    };
+    static const size_t HEADER = (sizeof(Chunk) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    // The chunk being filled, linked to the ones filled before it
+    Chunk* chunk;
+    // Released chunks, most recent first
+    Chunk* spare;
+    char* top;
+    char* limit;
+    size_t chunks;
+    size_t reserved;
+
+    void* grow(size_t bytes);
+    static char* begin(Chunk* chunk) { return reinterpret_cast<char*>(chunk) + HEADER; }
+};
+
+// The entry points compiled programs call. A function with run-time sized
+// arrays brackets its body with tinyc_enter() and tinyc_leave(), and each
+// array declaration or allocate() is one tinyc_allocate().
+extern "C" {
+    void* tinyc_enter(void);
+    // count elements of elementBytes each; a negative count aborts, as an
+    // out-of-range subscript would
+    void* tinyc_allocate(int32_t count, uint32_t elementBytes);
+    void tinyc_leave(void* mark);
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "AllocationTracker.h"
+#include "Json.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef TINYC_TRACK_ALLOCATIONS
+#include <malloc.h>
+#endif
+
+namespace {
+    // Plain data, so reaching it from operator new never allocates or runs
+    // a constructor
+    thread_local AllocationTracker::Counters threadCounters;
+
+    const size_t SIZE_CLASS_LIMITS[AllocationTracker::SIZE_CLASSES - 1] = {16, 32, 64, 128, 256, 1024, 4096};
+    const char* const SIZE_CLASS_NAMES[AllocationTracker::SIZE_CLASSES] = {
+        "<=16", "<=32", "<=64", "<=128", "<=256", "<=1K", "<=4K", ">4K"};
+
+    double average(uint64_t numerator, uint64_t denominator) {
+        return denominator ? (double)numerator / denominator : 0.0;
+    }
+}
+
+bool AllocationTracker::compiledIn() {
+#ifdef TINYC_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationTracker::Counters& AllocationTracker::current() {
+    return threadCounters;
+}
+
+void AllocationTracker::reset() {
+    threadCounters = Counters();
+}
+
+int AllocationTracker::sizeClass(size_t bytes) {
+    for (int i = 0; i < SIZE_CLASSES - 1; i++) {
+        if (bytes <= SIZE_CLASS_LIMITS[i]) return i;
+    }
+    return SIZE_CLASSES - 1;
+}
+
+const char* AllocationTracker::sizeClassName(int sizeClass) {
+    return SIZE_CLASS_NAMES[sizeClass];
+}
+
+void AllocationTracker::recordAllocation(size_t requested, size_t usable) {
+    Counters& counters = threadCounters;
+    int phase = (int)CompileStatistics::current().currentPhase();
+    counters.allocations[phase]++;
+    counters.bytes[phase] += requested;
+    counters.sizeClasses[sizeClass(requested)]++;
+    counters.liveBytes += usable;
+    if (counters.liveBytes > counters.peakLiveBytes) counters.peakLiveBytes = counters.liveBytes;
+}
+
+void AllocationTracker::recordFree(size_t usable) {
+    Counters& counters = threadCounters;
+    counters.frees++;
+    counters.freedBytes += usable;
+    counters.liveBytes -= usable;
+}
+
+void AllocationTracker::printReport(ostream& os, bool json, const CompileStatistics& statistics) {
+    const Counters& counters = threadCounters;
+    const int phases = (int)Phase::COUNT + 1;
+    uint64_t totalAllocations = 0, totalBytes = 0;
+    for (int i = 0; i < phases; i++) {
+        totalAllocations += counters.allocations[i];
+        totalBytes += counters.bytes[i];
+    }
+
+    // The parser builds no tree, so its bytes are reported per token too
+    uint64_t tokens = statistics.counters[(int)Counter::TOKENS_LEXED];
+    uint64_t symbols = statistics.counters[(int)Counter::SYMBOLS_DECLARED];
+    double lexerPerToken = average(counters.bytes[(int)Phase::LEXER], tokens);
+    double parserPerToken = average(counters.bytes[(int)Phase::PARSER], tokens);
+    double perSymbol = average(counters.bytes[(int)Phase::SYMBOL_TABLE], symbols);
+
+    auto phaseLabel = [](int phase) {
+        return phase == (int)Phase::COUNT ? "other" : CompileStatistics::phaseName((Phase)phase);
+    };
+
+    if (json) {
+        JsonValue report = JsonValue::object();
+        JsonValue byPhase = JsonValue::object();
+        for (int i = 0; i < phases; i++) {
+            JsonValue phase = JsonValue::object();
+            phase["allocations"] = (long long)counters.allocations[i];
+            phase["bytes"] = (long long)counters.bytes[i];
+            byPhase[phaseLabel(i)] = phase;
+        }
+        JsonValue sizes = JsonValue::object();
+        for (int i = 0; i < SIZE_CLASSES; i++) {
+            sizes[SIZE_CLASS_NAMES[i]] = (long long)counters.sizeClasses[i];
+        }
+        report["phases"] = byPhase;
+        report["size_classes"] = sizes;
+        report["allocations"] = (long long)totalAllocations;
+        report["bytes"] = (long long)totalBytes;
+        report["frees"] = (long long)counters.frees;
+        report["freed_bytes"] = (long long)counters.freedBytes;
+        report["peak_live_bytes"] = (long long)counters.peakLiveBytes;
+        report["lexer_bytes_per_token"] = lexerPerToken;
+        report["parser_bytes_per_token"] = parserPerToken;
+        report["symbol_table_bytes_per_symbol"] = perSymbol;
+        os << report.serialize() << endl;
+        return;
+    }
+
+    char line[128];
+    os << "\n=== Allocation Statistics ===" << endl;
+    snprintf(line, sizeof(line), "%-14s %12s %14s %10s", "Phase", "Allocations", "Bytes", "Avg size");
+    os << line << endl;
+    for (int i = 0; i <= phases; i++) {
+        bool isTotal = i == phases;
+        uint64_t allocations = isTotal ? totalAllocations : counters.allocations[i];
+        uint64_t bytes = isTotal ? totalBytes : counters.bytes[i];
+        snprintf(line, sizeof(line), "%-14s %12llu %14llu %10.1f", isTotal ? "total" : phaseLabel(i),
+                 (unsigned long long)allocations, (unsigned long long)bytes, average(bytes, allocations));
+        os << line << endl;
+    }
+    os << "Frees: " << counters.frees << " (" << counters.freedBytes << " bytes)" << endl;
+    os << "Peak live heap: " << counters.peakLiveBytes << " bytes" << endl;
+    os << "Size classes:";
+    for (int i = 0; i < SIZE_CLASSES; i++) {
+        os << " " << SIZE_CLASS_NAMES[i] << "=" << counters.sizeClasses[i];
+    }
+    os << endl;
+    snprintf(line, sizeof(line), "Bytes per token: lexer %.1f, parser %.1f", lexerPerToken, parserPerToken);
+    os << line << endl;
+    snprintf(line, sizeof(line), "Bytes per symbol: %.1f", perSymbol);
+    os << line << endl;
+    os << "=============================" << endl;
+}
+
+#ifdef TINYC_TRACK_ALLOCATIONS
+
+// Replacement global allocation functions. Live bytes are measured with
+// malloc_usable_size so unsized deletes balance their allocations.
+namespace {
+    void* allocate(size_t size) {
+        if (size == 0) size = 1;
+        void* pointer;
+        while ((pointer = malloc(size)) == nullptr) {
+            new_handler handler = get_new_handler();
+            if (!handler) throw bad_alloc();
+            handler();
+        }
+        if (CompileStatistics::enabled) {
+            AllocationTracker::recordAllocation(size, malloc_usable_size(pointer));
+        }
+        return pointer;
+    }
+
+    void release(void* pointer) {
+        if (!pointer) return;
+        if (CompileStatistics::enabled) {
+            AllocationTracker::recordFree(malloc_usable_size(pointer));
+        }
+        free(pointer);
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, const nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const nothrow_t&) noexcept { release(pointer); }
+
+#endif
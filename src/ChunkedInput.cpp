@@ -0,0 +1,32 @@
+#include "ChunkedInput.h"
+
+#include <cerrno>
+
+#include <unistd.h>
+
+ChunkedInputBuffer::ChunkedInputBuffer(int fd, size_t chunkBytes)
+    : descriptor(fd), chunk(chunkBytes > 0 ? chunkBytes : 1), failed(false) {
+    setg(chunk.data(), chunk.data(), chunk.data());
+}
+
+// Called once the lexer has consumed the whole chunk: the previous one is
+// overwritten, so at most one chunk of source is ever held
+streambuf::int_type ChunkedInputBuffer::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    ssize_t received;
+    do {
+        received = read(descriptor, chunk.data(), chunk.size());
+    } while (received < 0 && errno == EINTR);
+
+    if (received <= 0) {
+        failed = received < 0;
+        return traits_type::eof();
+    }
+    setg(chunk.data(), chunk.data(), chunk.data() + received);
+    return traits_type::to_int_type(*gptr());
+}
+
+bool ChunkedInputBuffer::readFailed() const {
+    return failed;
+}
@@ -0,0 +1,334 @@
+#include "CompileCache.h"
+#include "Hash.h"
+#include "Version.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char ENTRY_MAGIC[4] = {'T', 'C', 'C', '1'};
+    const size_t ENTRY_HEADER_SIZE = 4 + 8 + 8 + 8;
+    const string ENTRY_SUFFIX = ".entry";
+    const time_t STALE_TEMPORARY_SECONDS = 3600;
+
+    void appendUint64(string& out, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    uint64_t readUint64(const char* p) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--) {
+            value = (value << 8) | static_cast<unsigned char>(p[i]);
+        }
+        return value;
+    }
+
+    bool endsWith(const string& text, const string& suffix) {
+        return text.size() >= suffix.size() &&
+               text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool makeDirectories(const string& path) {
+        if (path.empty()) return false;
+        for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+            string prefix = path.substr(0, pos);
+            if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+            if (pos == string::npos) break;
+        }
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    }
+
+    struct EntryFile {
+        string path;
+        uint64_t size;
+        time_t lastUsed;
+    };
+}
+
+CompileCache::CompileCache(const string& dir, uint64_t maximum)
+    : directory(dir), maxBytes(maximum), usable(false) {
+    while (directory.size() > 1 && directory.back() == '/') {
+        directory.pop_back();
+    }
+    usable = makeDirectories(directory) && access(directory.c_str(), W_OK) == 0;
+}
+
+CompileCache::~CompileCache() {
+    flushStatistics();
+}
+
+bool CompileCache::isUsable() const {
+    return usable;
+}
+
+const string& CompileCache::getDirectory() const {
+    return directory;
+}
+
+string CompileCache::entryPath(uint64_t key) const {
+    return directory + "/" + Hash64::toHex(key) + ENTRY_SUFFIX;
+}
+
+string CompileCache::temporaryPath() const {
+    static atomic<unsigned> counter(0);
+    return directory + "/tmp." + to_string(getpid()) + "." + to_string(counter++) +
+           "." + to_string(rand());
+}
+
+bool CompileCache::lookup(uint64_t key, string& payload) {
+    if (!usable) return false;
+
+    string path = entryPath(key);
+    ifstream entry(path, ios::in | ios::binary);
+    if (!entry.is_open()) {
+        pending.misses++;
+        return false;
+    }
+
+    string contents((istreambuf_iterator<char>(entry)), istreambuf_iterator<char>());
+    entry.close();
+
+    bool valid = contents.size() >= ENTRY_HEADER_SIZE &&
+                 contents.compare(0, 4, ENTRY_MAGIC, 4) == 0 &&
+                 readUint64(contents.data() + 4) == key &&
+                 readUint64(contents.data() + 12) == contents.size() - ENTRY_HEADER_SIZE;
+    if (valid) {
+        payload = contents.substr(ENTRY_HEADER_SIZE);
+        valid = Hash64::hash(payload) == readUint64(contents.data() + 20);
+    }
+    if (!valid) {
+        // Never trust a damaged entry; the next store replaces it
+        unlink(path.c_str());
+        payload.clear();
+        pending.misses++;
+        return false;
+    }
+
+    // Refresh the LRU position; a failure here only affects eviction order
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    pending.hits++;
+    return true;
+}
+
+bool CompileCache::store(uint64_t key, const string& payload) {
+    if (!usable) return false;
+
+    string contents(ENTRY_MAGIC, 4);
+    appendUint64(contents, key);
+    appendUint64(contents, payload.size());
+    appendUint64(contents, Hash64::hash(payload));
+    contents += payload;
+
+    string temporary = temporaryPath();
+    {
+        ofstream entry(temporary, ios::out | ios::binary | ios::trunc);
+        if (!entry.is_open()) return false;
+        entry.write(contents.data(), contents.size());
+        entry.close();
+        if (entry.fail()) {
+            unlink(temporary.c_str());
+            return false;
+        }
+    }
+
+    // rename() is atomic within a directory: concurrent readers observe the
+    // old entry or the new one, and racing writers store identical bytes.
+    if (rename(temporary.c_str(), entryPath(key).c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    // Publishing the new size also tells us whether anyone needs to evict
+    pending.storedBytes += contents.size();
+    CacheStatistics totals = updateStatistics(pending);
+    pending = CacheStatistics();
+    if (totals.storedBytes > maxBytes) {
+        evict();
+    }
+    return true;
+}
+
+void CompileCache::flushStatistics() {
+    if (!usable) return;
+    if (pending.hits || pending.misses || pending.evictions || pending.storedBytes) {
+        updateStatistics(pending);
+        pending = CacheStatistics();
+    }
+}
+
+CacheStatistics CompileCache::updateStatistics(const CacheStatistics& delta, bool resetStoredBytes) {
+    CacheStatistics current;
+    string path = directory + "/stats";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return current;
+
+    if (flock(fd, LOCK_EX) == 0) {
+        char text[256];
+        ssize_t length = pread(fd, text, sizeof(text) - 1, 0);
+        text[length > 0 ? length : 0] = '\0';
+
+        unsigned long long hits = 0, misses = 0, evictions = 0, bytes = 0;
+        if (sscanf(text, "hits %llu misses %llu evictions %llu bytes %llu",
+                   &hits, &misses, &evictions, &bytes) >= 3) {
+            current.hits = hits;
+            current.misses = misses;
+            current.evictions = evictions;
+            current.storedBytes = bytes;
+        }
+
+        current.hits += delta.hits;
+        current.misses += delta.misses;
+        current.evictions += delta.evictions;
+        current.storedBytes = resetStoredBytes ? delta.storedBytes : current.storedBytes + delta.storedBytes;
+
+        int written = snprintf(text, sizeof(text), "hits %llu\nmisses %llu\nevictions %llu\nbytes %llu\n",
+                               (unsigned long long)current.hits, (unsigned long long)current.misses,
+                               (unsigned long long)current.evictions, (unsigned long long)current.storedBytes);
+        if (ftruncate(fd, 0) == 0 && pwrite(fd, text, written, 0) != written) {
+            // Statistics are advisory; a short write is repaired by the next update
+        }
+        flock(fd, LOCK_UN);
+    }
+    close(fd);
+    return current;
+}
+
+CacheStatistics CompileCache::readStatistics() const {
+    CacheStatistics stats;
+    ifstream file(directory + "/stats");
+    string label;
+    unsigned long long value;
+    while (file >> label >> value) {
+        if (label == "hits") stats.hits = value;
+        else if (label == "misses") stats.misses = value;
+        else if (label == "evictions") stats.evictions = value;
+        else if (label == "bytes") stats.storedBytes = value;
+    }
+    // Include this process's lookups that have not been flushed yet
+    stats.hits += pending.hits;
+    stats.misses += pending.misses;
+    return stats;
+}
+
+uint64_t CompileCache::totalSize(uint64_t* entryCount) const {
+    uint64_t total = 0, count = 0;
+    DIR* dir = opendir(directory.c_str());
+    if (dir) {
+        while (struct dirent* item = readdir(dir)) {
+            string name = item->d_name;
+            struct stat info;
+            if (endsWith(name, ENTRY_SUFFIX) &&
+                stat((directory + "/" + name).c_str(), &info) == 0) {
+                total += info.st_size;
+                count++;
+            }
+        }
+        closedir(dir);
+    }
+    if (entryCount) *entryCount = count;
+    return total;
+}
+
+void CompileCache::evict() {
+    string lockPath = directory + "/lock";
+    int fd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+
+    // Only one process scans at a time; the others leave the work to it
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return;
+    }
+
+    vector<EntryFile> entries;
+    uint64_t total = 0;
+    time_t now = time(nullptr);
+    DIR* dir = opendir(directory.c_str());
+    if (dir) {
+        while (struct dirent* item = readdir(dir)) {
+            string name = item->d_name;
+            string path = directory + "/" + name;
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0) continue;
+
+            if (endsWith(name, ENTRY_SUFFIX)) {
+                entries.push_back({path, (uint64_t)info.st_size, info.st_mtime});
+                total += info.st_size;
+            } else if (name.compare(0, 4, "tmp.") == 0 &&
+                       now - info.st_mtime > STALE_TEMPORARY_SECONDS) {
+                // Left behind by a writer that died before renaming
+                unlink(path.c_str());
+            }
+        }
+        closedir(dir);
+    }
+
+    CacheStatistics correction;
+    if (total > maxBytes) {
+        // Evict down to 90% of the limit so we do not rescan on every store
+        uint64_t target = maxBytes - maxBytes / 10;
+        sort(entries.begin(), entries.end(), [](const EntryFile& a, const EntryFile& b) {
+            return a.lastUsed < b.lastUsed;
+        });
+        uint64_t evicted = 0;
+        for (const EntryFile& entry : entries) {
+            if (total <= target) break;
+            if (unlink(entry.path.c_str()) == 0) {
+                total -= entry.size;
+                evicted++;
+            }
+        }
+        correction.evictions = evicted;
+    }
+
+    // The scan is authoritative: replace the running estimate
+    correction.storedBytes = total;
+    updateStatistics(correction, true);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+void CompileCache::printStatistics(ostream& os) const {
+    CacheStatistics stats = readStatistics();
+    uint64_t entries = 0;
+    uint64_t size = totalSize(&entries);
+    uint64_t lookups = stats.hits + stats.misses;
+
+    os << "\n=== Compilation Cache ===" << endl;
+    os << "Directory: " << directory << endl;
+    os << "Entries: " << entries << endl;
+    os << "Size: " << size << " / " << maxBytes << " bytes" << endl;
+    os << "Hits: " << stats.hits << endl;
+    os << "Misses: " << stats.misses << endl;
+    os << "Hit rate: " << (lookups ? (100.0 * stats.hits / lookups) : 0.0) << "%" << endl;
+    os << "Evictions: " << stats.evictions << endl;
+    os << "=========================" << endl;
+}
+
+uint64_t CompileCache::computeKey(const string& source, const string& options) {
+    Hash64 hasher;
+    string header = "tinyc " TINYC_VERSION "\n" + to_string(options.size()) + "\n";
+    hasher.update(header);
+    hasher.update(options);
+    hasher.update(source);
+    return hasher.digest();
+}
@@ -0,0 +1,370 @@
+#include "CompileServer.h"
+#include "Driver.h"
+#include "ModuleInterface.h"
+#include "Serialization.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    const uint64_t MAX_MESSAGE_BYTES = 1ULL << 30;
+    const int ACCEPT_POLL_MILLISECONDS = 250;
+    // Once a message has started, the rest must arrive within this long
+    const int MESSAGE_MILLISECONDS = 10000;
+
+    typedef chrono::steady_clock Clock;
+
+    volatile sig_atomic_t interrupted = 0;
+
+    void handleStopSignal(int) {
+        interrupted = 1;
+    }
+
+    bool writeAll(int fd, const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            length -= written;
+        }
+        return true;
+    }
+
+    bool readAll(int fd, char* data, size_t length, Clock::time_point deadline) {
+        while (length > 0) {
+            long long remaining = chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count();
+            if (remaining <= 0) return false;
+            pollfd ready = {fd, POLLIN, 0};
+            int polled = poll(&ready, 1, (int)remaining);
+            if (polled < 0 && errno == EINTR) continue;
+            if (polled <= 0) return false;
+            ssize_t received = recv(fd, data, length, 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0) return false;
+            data += received;
+            length -= received;
+        }
+        return true;
+    }
+
+    // Messages are an 8-byte little-endian length followed by the payload
+    bool sendMessage(int fd, const string& payload) {
+        char header[8];
+        uint64_t length = payload.size();
+        for (int i = 0; i < 8; i++) {
+            header[i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+        }
+        return writeAll(fd, header, 8) && writeAll(fd, payload.data(), payload.size());
+    }
+
+    // Waits as long as it takes for a message to start, since a response
+    // waits on a compile; a peer that stalls partway is dropped
+    bool receiveMessage(int fd, string& payload) {
+        unsigned char header[8];
+        ssize_t received;
+        do {
+            received = recv(fd, header, 1, 0);
+        } while (received < 0 && errno == EINTR);
+        if (received <= 0) return false;
+        Clock::time_point deadline = Clock::now() + chrono::milliseconds(MESSAGE_MILLISECONDS);
+        if (!readAll(fd, reinterpret_cast<char*>(header) + 1, 7, deadline)) return false;
+        uint64_t length = 0;
+        for (int i = 7; i >= 0; i--) {
+            length = (length << 8) | header[i];
+        }
+        if (length > MAX_MESSAGE_BYTES) return false;
+        payload.resize(length);
+        return length == 0 || readAll(fd, &payload[0], length, deadline);
+    }
+
+    bool fillAddress(const string& socketPath, sockaddr_un& address) {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) return false;
+        strcpy(address.sun_path, socketPath.c_str());
+        return true;
+    }
+}
+
+CompileServer::CompileServer(const string& path, int workers)
+    : socketPath(path), workerCount(workers), listenFd(-1), stopping(false), requestsServed(0) {
+    if (workerCount <= 0) {
+        workerCount = thread::hardware_concurrency();
+        if (workerCount <= 0) workerCount = 4;
+    }
+}
+
+CompileServer::~CompileServer() {
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+}
+
+int CompileServer::run() {
+    sockaddr_un address;
+    if (!fillAddress(socketPath, address)) {
+        cout << "ERROR - socket path too long: " << socketPath << endl;
+        return 1;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        cout << "ERROR - cannot create socket: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    // A socket file left behind by a crashed server would make bind() fail
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        cout << "ERROR - cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+        close(listenFd);
+        listenFd = -1;
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleStopSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    cout << "Compile server listening on " << socketPath << " with "
+         << workerCount << " workers" << endl;
+
+    vector<thread> workers;
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&CompileServer::workerLoop, this);
+    }
+
+    while (!interrupted) {
+        pollfd listening = {listenFd, POLLIN, 0};
+        int ready = poll(&listening, 1, ACCEPT_POLL_MILLISECONDS);
+        if (ready <= 0) continue;
+
+        int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd < 0) continue;
+
+        lock_guard<mutex> lock(queueMutex);
+        pendingClients.push(clientFd);
+        queueReady.notify_one();
+    }
+
+    stopping = true;
+    queueReady.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    cout << "Compile server stopped after " << requestsServed << " requests" << endl;
+    return 0;
+}
+
+void CompileServer::workerLoop() {
+    // Warm state that outlives individual requests
+    IncrementalCompiler incremental;
+
+    while (true) {
+        int clientFd;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return stopping || !pendingClients.empty(); });
+            if (pendingClients.empty()) return;
+            clientFd = pendingClients.front();
+            pendingClients.pop();
+        }
+        serveClient(clientFd, incremental);
+        close(clientFd);
+    }
+}
+
+void CompileServer::serveClient(int clientFd, IncrementalCompiler& incremental) {
+    string payload;
+    while (true) {
+        // Wake up periodically so idle connections cannot block shutdown
+        pollfd client = {clientFd, POLLIN, 0};
+        int ready = poll(&client, 1, ACCEPT_POLL_MILLISECONDS);
+        if (stopping) return;
+        if (ready <= 0) continue;
+        if (!receiveMessage(clientFd, payload)) return;
+
+        CompileRequest request;
+        CompileResponse response;
+        if (decodeRequest(payload, request)) {
+            response = execute(request, &incremental);
+        } else {
+            response.status = 1;
+            response.output = "ERROR - malformed compile request\n";
+        }
+        requestsServed++;
+        if (!sendMessage(clientFd, encodeResponse(response))) return;
+    }
+}
+
+CompileResponse CompileServer::execute(const CompileRequest& request, IncrementalCompiler* incremental) {
+    CompileResponse response;
+    ostringstream output;
+    // Functions are reused by their own text, which a header would not change
+    IncrementalCompiler* reuse = request.incremental && !request.options.preprocess ? incremental : nullptr;
+
+    TinyC::CompileOptions options = request.options;
+    options.imports.clear();
+    for (const string& path : request.importPaths) {
+        string error;
+        shared_ptr<const ModuleInterface> module = ModuleInterface::open(path, error);
+        if (!module) {
+            response.status = 1;
+            response.output = "ERROR - " + error + "\n";
+            return response;
+        }
+        options.imports.push_back(module);
+    }
+    // The incremental state is keyed by every option that changes results,
+    // so one worker may serve clients with different options
+    TinyC::ScopedOptions scope(options);
+
+    if (request.hasSource) {
+        istringstream source(request.source);
+        response.status = compileSource(source, output, reuse);
+    } else {
+        ifstream source(request.path);
+        if (!source.is_open()) {
+            output << "ERROR - cannot open input file: " << request.path << endl;
+            response.status = 1;
+        } else {
+            response.status = compileSource(source, output, reuse);
+        }
+    }
+
+    response.output = output.str();
+    return response;
+}
+
+string CompileServer::encodeRequest(const CompileRequest& request) {
+    string out;
+    putField(out, "compile");
+    putField(out, request.path);
+    putNumber(out, request.hasSource ? 1 : 0);
+    putField(out, request.source);
+    putNumber(out, request.incremental ? 1 : 0);
+
+    const TinyC::CompileOptions& options = request.options;
+    putNumber(out, options.tableParser ? 1 : 0);
+    putNumber(out, options.dfaLexer ? 1 : 0);
+    putNumber(out, options.pipelined ? 1 : 0);
+    putNumber(out, options.maxNesting);
+    putNumber(out, options.diagnostics.deduplicate ? 1 : 0);
+    putNumber(out, options.diagnostics.maxErrors);
+    putField(out, options.diagnostics.suppressed.to_string());
+    putNumber(out, options.preprocess ? 1 : 0);
+    putStrings(out, options.includePaths);
+    putStrings(out, request.importPaths);
+    return out;
+}
+
+bool CompileServer::decodeRequest(const string& payload, CompileRequest& request) {
+    size_t pos = 0;
+    string kind;
+    long long hasSource, incremental;
+    if (!getField(payload, pos, kind) || kind != "compile" ||
+        !getField(payload, pos, request.path) || !getNumber(payload, pos, hasSource) ||
+        !getField(payload, pos, request.source) || !getNumber(payload, pos, incremental)) {
+        return false;
+    }
+    request.hasSource = hasSource != 0;
+    request.incremental = incremental != 0;
+
+    TinyC::CompileOptions& options = request.options;
+    long long tableParser, dfaLexer, pipelined, maxNesting, deduplicate, maxErrors, preprocess;
+    string suppressed;
+    if (!getNumber(payload, pos, tableParser) || !getNumber(payload, pos, dfaLexer) ||
+        !getNumber(payload, pos, pipelined) || !getNumber(payload, pos, maxNesting) ||
+        !getNumber(payload, pos, deduplicate) || !getNumber(payload, pos, maxErrors) ||
+        !getField(payload, pos, suppressed) || !getNumber(payload, pos, preprocess) ||
+        !getStrings(payload, pos, options.includePaths) || !getStrings(payload, pos, request.importPaths)) {
+        return false;
+    }
+    // A client built with other diagnostic codes cannot be understood
+    if (maxNesting < 1 || maxErrors < 0 || suppressed.size() != options.diagnostics.suppressed.size() ||
+        suppressed.find_first_not_of("01") != string::npos) {
+        return false;
+    }
+    options.tableParser = tableParser != 0;
+    options.dfaLexer = dfaLexer != 0;
+    options.pipelined = pipelined != 0;
+    options.maxNesting = maxNesting;
+    options.diagnostics.deduplicate = deduplicate != 0;
+    options.diagnostics.maxErrors = maxErrors;
+    options.diagnostics.suppressed = decltype(options.diagnostics.suppressed)(suppressed);
+    options.preprocess = preprocess != 0;
+    return pos == payload.size();
+}
+
+string CompileServer::encodeResponse(const CompileResponse& response) {
+    string out;
+    putNumber(out, response.status);
+    putField(out, response.output);
+    return out;
+}
+
+bool CompileServer::decodeResponse(const string& payload, CompileResponse& response) {
+    size_t pos = 0;
+    long long status;
+    if (!getNumber(payload, pos, status) || !getField(payload, pos, response.output)) {
+        return false;
+    }
+    response.status = status;
+    return true;
+}
+
+CompileClient::CompileClient() : fd(-1) {}
+
+CompileClient::~CompileClient() {
+    disconnect();
+}
+
+bool CompileClient::connectTo(const string& socketPath) {
+    disconnect();
+    sockaddr_un address;
+    if (!fillAddress(socketPath, address)) return false;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+bool CompileClient::send(const CompileRequest& request, CompileResponse& response) {
+    string payload;
+    return fd >= 0 &&
+           sendMessage(fd, CompileServer::encodeRequest(request)) &&
+           receiveMessage(fd, payload) &&
+           CompileServer::decodeResponse(payload, response);
+}
+
+void CompileClient::disconnect() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
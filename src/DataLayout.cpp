@@ -0,0 +1,109 @@
+#include "DataLayout.h"
+#include "StringInterner.h"
+#include "SymbolTable.h"
+#include "Version.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    const char* sectionName(DataSection section) {
+        return section == DataSection::DATA ? ".data" : ".bss";
+    }
+
+    // Shortest text that reads back as the same float
+    string floatText(double value) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.9g", (double)(float)value);
+        return buffer;
+    }
+}
+
+DataLayout::DataLayout() : sectionEnd() {}
+
+uint32_t DataLayout::elementBytes(DataType type) {
+    return type == DataType::BOOL ? 1 : 4;
+}
+
+void DataLayout::place(uint32_t name, DataType type, const vector<int>& dimensions, const vector<double>& values,
+                       int line) {
+    DataObject object;
+    object.name = name;
+    object.type = type;
+    object.isArray = !dimensions.empty();
+    object.dimensions = dimensions;
+    object.elements = 1;
+    for (int extent : dimensions) object.elements *= extent;
+    object.line = line;
+    object.values = values;
+
+    // An initializer of zeros needs no file space either
+    object.section = DataSection::BSS;
+    for (double value : values) {
+        if (value != 0 || signbit(value)) object.section = DataSection::DATA;
+    }
+    if (object.section == DataSection::BSS) object.values.clear();
+
+    uint32_t size = elementBytes(type);
+    object.alignment = size;
+    if (object.isArray && type != DataType::BOOL) object.alignment = VECTOR_ALIGNMENT;
+    object.bytes = (uint64_t)size * object.elements;
+
+    uint64_t& end = sectionEnd[(int)object.section];
+    object.offset = (end + object.alignment - 1) / object.alignment * object.alignment;
+    end = object.offset + object.bytes;
+    objects.push_back(object);
+}
+
+const vector<DataObject>& DataLayout::getObjects() const {
+    return objects;
+}
+
+uint64_t DataLayout::sectionBytes(DataSection section) const {
+    return sectionEnd[(int)section];
+}
+
+bool DataLayout::empty() const {
+    return objects.empty();
+}
+
+void DataLayout::writeAssembly(ostream& out, const string& source) const {
+    out << "/* Static data of " << source << ", laid out by tinyc " << TINYC_VERSION << " */" << endl;
+    for (DataSection section : {DataSection::DATA, DataSection::BSS}) {
+        bool first = true;
+        for (const DataObject& object : objects) {
+            if (object.section != section) continue;
+            if (first) {
+                out << endl << "\t.section " << sectionName(section) << endl;
+                first = false;
+            }
+
+            string_view name = StringInterner::instance().view(object.name);
+            out << endl;
+            out << "\t/* " << sectionName(section) << "+" << object.offset << ": "
+                << SymbolTable::dataTypeToString(object.type);
+            for (int extent : object.dimensions) out << "[" << extent << "]";
+            out << ", line " << object.line << " */" << endl;
+            out << "\t.balign " << object.alignment << endl;
+            out << "\t.globl " << name << endl;
+            out << "\t.type " << name << ", %object" << endl;
+            out << "\t.size " << name << ", " << object.bytes << endl;
+            out << name << ":" << endl;
+
+            // Eight values to a line
+            const char* directive = object.type == DataType::BOOL ? ".byte" : object.type == DataType::FLOAT ?
+                                    ".float" : ".long";
+            for (size_t i = 0; i < object.values.size(); i++) {
+                out << (i % 8 == 0 ? (i ? "\n\t" : "\t") + string(directive) + " " : ", ");
+                double value = object.values[i];
+                if (object.type == DataType::FLOAT) out << floatText(value);
+                else out << (long long)value;
+            }
+            if (!object.values.empty()) out << endl;
+            uint64_t filled = (uint64_t)object.values.size() * elementBytes(object.type);
+            if (filled < object.bytes) out << "\t.zero " << object.bytes - filled << endl;
+        }
+    }
+    // Data only: the object does not need an executable stack
+    out << endl << "\t.section .note.GNU-stack,\"\",%progbits" << endl;
+}
@@ -0,0 +1,300 @@
+#include "Diagnostics.h"
+#include "Json.h"
+#include "StringInterner.h"
+#include "SymbolTable.h"
+#include "Version.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+const DiagnosticInfo DIAGNOSTIC_INFO[(int)DiagnosticCode::COUNT] = {
+    {"invalid-variable-type", Severity::ERROR, "Invalid data type for variable '%0'"},
+    {"void-variable", Severity::ERROR, "Variable '%0' cannot be of type void"},
+    {"invalid-array-type", Severity::ERROR, "Invalid data type for array '%0'"},
+    {"void-array", Severity::ERROR, "Array '%0' cannot be of type void"},
+    {"nonpositive-array-size", Severity::ERROR, "Array '%0' must have positive size"},
+    {"invalid-return-type", Severity::ERROR, "Invalid return type for function '%0'"},
+    {"invalid-signature-parameter-type", Severity::ERROR, "Invalid parameter type in function '%0'"},
+    {"void-signature-parameter", Severity::ERROR, "Parameter cannot be of type void in function '%0'"},
+    {"invalid-parameter-type", Severity::ERROR, "Invalid data type for parameter '%0'"},
+    {"void-parameter", Severity::ERROR, "Parameter '%0' cannot be of type void"},
+    {"undeclared-variable", Severity::ERROR, "Undeclared variable '%0'"},
+    {"function-as-variable", Severity::ERROR, "'%0' is a function, not a variable"},
+    {"undeclared-array", Severity::ERROR, "Undeclared array '%0'"},
+    {"symbol-not-found", Severity::ERROR, "Symbol '%0' not found"},
+    {"function-as-array", Severity::ERROR, "'%0' is a function, not an array"},
+    {"not-an-array", Severity::ERROR, "'%0' is not an array"},
+    {"integer-literal-range", Severity::ERROR, "Integer literal '%0' is out of range for %1"},
+    {"float-literal-range", Severity::ERROR, "Floating-point literal '%0' is out of range for %1"},
+    {"undeclared-function", Severity::ERROR, "Undeclared function '%0'"},
+    {"not-a-function", Severity::ERROR, "'%0' is not a function"},
+    {"argument-count", Severity::ERROR, "Function '%0' expects %3 parameters, but %4 provided"},
+    {"assignment-type-mismatch", Severity::ERROR, "Type mismatch in assignment to '%0': cannot assign %1 to %2"},
+    {"assignment-conversion", Severity::WARNING, "Implicit type conversion in assignment to '%0' from %1 to %2"},
+    {"return-type-mismatch", Severity::ERROR, "Return type mismatch: expected %1, but got %2"},
+    {"return-conversion", Severity::WARNING, "Implicit type conversion in return statement from %1 to %2"},
+    {"arithmetic-operands", Severity::ERROR, "Arithmetic operation requires numeric operands"},
+    {"comparison-operands", Severity::ERROR, "Comparison operation requires numeric operands"},
+    {"equality-operands", Severity::ERROR, "Equality operation requires compatible operands"},
+    {"logical-operands", Severity::ERROR, "Logical operation requires boolean operands"},
+    {"not-operand", Severity::ERROR, "Logical NOT operation requires boolean operand"},
+    {"negation-operand", Severity::ERROR, "Unary minus operation requires numeric operand"},
+    {"too-many-initializers", Severity::ERROR, "Array '%0' has %3 elements, but %4 initializers"},
+    {"array-too-large", Severity::ERROR, "Array '%0' has more than %3 elements"},
+    {"subscript-count", Severity::ERROR, "Array '%0' has %3 dimensions, but %4 subscripts"},
+    {"array-argument", Severity::ERROR, "Argument %3 of '%0' must be an array"},
+    {"scalar-argument", Severity::ERROR, "Argument %3 of '%0' is an array, but the parameter is not"},
+    {"array-argument-type", Severity::ERROR, "Argument %3 of '%0' must be an array of %1, not %2"},
+    {"array-argument-shape", Severity::ERROR, "Argument %3 of '%0' does not match the dimensions of its parameter"},
+    {"global-array-length", Severity::ERROR, "Global array '%0' needs a constant size"},
+    {"array-length-type", Severity::ERROR, "Length of array '%0' must be an int"},
+    {"allocate-target", Severity::ERROR, "Argument 1 of '%0' must be a local array of run-time length"},
+    {"syntax-error", Severity::ERROR, "%0"},
+};
+
+thread_local DiagnosticOptions DiagnosticEngine::options;
+
+bool Diagnostic::operator==(const Diagnostic& other) const {
+    return code == other.code && types[0] == other.types[0] && types[1] == other.types[1] &&
+           line == other.line && symbol == other.symbol && numbers[0] == other.numbers[0] &&
+           numbers[1] == other.numbers[1];
+}
+
+uint64_t Diagnostic::hash() const {
+    uint64_t value = (uint64_t)code | (uint64_t)types[0] << 8 | (uint64_t)types[1] << 16 |
+                     (uint64_t)(uint32_t)line << 32;
+    value = (value ^ symbol) * 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (uint32_t)numbers[0] ^ (uint64_t)(uint32_t)numbers[1] << 32) * 0x9E3779B97F4A7C15ULL;
+    return value ^ value >> 29;
+}
+
+DiagnosticEngine::DiagnosticEngine() : errorCount(0), warningCount(0) {}
+
+// Adds the record about to be appended to the set, unless an equal one is
+// there already. The table stays at most half full.
+bool DiagnosticEngine::insertUnique(const Diagnostic& diagnostic) {
+    if ((records.size() + 1) * 2 > slots.size()) {
+        vector<uint32_t> grown(max<size_t>(64, slots.size() * 2), 0);
+        for (uint32_t slot : slots) {
+            if (!slot) continue;
+            size_t i = records[slot - 1].hash() & (grown.size() - 1);
+            while (grown[i]) i = (i + 1) & (grown.size() - 1);
+            grown[i] = slot;
+        }
+        slots.swap(grown);
+    }
+
+    size_t i = diagnostic.hash() & (slots.size() - 1);
+    for (; slots[i]; i = (i + 1) & (slots.size() - 1)) {
+        if (records[slots[i] - 1] == diagnostic) return false;
+    }
+    slots[i] = records.size() + 1;
+    return true;
+}
+
+bool DiagnosticEngine::report(DiagnosticCode code, int line, uint32_t symbol, DataType first,
+                              DataType second, int firstNumber, int secondNumber) {
+    if (options.suppressed[(int)code]) return false;
+
+    // Records outlive the function whose local names they may mention
+    symbol = StringInterner::instance().globalize(symbol);
+    Diagnostic diagnostic = {code, {first, second}, line, symbol, {firstNumber, secondNumber}};
+    if (options.deduplicate && !insertUnique(diagnostic)) return false;
+
+    records.push_back(diagnostic);
+    if (DIAGNOSTIC_INFO[(int)code].severity == Severity::ERROR) {
+        errorCount++;
+    } else {
+        warningCount++;
+    }
+    return true;
+}
+
+bool DiagnosticEngine::report(DiagnosticCode code, int line, string_view symbol, DataType first,
+                              DataType second, int firstNumber, int secondNumber) {
+    return report(code, line, StringInterner::instance().intern(symbol), first, second, firstNumber, secondNumber);
+}
+
+void DiagnosticEngine::append(const DiagnosticEngine& other, size_t first, int lineDelta) {
+    for (size_t i = first; i < other.records.size(); i++) {
+        const Diagnostic& d = other.records[i];
+        report(d.code, d.line + lineDelta, d.symbol, d.types[0], d.types[1], d.numbers[0], d.numbers[1]);
+    }
+}
+
+size_t DiagnosticEngine::size() const {
+    return records.size();
+}
+
+const Diagnostic& DiagnosticEngine::at(size_t index) const {
+    return records[index];
+}
+
+string_view DiagnosticEngine::symbol(const Diagnostic& diagnostic) const {
+    return StringInterner::instance().view(diagnostic.symbol);
+}
+
+int DiagnosticEngine::getErrorCount() const {
+    return errorCount;
+}
+
+int DiagnosticEngine::getWarningCount() const {
+    return warningCount;
+}
+
+namespace {
+    // Writes the message of diagnostic, filling in its arguments
+    void expand(ostream& out, const Diagnostic& diagnostic) {
+        const char* text = DIAGNOSTIC_INFO[(int)diagnostic.code].message;
+        while (*text) {
+            const char* mark = strchr(text, '%');
+            if (!mark) {
+                out << text;
+                return;
+            }
+            out.write(text, mark - text);
+            switch (mark[1]) {
+            case '0': out << StringInterner::instance().view(diagnostic.symbol); break;
+            case '1': out << SymbolTable::dataTypeToString(diagnostic.types[0]); break;
+            case '2': out << SymbolTable::dataTypeToString(diagnostic.types[1]); break;
+            case '3': out << diagnostic.numbers[0]; break;
+            case '4': out << diagnostic.numbers[1]; break;
+            }
+            text = mark + 2;
+        }
+    }
+}
+
+string DiagnosticEngine::message(const Diagnostic& diagnostic) const {
+    ostringstream text;
+    expand(text, diagnostic);
+    return text.str();
+}
+
+void DiagnosticEngine::print(ostream& out, const Diagnostic& diagnostic) const {
+    bool error = DIAGNOSTIC_INFO[(int)diagnostic.code].severity == Severity::ERROR;
+    out << (error ? "Error (line " : "Warning (line ") << diagnostic.line << "): ";
+    expand(out, diagnostic);
+    out << '\n';
+}
+
+namespace {
+    // Calls visit for every record, skipping errors past the cap
+    template <typename Visit>
+    void forEachShown(const vector<Diagnostic>& records, Visit visit) {
+        int errors = 0;
+        for (const Diagnostic& diagnostic : records) {
+            if (DIAGNOSTIC_INFO[(int)diagnostic.code].severity == Severity::ERROR &&
+                DiagnosticEngine::options.maxErrors > 0 && errors++ >= DiagnosticEngine::options.maxErrors) {
+                continue;
+            }
+            visit(diagnostic);
+        }
+    }
+
+    const char* severityName(DiagnosticCode code) {
+        return DIAGNOSTIC_INFO[(int)code].severity == Severity::ERROR ? "error" : "warning";
+    }
+}
+
+string DiagnosticEngine::toJson() const {
+    JsonValue diagnostics = JsonValue::array();
+    forEachShown(records, [&](const Diagnostic& diagnostic) {
+        JsonValue entry = JsonValue::object();
+        entry["code"] = DIAGNOSTIC_INFO[(int)diagnostic.code].id;
+        entry["severity"] = severityName(diagnostic.code);
+        entry["line"] = diagnostic.line;
+        entry["message"] = message(diagnostic);
+        if (diagnostic.symbol != StringInterner::EMPTY) entry["symbol"] = string(symbol(diagnostic));
+        diagnostics.push(entry);
+    });
+
+    JsonValue report = JsonValue::object();
+    report["diagnostics"] = diagnostics;
+    report["errors"] = errorCount;
+    report["warnings"] = warningCount;
+    return report.serialize();
+}
+
+// SARIF 2.1.0, one run with every diagnostic code listed as a rule
+string DiagnosticEngine::toSarif(const string& path) const {
+    JsonValue rules = JsonValue::array();
+    for (const DiagnosticInfo& info : DIAGNOSTIC_INFO) {
+        JsonValue description = JsonValue::object();
+        description["text"] = info.message;
+        JsonValue configuration = JsonValue::object();
+        configuration["level"] = info.severity == Severity::ERROR ? "error" : "warning";
+        JsonValue rule = JsonValue::object();
+        rule["id"] = info.id;
+        rule["shortDescription"] = description;
+        rule["defaultConfiguration"] = configuration;
+        rules.push(rule);
+    }
+
+    JsonValue results = JsonValue::array();
+    forEachShown(records, [&](const Diagnostic& diagnostic) {
+        JsonValue text = JsonValue::object();
+        text["text"] = message(diagnostic);
+        JsonValue artifact = JsonValue::object();
+        artifact["uri"] = path;
+        JsonValue physical = JsonValue::object();
+        physical["artifactLocation"] = artifact;
+        if (diagnostic.line > 0) {
+            JsonValue region = JsonValue::object();
+            region["startLine"] = diagnostic.line;
+            physical["region"] = region;
+        }
+        JsonValue location = JsonValue::object();
+        location["physicalLocation"] = physical;
+        JsonValue locations = JsonValue::array();
+        locations.push(location);
+
+        JsonValue result = JsonValue::object();
+        result["ruleId"] = DIAGNOSTIC_INFO[(int)diagnostic.code].id;
+        result["ruleIndex"] = (int)diagnostic.code;
+        result["level"] = severityName(diagnostic.code);
+        result["message"] = text;
+        result["locations"] = locations;
+        results.push(result);
+    });
+
+    JsonValue driver = JsonValue::object();
+    driver["name"] = "tinyc";
+    driver["version"] = TINYC_VERSION;
+    driver["rules"] = rules;
+    JsonValue tool = JsonValue::object();
+    tool["driver"] = driver;
+    JsonValue run = JsonValue::object();
+    run["tool"] = tool;
+    run["results"] = results;
+    JsonValue runs = JsonValue::array();
+    runs.push(run);
+
+    JsonValue log = JsonValue::object();
+    log["$schema"] = "https://json.schemastore.org/sarif-2.1.0.json";
+    log["version"] = "2.1.0";
+    log["runs"] = runs;
+    return log.serialize();
+}
+
+bool DiagnosticEngine::findCode(const string& id, DiagnosticCode& code) {
+    for (int i = 0; i < (int)DiagnosticCode::COUNT; i++) {
+        if (id == DIAGNOSTIC_INFO[i].id) {
+            code = (DiagnosticCode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Only options that change what gets reported; empty for the defaults
+string DiagnosticEngine::optionsKey() {
+    string key;
+    if (!options.deduplicate) key += " no-dedupe";
+    if (options.maxErrors > 0) key += " max-errors=" + to_string(options.maxErrors);
+    for (int i = 0; i < (int)DiagnosticCode::COUNT; i++) {
+        if (options.suppressed[i]) key += string(" suppress=") + DIAGNOSTIC_INFO[i].id;
+    }
+    return key;
+}
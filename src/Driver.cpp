@@ -0,0 +1,143 @@
+#include <iterator>
+#include <string>
+
+#include "Driver.h"
+#include "LargeStack.h"
+#include "LexicalAnalyzer.h"
+#include "Preprocessor.h"
+#include "SyntaxAnalyzer.h"
+#include "SemanticAnalyzer.h"
+#include "TableParser.h"
+#include "TokenPipeline.h"
+#include "Trace.h"
+
+using namespace std;
+
+int compileSource(istream &source, ostream &out, IncrementalCompiler *incremental, DiagnosticEngine *diagnostics,
+                  vector<SymbolInfo> *globals, DataLayout *data)
+{
+  LexicalAnalyzer *la = nullptr;
+  SyntaxAnalyzer *parser = nullptr;
+  TableParser *tableParser = nullptr;
+  int status = 0;
+  TraceSpan span("Compile");
+
+  // With --pipeline the lexer scans ahead on a thread of its own. The
+  // preprocessor applies directives as it takes each token, so it keeps
+  // its lexer on this thread.
+  auto createLexer = [&]() -> LexicalAnalyzer *
+  {
+    if (Preprocessor::enabled)
+      return new Preprocessor(&source, out);
+    if (PipelinedLexer::enabled)
+      return new PipelinedLexer(&source, out);
+    return new LexicalAnalyzer(&source, out);
+  };
+
+  // The incremental compiler hands its diagnostics over itself
+  auto collectDiagnostics = [&]()
+  {
+    if (tableParser)
+      *diagnostics = tableParser->getSemanticAnalyzer()->getDiagnostics();
+    else if (parser)
+      *diagnostics = parser->getSemanticAnalyzer()->getDiagnostics();
+  };
+
+  auto collectGlobals = [&]()
+  {
+    if (incremental)
+    {
+      for (const FunctionOutline &function : incremental->getOutline())
+        for (SymbolInfo symbol : function.result->globals)
+        {
+          symbol.lineNumber += function.lineDelta;
+          globals->push_back(symbol);
+        }
+      return;
+    }
+    SemanticAnalyzer *analyzer = tableParser ? tableParser->getSemanticAnalyzer()
+                                             : parser ? parser->getSemanticAnalyzer() : nullptr;
+    if (!analyzer)
+      return;
+    const SymbolTable *table = analyzer->getSymbolTable();
+    for (uint32_t name : table->getGlobalInsertionOrder())
+      globals->push_back(table->getGlobalScope().at(name));
+  };
+
+  try
+  {
+    bool semanticErrors = false;
+    auto parse = [&]()
+    {
+      if (incremental)
+      {
+        string text((istreambuf_iterator<char>(source)), istreambuf_iterator<char>());
+        semanticErrors = incremental->compile(text, out, diagnostics);
+      }
+      else if (TableParser::enabled)
+      {
+        la = createLexer();
+        tableParser = new TableParser(la, out);
+
+        tableParser->Program();
+        semanticErrors = tableParser->getSemanticAnalyzer()->hasErrors();
+      }
+      else
+      {
+        la = createLexer();
+        parser = new SyntaxAnalyzer(la, out);
+
+        parser->Program();
+        semanticErrors = parser->getSemanticAnalyzer()->hasErrors();
+      }
+    };
+
+    // The parser recurses once per nesting level, so give it a stack
+    // sized for SyntaxAnalyzer::maxNesting whatever thread we are on
+    if (!runOnLargeStack(SyntaxAnalyzer::requiredStackBytes(), parse))
+      parse();
+    if (diagnostics)
+      collectDiagnostics();
+    if (globals)
+      collectGlobals();
+    if (data && (tableParser || parser))
+      *data = tableParser ? tableParser->getSemanticAnalyzer()->getDataLayout()
+                          : parser->getSemanticAnalyzer()->getDataLayout();
+
+    // Check for semantic errors
+    if (semanticErrors)
+    {
+      out << endl << "Compilation failed due to semantic errors!" << endl;
+      status = 1;
+    }
+    else
+    {
+      out << endl << "Parsing and semantic analysis completed successfully!" << endl;
+    }
+  }
+  catch (const SyntaxError &e)
+  {
+    // The syntax error report has already been printed
+    status = -1;
+    if (diagnostics)
+    {
+      collectDiagnostics();
+      diagnostics->report(DiagnosticCode::SYNTAX_ERROR, e.getLine(), e.what());
+    }
+  }
+  catch (const exception &e)
+  {
+    out << endl << "Parsing failed with exception: " << e.what() << endl;
+    status = 1;
+  }
+  catch (...)
+  {
+    out << endl << "Parsing failed with unknown error!" << endl;
+    status = 1;
+  }
+
+  delete la;
+  delete parser;
+  delete tableParser;
+  return status;
+}
@@ -0,0 +1,153 @@
+#include "Hash.h"
+#include <cstring>
+
+namespace {
+    const uint64_t PRIME1 = 11400714785074694791ULL;
+    const uint64_t PRIME2 = 14029467366897019727ULL;
+    const uint64_t PRIME3 = 1609587929392839161ULL;
+    const uint64_t PRIME4 = 9650029242287828579ULL;
+    const uint64_t PRIME5 = 2870177450012600261ULL;
+
+    inline uint64_t rotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // xxHash is specified over little-endian reads; assemble the bytes
+    // explicitly so the digest is the same on every host.
+    inline uint64_t read64(const unsigned char* p) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    inline uint64_t read32(const unsigned char* p) {
+        return (uint64_t)p[0] | ((uint64_t)p[1] << 8) |
+               ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24);
+    }
+}
+
+Hash64::Hash64(uint64_t seed) {
+    reset(seed);
+}
+
+void Hash64::reset(uint64_t s) {
+    seed = s;
+    accumulators[0] = seed + PRIME1 + PRIME2;
+    accumulators[1] = seed + PRIME2;
+    accumulators[2] = seed;
+    accumulators[3] = seed - PRIME1;
+    totalLength = 0;
+    bufferSize = 0;
+}
+
+uint64_t Hash64::round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * PRIME1;
+}
+
+uint64_t Hash64::mergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= round(0, value);
+    return accumulator * PRIME1 + PRIME4;
+}
+
+void Hash64::update(const void* data, size_t length) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    totalLength += length;
+
+    // Top up a partially filled stripe first
+    if (bufferSize + length < 32) {
+        memcpy(buffer + bufferSize, p, length);
+        bufferSize += length;
+        return;
+    }
+    if (bufferSize > 0) {
+        size_t fill = 32 - bufferSize;
+        memcpy(buffer + bufferSize, p, fill);
+        for (int i = 0; i < 4; i++) {
+            accumulators[i] = round(accumulators[i], read64(buffer + i * 8));
+        }
+        p += fill;
+        bufferSize = 0;
+    }
+
+    // Whole 32-byte stripes straight from the input
+    while (end - p >= 32) {
+        for (int i = 0; i < 4; i++) {
+            accumulators[i] = round(accumulators[i], read64(p + i * 8));
+        }
+        p += 32;
+    }
+
+    if (p < end) {
+        bufferSize = end - p;
+        memcpy(buffer, p, bufferSize);
+    }
+}
+
+void Hash64::update(const string& text) {
+    update(text.data(), text.size());
+}
+
+uint64_t Hash64::digest() const {
+    uint64_t h;
+    if (totalLength >= 32) {
+        h = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7) +
+            rotateLeft(accumulators[2], 12) + rotateLeft(accumulators[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = mergeRound(h, accumulators[i]);
+        }
+    } else {
+        h = seed + PRIME5;
+    }
+    h += totalLength;
+
+    const unsigned char* p = buffer;
+    const unsigned char* end = buffer + bufferSize;
+    while (end - p >= 8) {
+        h ^= round(0, read64(p));
+        h = rotateLeft(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= read32(p) * PRIME1;
+        h = rotateLeft(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME5;
+        h = rotateLeft(h, 11) * PRIME1;
+        p++;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t Hash64::hash(const void* data, size_t length, uint64_t seed) {
+    Hash64 hasher(seed);
+    hasher.update(data, length);
+    return hasher.digest();
+}
+
+uint64_t Hash64::hash(const string& text, uint64_t seed) {
+    return hash(text.data(), text.size(), seed);
+}
+
+string Hash64::toHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    string result(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        result[i] = digits[value & 0xF];
+        value >>= 4;
+    }
+    return result;
+}
@@ -0,0 +1,376 @@
+#include "IncrementalCompiler.h"
+#include "Hash.h"
+#include "LexicalAnalyzer.h"
+#include "SemanticAnalyzer.h"
+#include "Serialization.h"
+#include "Statistics.h"
+#include "StringInterner.h"
+#include "SyntaxAnalyzer.h"
+#include "Trace.h"
+
+#include <cctype>
+#include <cstdlib>
+
+IncrementalCompiler::IncrementalCompiler(CompileCache* c)
+    : cache(c), functionsAnalyzed(0), functionsReused(0) {}
+
+vector<FunctionChunk> IncrementalCompiler::splitFunctions(const string& source) {
+    // The language has no comments or string literals, so braces alone
+    // delimit function bodies. Leading whitespace, and any globals,
+    // belong to the function that follows; unbalanced text ends up in the
+    // last chunk and gets the same diagnostics the full parser would give
+    // it. The braces of a global's initializer are followed by ',' or ';'
+    // and end nothing.
+    vector<FunctionChunk> chunks;
+    size_t begin = 0;
+    int depth = 0;
+    int line = 1, startLine = 1;
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source[i] == '\n') {
+            line++;
+        } else if (source[i] == '{') {
+            depth++;
+        } else if (source[i] == '}' && depth > 0 && --depth == 0) {
+            size_t next = i + 1;
+            while (next < source.size() && isspace(static_cast<unsigned char>(source[next]))) next++;
+            if (next < source.size() && (source[next] == ',' || source[next] == ';')) continue;
+            chunks.push_back({begin, i + 1, startLine, Hash64::hash(source.data() + begin, i + 1 - begin)});
+            begin = i + 1;
+            startLine = line;
+        }
+    }
+
+    for (size_t i = begin; i < source.size(); i++) {
+        if (!isspace(static_cast<unsigned char>(source[i]))) {
+            chunks.push_back({begin, source.size(), startLine,
+                              Hash64::hash(source.data() + begin, source.size() - begin)});
+            break;
+        }
+    }
+    return chunks;
+}
+
+bool IncrementalCompiler::compile(const string& source, ostream& out, DiagnosticEngine* diagnostics) {
+    outline.clear();
+    if (results.size() > MAX_RESULTS_IN_MEMORY) {
+        results.clear();
+    }
+
+    // Every phase writes into this buffer, which is drained after each
+    // function so its output can be stored alongside its diagnostics.
+    ostringstream output;
+    SemanticAnalyzer analyzer(output);
+    uint64_t globalsHash = Hash64::hash("globals");
+
+    for (const FunctionChunk& chunk : splitFunctions(source)) {
+        Hash64 keyHasher;
+        keyHasher.update(Hash64::toHex(chunk.bodyHash));
+        keyHasher.update(Hash64::toHex(globalsHash));
+        if (SyntaxAnalyzer::maxNesting != SyntaxAnalyzer::DEFAULT_MAX_NESTING) {
+            keyHasher.update(" max-nesting=" + to_string(SyntaxAnalyzer::maxNesting));
+        }
+        keyHasher.update(DiagnosticEngine::optionsKey());
+        keyHasher.update(SymbolTable::importsKey());
+        uint64_t key = keyHasher.digest();
+
+        const FunctionResult* result = findResult(key);
+        // The report of a syntax error is not renumbered; it ends the
+        // compile, so analysing the function again costs little
+        if (result && result->syntaxError && result->startLine != chunk.startLine) result = nullptr;
+        TraceSpan span(result ? "Replay function" : "Analyze function", chunk.startLine);
+        if (result) {
+            replayChunk(*result, chunk.startLine - result->startLine, analyzer, out);
+            functionsReused++;
+            TINYC_COUNT(Counter::FUNCTIONS_REPLAYED, 1);
+        } else {
+            try {
+                result = saveResult(key, analyzeChunk(source.substr(chunk.begin, chunk.end - chunk.begin),
+                                                      chunk, analyzer, output));
+            } catch (...) {
+                out << output.str();
+                throw;
+            }
+            out << result->output;
+            functionsAnalyzed++;
+            TINYC_COUNT(Counter::FUNCTIONS_ANALYZED, 1);
+        }
+        outline.push_back({chunk, result, chunk.startLine - result->startLine});
+
+        if (result->syntaxError) {
+            if (diagnostics) *diagnostics = analyzer.getDiagnostics();
+            throw SyntaxError(result->syntaxMessage, result->syntaxLine);
+        }
+        globalsHash = hashGlobals(globalsHash, result->globals);
+    }
+
+    TraceSpan span("Semantic report");
+    analyzer.printSemanticReport();
+    analyzer.printSymbolTable();
+    out << output.str();
+    if (diagnostics) *diagnostics = analyzer.getDiagnostics();
+    return analyzer.hasErrors();
+}
+
+FunctionResult IncrementalCompiler::analyzeChunk(const string& text, const FunctionChunk& chunk,
+                                                SemanticAnalyzer& analyzer, ostringstream& output) {
+    FunctionResult result;
+    result.startLine = chunk.startLine;
+    size_t diagnosticsBefore = analyzer.getDiagnostics().size();
+    size_t globalsBefore = analyzer.getSymbolTable()->getGlobalInsertionOrder().size();
+
+    output.str("");
+    istringstream chunkStream(text);
+    LexicalAnalyzer la(&chunkStream, output);
+    la.setStartPosition(chunk.begin, chunk.startLine);
+    analyzer.getSymbolTable()->setDeclarationLog(&result.declarations);
+    analyzer.getSymbolTable()->setLineMarks(&result.lineOffsets);
+    try {
+        SyntaxAnalyzer parser(&la, &analyzer, output);
+        parser.Functions();
+    } catch (const SyntaxError& e) {
+        result.syntaxError = true;
+        result.syntaxMessage = e.what();
+        result.syntaxLine = e.getLine();
+    }
+    analyzer.getSymbolTable()->setDeclarationLog(nullptr);
+    analyzer.getSymbolTable()->setLineMarks(nullptr);
+
+    result.output = output.str();
+    output.str("");
+
+    result.diagnostics.append(analyzer.getDiagnostics(), diagnosticsBefore);
+
+    const vector<uint32_t>& order = analyzer.getSymbolTable()->getGlobalInsertionOrder();
+    const map<uint32_t, SymbolInfo>& globals = analyzer.getSymbolTable()->getGlobalScope();
+    for (size_t i = globalsBefore; i < order.size(); i++) {
+        result.globals.push_back(globals.at(order[i]));
+    }
+    return result;
+}
+
+// lineDelta is how far the function has moved down since it was analysed
+void IncrementalCompiler::replayChunk(const FunctionResult& result, int lineDelta, SemanticAnalyzer& analyzer,
+                                      ostream& output) {
+    if (lineDelta == 0) {
+        output << result.output;
+    } else {
+        size_t copied = 0;
+        for (size_t offset : result.lineOffsets) {
+            size_t end = offset;
+            while (end < result.output.size() && isdigit(static_cast<unsigned char>(result.output[end]))) end++;
+            output.write(result.output.data() + copied, offset - copied);
+            output << atoi(result.output.c_str() + offset) + lineDelta;
+            copied = end;
+        }
+        output.write(result.output.data() + copied, result.output.size() - copied);
+    }
+    analyzer.restoreDiagnostics(result.diagnostics, lineDelta);
+    for (SymbolInfo symbol : result.globals) {
+        symbol.lineNumber += lineDelta;
+        analyzer.getSymbolTable()->restoreGlobalSymbol(symbol);
+    }
+}
+
+// Results are handed out by pointer: std::map nodes stay put, and copying
+// the stored output of thousands of functions would dominate a re-check.
+const FunctionResult* IncrementalCompiler::findResult(uint64_t key) {
+    auto it = results.find(key);
+    if (it != results.end()) {
+        return &it->second;
+    }
+
+    string payload;
+    FunctionResult result;
+    if (cache && cache->lookup(CompileCache::computeKey(Hash64::toHex(key), "function"), payload) &&
+        deserialize(payload, result)) {
+        return &(results[key] = result);
+    }
+    return nullptr;
+}
+
+const FunctionResult* IncrementalCompiler::saveResult(uint64_t key, const FunctionResult& result) {
+    if (cache) {
+        cache->store(CompileCache::computeKey(Hash64::toHex(key), "function"), serialize(result));
+    }
+    return &(results[key] = result);
+}
+
+uint64_t IncrementalCompiler::hashGlobals(uint64_t previous, const vector<SymbolInfo>& globals) {
+    if (globals.empty()) return previous;
+
+    Hash64 hasher;
+    hasher.update(Hash64::toHex(previous));
+    for (const SymbolInfo& symbol : globals) {
+        string record = string(StringInterner::instance().view(symbol.name)) + "/" + to_string((int)symbol.dataType) + "/" +
+                        to_string((int)symbol.symbolType) + "/" + SymbolTable::dimensionsToString(symbol.dimensions);
+        for (const ParameterType& parameter : symbol.parameterTypes) {
+            record += "," + to_string((int)parameter.type) + SymbolTable::dimensionsToString(parameter.dimensions);
+        }
+        hasher.update(record + ";");
+    }
+    return hasher.digest();
+}
+
+// Names are stored as text: interned ids are only meaningful in the
+// process that assigned them
+namespace {
+    void putSymbols(string& out, const vector<SymbolInfo>& symbols) {
+        putNumber(out, symbols.size());
+        for (const SymbolInfo& symbol : symbols) {
+            putField(out, string(StringInterner::instance().view(symbol.name)));
+            putNumber(out, (int)symbol.dataType);
+            putNumber(out, (int)symbol.symbolType);
+            putNumber(out, symbol.scopeLevel);
+            putNumber(out, symbol.lineNumber);
+            putNumber(out, symbol.isInitialized ? 1 : 0);
+            putNumber(out, symbol.dimensions.size());
+            for (int extent : symbol.dimensions) {
+                putNumber(out, extent);
+            }
+            putNumber(out, symbol.parameterTypes.size());
+            for (const ParameterType& parameter : symbol.parameterTypes) {
+                putNumber(out, (int)parameter.type);
+                putNumber(out, parameter.dimensions.size());
+                for (int extent : parameter.dimensions) {
+                    putNumber(out, extent);
+                }
+            }
+        }
+    }
+
+    bool getSymbols(const string& payload, size_t& pos, vector<SymbolInfo>& symbols) {
+        long long count;
+        if (!getNumber(payload, pos, count)) return false;
+        for (long long i = 0; i < count; i++) {
+            SymbolInfo symbol;
+            string name;
+            long long dataType, symbolType, scopeLevel, lineNumber, initialized, dimensionCount, parameters;
+            if (!getField(payload, pos, name) || !getNumber(payload, pos, dataType) ||
+                !getNumber(payload, pos, symbolType) || !getNumber(payload, pos, scopeLevel) ||
+                !getNumber(payload, pos, lineNumber) || !getNumber(payload, pos, initialized) ||
+                !getNumber(payload, pos, dimensionCount)) {
+                return false;
+            }
+            vector<int> dimensions;
+            for (long long j = 0; j < dimensionCount; j++) {
+                long long extent;
+                if (!getNumber(payload, pos, extent)) return false;
+                dimensions.push_back(extent);
+            }
+            if (!getNumber(payload, pos, parameters)) return false;
+            symbol.name = StringInterner::instance().intern(name);
+            symbol.dataType = static_cast<DataType>(dataType);
+            symbol.symbolType = static_cast<SymbolType>(symbolType);
+            symbol.scopeLevel = scopeLevel;
+            symbol.lineNumber = lineNumber;
+            symbol.isInitialized = initialized != 0;
+            if (!dimensions.empty()) symbol.setDimensions(dimensions);
+            for (long long j = 0; j < parameters; j++) {
+                long long type, parameterDimensions;
+                if (!getNumber(payload, pos, type) || !getNumber(payload, pos, parameterDimensions)) return false;
+                ParameterType parameter{static_cast<DataType>(type), {}};
+                for (long long k = 0; k < parameterDimensions; k++) {
+                    long long extent;
+                    if (!getNumber(payload, pos, extent)) return false;
+                    parameter.dimensions.push_back(extent);
+                }
+                symbol.parameterTypes.push_back(parameter);
+            }
+            symbol.parameterCount = symbol.parameterTypes.size();
+            symbols.push_back(symbol);
+        }
+        return true;
+    }
+
+    void putDiagnostics(string& out, const DiagnosticEngine& diagnostics) {
+        putNumber(out, diagnostics.size());
+        for (size_t i = 0; i < diagnostics.size(); i++) {
+            const Diagnostic& diagnostic = diagnostics.at(i);
+            putNumber(out, (int)diagnostic.code);
+            putNumber(out, diagnostic.line);
+            putField(out, string(diagnostics.symbol(diagnostic)));
+            putNumber(out, (int)diagnostic.types[0]);
+            putNumber(out, (int)diagnostic.types[1]);
+            putNumber(out, diagnostic.numbers[0]);
+            putNumber(out, diagnostic.numbers[1]);
+        }
+    }
+
+    bool getDiagnostics(const string& payload, size_t& pos, DiagnosticEngine& diagnostics) {
+        long long count;
+        if (!getNumber(payload, pos, count)) return false;
+        for (long long i = 0; i < count; i++) {
+            long long code, line, first, second, firstNumber, secondNumber;
+            string symbol;
+            if (!getNumber(payload, pos, code) || !getNumber(payload, pos, line) ||
+                !getField(payload, pos, symbol) || !getNumber(payload, pos, first) ||
+                !getNumber(payload, pos, second) || !getNumber(payload, pos, firstNumber) ||
+                !getNumber(payload, pos, secondNumber) || code < 0 || code >= (int)DiagnosticCode::COUNT) {
+                return false;
+            }
+            diagnostics.report(static_cast<DiagnosticCode>(code), line, symbol, static_cast<DataType>(first),
+                               static_cast<DataType>(second), firstNumber, secondNumber);
+        }
+        return true;
+    }
+}
+
+string IncrementalCompiler::serialize(const FunctionResult& result) {
+    string out;
+    putNumber(out, result.syntaxError ? 1 : 0);
+    putField(out, result.syntaxMessage);
+    putNumber(out, result.syntaxLine);
+    putNumber(out, result.startLine);
+    putField(out, result.output);
+    putNumber(out, result.lineOffsets.size());
+    for (size_t offset : result.lineOffsets) {
+        putNumber(out, offset);
+    }
+    putDiagnostics(out, result.diagnostics);
+    putSymbols(out, result.globals);
+    putSymbols(out, result.declarations);
+    return out;
+}
+
+bool IncrementalCompiler::deserialize(const string& payload, FunctionResult& result) {
+    size_t pos = 0;
+    long long flag, line, startLine, offsets;
+    if (!getNumber(payload, pos, flag) || !getField(payload, pos, result.syntaxMessage) ||
+        !getNumber(payload, pos, line) || !getNumber(payload, pos, startLine) ||
+        !getField(payload, pos, result.output) || !getNumber(payload, pos, offsets)) {
+        return false;
+    }
+    for (long long i = 0; i < offsets; i++) {
+        long long offset;
+        if (!getNumber(payload, pos, offset) || offset < 0 || (size_t)offset > result.output.size()) return false;
+        result.lineOffsets.push_back(offset);
+    }
+    if (!getDiagnostics(payload, pos, result.diagnostics) ||
+        !getSymbols(payload, pos, result.globals) || !getSymbols(payload, pos, result.declarations)) {
+        return false;
+    }
+    result.syntaxError = flag != 0;
+    result.syntaxLine = line;
+    result.startLine = startLine;
+    return true;
+}
+
+int IncrementalCompiler::getFunctionsAnalyzed() const {
+    return functionsAnalyzed;
+}
+
+int IncrementalCompiler::getFunctionsReused() const {
+    return functionsReused;
+}
+
+const vector<FunctionOutline>& IncrementalCompiler::getOutline() const {
+    return outline;
+}
+
+void IncrementalCompiler::printStatistics(ostream& os) const {
+    os << "\n=== Incremental Analysis ===" << endl;
+    os << "Functions: " << (functionsAnalyzed + functionsReused) << endl;
+    os << "Re-analyzed: " << functionsAnalyzed << endl;
+    os << "Reused: " << functionsReused << endl;
+    os << "============================" << endl;
+}
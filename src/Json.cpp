@@ -0,0 +1,348 @@
+#include "Json.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+    const int MAX_NESTING = 256;
+
+    void skipWhitespace(const string& text, size_t& pos) {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' ||
+                                     text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    void appendUtf8(string& out, unsigned codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    bool readHex4(const string& text, size_t& pos, unsigned& value) {
+        if (pos + 4 > text.size()) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[pos++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+}
+
+JsonValue::JsonValue() : kind(NULL_VALUE), booleanValue(false), numberValue(0) {}
+JsonValue::JsonValue(bool value) : kind(BOOLEAN), booleanValue(value), numberValue(0) {}
+JsonValue::JsonValue(int value) : kind(NUMBER), booleanValue(false), numberValue(value) {}
+JsonValue::JsonValue(long long value) : kind(NUMBER), booleanValue(false), numberValue((double)value) {}
+JsonValue::JsonValue(double value) : kind(NUMBER), booleanValue(false), numberValue(value) {}
+JsonValue::JsonValue(const char* value) : kind(STRING), booleanValue(false), numberValue(0), stringValue(value) {}
+JsonValue::JsonValue(const string& value) : kind(STRING), booleanValue(false), numberValue(0), stringValue(value) {}
+
+JsonValue JsonValue::array() {
+    JsonValue value;
+    value.kind = ARRAY;
+    return value;
+}
+
+JsonValue JsonValue::object() {
+    JsonValue value;
+    value.kind = OBJECT;
+    return value;
+}
+
+JsonValue::Kind JsonValue::getKind() const {
+    return kind;
+}
+
+bool JsonValue::isNull() const {
+    return kind == NULL_VALUE;
+}
+
+bool JsonValue::asBool() const {
+    return kind == BOOLEAN && booleanValue;
+}
+
+double JsonValue::asNumber() const {
+    return kind == NUMBER ? numberValue : 0;
+}
+
+long long JsonValue::asInteger() const {
+    return kind == NUMBER ? (long long)numberValue : 0;
+}
+
+const string& JsonValue::asString() const {
+    return stringValue;
+}
+
+size_t JsonValue::size() const {
+    return kind == ARRAY ? items.size() : members.size();
+}
+
+const JsonValue& JsonValue::at(size_t index) const {
+    static const JsonValue missing;
+    return index < items.size() ? items[index] : missing;
+}
+
+void JsonValue::push(const JsonValue& value) {
+    kind = ARRAY;
+    items.push_back(value);
+}
+
+bool JsonValue::has(const string& key) const {
+    return members.count(key) != 0;
+}
+
+vector<string> JsonValue::keys() const {
+    vector<string> names;
+    for (const auto& member : members) names.push_back(member.first);
+    return names;
+}
+
+const JsonValue& JsonValue::get(const string& key) const {
+    static const JsonValue missing;
+    auto it = members.find(key);
+    return it != members.end() ? it->second : missing;
+}
+
+JsonValue& JsonValue::operator[](const string& key) {
+    kind = OBJECT;
+    return members[key];
+}
+
+void JsonValue::writeString(string& out, const string& value) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void JsonValue::write(string& out) const {
+    switch (kind) {
+        case NULL_VALUE:
+            out += "null";
+            break;
+        case BOOLEAN:
+            out += booleanValue ? "true" : "false";
+            break;
+        case NUMBER: {
+            if (!std::isfinite(numberValue)) {
+                out += "null";
+            } else if (numberValue == std::floor(numberValue) && std::fabs(numberValue) < 1e15) {
+                out += to_string((long long)numberValue);
+            } else {
+                // Shortest of the usual precisions that reads back exactly
+                char buffer[32];
+                snprintf(buffer, sizeof(buffer), "%.15g", numberValue);
+                if (strtod(buffer, nullptr) != numberValue) {
+                    snprintf(buffer, sizeof(buffer), "%.17g", numberValue);
+                }
+                out += buffer;
+            }
+            break;
+        }
+        case STRING:
+            writeString(out, stringValue);
+            break;
+        case ARRAY:
+            out += '[';
+            for (size_t i = 0; i < items.size(); i++) {
+                if (i) out += ',';
+                items[i].write(out);
+            }
+            out += ']';
+            break;
+        case OBJECT: {
+            out += '{';
+            bool first = true;
+            for (const auto& member : members) {
+                if (!first) out += ',';
+                first = false;
+                writeString(out, member.first);
+                out += ':';
+                member.second.write(out);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
+
+void JsonValue::appendQuoted(string& out, const string& value) {
+    writeString(out, value);
+}
+
+string JsonValue::serialize() const {
+    string out;
+    write(out);
+    return out;
+}
+
+bool JsonValue::parseString(const string& text, size_t& pos, string& value) {
+    if (pos >= text.size() || text[pos] != '"') return false;
+    pos++;
+    value.clear();
+    while (pos < text.size()) {
+        char c = text[pos++];
+        if (c == '"') return true;
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+        if (pos >= text.size()) return false;
+        char escape = text[pos++];
+        switch (escape) {
+            case '"': value += '"'; break;
+            case '\\': value += '\\'; break;
+            case '/': value += '/'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u': {
+                unsigned codePoint;
+                if (!readHex4(text, pos, codePoint)) return false;
+                // Surrogate pairs encode characters outside the BMP
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 &&
+                    text.compare(pos, 2, "\\u") == 0) {
+                    size_t save = pos;
+                    pos += 2;
+                    unsigned low;
+                    if (readHex4(text, pos, low) && low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        pos = save;
+                    }
+                }
+                appendUtf8(value, codePoint);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool JsonValue::parseValue(const string& text, size_t& pos, JsonValue& value, int depth) {
+    if (depth > MAX_NESTING) return false;
+    skipWhitespace(text, pos);
+    if (pos >= text.size()) return false;
+
+    char c = text[pos];
+    if (c == '{') {
+        value = object();
+        pos++;
+        skipWhitespace(text, pos);
+        if (pos < text.size() && text[pos] == '}') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            string key;
+            skipWhitespace(text, pos);
+            if (!parseString(text, pos, key)) return false;
+            skipWhitespace(text, pos);
+            if (pos >= text.size() || text[pos] != ':') return false;
+            pos++;
+            if (!parseValue(text, pos, value.members[key], depth + 1)) return false;
+            skipWhitespace(text, pos);
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+            } else if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            } else {
+                return false;
+            }
+        }
+    }
+    if (c == '[') {
+        value = array();
+        pos++;
+        skipWhitespace(text, pos);
+        if (pos < text.size() && text[pos] == ']') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            value.items.push_back(JsonValue());
+            if (!parseValue(text, pos, value.items.back(), depth + 1)) return false;
+            skipWhitespace(text, pos);
+            if (pos < text.size() && text[pos] == ',') {
+                pos++;
+            } else if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            } else {
+                return false;
+            }
+        }
+    }
+    if (c == '"') {
+        value = JsonValue("");
+        return parseString(text, pos, value.stringValue);
+    }
+    if (text.compare(pos, 4, "true") == 0) {
+        value = JsonValue(true);
+        pos += 4;
+        return true;
+    }
+    if (text.compare(pos, 5, "false") == 0) {
+        value = JsonValue(false);
+        pos += 5;
+        return true;
+    }
+    if (text.compare(pos, 4, "null") == 0) {
+        value = JsonValue();
+        pos += 4;
+        return true;
+    }
+
+    const char* start = text.c_str() + pos;
+    char* end = nullptr;
+    double number = strtod(start, &end);
+    if (end == start) return false;
+    value = JsonValue(number);
+    pos += end - start;
+    return true;
+}
+
+bool JsonValue::parse(const string& text, JsonValue& value) {
+    size_t pos = 0;
+    if (!parseValue(text, pos, value, 0)) return false;
+    skipWhitespace(text, pos);
+    return pos == text.size();
+}
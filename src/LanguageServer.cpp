@@ -0,0 +1,434 @@
+#include "LanguageServer.h"
+#include "LargeStack.h"
+#include "LexicalAnalyzer.h"
+#include "StringInterner.h"
+#include "SyntaxAnalyzer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <streambuf>
+
+namespace {
+    // JSON-RPC error codes used by the protocol
+    const int PARSE_ERROR = -32700;
+    const int INVALID_REQUEST = -32600;
+    const int METHOD_NOT_FOUND = -32601;
+
+    // Clients send changed ranges rather than whole files
+    const int TEXT_DOCUMENT_SYNC_INCREMENTAL = 2;
+    const int SEVERITY_ERROR = 1;
+    const int SEVERITY_WARNING = 2;
+
+    // Lets the lexer read a slice of a document without copying it
+    class MemoryBuffer : public streambuf {
+    public:
+        MemoryBuffer(const char* begin, const char* end) {
+            char* first = const_cast<char*>(begin);
+            setg(first, first, const_cast<char*>(end));
+        }
+    };
+
+    // Discards the token echo and reports the phases print while analysing
+    ostream nullStream(nullptr);
+
+    // Lexes text[from, end) as if it started at the given line. Returns after
+    // the callback asks to stop or at the end of input.
+    template <typename Callback>
+    void lexFrom(const string& text, int from, int line, Callback accept) {
+        MemoryBuffer buffer(text.data() + from, text.data() + text.size());
+        istream stream(&buffer);
+        LexicalAnalyzer lexer(&stream, nullStream);
+        lexer.setStartPosition(from, line);
+        while (true) {
+            Token* token = lexer.getNextToken();
+            TokenCodes code = token->getTokenCode();
+            IndexedToken indexed = {lexer.getCurrentTokenPosition(), token->getLineNumber(),
+                                    code, token->getLexemeString()};
+            delete token;
+            if (code == EOI || !accept(indexed)) break;
+        }
+    }
+
+    int countNewlines(const string& text, size_t begin, size_t end) {
+        return count(text.begin() + begin, text.begin() + end, '\n');
+    }
+}
+
+LanguageServer::LanguageServer(istream& input, ostream& output)
+    : in(input), out(output), shutdownRequested(false), exitRequested(false), tokensRelexed(0) {}
+
+bool LanguageServer::readMessage(string& payload) {
+    // Header lines end in CRLF; only Content-Length matters to us
+    long long length = -1;
+    string header;
+    while (getline(in, header)) {
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+        if (header.empty()) break;
+        if (header.compare(0, 15, "Content-Length:") == 0) {
+            length = atoll(header.c_str() + 15);
+        }
+    }
+    if (!in || length < 0) return false;
+
+    payload.resize(length);
+    return length == 0 || in.read(&payload[0], length).gcount() == length;
+}
+
+void LanguageServer::sendMessage(const JsonValue& message) {
+    string body = message.serialize();
+    out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    out.flush();
+}
+
+void LanguageServer::respond(const JsonValue& id, const JsonValue& result) {
+    JsonValue response = JsonValue::object();
+    response["jsonrpc"] = "2.0";
+    response["id"] = id;
+    response["result"] = result;
+    sendMessage(response);
+}
+
+void LanguageServer::respondError(const JsonValue& id, int code, const string& message) {
+    JsonValue error = JsonValue::object();
+    error["code"] = code;
+    error["message"] = message;
+    JsonValue response = JsonValue::object();
+    response["jsonrpc"] = "2.0";
+    response["id"] = id;
+    response["error"] = error;
+    sendMessage(response);
+}
+
+int LanguageServer::run() {
+    string payload;
+    while (!exitRequested && readMessage(payload)) {
+        JsonValue message;
+        if (!JsonValue::parse(payload, message) || message.getKind() != JsonValue::OBJECT) {
+            respondError(JsonValue(), PARSE_ERROR, "invalid JSON message");
+            continue;
+        }
+        handleMessage(message);
+    }
+    return exitRequested && shutdownRequested ? 0 : 1;
+}
+
+void LanguageServer::handleMessage(const JsonValue& message) {
+    const string& method = message.get("method").asString();
+    const JsonValue& params = message.get("params");
+    bool isRequest = message.has("id");
+    const JsonValue& id = message.get("id");
+
+    if (method.empty()) {
+        // Responses to requests we never send
+        if (isRequest && !message.has("result") && !message.has("error")) {
+            respondError(id, INVALID_REQUEST, "missing method");
+        }
+        return;
+    }
+
+    if (method == "initialize") {
+        JsonValue sync = JsonValue::object();
+        sync["openClose"] = true;
+        sync["change"] = TEXT_DOCUMENT_SYNC_INCREMENTAL;
+        JsonValue capabilities = JsonValue::object();
+        capabilities["textDocumentSync"] = sync;
+        capabilities["definitionProvider"] = true;
+        JsonValue info = JsonValue::object();
+        info["name"] = "tinyc";
+        JsonValue result = JsonValue::object();
+        result["capabilities"] = capabilities;
+        result["serverInfo"] = info;
+        respond(id, result);
+    } else if (method == "initialized") {
+        // Nothing to do until documents arrive
+    } else if (method == "shutdown") {
+        shutdownRequested = true;
+        respond(id, JsonValue());
+    } else if (method == "exit") {
+        exitRequested = true;
+    } else if (shutdownRequested) {
+        if (isRequest) respondError(id, INVALID_REQUEST, "server is shutting down");
+    } else if (method == "textDocument/didOpen") {
+        didOpen(params);
+    } else if (method == "textDocument/didChange") {
+        didChange(params);
+    } else if (method == "textDocument/didClose") {
+        didClose(params);
+    } else if (method == "textDocument/definition") {
+        respond(id, definition(params));
+    } else if (isRequest) {
+        respondError(id, METHOD_NOT_FOUND, "unsupported method: " + method);
+    }
+}
+
+void LanguageServer::didOpen(const JsonValue& params) {
+    const JsonValue& item = params.get("textDocument");
+    const string& uri = item.get("uri").asString();
+
+    unique_ptr<OpenDocument>& document = documents[uri];
+    document.reset(new OpenDocument());
+    document->text = item.get("text").asString();
+    document->version = item.get("version").asInteger();
+    indexLines(*document);
+    tokenize(*document);
+    analyze(uri, *document);
+}
+
+void LanguageServer::didChange(const JsonValue& params) {
+    const string& uri = params.get("textDocument").get("uri").asString();
+    auto it = documents.find(uri);
+    if (it == documents.end()) return;
+    OpenDocument& document = *it->second;
+
+    const JsonValue& changes = params.get("contentChanges");
+    for (size_t i = 0; i < changes.size(); i++) {
+        const JsonValue& change = changes.at(i);
+        const string& text = change.get("text").asString();
+        if (!change.has("range")) {
+            document.text = text;
+            indexLines(document);
+            tokenize(document);
+            continue;
+        }
+        int start = positionToOffset(document, change.get("range").get("start"));
+        int end = positionToOffset(document, change.get("range").get("end"));
+        if (end < start) swap(start, end);
+        applyEdit(document, start, end - start, text);
+    }
+    document.version = params.get("textDocument").get("version").asInteger();
+    analyze(uri, document);
+}
+
+void LanguageServer::didClose(const JsonValue& params) {
+    const string& uri = params.get("textDocument").get("uri").asString();
+    documents.erase(uri);
+
+    // Clear the editor's markers for the closed file
+    JsonValue clear = JsonValue::object();
+    clear["uri"] = uri;
+    clear["diagnostics"] = JsonValue::array();
+    JsonValue notification = JsonValue::object();
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = "textDocument/publishDiagnostics";
+    notification["params"] = clear;
+    sendMessage(notification);
+}
+
+void LanguageServer::applyEdit(OpenDocument& document, int start, int removedLength, const string& insertedText) {
+    int lineDelta = countNewlines(insertedText, 0, insertedText.size()) -
+                    countNewlines(document.text, start, start + removedLength);
+    document.text.replace(start, removedLength, insertedText);
+    indexLines(document);
+    relex(document, start, removedLength, insertedText.size(), lineDelta);
+}
+
+void LanguageServer::tokenize(OpenDocument& document) {
+    document.tokens.clear();
+    lexFrom(document.text, 0, 1, [&](const IndexedToken& token) {
+        document.tokens.push_back(token);
+        return true;
+    });
+}
+
+void LanguageServer::relex(OpenDocument& document, int start, int removedLength, int insertedLength, int lineDelta) {
+    vector<IndexedToken>& tokens = document.tokens;
+    int delta = insertedLength - removedLength;
+    int editEnd = start + insertedLength;
+
+    // Start one token before the first token touching the edit, since an
+    // edit can merge with its neighbour ("=" followed by a typed "=")
+    size_t first = lower_bound(tokens.begin(), tokens.end(), start,
+                               [](const IndexedToken& token, int offset) {
+                                   return token.offset + (int)token.lexeme.size() < offset;
+                               }) - tokens.begin();
+    if (first > 0) first--;
+    int from = first < tokens.size() ? min(tokens[first].offset, start) : start;
+    int line = upper_bound(document.lineStarts.begin(), document.lineStarts.end(), from) -
+               document.lineStarts.begin();
+
+    // Lex until a token past the edit lines up with an old token at the
+    // same (shifted) position; from there on the old tokens are still valid
+    vector<IndexedToken> fresh;
+    size_t resume = tokens.size();
+    lexFrom(document.text, from, line, [&](const IndexedToken& token) {
+        if (token.offset >= editEnd) {
+            int oldOffset = token.offset - delta;
+            auto match = lower_bound(tokens.begin() + first, tokens.end(), oldOffset,
+                                     [](const IndexedToken& old, int offset) {
+                                         return old.offset < offset;
+                                     });
+            if (match != tokens.end() && match->offset == oldOffset &&
+                match->code == token.code && match->lexeme == token.lexeme) {
+                resume = match - tokens.begin();
+                return false;
+            }
+        }
+        fresh.push_back(token);
+        return true;
+    });
+    tokensRelexed += fresh.size();
+
+    for (size_t i = resume; i < tokens.size(); i++) {
+        tokens[i].offset += delta;
+        tokens[i].line += lineDelta;
+    }
+    tokens.erase(tokens.begin() + first, tokens.begin() + resume);
+    tokens.insert(tokens.begin() + first, fresh.begin(), fresh.end());
+}
+
+void LanguageServer::indexLines(OpenDocument& document) {
+    document.lineStarts.assign(1, 0);
+    const string& text = document.text;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') document.lineStarts.push_back(i + 1);
+    }
+}
+
+int LanguageServer::positionToOffset(const OpenDocument& document, const JsonValue& position) const {
+    long long line = position.get("line").asInteger();
+    long long character = position.get("character").asInteger();
+    if (line < 0) return 0;
+    if (line >= (long long)document.lineStarts.size()) return document.text.size();
+
+    int begin = document.lineStarts[line];
+    int end = line + 1 < (long long)document.lineStarts.size() ? document.lineStarts[line + 1] - 1
+                                                                 : document.text.size();
+    return begin + (int)min<long long>(max<long long>(character, 0), end - begin);
+}
+
+JsonValue LanguageServer::makePosition(const OpenDocument& document, int offset) const {
+    int line = upper_bound(document.lineStarts.begin(), document.lineStarts.end(), offset) -
+               document.lineStarts.begin() - 1;
+    JsonValue position = JsonValue::object();
+    position["line"] = line;
+    position["character"] = offset - document.lineStarts[line];
+    return position;
+}
+
+JsonValue LanguageServer::makeRange(const OpenDocument& document, int begin, int end) const {
+    JsonValue range = JsonValue::object();
+    range["start"] = makePosition(document, begin);
+    range["end"] = makePosition(document, end);
+    return range;
+}
+
+// Diagnostics only carry a line, so they cover its non-blank text
+JsonValue LanguageServer::lineRange(const OpenDocument& document, int line) const {
+    int index = min(max(line - 1, 0), (int)document.lineStarts.size() - 1);
+    int begin = document.lineStarts[index];
+    int end = index + 1 < (int)document.lineStarts.size() ? document.lineStarts[index + 1] - 1
+                                                          : document.text.size();
+    while (begin < end && isspace(static_cast<unsigned char>(document.text[begin]))) begin++;
+    while (end > begin && isspace(static_cast<unsigned char>(document.text[end - 1]))) end--;
+    return makeRange(document, begin, end);
+}
+
+void LanguageServer::analyze(const string& uri, OpenDocument& document) {
+    JsonValue diagnostics = JsonValue::array();
+    auto add = [&](int line, int severity, const string& message) {
+        JsonValue diagnostic = JsonValue::object();
+        diagnostic["range"] = lineRange(document, line);
+        diagnostic["severity"] = severity;
+        diagnostic["source"] = "tinyc";
+        diagnostic["message"] = message;
+        diagnostics.push(diagnostic);
+    };
+
+    try {
+        auto compile = [&]() { document.compiler.compile(document.text, nullStream); };
+        if (!runOnLargeStack(SyntaxAnalyzer::requiredStackBytes(), compile)) compile();
+    } catch (const SyntaxError& e) {
+        add(e.getLine(), SEVERITY_ERROR, e.what());
+    }
+
+    for (const FunctionOutline& function : document.compiler.getOutline()) {
+        const DiagnosticEngine& found = function.result->diagnostics;
+        for (size_t i = 0; i < found.size(); i++) {
+            const Diagnostic& diagnostic = found.at(i);
+            bool error = DIAGNOSTIC_INFO[(int)diagnostic.code].severity == Severity::ERROR;
+            add(diagnostic.line + function.lineDelta, error ? SEVERITY_ERROR : SEVERITY_WARNING,
+                found.message(diagnostic));
+        }
+    }
+
+    JsonValue params = JsonValue::object();
+    params["uri"] = uri;
+    params["version"] = document.version;
+    params["diagnostics"] = diagnostics;
+    JsonValue notification = JsonValue::object();
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = "textDocument/publishDiagnostics";
+    notification["params"] = params;
+    sendMessage(notification);
+}
+
+JsonValue LanguageServer::definition(const JsonValue& params) {
+    const string& uri = params.get("textDocument").get("uri").asString();
+    auto it = documents.find(uri);
+    if (it == documents.end()) return JsonValue();
+    const OpenDocument& document = *it->second;
+
+    // The cursor may sit on any character of the identifier or just after it
+    int offset = positionToOffset(document, params.get("position"));
+    auto after = upper_bound(document.tokens.begin(), document.tokens.end(), offset,
+                             [](int position, const IndexedToken& token) {
+                                 return position < token.offset;
+                             });
+    if (after == document.tokens.begin()) return JsonValue();
+    const IndexedToken& token = *(after - 1);
+    if (token.code != IDENT || offset > token.offset + (int)token.lexeme.size()) return JsonValue();
+    uint32_t name = StringInterner::instance().intern(token.lexeme);
+
+    // Prefer the closest earlier declaration inside the same function, then
+    // fall back to a global or function declared anywhere in the file; a
+    // global is logged with the function after it. Lines recorded
+    // for a function that has since moved are shifted to where it is now.
+    const SymbolInfo* target = nullptr;
+    int targetLine = 0;
+    const vector<FunctionOutline>& outline = document.compiler.getOutline();
+    for (const FunctionOutline& function : outline) {
+        if ((size_t)token.offset < function.chunk.begin || (size_t)token.offset >= function.chunk.end) continue;
+        for (const SymbolInfo& symbol : function.result->declarations) {
+            if (symbol.name == name && symbol.lineNumber + function.lineDelta <= token.line) {
+                target = &symbol;
+                targetLine = symbol.lineNumber + function.lineDelta;
+            }
+        }
+    }
+    for (size_t i = 0; !target && i < outline.size(); i++) {
+        for (const SymbolInfo& symbol : outline[i].result->declarations) {
+            if (symbol.name == name && symbol.scopeLevel == 0) {
+                target = &symbol;
+                targetLine = symbol.lineNumber + outline[i].lineDelta;
+                break;
+            }
+        }
+    }
+    if (!target) return JsonValue();
+
+    // The symbol table stores lines; find the name's column in the index
+    int begin = document.lineStarts[min(max(targetLine - 1, 0), (int)document.lineStarts.size() - 1)];
+    int end = begin;
+    auto candidate = lower_bound(document.tokens.begin(), document.tokens.end(), targetLine,
+                                 [](const IndexedToken& indexed, int line) {
+                                     return indexed.line < line;
+                                 });
+    for (; candidate != document.tokens.end() && candidate->line == targetLine; ++candidate) {
+        if (candidate->code == IDENT && candidate->lexeme == StringInterner::instance().view(target->name)) {
+            begin = candidate->offset;
+            end = begin + candidate->lexeme.size();
+            break;
+        }
+    }
+
+    JsonValue location = JsonValue::object();
+    location["uri"] = uri;
+    location["range"] = makeRange(document, begin, end);
+    return location;
+}
+
+long long LanguageServer::getTokensRelexed() const {
+    return tokensRelexed;
+}
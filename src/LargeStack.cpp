@@ -0,0 +1,64 @@
+#include "LargeStack.h"
+
+#include <exception>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace {
+    struct StackCall {
+        const function<void()>* body;
+        exception_ptr error;
+        ucontext_t caller;
+        ucontext_t callee;
+    };
+
+    // makecontext passes only int arguments, so the call is handed over here
+    thread_local StackCall* pendingCall = nullptr;
+
+    void trampoline() {
+        StackCall* call = pendingCall;
+        try {
+            (*call->body)();
+        } catch (...) {
+            call->error = current_exception();
+        }
+        // Returning resumes call->caller through uc_link
+    }
+}
+
+bool runOnLargeStack(size_t requestedBytes, const function<void()>& body) {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t stackBytes = (requestedBytes + page - 1) / page * page;
+    const size_t mappedBytes = stackBytes + page;
+    void* memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (memory == MAP_FAILED) return false;
+    // Stacks grow down, so the guard goes at the lowest address
+    if (mprotect(memory, page, PROT_NONE) != 0) {
+        munmap(memory, mappedBytes);
+        return false;
+    }
+
+    StackCall call;
+    call.body = &body;
+    if (getcontext(&call.callee) != 0) {
+        munmap(memory, mappedBytes);
+        return false;
+    }
+    call.callee.uc_stack.ss_sp = (char*)memory + page;
+    call.callee.uc_stack.ss_size = stackBytes;
+    call.callee.uc_link = &call.caller;
+    makecontext(&call.callee, trampoline, 0);
+
+    // Nested calls (a compile started from inside another) restore the outer one
+    StackCall* outer = pendingCall;
+    pendingCall = &call;
+    swapcontext(&call.caller, &call.callee);
+    pendingCall = outer;
+
+    munmap(memory, mappedBytes);
+    if (call.error) rethrow_exception(call.error);
+    return true;
+}
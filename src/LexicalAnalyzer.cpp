@@ -1,23 +1,57 @@
+#include <charconv>
+#include <cmath>
 #include <iostream>
-#include <fstream>
 #include <cctype>
+#include <limits>
+#include <system_error>
 
 #include "LexicalAnalyzer.h"
+#include "Statistics.h"
 #include "Token.h"
 #include "TokenCodes.h"
+#include "TokenPatterns.h"
 
 using namespace std;
 
-LexicalAnalyzer::LexicalAnalyzer(ifstream *scf) : sourceCodeFile(scf), currentTokenPosition(0) {}
+thread_local bool LexicalAnalyzer::useDfa = false;
+
+const string LexicalAnalyzer::lexemes[LexicalAnalyzer::LEXEME_COUNT] = {"+", "-", "*", "/", "%", "(", ")", "{", "}", ",", ";", "||", "&&",
+                        "=", "==", "!", "!=", "<", "<=", ">", ">=", "bool", "do", "else", "false", "float", "for",
+                        "if", "int", "printf", "return", "scanf", "true", "void", "while", "[", "]"};
+
+LexicalAnalyzer::LexicalAnalyzer(istream *scf, ostream &output) : sourceCodeFile(scf), out(output), currentTokenPosition(0), currentLine(1), offset(0) {}
+
+void LexicalAnalyzer::setStartPosition(int startOffset, int startLine)
+{
+    offset = startOffset;
+    currentTokenPosition = startOffset;
+    currentLine = startLine;
+}
+
+// Reads one character, keeping the offset and line count up to date
+bool LexicalAnalyzer::readCharacter(char &c)
+{
+    if (!sourceCodeFile->get(c))
+        return false;
+    offset++;
+    if (c == '\n')
+        currentLine++;
+    return true;
+}
 
 Token *LexicalAnalyzer::getNextToken()
 {
+    TINYC_PHASE(Phase::LEXER);
+    TINYC_COUNT(Counter::TOKENS_LEXED, 1);
+    if (useDfa)
+        return scanToken();
     Token *t = new Token();
 
     if (sourceCodeFile->eof())
     {
         t->setLexemeString("end of file");
         t->setTokenCode(TokenCodes::EOI);
+        t->setLineNumber(currentLine);
         return t;
     }
 
@@ -27,14 +61,17 @@ Token *LexicalAnalyzer::getNextToken()
     // Skip whitespace
     while (!sourceCodeFile->eof() && isWhitespace(tokenPart))
     {
-        sourceCodeFile->get(tokenPart);
+        readCharacter(tokenPart);
         if (sourceCodeFile->eof()) 
         {
             t->setLexemeString("end of file");
             t->setTokenCode(TokenCodes::EOI);
+            t->setLineNumber(currentLine);
             return t;
         }
     }
+    currentTokenPosition = offset - 1;
+    t->setLineNumber(currentLine);
 
     // Build the token
     if (!sourceCodeFile->eof())
@@ -49,7 +86,7 @@ Token *LexicalAnalyzer::getNextToken()
             
             if (LexicalAnalyzer::checkLongLexeme(newToken, nextCharacter))
             {
-                sourceCodeFile->get(tokenPart);
+                readCharacter(tokenPart);
                 newToken += tokenPart;
             }
             else
@@ -63,6 +100,17 @@ Token *LexicalAnalyzer::getNextToken()
                     if (isWhitespace(peeked) || sourceCodeFile->eof())
                         break;
                         
+                    // An exponent sign belongs to the number (once), as
+                    // in a C preprocessing number: 1e-5, 2.5E+3
+                    if ((peeked == '+' || peeked == '-') && isDigit(newToken[0]) &&
+                        (newToken.back() == 'e' || newToken.back() == 'E') &&
+                        newToken.find_first_of("+-") == string::npos)
+                    {
+                        readCharacter(tokenPart);
+                        newToken += tokenPart;
+                        continue;
+                    }
+
                     // Stop if next character would start a new token
                     string peekStr(1, peeked);
                     if (LexicalAnalyzer::checkNextCharacter(newToken, peekStr, LexicalAnalyzer::lexemes))
@@ -74,7 +122,7 @@ Token *LexicalAnalyzer::getNextToken()
                         if (isAlpha(peeked) || isDigit(peeked) ||
                             (peeked == '.' && isDigit(newToken[0])))
                         {
-                            sourceCodeFile->get(tokenPart);
+                            readCharacter(tokenPart);
                             newToken += tokenPart;
                         }
                         else
@@ -91,7 +139,7 @@ Token *LexicalAnalyzer::getNextToken()
         }
     }
 
-    cout << newToken << " ";
+    out << newToken << " ";
     t->setLexemeString(newToken);
 
     if (newToken == "bool") t->setTokenCode(BOOLSYM);
@@ -133,13 +181,98 @@ Token *LexicalAnalyzer::getNextToken()
     else
     {
         t->setTokenCode(LexicalAnalyzer::tokenCodeSolver(newToken, LexicalAnalyzer::lexemes));
+        if (t->getTokenCode() == NUMLIT)
+            decodeNumber(t, newToken);
     }
-    currentTokenPosition += newToken.length();
 
     return t;
 }
 
-bool LexicalAnalyzer::checkNextCharacter(string &newToken, string &nextToken, string lexemes[])
+// Longest match: follow transitions until the next byte has none. Every
+// state but the start accepts, so there is never anything to give back.
+Token *LexicalAnalyzer::scanToken()
+{
+    using namespace TokenPatterns;
+    Token *t = new Token();
+    streambuf *input = sourceCodeFile->rdbuf();
+
+    int c = input->sgetc();
+    while (c != EOF && AUTOMATON.byteClass[c] == 0)
+    {
+        if (c == '\n')
+            currentLine++;
+        offset++;
+        c = input->snextc();
+    }
+    t->setLineNumber(currentLine);
+
+    if (c == EOF)
+    {
+        sourceCodeFile->setstate(ios::eofbit);
+        t->setLexemeString("end of file");
+        t->setTokenCode(TokenCodes::EOI);
+        return t;
+    }
+
+    currentTokenPosition = offset;
+    string lexeme;
+    int state = START;
+    while (c != EOF)
+    {
+        int next = AUTOMATON.next[state][AUTOMATON.byteClass[c]];
+        if (next == DEAD)
+            break;
+        lexeme += (char)c;
+        state = next;
+        c = input->snextc();
+    }
+    offset += lexeme.size();
+
+    out << lexeme << " ";
+    t->setLexemeString(lexeme);
+    t->setTokenCode((TokenCodes)AUTOMATON.accept[state]);
+    if (t->getTokenCode() == NUMLIT)
+        decodeNumber(t, lexeme);
+    return t;
+}
+
+// Numbers are decoded here once, so no later phase converts text again.
+// 0x1F is hexadecimal and 017 octal; a '.' or exponent makes a float.
+// A literal too large for its type keeps NUMLIT and is flagged, so the
+// parser goes on and the semantic analyzer reports it.
+void LexicalAnalyzer::decodeNumber(Token *t, const string &text)
+{
+    const char *first = text.data();
+    const char *last = first + text.size();
+    bool hexadecimal = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+    bool floating = !hexadecimal && text.find_first_of(".eE") != string::npos;
+    int intValue = 0;
+    double floatValue = 0;
+    from_chars_result result;
+
+    if (hexadecimal)
+        result = from_chars(first + 2, last, intValue, 16);
+    else if (floating)
+        result = from_chars(first, last, floatValue);
+    else
+        result = from_chars(first, last, intValue, text.size() > 1 && text[0] == '0' ? 8 : 10);
+
+    // A float literal must fit a float, not just the double it is read into
+    bool outOfRange = result.ec == errc::result_out_of_range ||
+                      (floating && fabs(floatValue) > numeric_limits<float>::max());
+    if (result.ptr != last || (result.ec != errc() && !outOfRange))
+    {
+        t->setTokenCode(NAL);
+        return;
+    }
+
+    if (floating)
+        t->setFloatValue(outOfRange ? 0 : floatValue, outOfRange);
+    else
+        t->setIntValue(outOfRange ? 0 : intValue, outOfRange);
+}
+
+bool LexicalAnalyzer::checkNextCharacter(string &newToken, string &nextToken, const string lexemes[])
 {
     for (int i = 0; i < LEXEME_COUNT; i++)
     {
@@ -155,7 +288,7 @@ bool LexicalAnalyzer::checkNextCharacter(string &newToken, string &nextToken, st
     return false;
 }
 
-bool LexicalAnalyzer::validLexeme(string &token, char tokenpart, string lexemes[])
+bool LexicalAnalyzer::validLexeme(string &token, char tokenpart, const string lexemes[])
 {
     for (int i = 0; i < LEXEME_COUNT; i++)
     {
@@ -226,7 +359,7 @@ bool LexicalAnalyzer::checkLongLexeme(string &token, string &nextToken)
     return false;
 }
 
-TokenCodes LexicalAnalyzer::tokenCodeSolver(string &token, string lexemes[])
+TokenCodes LexicalAnalyzer::tokenCodeSolver(string &token, const string lexemes[])
 {
     for (int i = 0; i < LEXEME_COUNT; i++)
     {
@@ -249,22 +382,7 @@ TokenCodes LexicalAnalyzer::tokenCodeSolver(string &token, string lexemes[])
     }
     else if (isDigit(token[0]))
     {
-        bool hasDecimal = false;
-        for (size_t i = 0; i < token.length(); i++)
-        {
-            if (!isDigit(token[i]))
-            {
-                if (token[i] == '.' && !hasDecimal)  // '.' character
-                {
-                    hasDecimal = true;
-                    continue;
-                }
-                else
-                {
-                    return TokenCodes::NAL;
-                }
-            }
-        }
+        // Checked and decoded by decodeNumber()
         return TokenCodes::NUMLIT;
     }
     else
@@ -278,6 +396,11 @@ int LexicalAnalyzer::getCurrentTokenPosition()
     return currentTokenPosition;
 }
 
+int LexicalAnalyzer::getCurrentLine()
+{
+    return currentLine;
+}
+
 bool LexicalAnalyzer::isAlpha(char c) const
 {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
@@ -0,0 +1,279 @@
+#include "ModuleInterface.h"
+#include "Hash.h"
+#include "StringInterner.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[4] = {'T', 'C', 'M', 'I'};
+    const uint16_t BYTE_ORDER_MARK = 0x0102;
+
+    template <typename T>
+    void append(string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+ModuleInterface::ModuleInterface()
+    : mapping(nullptr), mappedBytes(0), header(nullptr), records(nullptr), buckets(nullptr),
+      parameters(nullptr), extents(nullptr), pool(nullptr) {}
+
+ModuleInterface::~ModuleInterface() {
+    if (mapping) munmap(const_cast<char*>(mapping), mappedBytes);
+}
+
+uint32_t ModuleInterface::hashName(string_view name) {
+    return (uint32_t)Hash64::hash(name.data(), name.size());
+}
+
+bool ModuleInterface::write(const string& path, const vector<SymbolInfo>& globals, string& error) {
+    // The index stays at most half full, so a probe for a missing name
+    // soon meets an empty bucket
+    uint32_t bucketCount = 1;
+    while (bucketCount < globals.size() * 2) bucketCount *= 2;
+
+    vector<Record> records;
+    vector<uint32_t> buckets(bucketCount, 0);
+    vector<Parameter> parameters;
+    vector<int32_t> extents;
+    string pool;
+    for (const SymbolInfo& symbol : globals) {
+        string_view name = StringInterner::instance().view(symbol.name);
+        // Dimension counts are stored in a byte
+        const char* tooDeep = symbol.dimensions.size() > UINT8_MAX ? "an array" : nullptr;
+        for (const ParameterType& type : symbol.parameterTypes) {
+            if (type.dimensions.size() > UINT8_MAX) tooDeep = "an array parameter";
+        }
+        if (tooDeep) {
+            error = "cannot write " + path + ": '" + string(name) + "' has " + tooDeep + " of more than " +
+                    to_string(UINT8_MAX) + " dimensions";
+            return false;
+        }
+
+        Record record;
+        record.nameOffset = pool.size();
+        record.nameLength = name.size();
+        record.hash = hashName(name);
+        record.dataType = (uint8_t)symbol.dataType;
+        record.symbolType = (uint8_t)symbol.symbolType;
+        record.isArray = symbol.isArray ? 1 : 0;
+        record.dimensionCount = symbol.dimensions.size();
+        record.lineNumber = symbol.lineNumber;
+        record.arraySize = symbol.arraySize;
+        record.firstExtent = extents.size();
+        extents.insert(extents.end(), symbol.dimensions.begin(), symbol.dimensions.end());
+        record.firstParameter = parameters.size();
+        record.parameterCount = symbol.parameterTypes.size();
+        for (const ParameterType& type : symbol.parameterTypes) {
+            Parameter parameter;
+            parameter.dataType = (uint8_t)type.type;
+            parameter.dimensionCount = type.dimensions.size();
+            parameter.reserved = 0;
+            parameter.firstExtent = extents.size();
+            extents.insert(extents.end(), type.dimensions.begin(), type.dimensions.end());
+            parameters.push_back(parameter);
+        }
+        pool.append(name.data(), name.size());
+
+        size_t i = record.hash & (bucketCount - 1);
+        while (buckets[i]) i = (i + 1) & (bucketCount - 1);
+        buckets[i] = records.size() + 1;
+        records.push_back(record);
+    }
+
+    string body;
+    body.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    body.append(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+    body.append(reinterpret_cast<const char*>(parameters.data()), parameters.size() * sizeof(Parameter));
+    body.append(reinterpret_cast<const char*>(extents.data()), extents.size() * sizeof(int32_t));
+    body += pool;
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.symbolCount = records.size();
+    header.bucketCount = bucketCount;
+    header.parameterCount = parameters.size();
+    header.poolBytes = pool.size();
+    header.extentCount = extents.size();
+    header.reserved = 0;
+    header.contentHash = Hash64::hash(body);
+    header.fileBytes = sizeof(Header) + body.size();
+
+    string contents;
+    append(contents, header);
+    contents += body;
+
+    // Written beside the target and renamed over it, so a compiler that
+    // maps the old file keeps a consistent view
+    string temporary = path + ".tmp" + to_string(getpid());
+    {
+        ofstream file(temporary, ios::out | ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            error = "cannot write " + temporary;
+            return false;
+        }
+        file.write(contents.data(), contents.size());
+        file.close();
+        if (file.fail()) {
+            unlink(temporary.c_str());
+            error = "cannot write " + temporary;
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "cannot replace " + path + ": " + strerror(errno);
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+shared_ptr<const ModuleInterface> ModuleInterface::open(const string& path, string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + strerror(errno);
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        error = path + " is not a module interface";
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        error = "cannot map " + path + ": " + strerror(errno);
+        return nullptr;
+    }
+
+    shared_ptr<ModuleInterface> module(new ModuleInterface());
+    module->path = path;
+    module->mapping = static_cast<const char*>(memory);
+    module->mappedBytes = status.st_size;
+    module->header = reinterpret_cast<const Header*>(module->mapping);
+
+    const Header& header = *module->header;
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a module interface";
+        return nullptr;
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK || header.version != VERSION) {
+        error = path + " was written by an incompatible compiler (interface version " +
+                to_string(header.version) + ", expected " + to_string(VERSION) + ")";
+        return nullptr;
+    }
+
+    // Every section must fit exactly; the records themselves are checked
+    // when they are decoded
+    uint64_t recordsEnd = sizeof(Header) + (uint64_t)header.symbolCount * sizeof(Record);
+    uint64_t bucketsEnd = recordsEnd + (uint64_t)header.bucketCount * sizeof(uint32_t);
+    uint64_t parametersEnd = bucketsEnd + (uint64_t)header.parameterCount * sizeof(Parameter);
+    uint64_t extentsEnd = parametersEnd + (uint64_t)header.extentCount * sizeof(int32_t);
+    uint64_t poolEnd = extentsEnd + header.poolBytes;
+    bool powerOfTwo = header.bucketCount != 0 && (header.bucketCount & (header.bucketCount - 1)) == 0;
+    if (!powerOfTwo || header.bucketCount < header.symbolCount || header.fileBytes != module->mappedBytes ||
+        poolEnd != module->mappedBytes) {
+        error = path + " is truncated or damaged";
+        return nullptr;
+    }
+
+    module->records = reinterpret_cast<const Record*>(module->mapping + sizeof(Header));
+    module->buckets = reinterpret_cast<const uint32_t*>(module->mapping + recordsEnd);
+    module->parameters = reinterpret_cast<const Parameter*>(module->mapping + bucketsEnd);
+    module->extents = reinterpret_cast<const int32_t*>(module->mapping + parametersEnd);
+    module->pool = module->mapping + extentsEnd;
+    return module;
+}
+
+bool ModuleInterface::find(string_view name, SymbolInfo& symbol) const {
+    uint32_t hash = hashName(name);
+    uint32_t mask = header->bucketCount - 1;
+    for (uint32_t probe = 0, i = hash & mask; probe <= mask; probe++, i = (i + 1) & mask) {
+        uint32_t slot = buckets[i];
+        if (slot == 0 || slot > header->symbolCount) return false;
+
+        const Record& record = records[slot - 1];
+        if (record.hash != hash || record.nameLength != name.size()) continue;
+        if ((uint64_t)record.nameOffset + record.nameLength > header->poolBytes) return false;
+        if (memcmp(pool + record.nameOffset, name.data(), name.size()) != 0) continue;
+        return decode(record, symbol);
+    }
+    return false;
+}
+
+bool ModuleInterface::decode(const Record& record, SymbolInfo& symbol) const {
+    if (record.dataType > (uint8_t)DataType::UNKNOWN || record.symbolType > (uint8_t)SymbolType::PARAMETER ||
+        (uint64_t)record.firstParameter + record.parameterCount > header->parameterCount ||
+        (record.isArray != 0) != (record.dimensionCount != 0)) {
+        return false;
+    }
+
+    // The extents must describe the array the record claims
+    vector<int> dimensions;
+    if (!decodeDimensions(record.firstExtent, record.dimensionCount, false, dimensions)) return false;
+    int64_t elements = 1;
+    for (int extent : dimensions) elements *= extent;
+    if (record.isArray && elements != record.arraySize) return false;
+
+    vector<ParameterType> parameterTypes(record.parameterCount);
+    for (uint32_t i = 0; i < record.parameterCount; i++) {
+        const Parameter& parameter = parameters[record.firstParameter + i];
+        uint8_t type = parameter.dataType;
+        parameterTypes[i].type = static_cast<DataType>(type > (uint8_t)DataType::UNKNOWN ?
+                                                       (uint8_t)DataType::UNKNOWN : type);
+        if (!decodeDimensions(parameter.firstExtent, parameter.dimensionCount, true, parameterTypes[i].dimensions)) {
+            return false;
+        }
+    }
+
+    symbol.name = StringInterner::instance().intern(string_view(pool + record.nameOffset, record.nameLength));
+    symbol.dataType = static_cast<DataType>(record.dataType);
+    symbol.symbolType = static_cast<SymbolType>(record.symbolType);
+    symbol.scopeLevel = 0;
+    symbol.lineNumber = record.lineNumber;
+    symbol.isInitialized = false;
+    symbol.isArray = false;
+    symbol.arraySize = 0;
+    symbol.dimensions.clear();
+    symbol.strides.clear();
+    if (record.isArray) symbol.setDimensions(dimensions);
+    symbol.parameterTypes = move(parameterTypes);
+    symbol.parameterCount = symbol.parameterTypes.size();
+    return true;
+}
+
+bool ModuleInterface::decodeDimensions(uint32_t first, uint32_t count, bool parameter,
+                                       vector<int>& dimensions) const {
+    if ((uint64_t)first + count > header->extentCount) return false;
+    dimensions.assign(extents + first, extents + first + count);
+    int64_t elements = 1;
+    for (size_t i = 0; i < dimensions.size(); i++) {
+        // A parameter's first extent may be left out
+        if (parameter && i == 0 && dimensions[i] == 0) continue;
+        if (dimensions[i] <= 0 || (elements *= dimensions[i]) > INT32_MAX) return false;
+    }
+    return true;
+}
+
+size_t ModuleInterface::size() const {
+    return header->symbolCount;
+}
+
+const string& ModuleInterface::getPath() const {
+    return path;
+}
+
+uint64_t ModuleInterface::getContentHash() const {
+    return header->contentHash;
+}
@@ -0,0 +1,394 @@
+#include "Preprocessor.h"
+#include "Statistics.h"
+#include "StringInterner.h"
+#include "SyntaxAnalyzer.h"
+
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <sys/stat.h>
+
+using namespace std;
+
+thread_local bool Preprocessor::enabled = false;
+thread_local vector<string> Preprocessor::includePaths;
+
+namespace {
+    bool isIdentifier(const string& name) {
+        if (name.empty() || !(isalpha((unsigned char)name[0]) || name[0] == '_')) return false;
+        for (char c : name) {
+            if (!isalnum((unsigned char)c) && c != '_') return false;
+        }
+        return true;
+    }
+
+    string directoryOf(const string& path) {
+        size_t slash = path.rfind('/');
+        return slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    }
+
+    // The canonical path of an existing file, so every spelling of a
+    // header shares one cache entry and one #pragma once
+    bool resolve(const string& candidate, string& path) {
+        char buffer[PATH_MAX];
+        struct stat status;
+        if (stat(candidate.c_str(), &status) != 0 || !S_ISREG(status.st_mode) ||
+            !realpath(candidate.c_str(), buffer)) {
+            return false;
+        }
+        path = buffer;
+        return true;
+    }
+
+    // Lexes a fragment (a macro body) without echoing it
+    vector<Token> lexFragment(const string& text) {
+        istringstream input(text);
+        ostream discard(nullptr);
+        LexicalAnalyzer lexer(&input, discard);
+        vector<Token> tokens;
+        while (true) {
+            Token* token = lexer.getNextToken();
+            bool done = token->getTokenCode() == EOI;
+            if (!done) tokens.push_back(*token);
+            delete token;
+            if (done) return tokens;
+        }
+    }
+}
+
+DirectiveFilter::DirectiveFilter(streambuf* source, deque<Directive>& directives)
+    : source(source), directives(directives), lineNumber(0) {}
+
+DirectiveFilter::int_type DirectiveFilter::underflow() {
+    while (true) {
+        line.clear();
+        int_type c;
+        while ((c = source->sbumpc()) != traits_type::eof()) {
+            line += traits_type::to_char_type(c);
+            if (c == '\n') break;
+        }
+        if (line.empty()) return traits_type::eof();
+        lineNumber++;
+
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first != string::npos && line[first] == '#') {
+            string text = line.substr(first + 1);
+            while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+            directives.push_back(parse(text, lineNumber));
+            if (line.back() != '\n') continue;
+            line = "\n";
+        }
+        char* begin = &line[0];
+        setg(begin, begin, begin + line.size());
+        return traits_type::to_int_type(line[0]);
+    }
+}
+
+Directive DirectiveFilter::parse(const string& text, int line) {
+    Directive directive;
+    directive.line = line;
+
+    size_t pos = text.find_first_not_of(" \t");
+    size_t end = pos == string::npos ? text.size() : pos;
+    while (end < text.size() && isalpha((unsigned char)text[end])) end++;
+    string word = pos == string::npos ? "" : text.substr(pos, end - pos);
+    size_t restBegin = text.find_first_not_of(" \t", end);
+    string rest = restBegin == string::npos ? "" : text.substr(restBegin);
+    while (!rest.empty() && (rest.back() == ' ' || rest.back() == '\t')) rest.pop_back();
+
+    auto error = [&](const string& message) {
+        directive.kind = Directive::ERROR;
+        directive.argument = message;
+        return directive;
+    };
+
+    if (word.empty()) {
+        // A lone # is a null directive
+        directive.kind = Directive::IGNORED;
+    } else if (word == "include") {
+        char close = rest.empty() ? 0 : rest[0] == '"' ? '"' : rest[0] == '<' ? '>' : 0;
+        if (!close || rest.size() < 3 || rest.back() != close) {
+            return error("#include expects \"FILE\" or <FILE>");
+        }
+        directive.kind = Directive::INCLUDE;
+        directive.system = close == '>';
+        directive.argument = rest.substr(1, rest.size() - 2);
+    } else if (word == "define") {
+        size_t nameEnd = 0;
+        while (nameEnd < rest.size() && (isalnum((unsigned char)rest[nameEnd]) || rest[nameEnd] == '_')) nameEnd++;
+        string name = rest.substr(0, nameEnd);
+        if (!isIdentifier(name)) return error("#define expects a macro name");
+        if (nameEnd < rest.size() && rest[nameEnd] == '(') {
+            return error("function-like macro '" + name + "' is not supported");
+        }
+        directive.kind = Directive::DEFINE;
+        directive.argument = name;
+        directive.body = lexFragment(rest.substr(nameEnd));
+    } else if (word == "undef" || word == "ifdef" || word == "ifndef") {
+        if (!isIdentifier(rest)) return error("#" + word + " expects a macro name");
+        directive.kind = word == "undef" ? Directive::UNDEF : word == "ifdef" ? Directive::IFDEF : Directive::IFNDEF;
+        directive.argument = rest;
+    } else if (word == "else" || word == "endif") {
+        directive.kind = word == "else" ? Directive::ELSE : Directive::ENDIF;
+    } else if (word == "pragma") {
+        directive.kind = rest == "once" ? Directive::PRAGMA_ONCE : Directive::IGNORED;
+    } else {
+        return error("unknown directive #" + word);
+    }
+    return directive;
+}
+
+HeaderCache& HeaderCache::instance() {
+    static HeaderCache cache;
+    return cache;
+}
+
+shared_ptr<const TokenizedHeader> HeaderCache::load(const string& path, string& error) {
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        error = "cannot open include file '" + path + "'";
+        return nullptr;
+    }
+    int64_t modified = (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = entries.find(path);
+        if (it != entries.end() && it->second.modified == modified && it->second.bytes == status.st_size) {
+            TINYC_COUNT(Counter::HEADERS_REUSED, 1);
+            return it->second.header;
+        }
+    }
+
+    // Lexed outside the lock; two threads missing at once both lex the
+    // header and the second result replaces the first
+    ifstream file(path, ios::in | ios::binary);
+    if (!file.is_open()) {
+        error = "cannot open include file '" + path + "'";
+        return nullptr;
+    }
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    shared_ptr<TokenizedHeader> header = make_shared<TokenizedHeader>();
+    header->path = path;
+    header->directory = directoryOf(path);
+    Preprocessor::tokenize(text, *header);
+    TINYC_COUNT(Counter::HEADERS_LEXED, 1);
+
+    lock_guard<mutex> guard(lock);
+    entries[path] = {modified, (int64_t)status.st_size, header};
+    return header;
+}
+
+size_t HeaderCache::size() const {
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+void HeaderCache::clear() {
+    lock_guard<mutex> guard(lock);
+    entries.clear();
+}
+
+void Preprocessor::tokenize(const string& text, TokenizedHeader& header) {
+    istringstream input(text);
+    deque<Directive> directives;
+    DirectiveFilter filter(input.rdbuf(), directives);
+    istream filtered(&filter);
+    ostream discard(nullptr);
+    LexicalAnalyzer lexer(&filtered, discard);
+
+    while (true) {
+        Token* token = lexer.getNextToken();
+        bool done = token->getTokenCode() == EOI;
+        // Every directive above the token's line comes before it
+        while (!directives.empty() && (done || directives.front().line < token->getLineNumber())) {
+            directives.front().position = header.tokens.size();
+            header.directives.push_back(move(directives.front()));
+            directives.pop_front();
+        }
+        if (!done) header.tokens.push_back(*token);
+        delete token;
+        if (done) return;
+    }
+}
+
+Preprocessor::Preprocessor(istream* source, ostream& output)
+    : LexicalAnalyzer(source, output), discard(nullptr), filter(source->rdbuf(), pending), filtered(&filter),
+      scanner(&filtered, discard), echo(output), lookahead(nullptr), headerDepth(0) {}
+
+Preprocessor::~Preprocessor() {
+    delete lookahead;
+}
+
+bool Preprocessor::skipping() const {
+    return !conditionals.empty() && !conditionals.back().active();
+}
+
+bool Preprocessor::expanding(uint32_t macro) const {
+    for (const Frame& frame : frames) {
+        if (frame.body && frame.macro == macro) return true;
+    }
+    return false;
+}
+
+void Preprocessor::fail(const string& message, int line) {
+    echo << endl;
+    echo << "===============================================" << endl;
+    echo << "PREPROCESSOR ERROR" << endl;
+    echo << "===============================================" << endl;
+    echo << message << endl;
+    echo << "Line:     " << line << endl;
+    echo << "===============================================" << endl;
+    TINYC_COUNT(Counter::DIAGNOSTICS, 1);
+    throw SyntaxError(message, line);
+}
+
+// The next token of the innermost header or macro, or of the source once
+// they are exhausted, after applying the directives that precede it
+Token* Preprocessor::nextRawToken() {
+    while (true) {
+        if (!frames.empty()) {
+            Frame& frame = frames.back();
+            if (frame.body) {
+                if (frame.nextToken < frame.body->size()) {
+                    Token* token = new Token((*frame.body)[frame.nextToken++]);
+                    token->setLineNumber(frame.line);
+                    return token;
+                }
+                frames.pop_back();
+                continue;
+            }
+
+            const TokenizedHeader& header = *frame.header;
+            if (frame.nextDirective < header.directives.size() &&
+                header.directives[frame.nextDirective].position == frame.nextToken) {
+                // apply() may push a frame, so frame is not used after it
+                shared_ptr<const TokenizedHeader> file = frame.header;
+                const Directive& directive = header.directives[frame.nextDirective++];
+                apply(directive, file.get());
+                continue;
+            }
+            if (frame.nextToken < header.tokens.size()) {
+                return new Token(header.tokens[frame.nextToken++]);
+            }
+            endOfFile(frame.conditionalDepth);
+            frames.pop_back();
+            headerDepth--;
+            continue;
+        }
+
+        if (!lookahead) lookahead = scanner.getNextToken();
+        bool done = lookahead->getTokenCode() == EOI;
+        if (!pending.empty() && (done || pending.front().line < lookahead->getLineNumber())) {
+            Directive directive = move(pending.front());
+            pending.pop_front();
+            apply(directive, nullptr);
+            continue;
+        }
+        if (done) endOfFile(0);
+        Token* token = lookahead;
+        lookahead = nullptr;
+        return token;
+    }
+}
+
+void Preprocessor::endOfFile(size_t conditionalDepth) {
+    if (conditionals.size() > conditionalDepth) {
+        fail("unterminated #ifdef", conditionals.back().line);
+    }
+}
+
+// file is the header the directive is in, or null for the source itself
+void Preprocessor::apply(const Directive& directive, const TokenizedHeader* file) {
+    size_t depth = frames.empty() ? 0 : frames.back().conditionalDepth;
+    switch (directive.kind) {
+    case Directive::IFDEF:
+    case Directive::IFNDEF: {
+        bool defined = macros.count(StringInterner::instance().intern(directive.argument)) > 0;
+        conditionals.push_back({defined == (directive.kind == Directive::IFDEF), !skipping(), false, directive.line});
+        return;
+    }
+    case Directive::ELSE:
+        if (conditionals.size() <= depth || conditionals.back().sawElse) fail("#else without #ifdef", directive.line);
+        conditionals.back().sawElse = true;
+        return;
+    case Directive::ENDIF:
+        if (conditionals.size() <= depth) fail("#endif without #ifdef", directive.line);
+        conditionals.pop_back();
+        return;
+    default:
+        break;
+    }
+    if (skipping()) return;
+
+    switch (directive.kind) {
+    case Directive::INCLUDE:
+        include(directive, file);
+        break;
+    case Directive::DEFINE:
+        macros[StringInterner::instance().intern(directive.argument)] = directive.body;
+        break;
+    case Directive::UNDEF:
+        macros.erase(StringInterner::instance().intern(directive.argument));
+        break;
+    case Directive::PRAGMA_ONCE:
+        if (file) onceFiles.insert(file->path);
+        break;
+    case Directive::ERROR:
+        fail(directive.argument, directive.line);
+    default:
+        break;
+    }
+}
+
+void Preprocessor::include(const Directive& directive, const TokenizedHeader* file) {
+    string path;
+    bool found = !directive.argument.empty() && directive.argument[0] == '/' && resolve(directive.argument, path);
+    if (!found && !directive.system && file) {
+        found = resolve(file->directory + "/" + directive.argument, path);
+    }
+    for (size_t i = 0; !found && i < includePaths.size(); i++) {
+        found = resolve(includePaths[i] + "/" + directive.argument, path);
+    }
+    if (!found && !directive.system && !file && includePaths.empty()) {
+        found = resolve(directive.argument, path);
+    }
+    if (!found) fail("cannot find include file '" + directive.argument + "'", directive.line);
+
+    if (onceFiles.count(path)) return;
+    if (headerDepth >= MAX_INCLUDE_DEPTH) {
+        fail("#include nested more than " + to_string(MAX_INCLUDE_DEPTH) + " deep", directive.line);
+    }
+
+    string error;
+    shared_ptr<const TokenizedHeader> header = HeaderCache::instance().load(path, error);
+    if (!header) fail(error, directive.line);
+    frames.push_back({header, 0, 0, conditionals.size(), nullptr, 0, 0});
+    headerDepth++;
+}
+
+Token* Preprocessor::getNextToken() {
+    while (true) {
+        Token* token = nextRawToken();
+        if (token->getTokenCode() == EOI) return token;
+        if (skipping()) {
+            delete token;
+            continue;
+        }
+        if (token->getTokenCode() == IDENT && !macros.empty()) {
+            auto it = macros.find(StringInterner::instance().find(token->getLexemeString()));
+            if (it != macros.end() && !expanding(it->first)) {
+                TINYC_COUNT(Counter::MACRO_EXPANSIONS, 1);
+                frames.push_back({nullptr, 0, 0, conditionals.size(), &it->second, it->first,
+                                  token->getLineNumber()});
+                delete token;
+                continue;
+            }
+        }
+        echo << token->getLexemeString() << " ";
+        return token;
+    }
+}
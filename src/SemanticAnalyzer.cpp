@@ -1,314 +1,508 @@
 #include "SemanticAnalyzer.h"
+#include "Statistics.h"
+#include "StringInterner.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 
-SemanticAnalyzer::SemanticAnalyzer() : currentLine(0) {
-    symbolTable = new SymbolTable();
+SemanticAnalyzer::SemanticAnalyzer(ostream& output) : currentLine(0), out(output) {
+    symbolTable = new SymbolTable(output);
 }
 
 SemanticAnalyzer::~SemanticAnalyzer() {
     delete symbolTable;
 }
 
+// A function's local names are released when its scope closes, and
+// again on the way in in case the last function was abandoned midway
 void SemanticAnalyzer::enterScope() {
+    TINYC_PHASE(Phase::SEMANTIC);
+    if (symbolTable->getCurrentScope() == 0) StringInterner::instance().releaseLocals();
     symbolTable->enterScope();
 }
 
 void SemanticAnalyzer::exitScope() {
+    TINYC_PHASE(Phase::SEMANTIC);
     symbolTable->exitScope();
+    if (symbolTable->getCurrentScope() == 0) StringInterner::instance().releaseLocals();
 }
 
-bool SemanticAnalyzer::declareVariable(const string& name, TokenCodes type, int line) {
+uint32_t SemanticAnalyzer::internName(const string& text) {
+    StringInterner& interner = StringInterner::instance();
+    return symbolTable->getCurrentScope() > 0 ? interner.internLocal(text) : interner.intern(text);
+}
+
+bool SemanticAnalyzer::declareVariable(uint32_t name, TokenCodes type, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     DataType dataType = SymbolTable::tokenToDataType(type);
     
     if (dataType == DataType::UNKNOWN) {
-        addError("Invalid data type for variable '" + name + "'");
+        report(DiagnosticCode::INVALID_VARIABLE_TYPE, name);
         return false;
     }
     
     if (dataType == DataType::VOID) {
-        addError("Variable '" + name + "' cannot be of type void");
+        report(DiagnosticCode::VOID_VARIABLE, name);
         return false;
     }
     
     return symbolTable->insertSymbol(name, dataType, SymbolType::VARIABLE, line);
 }
 
-bool SemanticAnalyzer::declareArray(const string& name, TokenCodes type, int size, int line) {
+bool SemanticAnalyzer::declareArray(uint32_t name, TokenCodes type, const vector<int>& dimensions, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
+    setCurrentLine(line);
+    DataType dataType = SymbolTable::tokenToDataType(type);
+    
+    if (dataType == DataType::UNKNOWN) {
+        report(DiagnosticCode::INVALID_ARRAY_TYPE, name);
+        return false;
+    }
+    
+    if (dataType == DataType::VOID) {
+        report(DiagnosticCode::VOID_ARRAY, name);
+        return false;
+    }
+    
+    if (!checkDimensions(name, dimensions, false)) {
+        return false;
+    }
+    
+    return symbolTable->insertArray(name, dataType, SymbolType::VARIABLE, dimensions, line);
+}
+
+bool SemanticAnalyzer::declareDynamicArray(uint32_t name, TokenCodes type, const vector<int>& dimensions,
+                                           uint32_t length, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     DataType dataType = SymbolTable::tokenToDataType(type);
     
     if (dataType == DataType::UNKNOWN) {
-        addError("Invalid data type for array '" + name + "'");
+        report(DiagnosticCode::INVALID_ARRAY_TYPE, name);
         return false;
     }
     
     if (dataType == DataType::VOID) {
-        addError("Array '" + name + "' cannot be of type void");
+        report(DiagnosticCode::VOID_ARRAY, name);
         return false;
     }
     
-    if (size <= 0) {
-        addError("Array '" + name + "' must have positive size");
+    // Static data is laid out at compile time
+    if (symbolTable->getCurrentScope() == 0) {
+        report(DiagnosticCode::GLOBAL_ARRAY_LENGTH, name);
         return false;
     }
     
-    return symbolTable->insertArray(name, dataType, size, line);
+    if (length != StringInterner::EMPTY) {
+        if (checkVariableUsage(length, line) == DataType::UNKNOWN) {
+            return false;
+        }
+        SymbolInfo* symbol = symbolTable->lookupSymbol(length);
+        if (!symbol || symbol->isArray || symbol->dataType != DataType::INT) {
+            report(DiagnosticCode::ARRAY_LENGTH_TYPE, name);
+            return false;
+        }
+    }
+    
+    if (!checkDimensions(name, dimensions, true)) {
+        return false;
+    }
+    
+    return symbolTable->insertArray(name, dataType, SymbolType::VARIABLE, dimensions, line);
 }
 
-bool SemanticAnalyzer::declareFunction(const string& name, TokenCodes returnType, const vector<TokenCodes>& paramTypes, int line) {
+bool SemanticAnalyzer::declareFunction(uint32_t name, TokenCodes returnType,
+                                       const vector<ParameterDeclaration>& parameters, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     DataType returnDataType = SymbolTable::tokenToDataType(returnType);
     
     if (returnDataType == DataType::UNKNOWN) {
-        addError("Invalid return type for function '" + name + "'");
+        report(DiagnosticCode::INVALID_RETURN_TYPE, name);
         return false;
     }
     
-    vector<DataType> paramDataTypes;
-    for (TokenCodes paramType : paramTypes) {
-        DataType paramDataType = SymbolTable::tokenToDataType(paramType);
+    vector<ParameterType> paramDataTypes;
+    for (const ParameterDeclaration& parameter : parameters) {
+        DataType paramDataType = SymbolTable::tokenToDataType(parameter.type);
         if (paramDataType == DataType::UNKNOWN) {
-            addError("Invalid parameter type in function '" + name + "'");
+            report(DiagnosticCode::INVALID_SIGNATURE_PARAMETER_TYPE, name);
             return false;
         }
         if (paramDataType == DataType::VOID) {
-            addError("Parameter cannot be of type void in function '" + name + "'");
+            report(DiagnosticCode::VOID_SIGNATURE_PARAMETER, name);
             return false;
         }
-        paramDataTypes.push_back(paramDataType);
+        paramDataTypes.push_back({paramDataType, parameter.dimensions});
     }
     
     return symbolTable->insertFunction(name, returnDataType, paramDataTypes, line);
 }
 
-bool SemanticAnalyzer::declareParameter(const string& name, TokenCodes type, int line) {
+bool SemanticAnalyzer::declareParameter(uint32_t name, TokenCodes type, const vector<int>& dimensions, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     DataType dataType = SymbolTable::tokenToDataType(type);
     
     if (dataType == DataType::UNKNOWN) {
-        addError("Invalid data type for parameter '" + name + "'");
+        report(DiagnosticCode::INVALID_PARAMETER_TYPE, name);
         return false;
     }
     
     if (dataType == DataType::VOID) {
-        addError("Parameter '" + name + "' cannot be of type void");
+        report(DiagnosticCode::VOID_PARAMETER, name);
         return false;
     }
     
-    return symbolTable->insertSymbol(name, dataType, SymbolType::PARAMETER, line);
+    if (dimensions.empty()) {
+        return symbolTable->insertSymbol(name, dataType, SymbolType::PARAMETER, line);
+    }
+    if (!checkDimensions(name, dimensions, true)) {
+        return false;
+    }
+    return symbolTable->insertArray(name, dataType, SymbolType::PARAMETER, dimensions, line);
+}
+
+bool SemanticAnalyzer::defineGlobal(uint32_t name, const vector<InitialValue>& values, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
+    setCurrentLine(line);
+    SymbolInfo* symbol = symbolTable->lookupInCurrentScope(name);
+    if (!symbol) {
+        report(DiagnosticCode::SYMBOL_NOT_FOUND, name);
+        return false;
+    }
+
+    int elements = symbol->isArray ? symbol->arraySize : 1;
+    if ((int)values.size() > elements) {
+        report(DiagnosticCode::TOO_MANY_INITIALIZERS, name, DataType::UNKNOWN, DataType::UNKNOWN, elements,
+               values.size());
+        return false;
+    }
+
+    // Each value is converted as an assignment would convert it
+    vector<double> converted;
+    for (const InitialValue& initial : values) {
+        if (!checkAssignment(name, initial.type, line)) return false;
+        double value = initial.value;
+        if (symbol->dataType == DataType::INT) {
+            value = value < INT32_MIN ? INT32_MIN : value > INT32_MAX ? INT32_MAX : trunc(value);
+        } else if (symbol->dataType == DataType::BOOL) {
+            value = value != 0;
+        }
+        converted.push_back(value);
+    }
+    symbol->isInitialized = !values.empty();
+    dataLayout.place(name, symbol->dataType, symbol->dimensions, converted, line);
+    return true;
 }
 
-bool SemanticAnalyzer::checkVariableUsage(const string& name, int line) {
+DataType SemanticAnalyzer::checkVariableUsage(uint32_t name, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     
     if (!symbolTable->isDeclared(name)) {
-        addError("Undeclared variable '" + name + "'");
-        return false;
+        report(DiagnosticCode::UNDECLARED_VARIABLE, name);
+        return DataType::UNKNOWN;
     }
     
     SymbolInfo* symbol = symbolTable->lookupSymbol(name);
     if (symbol && symbol->symbolType == SymbolType::FUNCTION) {
-        addError("'" + name + "' is a function, not a variable");
-        return false;
+        report(DiagnosticCode::FUNCTION_AS_VARIABLE, name);
+        return DataType::UNKNOWN;
     }
     
-    return true;
+    return symbol ? symbol->dataType : DataType::UNKNOWN;
 }
 
-bool SemanticAnalyzer::checkArrayAccess(const string& name, int line) {
+bool SemanticAnalyzer::checkArrayAccess(uint32_t name, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     
     if (!symbolTable->isDeclared(name)) {
-        addError("Undeclared array '" + name + "'");
+        report(DiagnosticCode::UNDECLARED_ARRAY, name);
         return false;
     }
     
     SymbolInfo* symbol = symbolTable->lookupSymbol(name);
     if (!symbol) {
-        addError("Symbol '" + name + "' not found");
+        report(DiagnosticCode::SYMBOL_NOT_FOUND, name);
         return false;
     }
     
     if (symbol->symbolType == SymbolType::FUNCTION) {
-        addError("'" + name + "' is a function, not an array");
+        report(DiagnosticCode::FUNCTION_AS_ARRAY, name);
         return false;
     }
     
     if (!symbol->isArray) {
-        addError("'" + name + "' is not an array");
+        report(DiagnosticCode::NOT_AN_ARRAY, name);
         return false;
     }
     
     return true;
 }
 
-bool SemanticAnalyzer::checkFunctionCall(const string& name, int paramCount, int line) {
+DataType SemanticAnalyzer::checkSubscripts(uint32_t name, int subscripts, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
+    setCurrentLine(line);
+
+    // Anything else has been reported by checkArrayAccess()
+    SymbolInfo* symbol = symbolTable->lookupSymbol(name);
+    if (!symbol || !symbol->isArray) return DataType::UNKNOWN;
+
+    if ((int)symbol->dimensions.size() != subscripts) {
+        report(DiagnosticCode::SUBSCRIPT_COUNT, name, DataType::UNKNOWN, DataType::UNKNOWN,
+               symbol->dimensions.size(), subscripts);
+        return DataType::UNKNOWN;
+    }
+    return symbol->dataType;
+}
+
+// The lexer has already decoded the literal; only its range is checked here
+bool SemanticAnalyzer::checkLiteral(const string& text, DataType type, bool outOfRange, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
+    setCurrentLine(line);
+
+    if (outOfRange) {
+        report(type == DataType::FLOAT ? DiagnosticCode::FLOAT_LITERAL_RANGE : DiagnosticCode::INTEGER_LITERAL_RANGE,
+               StringInterner::instance().intern(text), type);
+        return false;
+    }
+
+    return true;
+}
+
+DataType SemanticAnalyzer::checkFunctionCall(uint32_t name, const vector<CallArgument>& arguments, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     
     if (!symbolTable->isDeclared(name)) {
-        addError("Undeclared function '" + name + "'");
-        return false;
+        // By text: inside a function the name may have a local ID
+        if (StringInterner::instance().view(name) == "allocate") {
+            return checkAllocate(name, arguments) ? DataType::VOID : DataType::UNKNOWN;
+        }
+        report(DiagnosticCode::UNDECLARED_FUNCTION, name);
+        return DataType::UNKNOWN;
     }
     
     SymbolInfo* symbol = symbolTable->lookupSymbol(name);
     if (!symbol || symbol->symbolType != SymbolType::FUNCTION) {
-        addError("'" + name + "' is not a function");
-        return false;
-    }
-    
-    if (symbol->parameterCount != paramCount) {
-        addError("Function '" + name + "' expects " + to_string(symbol->parameterCount) + 
-                " parameters, but " + to_string(paramCount) + " provided");
-        return false;
+        report(DiagnosticCode::NOT_A_FUNCTION, name);
+        return DataType::UNKNOWN;
+    }
+    
+    if (symbol->parameterCount != (int)arguments.size()) {
+        report(DiagnosticCode::ARGUMENT_COUNT, name, DataType::UNKNOWN, DataType::UNKNOWN,
+               symbol->parameterCount, arguments.size());
+        return DataType::UNKNOWN;
+    }
+    
+    // An array is passed by reference, so it must be the parameter's
+    // array exactly: same element type and inner extents, and at least
+    // as many rows as a sized parameter asks for
+    bool valid = true;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const ParameterType& parameter = symbol->parameterTypes[i];
+        SymbolInfo* argument = nullptr;
+        if (arguments[i].name != StringInterner::EMPTY) {
+            argument = symbolTable->lookupSymbol(arguments[i].name);
+            if (argument && !argument->isArray) argument = nullptr;
+        }
+        
+        if (parameter.dimensions.empty()) {
+            if (argument) {
+                report(DiagnosticCode::SCALAR_ARGUMENT, name, DataType::UNKNOWN, DataType::UNKNOWN, i + 1);
+                valid = false;
+            }
+            continue;
+        }
+        if (!argument) {
+            report(DiagnosticCode::ARRAY_ARGUMENT, name, DataType::UNKNOWN, DataType::UNKNOWN, i + 1);
+            valid = false;
+            continue;
+        }
+        if (argument->dataType != parameter.type) {
+            report(DiagnosticCode::ARRAY_ARGUMENT_TYPE, name, parameter.type, argument->dataType, i + 1);
+            valid = false;
+            continue;
+        }
+        
+        const vector<int>& expected = parameter.dimensions;
+        const vector<int>& actual = argument->dimensions;
+        bool matches = expected.size() == actual.size() &&
+                       equal(expected.begin() + 1, expected.end(), actual.begin() + 1);
+        // The length of an array parameter passed on, or of a dynamic
+        // array, is not known here
+        if (matches && actual[0] != 0 && actual[0] < expected[0]) matches = false;
+        if (!matches) {
+            report(DiagnosticCode::ARRAY_ARGUMENT_SHAPE, name, DataType::UNKNOWN, DataType::UNKNOWN, i + 1);
+            valid = false;
+        }
     }
-    
-    return true;
+    return valid ? symbol->dataType : DataType::UNKNOWN;
 }
 
-bool SemanticAnalyzer::checkAssignment(const string& varName, DataType expressionType, int line) {
+bool SemanticAnalyzer::checkAssignment(uint32_t varName, DataType expressionType, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     
-    if (!checkVariableUsage(varName, line)) {
+    if (checkVariableUsage(varName, line) == DataType::UNKNOWN) {
         return false;
     }
     
     DataType varType = getVariableType(varName);
     if (!isCompatibleTypes(varType, expressionType)) {
-        addError("Type mismatch in assignment to '" + varName + "': cannot assign " + 
-                SymbolTable::dataTypeToString(expressionType) + " to " + 
-                SymbolTable::dataTypeToString(varType));
+        report(DiagnosticCode::ASSIGNMENT_TYPE_MISMATCH, varName, expressionType, varType);
         return false;
     }
     
     if (varType != expressionType) {
-        addWarning("Implicit type conversion in assignment to '" + varName + "' from " + 
-                  SymbolTable::dataTypeToString(expressionType) + " to " + 
-                  SymbolTable::dataTypeToString(varType));
+        report(DiagnosticCode::ASSIGNMENT_CONVERSION, varName, expressionType, varType);
     }
     
     return true;
 }
 
 bool SemanticAnalyzer::checkReturnType(DataType returnType, DataType expectedType, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     
     if (!isCompatibleTypes(expectedType, returnType)) {
-        addError("Return type mismatch: expected " + SymbolTable::dataTypeToString(expectedType) + 
-                ", but got " + SymbolTable::dataTypeToString(returnType));
+        report(DiagnosticCode::RETURN_TYPE_MISMATCH, StringInterner::EMPTY, expectedType, returnType);
         return false;
     }
     
     if (expectedType != returnType) {
-        addWarning("Implicit type conversion in return statement from " + 
-                  SymbolTable::dataTypeToString(returnType) + " to " + 
-                  SymbolTable::dataTypeToString(expectedType));
+        report(DiagnosticCode::RETURN_CONVERSION, StringInterner::EMPTY, returnType, expectedType);
     }
     
     return true;
 }
 
-DataType SemanticAnalyzer::getVariableType(const string& name) {
+DataType SemanticAnalyzer::getVariableType(uint32_t name) {
+    TINYC_PHASE(Phase::SEMANTIC);
     return symbolTable->getSymbolType(name);
 }
 
 DataType SemanticAnalyzer::checkBinaryOperation(DataType left, DataType right, TokenCodes op, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
     setCurrentLine(line);
     
+    DataType result = operationType(left, right, op);
+    if (result != DataType::UNKNOWN) return result;
+    
+    if (op == PLUS || op == MINUS || op == TIMES || op == SLASH || op == MOD) {
+        report(DiagnosticCode::ARITHMETIC_OPERANDS);
+    } else if (op == LSS || op == LEQ || op == GTR || op == GEQ) {
+        report(DiagnosticCode::COMPARISON_OPERANDS);
+    } else if (op == EQL || op == NEQ) {
+        report(DiagnosticCode::EQUALITY_OPERANDS);
+    } else if (op == AND || op == OR) {
+        report(DiagnosticCode::LOGICAL_OPERANDS);
+    }
+    return DataType::UNKNOWN;
+}
+
+DataType SemanticAnalyzer::checkUnaryOperation(DataType operand, TokenCodes op, int line) {
+    TINYC_PHASE(Phase::SEMANTIC);
+    setCurrentLine(line);
+    
+    DataType result = operationType(operand, op);
+    if (result != DataType::UNKNOWN) return result;
+    
+    if (op == NOT) {
+        report(DiagnosticCode::NOT_OPERAND);
+    } else if (op == MINUS) {
+        report(DiagnosticCode::NEGATION_OPERAND);
+    }
+    return DataType::UNKNOWN;
+}
+
+DataType SemanticAnalyzer::operationType(DataType left, DataType right, TokenCodes op) {
     // Arithmetic operations
     if (op == PLUS || op == MINUS || op == TIMES || op == SLASH || op == MOD) {
-        if (!isNumericType(left) || !isNumericType(right)) {
-            addError("Arithmetic operation requires numeric operands");
-            return DataType::UNKNOWN;
-        }
+        if (!isNumericType(left) || !isNumericType(right)) return DataType::UNKNOWN;
         return getPromotedType(left, right);
     }
     
     // Comparison operations
     if (op == LSS || op == LEQ || op == GTR || op == GEQ) {
-        if (!isNumericType(left) || !isNumericType(right)) {
-            addError("Comparison operation requires numeric operands");
-            return DataType::UNKNOWN;
-        }
+        if (!isNumericType(left) || !isNumericType(right)) return DataType::UNKNOWN;
         return DataType::BOOL;
     }
     
     // Equality operations
     if (op == EQL || op == NEQ) {
-        if (!isCompatibleTypes(left, right)) {
-            addError("Equality operation requires compatible operands");
-            return DataType::UNKNOWN;
-        }
+        if (!isCompatibleTypes(left, right)) return DataType::UNKNOWN;
         return DataType::BOOL;
     }
     
     // Logical operations
     if (op == AND || op == OR) {
-        if (left != DataType::BOOL || right != DataType::BOOL) {
-            addError("Logical operation requires boolean operands");
-            return DataType::UNKNOWN;
-        }
+        if (left != DataType::BOOL || right != DataType::BOOL) return DataType::UNKNOWN;
         return DataType::BOOL;
     }
     
     return DataType::UNKNOWN;
 }
 
-DataType SemanticAnalyzer::checkUnaryOperation(DataType operand, TokenCodes op, int line) {
-    setCurrentLine(line);
-    
+DataType SemanticAnalyzer::operationType(DataType operand, TokenCodes op) {
     if (op == NOT) {
-        if (operand != DataType::BOOL) {
-            addError("Logical NOT operation requires boolean operand");
-            return DataType::UNKNOWN;
-        }
-        return DataType::BOOL;
+        return operand == DataType::BOOL ? DataType::BOOL : DataType::UNKNOWN;
     }
-    
     if (op == MINUS) {
-        if (!isNumericType(operand)) {
-            addError("Unary minus operation requires numeric operand");
-            return DataType::UNKNOWN;
-        }
-        return operand;
+        return isNumericType(operand) ? operand : DataType::UNKNOWN;
     }
-    
     return DataType::UNKNOWN;
 }
 
-void SemanticAnalyzer::addError(const string& message) {
-    errors.push_back(formatError(message, currentLine));
-}
-
-void SemanticAnalyzer::addWarning(const string& message) {
-    warnings.push_back(formatWarning(message, currentLine));
+// Arguments are kept as values; the message is only built if printed
+void SemanticAnalyzer::report(DiagnosticCode code, uint32_t symbol, DataType first, DataType second,
+                              int firstNumber, int secondNumber) {
+    TINYC_COUNT(Counter::DIAGNOSTICS, 1);
+    diagnostics.report(code, currentLine, symbol, first, second, firstNumber, secondNumber);
 }
 
 bool SemanticAnalyzer::hasErrors() const {
-    return !errors.empty();
+    return diagnostics.getErrorCount() > 0;
 }
 
 bool SemanticAnalyzer::hasWarnings() const {
-    return !warnings.empty();
+    return diagnostics.getWarningCount() > 0;
 }
 
 void SemanticAnalyzer::printErrors() const {
     if (hasErrors()) {
-        cout << "\n=== Semantic Errors ===" << endl;
-        for (const string& error : errors) {
-            cout << error << endl;
+        out << "\n=== Semantic Errors ===" << endl;
+        int limit = DiagnosticEngine::options.maxErrors;
+        int printed = 0;
+        for (size_t i = 0; i < diagnostics.size(); i++) {
+            const Diagnostic& diagnostic = diagnostics.at(i);
+            if (DIAGNOSTIC_INFO[(int)diagnostic.code].severity != Severity::ERROR) continue;
+            if (limit > 0 && printed == limit) {
+                out << "... " << diagnostics.getErrorCount() - limit << " more errors not shown (--max-errors="
+                    << limit << ")" << endl;
+                break;
+            }
+            diagnostics.print(out, diagnostic);
+            printed++;
         }
-        cout << "======================" << endl;
+        out << "======================" << endl;
     }
 }
 
 void SemanticAnalyzer::printWarnings() const {
     if (hasWarnings()) {
-        cout << "\n=== Semantic Warnings ===" << endl;
-        for (const string& warning : warnings) {
-            cout << warning << endl;
+        out << "\n=== Semantic Warnings ===" << endl;
+        for (size_t i = 0; i < diagnostics.size(); i++) {
+            const Diagnostic& diagnostic = diagnostics.at(i);
+            if (DIAGNOSTIC_INFO[(int)diagnostic.code].severity == Severity::WARNING) {
+                diagnostics.print(out, diagnostic);
+            }
         }
-        cout << "=========================" << endl;
+        out << "=========================" << endl;
     }
 }
 
@@ -316,10 +510,18 @@ void SemanticAnalyzer::printSemanticReport() const {
     printErrors();
     printWarnings();
     
-    cout << "\n=== Semantic Analysis Summary ===" << endl;
-    cout << "Errors: " << errors.size() << endl;
-    cout << "Warnings: " << warnings.size() << endl;
-    cout << "=================================" << endl;
+    out << "\n=== Semantic Analysis Summary ===" << endl;
+    out << "Errors: " << diagnostics.getErrorCount() << endl;
+    out << "Warnings: " << diagnostics.getWarningCount() << endl;
+    out << "=================================" << endl;
+}
+
+const DiagnosticEngine& SemanticAnalyzer::getDiagnostics() const {
+    return diagnostics;
+}
+
+void SemanticAnalyzer::restoreDiagnostics(const DiagnosticEngine& previous, int lineDelta) {
+    diagnostics.append(previous, 0, lineDelta);
 }
 
 void SemanticAnalyzer::setCurrentLine(int line) {
@@ -330,6 +532,62 @@ void SemanticAnalyzer::printSymbolTable() const {
     symbolTable->printSymbolTable();
 }
 
+SymbolTable* SemanticAnalyzer::getSymbolTable() const {
+    return symbolTable;
+}
+
+const DataLayout& SemanticAnalyzer::getDataLayout() const {
+    return dataLayout;
+}
+
+// The block is indexed by int, so every element must be reachable
+bool SemanticAnalyzer::checkDimensions(uint32_t name, const vector<int>& dimensions, bool unsizedFirst) {
+    int64_t elements = 1;
+    for (size_t i = 0; i < dimensions.size(); i++) {
+        if (i == 0 && unsizedFirst && dimensions[i] == 0) continue;
+        if (dimensions[i] <= 0) {
+            report(DiagnosticCode::NONPOSITIVE_ARRAY_SIZE, name);
+            return false;
+        }
+        elements *= dimensions[i];
+        if (elements > INT32_MAX) {
+            report(DiagnosticCode::ARRAY_TOO_LARGE, name, DataType::UNKNOWN, DataType::UNKNOWN, INT32_MAX);
+            return false;
+        }
+    }
+    return true;
+}
+
+// allocate(a, n) gives a local array of run-time length n elements from
+// the function's arena, replacing any it had before
+bool SemanticAnalyzer::checkAllocate(uint32_t name, const vector<CallArgument>& arguments) {
+    if (arguments.size() != 2) {
+        report(DiagnosticCode::ARGUMENT_COUNT, name, DataType::UNKNOWN, DataType::UNKNOWN, 2, arguments.size());
+        return false;
+    }
+    
+    SymbolInfo* target = nullptr;
+    if (arguments[0].name != StringInterner::EMPTY) target = symbolTable->lookupSymbol(arguments[0].name);
+    if (!target || !target->isArray || target->arraySize != 0 || target->symbolType != SymbolType::VARIABLE) {
+        report(DiagnosticCode::ALLOCATE_TARGET, name);
+        return false;
+    }
+    
+    SymbolInfo* length = nullptr;
+    if (arguments[1].name != StringInterner::EMPTY) length = symbolTable->lookupSymbol(arguments[1].name);
+    if (length && length->isArray) {
+        report(DiagnosticCode::SCALAR_ARGUMENT, name, DataType::UNKNOWN, DataType::UNKNOWN, 2);
+        return false;
+    }
+    // An unknown type is let through: an undeclared or misused operand
+    // has been reported, and operators are not checked here
+    if (arguments[1].type != DataType::INT && arguments[1].type != DataType::UNKNOWN) {
+        report(DiagnosticCode::ARRAY_LENGTH_TYPE, arguments[0].name);
+        return false;
+    }
+    return true;
+}
+
 bool SemanticAnalyzer::isNumericType(DataType type) {
     return type == DataType::INT || type == DataType::FLOAT;
 }
@@ -351,11 +609,3 @@ DataType SemanticAnalyzer::getPromotedType(DataType type1, DataType type2) {
     
     return DataType::INT;
 }
-
-string SemanticAnalyzer::formatError(const string& message, int line) {
-    return "Error (line " + to_string(line) + "): " + message;
-}
-
-string SemanticAnalyzer::formatWarning(const string& message, int line) {
-    return "Warning (line " + to_string(line) + "): " + message;
-}
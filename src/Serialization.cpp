@@ -0,0 +1,47 @@
+#include "Serialization.h"
+#include <cstdlib>
+
+void putField(string& out, const string& value) {
+    out += to_string(value.size());
+    out += ':';
+    out += value;
+}
+
+void putNumber(string& out, long long value) {
+    putField(out, to_string(value));
+}
+
+void putStrings(string& out, const vector<string>& values) {
+    putNumber(out, values.size());
+    for (const string& value : values) {
+        putField(out, value);
+    }
+}
+
+bool getField(const string& in, size_t& pos, string& value) {
+    size_t colon = in.find(':', pos);
+    if (colon == string::npos || colon == pos) return false;
+    size_t length = strtoull(in.c_str() + pos, nullptr, 10);
+    if (length > in.size() || colon + 1 + length > in.size()) return false;
+    value = in.substr(colon + 1, length);
+    pos = colon + 1 + length;
+    return true;
+}
+
+bool getNumber(const string& in, size_t& pos, long long& value) {
+    string field;
+    if (!getField(in, pos, field)) return false;
+    value = atoll(field.c_str());
+    return true;
+}
+
+bool getStrings(const string& in, size_t& pos, vector<string>& values) {
+    long long count;
+    if (!getNumber(in, pos, count) || count < 0) return false;
+    for (long long i = 0; i < count; i++) {
+        string value;
+        if (!getField(in, pos, value)) return false;
+        values.push_back(value);
+    }
+    return true;
+}
@@ -0,0 +1,243 @@
+#include "Statistics.h"
+#include "Json.h"
+#include "StringInterner.h"
+
+#include <cstdio>
+#include <ctime>
+
+#include <sys/resource.h>
+
+namespace {
+    uint64_t threadCpuNanos() {
+        timespec now;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+        return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    }
+
+    // Microsecond resolution keeps the JSON readable
+    double milliseconds(uint64_t nanos) {
+        return (double)((nanos + 500) / 1000) / 1000.0;
+    }
+}
+
+bool CompileStatistics::enabled = false;
+
+CompileStatistics::CompileStatistics() {
+    reset();
+}
+
+CompileStatistics& CompileStatistics::current() {
+    static thread_local CompileStatistics statistics;
+    return statistics;
+}
+
+void CompileStatistics::reset() {
+    depth = 0;
+    cpuStartNanos = 0;
+    maxLookupDepth = 0;
+    totalNanos = 0;
+    cpuNanos = 0;
+    for (int i = 0; i < (int)Phase::COUNT; i++) {
+        phaseNanos[i] = 0;
+        phaseEntries[i] = 0;
+    }
+    for (int i = 0; i < (int)Counter::COUNT; i++) {
+        counters[i] = 0;
+    }
+}
+
+void CompileStatistics::beginCompile() {
+    reset();
+    compileStart = mark = Clock::now();
+    cpuStartNanos = threadCpuNanos();
+}
+
+void CompileStatistics::endCompile() {
+    Clock::time_point now = Clock::now();
+    // Close phases left open by an exception unwinding past their scopes
+    while (depth > 0) {
+        phaseNanos[(int)stack[--depth]] += chrono::duration_cast<chrono::nanoseconds>(now - mark).count();
+        mark = now;
+    }
+    totalNanos += chrono::duration_cast<chrono::nanoseconds>(now - compileStart).count();
+    cpuNanos += threadCpuNanos() - cpuStartNanos;
+}
+
+void CompileStatistics::enter(Phase phase) {
+    Clock::time_point now = Clock::now();
+    if (depth > 0) {
+        phaseNanos[(int)stack[depth - 1]] += chrono::duration_cast<chrono::nanoseconds>(now - mark).count();
+    }
+    if (depth < MAX_NESTING) {
+        stack[depth] = phase;
+    }
+    depth++;
+    phaseEntries[(int)phase]++;
+    mark = now;
+}
+
+void CompileStatistics::leave() {
+    if (depth == 0) return;
+    Clock::time_point now = Clock::now();
+    depth--;
+    Phase phase = stack[depth < MAX_NESTING ? depth : MAX_NESTING - 1];
+    phaseNanos[(int)phase] += chrono::duration_cast<chrono::nanoseconds>(now - mark).count();
+    mark = now;
+}
+
+void CompileStatistics::recordLookup(int scopesSearched) {
+    counters[(int)Counter::SYMBOL_LOOKUPS]++;
+    counters[(int)Counter::LOOKUP_SCOPES_SEARCHED] += scopesSearched;
+    if ((uint64_t)scopesSearched > maxLookupDepth) maxLookupDepth = scopesSearched;
+}
+
+void CompileStatistics::merge(const CompileStatistics& other) {
+    for (int i = 0; i < (int)Phase::COUNT; i++) {
+        phaseNanos[i] += other.phaseNanos[i];
+        phaseEntries[i] += other.phaseEntries[i];
+    }
+    for (int i = 0; i < (int)Counter::COUNT; i++) {
+        counters[i] += other.counters[i];
+    }
+    if (other.maxLookupDepth > maxLookupDepth) maxLookupDepth = other.maxLookupDepth;
+    cpuNanos += other.cpuNanos;
+}
+
+long CompileStatistics::peakResidentKilobytes() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+const char* CompileStatistics::phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::LEXER: return "lexer";
+        case Phase::PARSER: return "parser";
+        case Phase::SEMANTIC: return "semantic";
+        case Phase::SYMBOL_TABLE: return "symbol_table";
+        default: return "unknown";
+    }
+}
+
+const char* CompileStatistics::counterName(Counter counter) {
+    switch (counter) {
+        case Counter::TOKENS_LEXED: return "tokens_lexed";
+        case Counter::SCOPES_ENTERED: return "scopes_entered";
+        case Counter::SYMBOLS_DECLARED: return "symbols_declared";
+        case Counter::SYMBOL_LOOKUPS: return "symbol_lookups";
+        case Counter::LOOKUP_SCOPES_SEARCHED: return "lookup_scopes_searched";
+        case Counter::DIAGNOSTICS: return "diagnostics";
+        case Counter::IDENTIFIER_HASHES: return "identifier_hashes";
+        case Counter::IMPORTED_SYMBOLS: return "imported_symbols";
+        case Counter::HEADERS_LEXED: return "headers_lexed";
+        case Counter::HEADERS_REUSED: return "headers_reused";
+        case Counter::MACRO_EXPANSIONS: return "macro_expansions";
+        case Counter::FUNCTIONS_ANALYZED: return "functions_analyzed";
+        case Counter::FUNCTIONS_REPLAYED: return "functions_replayed";
+        case Counter::QUEUE_BATCHES: return "queue_batches";
+        case Counter::QUEUE_PRODUCER_WAITS: return "queue_producer_waits";
+        case Counter::QUEUE_CONSUMER_WAITS: return "queue_consumer_waits";
+        default: return "unknown";
+    }
+}
+
+void CompileStatistics::printTimeReport(ostream& os, bool json) const {
+    uint64_t phasesTotal = 0;
+    for (int i = 0; i < (int)Phase::COUNT; i++) {
+        phasesTotal += phaseNanos[i];
+    }
+    // Reading the source and printing the reports happen outside any phase
+    uint64_t other = totalNanos > phasesTotal ? totalNanos - phasesTotal : 0;
+
+    if (json) {
+        JsonValue report = JsonValue::object();
+        JsonValue phases = JsonValue::object();
+        for (int i = 0; i < (int)Phase::COUNT; i++) {
+            JsonValue phase = JsonValue::object();
+            phase["wall_ms"] = milliseconds(phaseNanos[i]);
+            phase["entries"] = (long long)phaseEntries[i];
+            phases[phaseName((Phase)i)] = phase;
+        }
+        JsonValue driver = JsonValue::object();
+        driver["wall_ms"] = milliseconds(other);
+        phases["other"] = driver;
+        report["phases"] = phases;
+        report["wall_ms"] = milliseconds(totalNanos);
+        report["cpu_ms"] = milliseconds(cpuNanos);
+        os << report.serialize() << endl;
+        return;
+    }
+
+    char line[128];
+    os << "\n=== Time Report ===" << endl;
+    snprintf(line, sizeof(line), "%-14s %12s %8s %12s", "Phase", "Wall (ms)", "Share", "Entries");
+    os << line << endl;
+    for (int i = 0; i <= (int)Phase::COUNT; i++) {
+        bool isOther = i == (int)Phase::COUNT;
+        uint64_t nanos = isOther ? other : phaseNanos[i];
+        double share = totalNanos ? 100.0 * nanos / totalNanos : 0.0;
+        if (isOther) {
+            snprintf(line, sizeof(line), "%-14s %12.3f %7.1f%% %12s", "other", milliseconds(nanos), share, "-");
+        } else {
+            snprintf(line, sizeof(line), "%-14s %12.3f %7.1f%% %12llu", phaseName((Phase)i),
+                     milliseconds(nanos), share, (unsigned long long)phaseEntries[i]);
+        }
+        os << line << endl;
+    }
+    snprintf(line, sizeof(line), "%-14s %12.3f   (CPU %.3f ms)", "total",
+             milliseconds(totalNanos), milliseconds(cpuNanos));
+    os << line << endl;
+    os << "===================" << endl;
+}
+
+void CompileStatistics::printCounters(ostream& os, bool json) const {
+    uint64_t lookups = counters[(int)Counter::SYMBOL_LOOKUPS];
+    double averageDepth = lookups ? (double)counters[(int)Counter::LOOKUP_SCOPES_SEARCHED] / lookups : 0.0;
+
+    if (json) {
+        JsonValue report = JsonValue::object();
+        for (int i = 0; i < (int)Counter::COUNT; i++) {
+            report[counterName((Counter)i)] = (long long)counters[i];
+        }
+        report["max_lookup_depth"] = (long long)maxLookupDepth;
+        report["average_lookup_depth"] = averageDepth;
+        report["interned_strings"] = (long long)StringInterner::instance().size();
+        report["interner_bytes"] = (long long)StringInterner::instance().memoryBytes();
+        report["peak_rss_kb"] = (long long)peakResidentKilobytes();
+        os << report.serialize() << endl;
+        return;
+    }
+
+    os << "\n=== Compile Statistics ===" << endl;
+    os << "Tokens lexed: " << counters[(int)Counter::TOKENS_LEXED] << endl;
+    os << "Scopes entered: " << counters[(int)Counter::SCOPES_ENTERED] << endl;
+    os << "Symbols declared: " << counters[(int)Counter::SYMBOLS_DECLARED] << endl;
+    os << "Symbol lookups: " << lookups << endl;
+    os << "Average lookup depth: " << averageDepth << endl;
+    os << "Max lookup depth: " << maxLookupDepth << endl;
+    os << "Diagnostics: " << counters[(int)Counter::DIAGNOSTICS] << endl;
+    os << "Identifier hashes: " << counters[(int)Counter::IDENTIFIER_HASHES] << endl;
+    os << "Interned strings: " << StringInterner::instance().size() << " ("
+       << StringInterner::instance().memoryBytes() << " bytes)" << endl;
+    if (counters[(int)Counter::IMPORTED_SYMBOLS] > 0) {
+        os << "Imported symbols used: " << counters[(int)Counter::IMPORTED_SYMBOLS] << endl;
+    }
+    if (counters[(int)Counter::HEADERS_LEXED] + counters[(int)Counter::HEADERS_REUSED] > 0) {
+        os << "Headers: " << counters[(int)Counter::HEADERS_LEXED] << " lexed, "
+           << counters[(int)Counter::HEADERS_REUSED] << " reused" << endl;
+    }
+    if (counters[(int)Counter::MACRO_EXPANSIONS] > 0) {
+        os << "Macro expansions: " << counters[(int)Counter::MACRO_EXPANSIONS] << endl;
+    }
+    if (counters[(int)Counter::FUNCTIONS_ANALYZED] + counters[(int)Counter::FUNCTIONS_REPLAYED] > 0) {
+        os << "Functions: " << counters[(int)Counter::FUNCTIONS_ANALYZED] << " analyzed, "
+           << counters[(int)Counter::FUNCTIONS_REPLAYED] << " replayed" << endl;
+    }
+    if (counters[(int)Counter::QUEUE_BATCHES] > 0) {
+        os << "Token batches queued: " << counters[(int)Counter::QUEUE_BATCHES] << " (lexer waited "
+           << counters[(int)Counter::QUEUE_PRODUCER_WAITS] << " times, parser "
+           << counters[(int)Counter::QUEUE_CONSUMER_WAITS] << ")" << endl;
+    }
+    os << "Peak RSS: " << peakResidentKilobytes() << " KB" << endl;
+    os << "==========================" << endl;
+}
@@ -0,0 +1,237 @@
+#include "StringInterner.h"
+#include "Hash.h"
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // Direct-mapped cache of recent IDs, indexed by the low bits of the
+    // hash; a stale or colliding slot just falls through to the shard
+    const int CACHE_SLOTS = 1024;
+    thread_local uint32_t recentIds[CACHE_SLOTS];
+
+    // Names local to the function this thread is analysing: entries
+    // indexed by local ID, an open-addressed set of index + 1, and the
+    // text in chunks that stay put until the table is released
+    struct LocalEntry {
+        const char* text;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    struct LocalNames {
+        vector<LocalEntry> entries;
+        vector<uint32_t> slots;
+        vector<unique_ptr<char[]>> chunks;
+        char* cursor = nullptr;
+        size_t remaining = 0;
+    };
+
+    const size_t LOCAL_CHUNK = 4 * 1024;
+    thread_local LocalNames locals;
+}
+
+StringInterner& StringInterner::instance() {
+    // Never destroyed: other threads' static destructors may still look
+    // names up during exit
+    static StringInterner* interner = new StringInterner();
+    return *interner;
+}
+
+StringInterner::StringInterner() : blocks(new atomic<Entry*>[MAX_BLOCKS]), nextId(1) {
+    for (uint32_t i = 0; i < MAX_BLOCKS; i++) blocks[i].store(nullptr, memory_order_relaxed);
+    Entry* first = new Entry[BLOCK_SIZE];
+    first[EMPTY] = {"", 0, hashOf("")};
+    blocks[0].store(first, memory_order_release);
+}
+
+StringInterner::~StringInterner() {
+    for (uint32_t i = 0; i < MAX_BLOCKS; i++) delete[] blocks[i].load(memory_order_relaxed);
+}
+
+uint32_t StringInterner::hashOf(string_view text) {
+    uint64_t hash = Hash64::hash(text.data(), text.size());
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+const StringInterner::Entry& StringInterner::entry(uint32_t id) const {
+    return blocks[id >> BLOCK_BITS].load(memory_order_acquire)[id & (BLOCK_SIZE - 1)];
+}
+
+bool StringInterner::matches(uint32_t id, string_view text, uint32_t hash) const {
+    const Entry& candidate = entry(id);
+    return candidate.hash == hash && candidate.length == text.size() &&
+           memcmp(candidate.text, text.data(), text.size()) == 0;
+}
+
+uint32_t StringInterner::intern(string_view text) {
+    if (text.empty()) return EMPTY;
+    TINYC_COUNT(Counter::IDENTIFIER_HASHES, 1);
+    return search(text, hashOf(text), true);
+}
+
+uint32_t StringInterner::find(string_view text) {
+    if (text.empty()) return EMPTY;
+    TINYC_COUNT(Counter::IDENTIFIER_HASHES, 1);
+    return search(text, hashOf(text), false);
+}
+
+// The local table is searched first, so a name keeps its local ID for
+// the rest of the function even if something globalizes it meanwhile
+uint32_t StringInterner::internLocal(string_view text) {
+    if (text.empty()) return EMPTY;
+    TINYC_COUNT(Counter::IDENTIFIER_HASHES, 1);
+    uint32_t hash = hashOf(text);
+
+    size_t mask = locals.slots.size() - 1;
+    for (size_t i = hash & mask; !locals.slots.empty(); i = (i + 1) & mask) {
+        uint32_t slot = locals.slots[i];
+        if (slot == 0) break;
+        const LocalEntry& candidate = locals.entries[slot - 1];
+        if (candidate.hash == hash && candidate.length == text.size() &&
+            memcmp(candidate.text, text.data(), text.size()) == 0) {
+            return LOCAL_BIT | (slot - 1);
+        }
+    }
+    uint32_t global = search(text, hash, false);
+    if (global != EMPTY) return global;
+
+    if ((locals.entries.size() + 1) * 2 > locals.slots.size()) {
+        vector<uint32_t> slots(locals.slots.empty() ? 64 : locals.slots.size() * 2);
+        mask = slots.size() - 1;
+        for (uint32_t slot : locals.slots) {
+            if (slot == 0) continue;
+            size_t i = locals.entries[slot - 1].hash & mask;
+            while (slots[i] != 0) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+        locals.slots.swap(slots);
+    }
+    if (text.size() > locals.remaining) {
+        size_t size = text.size() > LOCAL_CHUNK ? text.size() : LOCAL_CHUNK;
+        locals.chunks.emplace_back(new char[size]);
+        locals.cursor = locals.chunks.back().get();
+        locals.remaining = size;
+    }
+    memcpy(locals.cursor, text.data(), text.size());
+    locals.entries.push_back({locals.cursor, (uint32_t)text.size(), hash});
+    locals.cursor += text.size();
+    locals.remaining -= text.size();
+
+    size_t i = hash & mask;
+    while (locals.slots[i] != 0) i = (i + 1) & mask;
+    locals.slots[i] = (uint32_t)locals.entries.size();
+    return LOCAL_BIT | (uint32_t)(locals.entries.size() - 1);
+}
+
+// Keeps the first chunk and the tables' capacity for the next function
+void StringInterner::releaseLocals() {
+    if (locals.entries.empty()) return;
+    locals.entries.clear();
+    fill(locals.slots.begin(), locals.slots.end(), 0);
+    locals.chunks.resize(1);
+    locals.cursor = locals.chunks[0].get();
+    locals.remaining = LOCAL_CHUNK;
+}
+
+uint32_t StringInterner::globalize(uint32_t id) {
+    return isLocal(id) ? intern(view(id)) : id;
+}
+
+// With add false, only looks the text up
+uint32_t StringInterner::search(string_view text, uint32_t hash, bool add) {
+    uint32_t& recent = recentIds[hash & (CACHE_SLOTS - 1)];
+    if (recent != EMPTY && matches(recent, text, hash)) return recent;
+
+    Shard& shard = shards[hash >> (32 - SHARD_BITS)];
+    lock_guard<mutex> guard(shard.lock);
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = hash & mask; !shard.slots.empty(); i = (i + 1) & mask) {
+        uint32_t id = shard.slots[i];
+        if (id == EMPTY) break;
+        if (matches(id, text, hash)) return recent = id;
+    }
+    return add ? recent = insert(shard, text, hash) : EMPTY;
+}
+
+string_view StringInterner::view(uint32_t id) const {
+    if (isLocal(id)) {
+        const LocalEntry& local = locals.entries[id & ~LOCAL_BIT];
+        return string_view(local.text, local.length);
+    }
+    const Entry& found = entry(id);
+    return string_view(found.text, found.length);
+}
+
+size_t StringInterner::size() const {
+    return nextId.load(memory_order_relaxed);
+}
+
+uint64_t StringInterner::memoryBytes() const {
+    uint32_t ids = nextId.load(memory_order_relaxed);
+    uint64_t bytes = (uint64_t)((ids + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE * sizeof(Entry);
+    for (const Shard& shard : shards) {
+        lock_guard<mutex> guard(const_cast<Shard&>(shard).lock);
+        bytes += shard.arenaBytes + shard.slots.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+// Called with the shard locked
+uint32_t StringInterner::insert(Shard& shard, string_view text, uint32_t hash) {
+    if ((shard.count + 1) * 2 > shard.slots.size()) grow(shard);
+
+    uint32_t id = nextId.fetch_add(1, memory_order_relaxed);
+    uint32_t block = id >> BLOCK_BITS;
+    if (block >= MAX_BLOCKS) throw length_error("too many distinct identifiers");
+    Entry* entries = blocks[block].load(memory_order_acquire);
+    if (!entries) {
+        lock_guard<mutex> guard(blockLock);
+        entries = blocks[block].load(memory_order_acquire);
+        if (!entries) {
+            entries = new Entry[BLOCK_SIZE];
+            blocks[block].store(entries, memory_order_release);
+        }
+    }
+    entries[id & (BLOCK_SIZE - 1)] = {store(shard, text), (uint32_t)text.size(), hash};
+
+    size_t mask = shard.slots.size() - 1;
+    size_t i = hash & mask;
+    while (shard.slots[i] != EMPTY) i = (i + 1) & mask;
+    shard.slots[i] = id;
+    shard.count++;
+    return id;
+}
+
+// Copies text into the shard's arena; chunks are never freed or moved,
+// so every view handed out stays valid
+const char* StringInterner::store(Shard& shard, string_view text) {
+    if (text.size() > shard.remaining) {
+        size_t size = shard.arenaBytes < FIRST_CHUNK ? FIRST_CHUNK : shard.arenaBytes;
+        if (size > ARENA_CHUNK) size = ARENA_CHUNK;
+        if (text.size() > size) size = text.size();
+        shard.chunks.emplace_back(new char[size]);
+        shard.cursor = shard.chunks.back().get();
+        shard.remaining = size;
+        shard.arenaBytes += size;
+    }
+    char* copy = shard.cursor;
+    memcpy(copy, text.data(), text.size());
+    shard.cursor += text.size();
+    shard.remaining -= text.size();
+    return copy;
+}
+
+void StringInterner::grow(Shard& shard) {
+    vector<uint32_t> slots(shard.slots.empty() ? 64 : shard.slots.size() * 2);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id : shard.slots) {
+        if (id == EMPTY) continue;
+        size_t i = entry(id).hash & mask;
+        while (slots[i] != EMPTY) i = (i + 1) & mask;
+        slots[i] = id;
+    }
+    shard.slots.swap(slots);
+}
@@ -1,23 +1,50 @@
 #include "SymbolTable.h"
+#include "Hash.h"
+#include "ModuleInterface.h"
+#include "Statistics.h"
+#include "StringInterner.h"
 
-SymbolTable::SymbolTable() : currentScope(0) {
+#include <algorithm>
+
+namespace {
+    string_view nameOf(uint32_t name) {
+        return StringInterner::instance().view(name);
+    }
+}
+
+void SymbolInfo::setDimensions(const vector<int>& extents) {
+    isArray = true;
+    dimensions = extents;
+    strides.assign(extents.size(), 1);
+    for (size_t i = extents.size() - 1; i > 0; i--) {
+        strides[i - 1] = strides[i] * extents[i];
+    }
+    arraySize = strides[0] * extents[0];
+}
+
+SymbolTable::SymbolTable(ostream& output) : declarationLog(nullptr), lineMarks(nullptr), currentScope(0), out(output) {
     // Create global scope
-    scopes.push_back(map<string, SymbolInfo>());
+    scopes.push_back(map<uint32_t, SymbolInfo>());
 }
 
+thread_local vector<shared_ptr<const ModuleInterface>> SymbolTable::imports;
+
 SymbolTable::~SymbolTable() {
     scopes.clear();
 }
 
 void SymbolTable::enterScope() {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
+    TINYC_COUNT(Counter::SCOPES_ENTERED, 1);
     currentScope++;
-    scopes.push_back(map<string, SymbolInfo>());
-    cout << "Entered scope level " << currentScope << endl;
+    scopes.push_back(map<uint32_t, SymbolInfo>());
+    out << "Entered scope level " << currentScope << endl;
 }
 
 void SymbolTable::exitScope() {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
     if (currentScope > 0) {
-        cout << "Exiting scope level " << currentScope << endl;
+        out << "Exiting scope level " << currentScope << endl;
         scopes.pop_back();
         currentScope--;
     }
@@ -27,120 +54,219 @@ int SymbolTable::getCurrentScope() const {
     return currentScope;
 }
 
-bool SymbolTable::insertSymbol(const string& name, DataType type, SymbolType symbolType, int lineNumber) {
+bool SymbolTable::insertSymbol(uint32_t name, DataType type, SymbolType symbolType, int lineNumber) {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
     if (isDeclaredInCurrentScope(name)) {
-        cout << "Error: Symbol '" << name << "' already declared in current scope at line " << lineNumber << endl;
+        out << "Error: Symbol '" << nameOf(name) << "' already declared in current scope at line " << markedLine(lineNumber) << endl;
         return false;
     }
     
     SymbolInfo symbol(name, type, symbolType, currentScope, lineNumber);
     scopes[currentScope][name] = symbol;
+    if (currentScope == 0) globalOrder.push_back(name);
+    logDeclaration(symbol);
+    TINYC_COUNT(Counter::SYMBOLS_DECLARED, 1);
     
-    cout << "Inserted " << symbolTypeToString(symbolType) << " '" << name 
-         << "' of type " << dataTypeToString(type) << " at line " << lineNumber << endl;
+    out << "Inserted " << symbolTypeToString(symbolType) << " '" << nameOf(name) 
+         << "' of type " << dataTypeToString(type) << " at line " << markedLine(lineNumber) << endl;
     
     return true;
 }
 
-bool SymbolTable::insertArray(const string& name, DataType type, int size, int lineNumber) {
+bool SymbolTable::insertArray(uint32_t name, DataType type, SymbolType symbolType, const vector<int>& dimensions,
+                              int lineNumber) {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
     if (isDeclaredInCurrentScope(name)) {
-        cout << "Error: Array '" << name << "' already declared in current scope at line " << lineNumber << endl;
+        out << "Error: Array '" << nameOf(name) << "' already declared in current scope at line " << markedLine(lineNumber) << endl;
         return false;
     }
     
-    if (size <= 0) {
-        cout << "Error: Array '" << name << "' must have positive size at line " << lineNumber << endl;
-        return false;
+    // Only a parameter or a local array sized at run time may leave its
+    // first extent out
+    bool unsized = symbolType == SymbolType::PARAMETER || currentScope > 0;
+    for (size_t i = 0; i < dimensions.size(); i++) {
+        if (dimensions[i] < 0 || (dimensions[i] == 0 && (i > 0 || !unsized))) {
+            out << "Error: Array '" << nameOf(name) << "' must have positive size at line " << markedLine(lineNumber) << endl;
+            return false;
+        }
     }
     
-    SymbolInfo symbol(name, type, SymbolType::VARIABLE, currentScope, lineNumber);
-    symbol.isArray = true;
-    symbol.arraySize = size;
+    SymbolInfo symbol(name, type, symbolType, currentScope, lineNumber);
+    symbol.setDimensions(dimensions);
     scopes[currentScope][name] = symbol;
+    if (currentScope == 0) globalOrder.push_back(name);
+    logDeclaration(symbol);
+    TINYC_COUNT(Counter::SYMBOLS_DECLARED, 1);
     
-    cout << "Inserted array '" << name << "' of type " << dataTypeToString(type) 
-         << "[" << size << "] at line " << lineNumber << endl;
+    out << "Inserted array " << (symbolType == SymbolType::PARAMETER ? "parameter " : "") << "'" << nameOf(name)
+         << "' of type " << dataTypeToString(type) << dimensionsToString(dimensions) << " at line " << markedLine(lineNumber) << endl;
     
     return true;
 }
 
-bool SymbolTable::insertFunction(const string& name, DataType returnType, const vector<DataType>& paramTypes, int lineNumber) {
-    if (isDeclaredInCurrentScope(name)) {
-        cout << "Error: Function '" << name << "' already declared in current scope at line " << lineNumber << endl;
+bool SymbolTable::insertFunction(uint32_t name, DataType returnType, const vector<ParameterType>& paramTypes, int lineNumber) {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
+    // Functions always live in the global scope, even though the parser
+    // declares them after entering the function's own scope.
+    if (scopes[0].count(name) || lookupImport(name)) {
+        out << "Error: Function '" << nameOf(name) << "' already declared in global scope at line " << markedLine(lineNumber) << endl;
         return false;
     }
     
-    SymbolInfo symbol(name, returnType, SymbolType::FUNCTION, currentScope, lineNumber);
+    SymbolInfo symbol(name, returnType, SymbolType::FUNCTION, 0, lineNumber);
     symbol.parameterTypes = paramTypes;
     symbol.parameterCount = paramTypes.size();
     
-    scopes[currentScope][name] = symbol;
+    scopes[0][name] = symbol;
+    globalOrder.push_back(name);
+    logDeclaration(symbol);
+    TINYC_COUNT(Counter::SYMBOLS_DECLARED, 1);
     
-    cout << "Inserted function '" << name << "' with return type " << dataTypeToString(returnType) 
-         << " and " << paramTypes.size() << " parameters at line " << lineNumber << endl;
+    out << "Inserted function '" << nameOf(name) << "' with return type " << dataTypeToString(returnType) 
+         << " and " << paramTypes.size() << " parameters at line " << markedLine(lineNumber) << endl;
     
     return true;
 }
 
-SymbolInfo* SymbolTable::lookupSymbol(const string& name) {
+SymbolInfo* SymbolTable::lookupSymbol(uint32_t name) {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
     // Search from current scope back to global scope
     for (int i = currentScope; i >= 0; i--) {
         auto it = scopes[i].find(name);
         if (it != scopes[i].end()) {
+            TINYC_RECORD_LOOKUP(currentScope - i + 1);
             return &(it->second);
         }
     }
-    return nullptr;
+    TINYC_RECORD_LOOKUP(currentScope + 1);
+    return lookupImport(name);
 }
 
-SymbolInfo* SymbolTable::lookupInCurrentScope(const string& name) {
+SymbolInfo* SymbolTable::lookupInCurrentScope(uint32_t name) {
+    TINYC_PHASE(Phase::SYMBOL_TABLE);
+    TINYC_RECORD_LOOKUP(1);
     auto it = scopes[currentScope].find(name);
     if (it != scopes[currentScope].end()) {
         return &(it->second);
     }
+    return currentScope == 0 ? lookupImport(name) : nullptr;
+}
+
+// Decodes an imported symbol on first use; the first import that has
+// the name wins
+SymbolInfo* SymbolTable::lookupImport(uint32_t name) {
+    if (imports.empty()) return nullptr;
+    // Decoded symbols are kept after the function ends
+    name = StringInterner::instance().globalize(name);
+    auto it = imported.find(name);
+    if (it != imported.end()) return &(it->second);
+
+    SymbolInfo symbol;
+    for (const shared_ptr<const ModuleInterface>& module : imports) {
+        if (module->find(nameOf(name), symbol)) {
+            TINYC_COUNT(Counter::IMPORTED_SYMBOLS, 1);
+            return &(imported[name] = symbol);
+        }
+    }
     return nullptr;
 }
 
-bool SymbolTable::isDeclared(const string& name) {
+bool SymbolTable::isDeclared(uint32_t name) {
     return lookupSymbol(name) != nullptr;
 }
 
-bool SymbolTable::isDeclaredInCurrentScope(const string& name) {
+bool SymbolTable::isDeclaredInCurrentScope(uint32_t name) {
     return lookupInCurrentScope(name) != nullptr;
 }
 
-DataType SymbolTable::getSymbolType(const string& name) {
+DataType SymbolTable::getSymbolType(uint32_t name) {
     SymbolInfo* symbol = lookupSymbol(name);
     return symbol ? symbol->dataType : DataType::UNKNOWN;
 }
 
+string SymbolTable::importsKey() {
+    string key;
+    for (const shared_ptr<const ModuleInterface>& module : imports) {
+        key += " import=" + Hash64::toHex(module->getContentHash());
+    }
+    return key;
+}
+
+const map<uint32_t, SymbolInfo>& SymbolTable::getGlobalScope() const {
+    return scopes[0];
+}
+
+void SymbolTable::restoreGlobalSymbol(const SymbolInfo& symbol) {
+    // Silent insert: the trace for this symbol was printed when it was
+    // first analysed and is replayed by the caller.
+    if (!scopes[0].count(symbol.name)) {
+        globalOrder.push_back(symbol.name);
+    }
+    scopes[0][symbol.name] = symbol;
+}
+
+const vector<uint32_t>& SymbolTable::getGlobalInsertionOrder() const {
+    return globalOrder;
+}
+
+void SymbolTable::setDeclarationLog(vector<SymbolInfo>* log) {
+    declarationLog = log;
+}
+
+void SymbolTable::setLineMarks(vector<size_t>* marks) {
+    lineMarks = marks;
+}
+
+SymbolTable::MarkedLine SymbolTable::markedLine(int lineNumber) const {
+    return {lineNumber, lineMarks};
+}
+
+ostream& operator<<(ostream& out, const SymbolTable::MarkedLine& line) {
+    if (line.marks) line.marks->push_back((size_t)out.tellp());
+    return out << line.lineNumber;
+}
+
+// The log outlives the scope, so a local name is made global
+void SymbolTable::logDeclaration(const SymbolInfo& symbol) {
+    if (!declarationLog) return;
+    declarationLog->push_back(symbol);
+    declarationLog->back().name = StringInterner::instance().globalize(symbol.name);
+}
+
+// IDs follow first appearance, so listings sort by the names themselves
+vector<const SymbolInfo*> SymbolTable::sortedByName(const map<uint32_t, SymbolInfo>& scope) {
+    vector<const SymbolInfo*> symbols;
+    for (const auto& pair : scope) symbols.push_back(&pair.second);
+    sort(symbols.begin(), symbols.end(),
+         [](const SymbolInfo* a, const SymbolInfo* b) { return nameOf(a->name) < nameOf(b->name); });
+    return symbols;
+}
+
 void SymbolTable::printSymbolTable() const {
-    cout << "\n=== Symbol Table ===" << endl;
+    out << "\n=== Symbol Table ===" << endl;
     for (int i = 0; i <= currentScope; i++) {
-        cout << "Scope " << i << ":" << endl;
-        for (const auto& pair : scopes[i]) {
-            const SymbolInfo& symbol = pair.second;
-            cout << "  " << symbol.name << " (" << symbolTypeToString(symbol.symbolType) 
+        out << "Scope " << i << ":" << endl;
+        for (const SymbolInfo* entry : sortedByName(scopes[i])) {
+            const SymbolInfo& symbol = *entry;
+            out << "  " << nameOf(symbol.name) << " (" << symbolTypeToString(symbol.symbolType) 
                  << ", " << dataTypeToString(symbol.dataType);
-            if (symbol.isArray) {
-                cout << "[" << symbol.arraySize << "]";
-            }
-            cout << ", line " << symbol.lineNumber << ")";
+            out << dimensionsToString(symbol.dimensions);
+            out << ", line " << symbol.lineNumber << ")";
             if (symbol.symbolType == SymbolType::FUNCTION) {
-                cout << " - " << symbol.parameterCount << " parameters";
+                out << " - " << symbol.parameterCount << " parameters";
             }
-            cout << endl;
+            out << endl;
         }
     }
-    cout << "===================" << endl;
+    out << "===================" << endl;
 }
 
 void SymbolTable::printCurrentScope() const {
-    cout << "Current scope (" << currentScope << "): ";
-    for (const auto& pair : scopes[currentScope]) {
-        cout << pair.first << " ";
+    out << "Current scope (" << currentScope << "): ";
+    for (const SymbolInfo* symbol : sortedByName(scopes[currentScope])) {
+        out << nameOf(symbol->name) << " ";
     }
-    cout << endl;
+    out << endl;
 }
 
 DataType SymbolTable::tokenToDataType(TokenCodes token) {
@@ -164,6 +290,14 @@ string SymbolTable::dataTypeToString(DataType type) {
     }
 }
 
+string SymbolTable::dimensionsToString(const vector<int>& dimensions) {
+    string text;
+    for (int extent : dimensions) {
+        text += extent ? "[" + to_string(extent) + "]" : "[]";
+    }
+    return text;
+}
+
 string SymbolTable::symbolTypeToString(SymbolType type) {
     switch (type) {
         case SymbolType::VARIABLE: return "variable";
@@ -1,53 +1,172 @@
 #include <iostream>
 #include <string>
 #include "LexicalAnalyzer.h"
+#include "Statistics.h"
+#include "StringInterner.h"
 #include "SyntaxAnalyzer.h"
 #include "Token.h"
 #include "TokenCodes.h"
+#include "Trace.h"
 
 using namespace std;
 
+// Expressions are parsed by precedence climbing over the operator table
+// below rather than one grammar rule per level. A chain of operators of
+// the same level is consumed by a loop, and recursion happens only when a
+// tighter operator follows, so the depth of the C++ stack is bounded by
+// the number of levels (plus parenthesis nesting), not by chain length.
+//
+//   level 1  ||
+//   level 2  &&
+//   level 3  ==  !=
+//   level 4  <  <=  >  >=
+//   level 5  +  -
+//   level 6  *  /  %
+//
+// All binary operators are left-associative.
+namespace
+{
+  const int LOWEST_PRECEDENCE = 1;
+
+  struct OperatorPrecedence
+  {
+    TokenCodes token;
+    int precedence;
+  };
+
+  const OperatorPrecedence BINARY_OPERATORS[] = {
+      {OR, 1},
+      {AND, 2},
+      {EQL, 3}, {NEQ, 3},
+      {LSS, 4}, {LEQ, 4}, {GTR, 4}, {GEQ, 4},
+      {PLUS, 5}, {MINUS, 5},
+      {TIMES, 6}, {SLASH, 6}, {MOD, 6},
+  };
+
+  // Indexed by token code; built once from BINARY_OPERATORS
+  struct PrecedenceTable
+  {
+    int precedence[NAL + 1];
+
+    PrecedenceTable() : precedence()
+    {
+      for (const OperatorPrecedence &entry : BINARY_OPERATORS)
+        precedence[entry.token] = entry.precedence;
+    }
+  };
+
+  const PrecedenceTable PRECEDENCE;
+}
+
+thread_local int SyntaxAnalyzer::maxNesting = SyntaxAnalyzer::DEFAULT_MAX_NESTING;
+
+// Measured at about 400 bytes per level of statement nesting in an -O0
+// build (half that optimised); a kilobyte per level leaves headroom
+size_t SyntaxAnalyzer::requiredStackBytes()
+{
+  return ((size_t)8 << 20) + (size_t)maxNesting * 1024;
+}
+
 // Constructor: Initialize the syntax analyzer with a lexical analyzer
-SyntaxAnalyzer::SyntaxAnalyzer(LexicalAnalyzer *l)
+SyntaxAnalyzer::SyntaxAnalyzer(LexicalAnalyzer *l, ostream &output) : nextToken(nullptr), nestingDepth(0), out(output)
 {
   la = l;
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
-  semanticAnalyzer = new SemanticAnalyzer();
-  currentLine = 1;
+  advance();
+  semanticAnalyzer = new SemanticAnalyzer(output);
+  ownsSemanticAnalyzer = true;
+}
+
+// Constructor: Parse into an existing semantic analyzer, so that several
+// pieces of one program can share its symbol table and diagnostics
+SyntaxAnalyzer::SyntaxAnalyzer(LexicalAnalyzer *l, SemanticAnalyzer *sa, ostream &output)
+    : nextToken(nullptr), nestingDepth(0), out(output)
+{
+  la = l;
+  advance();
+  semanticAnalyzer = sa;
+  ownsSemanticAnalyzer = false;
 }
 
-// Destructor: Clean up semantic analyzer
+// Destructor: Clean up the current token and semantic analyzer
 SyntaxAnalyzer::~SyntaxAnalyzer()
 {
-  delete semanticAnalyzer;
+  delete nextToken;
+  if (ownsSemanticAnalyzer)
+  {
+    delete semanticAnalyzer;
+  }
 }
 
-// Error handling: Display user-friendly error message and exit
+// Move to the next token, tracking the line used in diagnostics. Only
+// the current token is kept (anything needed later is copied out of it
+// first), so a parse holds one token whatever the length of the input.
+void SyntaxAnalyzer::advance()
+{
+  delete nextToken;
+  nextToken = la->getNextToken();
+  nextTokenCode = nextToken->getTokenCode();
+  currentLine = nextToken->getLineNumber();
+}
+
+// Error handling: Display user-friendly error message and abort the parse
 void SyntaxAnalyzer::error(TokenCodes expectedToken)
 {
-  cout << endl;
-  cout << "===============================================" << endl;
-  cout << "SYNTAX ERROR" << endl;
-  cout << "===============================================" << endl;
+  reportSyntaxError(out, expectedToken, nextToken, currentLine);
+}
+
+void SyntaxAnalyzer::reportSyntaxError(ostream &out, TokenCodes expectedToken, Token *nextToken, int currentLine)
+{
+  out << endl;
+  out << "===============================================" << endl;
+  out << "SYNTAX ERROR" << endl;
+  out << "===============================================" << endl;
   
   // Create user-friendly error messages
   string expectedDescription = getTokenDescription(expectedToken);
   string currentToken = nextToken ? nextToken->getLexemeString() : "end of file";
   
-  cout << "Expected: " << expectedDescription << endl;
+  out << "Expected: " << expectedDescription << endl;
   
   if (nextToken && !nextToken->getLexemeString().empty()) {
-    cout << "Found:    '" << currentToken << "'" << endl;
+    out << "Found:    '" << currentToken << "'" << endl;
   } else {
-    cout << "Found:    end of file" << endl;
+    out << "Found:    end of file" << endl;
   }
   
-  cout << "Line:     " << currentLine << endl;
-  cout << "===============================================" << endl;
-  cout << "Please check your syntax and try again." << endl;
-  cout << "===============================================" << endl;
-  exit(-1);
+  out << "Line:     " << currentLine << endl;
+  out << "===============================================" << endl;
+  out << "Please check your syntax and try again." << endl;
+  out << "===============================================" << endl;
+  TINYC_COUNT(Counter::DIAGNOSTICS, 1);
+  throw SyntaxError("Expected " + expectedDescription, currentLine);
+}
+
+// Reported instead of overflowing the stack on pathologically deep input
+void SyntaxAnalyzer::nestingError()
+{
+  reportNestingError(out, currentLine);
+}
+
+void SyntaxAnalyzer::reportNestingError(ostream &out, int currentLine)
+{
+  out << endl;
+  out << "===============================================" << endl;
+  out << "SYNTAX ERROR" << endl;
+  out << "===============================================" << endl;
+  out << "Nesting too deep: more than " << maxNesting << " levels of blocks and parentheses" << endl;
+  out << "Line:     " << currentLine << endl;
+  out << "===============================================" << endl;
+  out << "Please simplify the program or raise --max-nesting." << endl;
+  out << "===============================================" << endl;
+  TINYC_COUNT(Counter::DIAGNOSTICS, 1);
+  throw SyntaxError("Nesting deeper than " + to_string(maxNesting) + " levels", currentLine);
+}
+
+void SyntaxAnalyzer::reportInvalidArraySize(ostream &out, const string &sizeStr, int currentLine)
+{
+  out << "Error: Invalid array size '" << sizeStr << "'" << endl;
+  TINYC_COUNT(Counter::DIAGNOSTICS, 1);
+  throw SyntaxError("Invalid array size '" + sizeStr + "'", currentLine);
 }
 
 // Helper function to convert token codes to user-friendly descriptions
@@ -108,21 +227,23 @@ void SyntaxAnalyzer::Program()
   }
   
   // Print semantic analysis results
+  TraceSpan span("Semantic report");
   printSemanticReport();
 }
 
 void SyntaxAnalyzer::Functions()
 {
+  TINYC_PHASE(Phase::PARSER);
+  // Compstmt() has already advanced past each function's closing brace
   while (nextTokenCode != TokenCodes::EOI)
   {
     Function();
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
   }
 }
 
 void SyntaxAnalyzer::Function()
 {
+  TraceSpan span("Function", currentLine);
   TokenCodes returnType = nextTokenCode;
   
   if (nextTokenCode != TokenCodes::BOOLSYM &&
@@ -132,31 +253,36 @@ void SyntaxAnalyzer::Function()
   {
     error(TokenCodes::BOOLSYM);
   }
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
 
-  string functionName = "";
   if (nextTokenCode != TokenCodes::IDENT)
   {
     error(IDENT);
   }
-  functionName = nextToken->getLexemeString();
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  uint32_t functionName = semanticAnalyzer->internName(nextToken->getLexemeString());
+  span.setDetail(nextToken->getLexemeString());
+  advance();
+
+  // A global variable or array rather than a function
+  if (nextTokenCode == TokenCodes::LBRACKET || nextTokenCode == TokenCodes::ASSIGN ||
+      nextTokenCode == TokenCodes::COMMA || nextTokenCode == TokenCodes::SEMICOLON)
+  {
+    GlobalDeclarations(returnType, functionName);
+    return;
+  }
 
   if (nextTokenCode != TokenCodes::LPAREN)
   {
     error(LPAREN);
   }
 
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
 
   // Enter function scope
   semanticAnalyzer->enterScope();
   
   // Parse parameters and collect their types
-  vector<TokenCodes> paramTypes;
+  vector<ParameterDeclaration> paramTypes;
   Paramlist(paramTypes);
 
   if (nextTokenCode != TokenCodes::RPAREN)
@@ -167,8 +293,7 @@ void SyntaxAnalyzer::Function()
   // Declare function in symbol table
   semanticAnalyzer->declareFunction(functionName, returnType, paramTypes, currentLine);
 
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
 
   Compstmt();
   
@@ -176,30 +301,138 @@ void SyntaxAnalyzer::Function()
   semanticAnalyzer->exitScope();
 }
 
-void SyntaxAnalyzer::Paramlist(vector<TokenCodes>& paramTypes)
+//<GLOBALS> → <TYPE> <GLOBAL> { , <GLOBAL> } ;
+// Function() has already read the type and the first name
+void SyntaxAnalyzer::GlobalDeclarations(TokenCodes varType, uint32_t firstName)
+{
+  Global(varType, firstName);
+
+  while (nextTokenCode == TokenCodes::COMMA)
+  {
+    advance();
+    if (nextTokenCode != TokenCodes::IDENT)
+    {
+      error(TokenCodes::IDENT);
+    }
+    uint32_t name = semanticAnalyzer->internName(nextToken->getLexemeString());
+    advance();
+    Global(varType, name);
+  }
+
+  if (nextTokenCode != TokenCodes::SEMICOLON)
+  {
+    error(TokenCodes::COMMA);
+  }
+  advance();
+}
+
+//<GLOBAL> → <IDENT> [ = <CONSTANT> ]
+//<GLOBAL> → <IDENT> [ <NUMLIT> ] { [ <NUMLIT> ] } [ = { <CONSTANT> { , <CONSTANT> } } ]
+// Declared as a local would be, then placed in static data
+void SyntaxAnalyzer::Global(TokenCodes varType, uint32_t name)
+{
+  vector<InitialValue> values;
+  bool declared;
+
+  if (nextTokenCode == TokenCodes::LBRACKET)
+  {
+    declared = ArrayDeclaration(varType, name);
+    if (nextTokenCode == TokenCodes::ASSIGN)
+    {
+      advance();
+      if (nextTokenCode != TokenCodes::LBRACE)
+      {
+        error(TokenCodes::LBRACE);
+      }
+      advance();
+      Constant(values);
+      while (nextTokenCode == TokenCodes::COMMA)
+      {
+        advance();
+        Constant(values);
+      }
+      if (nextTokenCode != TokenCodes::RBRACE)
+      {
+        error(TokenCodes::RBRACE);
+      }
+      advance();
+    }
+  }
+  else
+  {
+    declared = semanticAnalyzer->declareVariable(name, varType, currentLine);
+    if (nextTokenCode == TokenCodes::ASSIGN)
+    {
+      advance();
+      Constant(values);
+    }
+  }
+
+  if (declared)
+  {
+    semanticAnalyzer->defineGlobal(name, values, currentLine);
+  }
+}
+
+//<CONSTANT> → [ - ] <NUMLIT> | true | false
+void SyntaxAnalyzer::Constant(vector<InitialValue>& values)
+{
+  bool negate = false;
+  if (nextTokenCode == TokenCodes::MINUS)
+  {
+    negate = true;
+    advance();
+    if (nextTokenCode != TokenCodes::NUMLIT)
+    {
+      error(TokenCodes::NUMLIT);
+    }
+  }
+
+  if (nextTokenCode == TokenCodes::NUMLIT)
+  {
+    semanticAnalyzer->checkLiteral(nextToken->getLexemeString(), nextToken->getLiteralType(),
+                                   nextToken->isOutOfRange(), currentLine);
+    DataType type = nextToken->getLiteralType();
+    double value = type == DataType::FLOAT ? nextToken->getFloatValue() : nextToken->getIntValue();
+    values.push_back({type, negate ? -value : value});
+  }
+  else if (nextTokenCode == TokenCodes::TRUESYM || nextTokenCode == TokenCodes::FALSESYM)
+  {
+    values.push_back({DataType::BOOL, nextTokenCode == TokenCodes::TRUESYM ? 1.0 : 0.0});
+  }
+  else
+  {
+    error(TokenCodes::NUMLIT);
+  }
+  advance();
+}
+
+void SyntaxAnalyzer::Paramlist(vector<ParameterDeclaration>& paramTypes)
 {
   if (nextTokenCode == TokenCodes::BOOLSYM ||
       nextTokenCode == TokenCodes::FLOATSYM ||
       nextTokenCode == TokenCodes::INTSYM)
   {
-    Parameters();
+    Parameters(paramTypes);
   }
   // If no parameters, just continue (empty parameter list is valid)
 }
 
-void SyntaxAnalyzer::Parameters()
+void SyntaxAnalyzer::Parameters(vector<ParameterDeclaration>& paramTypes)
 {
-  Parameter();
+  Parameter(paramTypes);
 
   while (nextTokenCode == TokenCodes::COMMA)
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Parameter();
+    advance();
+    Parameter(paramTypes);
   }
 }
 
-void SyntaxAnalyzer::Parameter()
+//<PARAMETER> → <TYPE> <IDENT> [ [ [ <NUMLIT> ] ] { [ <NUMLIT> ] } ]
+// An array parameter may leave its first extent out. Declared once its
+// dimensions are known, so it follows the next token.
+void SyntaxAnalyzer::Parameter(vector<ParameterDeclaration>& paramTypes)
 {
   TokenCodes paramType = nextTokenCode;
   
@@ -210,29 +443,48 @@ void SyntaxAnalyzer::Parameter()
     error(TokenCodes::BOOLSYM);
   }
 
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
 
   if (nextTokenCode != TokenCodes::IDENT)
   {
     error(TokenCodes::IDENT);
   }
 
-  string paramName = nextToken->getLexemeString();
-  semanticAnalyzer->declareParameter(paramName, paramType, currentLine);
+  uint32_t paramName = semanticAnalyzer->internName(nextToken->getLexemeString());
+  advance();
 
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  vector<int> dimensions;
+  if (nextTokenCode == TokenCodes::LBRACKET)
+  {
+    advance();
+    
+    int extent = 0;
+    if (nextTokenCode == TokenCodes::NUMLIT)
+    {
+      extent = ArraySize();
+    }
+    
+    if (nextTokenCode != TokenCodes::RBRACKET)
+    {
+      error(TokenCodes::RBRACKET);
+    }
+    advance();
+    dimensions.push_back(extent);
+    Extents(dimensions);
+  }
+
+  semanticAnalyzer->declareParameter(paramName, paramType, dimensions, currentLine);
+  paramTypes.push_back({paramType, dimensions});
 }
 
 void SyntaxAnalyzer::Compstmt()
 {
+  TraceSpan span("Compstmt", currentLine);
   if (nextTokenCode != LBRACE)
   {
     error(LBRACE);
   }
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
 
   Seqofstmt();
 
@@ -240,8 +492,7 @@ void SyntaxAnalyzer::Compstmt()
   {
     error(RBRACE);
   }
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
 }
 
 void SyntaxAnalyzer::Seqofstmt()
@@ -254,6 +505,9 @@ void SyntaxAnalyzer::Seqofstmt()
 
 void SyntaxAnalyzer::Statement()
 {
+  // Every nested block passes through here, braced or not
+  NestingScope nesting(*this);
+
   switch (nextTokenCode)
   {
     //<STATEMENT> → <DECLARATION> ;
@@ -265,207 +519,166 @@ void SyntaxAnalyzer::Statement()
     {
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     break;
 
     //<STATEMENT> → do <BLOCK> while ( <EXPRESSION> ) ;
   case (DOSYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Block();
     if (nextTokenCode != WHILESYM)
     {
       error(WHILESYM);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
 
     if (nextTokenCode != LPAREN)
     {
       error(LPAREN);
     }
+    advance();
     Expression();
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
     if (nextTokenCode != RPAREN)
     {
       error(RPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != SEMICOLON)
     {
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     break;
 
   //<STATEMENT> → <EXPRESSION> ;
 
 //<STATEMENT> → for ( <EXPRESSION> ; <EXPRESSION> ; <EXPRESSION> ) <BLOCK>
   case(FORSYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if(nextTokenCode != LPAREN){
       error(LPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Expression();
     if(nextTokenCode != SEMICOLON){
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Expression();
     if(nextTokenCode != SEMICOLON){
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Expression();
     if(nextTokenCode != RPAREN){
       error(RPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Block();
     break;
 
 //<STATEMENT> → if ( <EXPRESSION> ) <BLOCK> and <STATEMENT> → if ( <EXPRESSION> ) <BLOCK> else <BLOCK> 
 case(IFSYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if(nextTokenCode != LPAREN){
       error(LPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Expression();
     if(nextTokenCode != RPAREN){
       error(RPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Block();
 
     if(nextTokenCode == ELSESYM){
-      nextToken = la->getNextToken();
-      nextTokenCode = nextToken->getTokenCode();
+      advance();
       Block();
     }
     break;
   //<STATEMENT> → printf ( <IDENTLIST> ) ;
   case (PRINTFSYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != LPAREN)
     {
       error(LPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != RPAREN)
     {
       error(RPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != SEMICOLON)
     {
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     break;
 
   //<STATEMENT> → return <EXPRESSION> ;
   case (RETURNSYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Expression();
     if (nextTokenCode != SEMICOLON)
     {
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     break;
 
     //<STATEMENT> → scanf ( <IDENTLIST> ) ;
   case (SCANFSYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != LPAREN)
     {
       error(LPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != RPAREN)
     {
       error(RPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != SEMICOLON)
     {
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     break;
 
   //<STATEMENT> → while ( <EXPRESSION> ) <BLOCK>
   case (WHILESYM):
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     if (nextTokenCode != LPAREN)
     {
       error(LPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Expression();
     if (nextTokenCode != RPAREN)
     {
       error(RPAREN);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     Block();
     break;
     
   // Handle assignment statements and expressions  
   case (IDENT):
     {
-      string varName = nextToken->getLexemeString();
-      nextToken = la->getNextToken();
-      nextTokenCode = nextToken->getTokenCode();
+      uint32_t varName = semanticAnalyzer->internName(nextToken->getLexemeString());
+      advance();
       
       if (nextTokenCode == LBRACKET)
       {
-        // Array assignment: identifier[expression] = expression
+        // Array assignment: identifier[expression]... = expression
         semanticAnalyzer->checkArrayAccess(varName, currentLine);
-        
-        nextToken = la->getNextToken();
-        nextTokenCode = nextToken->getTokenCode();
-        
-        Expression(); // Parse the index expression
-        
-        if (nextTokenCode != RBRACKET)
-        {
-          error(RBRACKET);
-        }
-        nextToken = la->getNextToken();
-        nextTokenCode = nextToken->getTokenCode();
+        Subscripts(varName);
         
         if (nextTokenCode == ASSIGN)
         {
-          nextToken = la->getNextToken();
-          nextTokenCode = nextToken->getTokenCode();
+          advance();
           Expression();
         }
         else
@@ -473,27 +686,23 @@ case(IFSYM):
           error(ASSIGN);
         }
       }
-      else if (nextTokenCode == ASSIGN)
+      else if (nextTokenCode == LPAREN)
       {
-        // Regular variable assignment
-        semanticAnalyzer->checkVariableUsage(varName, currentLine);
-        nextToken = la->getNextToken();
-        nextTokenCode = nextToken->getTokenCode();
-        Expression();
+        // A call, perhaps the first operand of an expression statement
+        BinaryTail(Call(varName), LOWEST_PRECEDENCE);
       }
-      else if (nextTokenCode == EQL)
+      else if (nextTokenCode == ASSIGN)
       {
-        // Handle equality comparison like "x == 10"
+        // Regular variable assignment
         semanticAnalyzer->checkVariableUsage(varName, currentLine);
-        nextToken = la->getNextToken();
-        nextTokenCode = nextToken->getTokenCode();
+        advance();
         Expression();
       }
       else
       {
-        // Handle other expressions that might start with an identifier
-        // but since we already consumed the IDENT, we need to continue from where we are
-        Or();
+        // An expression statement such as "x == 10" or "x + 1": the
+        // identifier already consumed is the left operand
+        BinaryTail(semanticAnalyzer->checkVariableUsage(varName, currentLine), LOWEST_PRECEDENCE);
       }
     }
     
@@ -501,8 +710,7 @@ case(IFSYM):
     {
       error(SEMICOLON);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
     break;
     
   default:
@@ -511,11 +719,12 @@ case(IFSYM):
   }
 }
 
+// Declarations are where most semantic checks happen, one batch per list
 void SyntaxAnalyzer::Declaration()
 {
+  TraceSpan span("Declaration checks", currentLine);
   TokenCodes varType = nextTokenCode;
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
   Identlist(varType);
 }
 
@@ -528,9 +737,8 @@ void SyntaxAnalyzer::Identlist(TokenCodes varType)
       error(IDENT);
     }
     
-    string varName = nextToken->getLexemeString();
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    uint32_t varName = semanticAnalyzer->internName(nextToken->getLexemeString());
+    advance();
 
     // Check if this is an array declaration
     if (nextTokenCode == LBRACKET)
@@ -550,245 +758,284 @@ void SyntaxAnalyzer::Identlist(TokenCodes varType)
     {
       error(COMMA);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    advance();
   }
 }
 
-void SyntaxAnalyzer::ArrayDeclaration(TokenCodes varType, const string& arrayName)
+//<ARRAY> → [ <NUMLIT> ] { [ <NUMLIT> ] }
+//<ARRAY> → [ [ <IDENT> ] ] { [ <NUMLIT> ] }
+// Declared once the last dimension is known, so it follows the next token.
+// A first extent that is a variable or left out is sized at run time.
+bool SyntaxAnalyzer::ArrayDeclaration(TokenCodes varType, uint32_t arrayName)
 {
+  vector<int> dimensions;
+  
   // We're already at the LBRACKET token
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  advance();
   
-  if (nextTokenCode != NUMLIT)
+  if (nextTokenCode == IDENT || nextTokenCode == RBRACKET)
   {
-    error(NUMLIT);
+    uint32_t length = StringInterner::EMPTY;
+    if (nextTokenCode == IDENT)
+    {
+      length = semanticAnalyzer->internName(nextToken->getLexemeString());
+      advance();
+    }
+    
+    if (nextTokenCode != RBRACKET)
+    {
+      error(RBRACKET);
+    }
+    advance();
+    dimensions.push_back(0);
+    Extents(dimensions);
+    return semanticAnalyzer->declareDynamicArray(arrayName, varType, dimensions, length, currentLine);
   }
   
-  // Parse array size
-  string sizeStr = nextToken->getLexemeString();
-  int arraySize = 0;
-  try {
-    arraySize = std::stoi(sizeStr);
-  } catch (const std::exception& e) {
-    cout << "Error: Invalid array size '" << sizeStr << "'" << endl;
-    exit(-1);
+  if (nextTokenCode != NUMLIT)
+  {
+    error(NUMLIT);
   }
-  
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  dimensions.push_back(ArraySize());
   
   if (nextTokenCode != RBRACKET)
   {
     error(RBRACKET);
   }
+  advance();
+  Extents(dimensions);
   
   // Declare the array in the symbol table
-  semanticAnalyzer->declareArray(arrayName, varType, arraySize, currentLine);
-  
-  nextToken = la->getNextToken();
-  nextTokenCode = nextToken->getTokenCode();
+  return semanticAnalyzer->declareArray(arrayName, varType, dimensions, currentLine);
 }
 
-void SyntaxAnalyzer::Block()
+//<EXTENTS> → { [ <NUMLIT> ] }
+void SyntaxAnalyzer::Extents(vector<int>& dimensions)
 {
-  if (nextTokenCode == LBRACE)
+  while (nextTokenCode == LBRACKET)
   {
-    Compstmt();
-  }
-  else
-  {
-    Statement();
+    advance();
+    
+    if (nextTokenCode != NUMLIT)
+    {
+      error(NUMLIT);
+    }
+    dimensions.push_back(ArraySize());
+    
+    if (nextTokenCode != RBRACKET)
+    {
+      error(RBRACKET);
+    }
+    advance();
   }
 }
 
-void SyntaxAnalyzer::Expression()
+// Reads the NUMLIT of an array size
+int SyntaxAnalyzer::ArraySize()
 {
-  Or();
+  // The lexer has decoded the size; it must be an int that fits
+  if (nextToken->getLiteralType() != DataType::INT || nextToken->isOutOfRange())
+  {
+    reportInvalidArraySize(out, nextToken->getLexemeString(), currentLine);
+  }
+  int size = nextToken->getIntValue();
+  
+  advance();
+  return size;
 }
 
-void SyntaxAnalyzer::Or()
+//<SUBSCRIPTS> → [ <EXPRESSION> ] { [ <EXPRESSION> ] }
+// One per dimension, checked once they have all been read
+DataType SyntaxAnalyzer::Subscripts(uint32_t arrayName)
 {
-  And();
-  OrPrime();
+  int subscripts = 0;
+  
+  // We're already at the LBRACKET token
+  while (nextTokenCode == LBRACKET)
+  {
+    advance();
+    
+    Expression(); // Parse the index expression
+    
+    if (nextTokenCode != RBRACKET)
+    {
+      error(RBRACKET);
+    }
+    advance();
+    subscripts++;
+  }
+  
+  return semanticAnalyzer->checkSubscripts(arrayName, subscripts, currentLine);
 }
-void SyntaxAnalyzer::OrPrime()
+
+void SyntaxAnalyzer::Block()
 {
-  if (nextTokenCode == OR)
+  if (nextTokenCode == LBRACE)
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    And();
-    OrPrime();
+    Compstmt();
   }
   else
   {
+    Statement();
   }
 }
 
-void SyntaxAnalyzer::And()
+int SyntaxAnalyzer::binaryPrecedence(TokenCodes token)
 {
-  Equality();
-  AndPrime();
+  return PRECEDENCE.precedence[token];
 }
 
-void SyntaxAnalyzer::AndPrime()
+DataType SyntaxAnalyzer::Expression()
 {
-  if (nextTokenCode == AND)
-  {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Equality();
-    AndPrime();
-  }
-  else
-  {
-  }
+  return BinaryExpression(LOWEST_PRECEDENCE);
 }
 
-void SyntaxAnalyzer::Equality()
+//<BINARY> → <UNARY> { <OPERATOR> <UNARY> }, grouped by precedence
+DataType SyntaxAnalyzer::BinaryExpression(int minPrecedence)
 {
-  Relational();
-  EqualityPrime();
+  return BinaryTail(Unary(), minPrecedence);
 }
 
-void SyntaxAnalyzer::EqualityPrime()
+// Continues an expression whose left operand has already been parsed
+DataType SyntaxAnalyzer::BinaryTail(DataType left, int minPrecedence)
 {
-  if ((nextTokenCode == EQL) || (nextTokenCode == NEQ))
-  {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Relational();
-    EqualityPrime();
-  }
-  else
+  int precedence = binaryPrecedence(nextTokenCode);
+  while (precedence >= minPrecedence)
   {
+    TokenCodes op = nextTokenCode;
+    advance();
+    DataType right = Unary();
+
+    // A tighter operator takes the operand just parsed as its left side
+    int next = binaryPrecedence(nextTokenCode);
+    while (next > precedence)
+    {
+      right = BinaryTail(right, precedence + 1);
+      next = binaryPrecedence(nextTokenCode);
+    }
+    left = semanticAnalyzer->operationType(left, right, op);
+    precedence = next;
   }
+  return left;
 }
 
-void SyntaxAnalyzer::Relational()
+DataType SyntaxAnalyzer::Unary()
 {
-  Term();
-  RelationalPrime();
+  if (nextTokenCode == NOT)
+  {
+    advance();
+    return semanticAnalyzer->operationType(Primary(), NOT);
+  }
+  return Primary();
 }
 
-void SyntaxAnalyzer::RelationalPrime()
+DataType SyntaxAnalyzer::Primary()
 {
-  if ((nextTokenCode == LSS) || (nextTokenCode == LEQ) || (nextTokenCode == GTR) || (nextTokenCode == GEQ))
+  DataType type = DataType::UNKNOWN;
+  if (nextTokenCode == LPAREN)
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Term();
-    RelationalPrime();
+    NestingScope nesting(*this);
+    advance();
+    type = Expression();
+    if (nextTokenCode != RPAREN)
+    {
+      error(RPAREN);
+    }
+    advance();
   }
-  else
+  else if (nextTokenCode == IDENT)
   {
+    uint32_t varName = semanticAnalyzer->internName(nextToken->getLexemeString());
+    advance();
+    type = IdentPrimary(varName);
   }
-}
-
-void SyntaxAnalyzer::Term()
-{
-  Factor();
-  TermPrime();
-}
-
-void SyntaxAnalyzer::TermPrime()
-{
-  if ((nextTokenCode == PLUS) || (nextTokenCode == MINUS))
+  else if (nextTokenCode == NUMLIT)
+  {
+    type = nextToken->getLiteralType();
+    semanticAnalyzer->checkLiteral(nextToken->getLexemeString(), type, nextToken->isOutOfRange(), currentLine);
+    advance();
+  }
+  else if ((nextTokenCode == TRUESYM) || (nextTokenCode == FALSESYM))
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Factor();
-    TermPrime();
+    type = DataType::BOOL;
+    advance();
   }
   else
   {
+    error(IDENT);
   }
+  return type;
 }
 
-void SyntaxAnalyzer::Factor()
-{
-  Unary();
-  FactorPrime();
-}
-
-void SyntaxAnalyzer::FactorPrime()
+// An operand that starts with an identifier, already consumed
+DataType SyntaxAnalyzer::IdentPrimary(uint32_t varName)
 {
-  if ((nextTokenCode == TIMES) || (nextTokenCode == SLASH) || (nextTokenCode == MOD))
+  // Check if this is array access
+  if (nextTokenCode == LBRACKET)
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Unary();
-    FactorPrime();
+    // Array access: identifier[expression]...
+    semanticAnalyzer->checkArrayAccess(varName, currentLine);
+    NestingScope nesting(*this);
+    return Subscripts(varName);
   }
-  else
+  else if (nextTokenCode == LPAREN)
   {
+    return Call(varName);
   }
-}
-
-void SyntaxAnalyzer::Unary()
-{
-  if (nextTokenCode == NOT)
+  else
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    // Regular variable access
+    return semanticAnalyzer->checkVariableUsage(varName, currentLine);
   }
-  Primary();
 }
 
-void SyntaxAnalyzer::Primary()
+//<CALL> → <IDENT> ( [ <ARGUMENT> { , <ARGUMENT> } ] )
+// The function name has been consumed. The call is checked before its
+// ')' is, as a function is declared.
+DataType SyntaxAnalyzer::Call(uint32_t functionName)
 {
-  if (nextTokenCode == LPAREN)
+  NestingScope nesting(*this);
+  vector<CallArgument> arguments;
+  
+  advance();
+  if (nextTokenCode != RPAREN)
   {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
-    Expression();
-    if (nextTokenCode != RPAREN)
+    Argument(arguments);
+    while (nextTokenCode == COMMA)
     {
-      error(RPAREN);
+      advance();
+      Argument(arguments);
     }
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
   }
-  else if (nextTokenCode == IDENT)
+  
+  if (nextTokenCode != RPAREN)
+  {
+    error(RPAREN);
+  }
+  DataType type = semanticAnalyzer->checkFunctionCall(functionName, arguments, currentLine);
+  advance();
+  return type;
+}
+
+//<ARGUMENT> → <EXPRESSION>
+void SyntaxAnalyzer::Argument(vector<CallArgument>& arguments)
+{
+  if (nextTokenCode == IDENT)
   {
-    string varName = nextToken->getLexemeString();
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    uint32_t name = semanticAnalyzer->internName(nextToken->getLexemeString());
+    advance();
     
-    // Check if this is array access
-    if (nextTokenCode == LBRACKET)
+    // A lone identifier is recorded by name, since it may pass an array
+    if (nextTokenCode == COMMA || nextTokenCode == RPAREN)
     {
-      // Array access: identifier[expression]
-      semanticAnalyzer->checkArrayAccess(varName, currentLine);
-      
-      nextToken = la->getNextToken();
-      nextTokenCode = nextToken->getTokenCode();
-      
-      Expression(); // Parse the index expression
-      
-      if (nextTokenCode != RBRACKET)
-      {
-        error(RBRACKET);
-      }
-      nextToken = la->getNextToken();
-      nextTokenCode = nextToken->getTokenCode();
-    }
-    else
-    {
-      // Regular variable access
-      semanticAnalyzer->checkVariableUsage(varName, currentLine);
+      arguments.push_back({name, semanticAnalyzer->checkVariableUsage(name, currentLine)});
+      return;
     }
-  }
-  else if ((nextTokenCode == NUMLIT) || (nextTokenCode == TRUESYM) || (nextTokenCode == FALSESYM))
-  {
-    nextToken = la->getNextToken();
-    nextTokenCode = nextToken->getTokenCode();
+    arguments.push_back({StringInterner::EMPTY, BinaryTail(IdentPrimary(name), LOWEST_PRECEDENCE)});
   }
   else
   {
-    error(IDENT);
+    arguments.push_back({StringInterner::EMPTY, Expression()});
   }
 }
 
@@ -0,0 +1,289 @@
+#include <string>
+#include "Grammar.h"
+#include "Statistics.h"
+#include "StringInterner.h"
+#include "SyntaxAnalyzer.h"
+#include "TableParser.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace Grammar;
+
+namespace
+{
+  // Right-hand sides stored back to front, so expanding a production is a
+  // straight copy onto the parse stack
+  struct ReversedProductions
+  {
+    uint8_t symbols[PRODUCTION_COUNT][MAX_RHS];
+    uint8_t length[PRODUCTION_COUNT];
+  };
+
+  constexpr ReversedProductions reverseProductions()
+  {
+    ReversedProductions reversed{};
+    for (int p = 0; p < PRODUCTION_COUNT; p++)
+    {
+      const Production &production = PRODUCTIONS[p];
+      reversed.length[p] = (uint8_t)production.length;
+      for (int i = 0; i < production.length; i++)
+        reversed.symbols[p][i] = (uint8_t)production.rhs[production.length - 1 - i];
+    }
+    return reversed;
+  }
+
+  constexpr ReversedProductions REVERSED = reverseProductions();
+}
+
+thread_local bool TableParser::enabled = false;
+
+TableParser::TableParser(LexicalAnalyzer *l, ostream &output)
+    : la(l), nextToken(nullptr), previousToken(nullptr), nestingDepth(0), out(output),
+      returnType(NAL), type(NAL), functionName(0), name(0), sizedAtRunTime(false),
+      arrayLength(0), tokensRead(0), declared(false), negate(false)
+{
+  advance();
+  semanticAnalyzer = new SemanticAnalyzer(output);
+  stack.reserve(256);
+}
+
+TableParser::~TableParser()
+{
+  delete previousToken;
+  delete nextToken;
+  delete semanticAnalyzer;
+}
+
+// Tokens are pulled one at a time, as the recursive descent parser does,
+// so lexer output and semantic messages interleave the same way
+void TableParser::advance()
+{
+  delete previousToken;
+  previousToken = nextToken;
+  nextToken = la->getNextToken();
+  tokensRead++;
+  nextTokenCode = nextToken->getTokenCode();
+  currentLine = nextToken->getLineNumber();
+}
+
+void TableParser::Program()
+{
+  parse();
+
+  if (nextTokenCode != EOI)
+  {
+    SyntaxAnalyzer::reportSyntaxError(out, EOI, nextToken, currentLine);
+  }
+
+  TraceSpan span("Semantic report");
+  semanticAnalyzer->printSemanticReport();
+  semanticAnalyzer->printSymbolTable();
+}
+
+void TableParser::parse()
+{
+  TINYC_PHASE(Phase::PARSER);
+  stack.clear();
+  stack.push_back(PROGRAM);
+
+  while (!stack.empty())
+  {
+    int symbol = stack.back();
+    stack.pop_back();
+
+    if (isTerminal(symbol))
+    {
+      if (nextTokenCode != symbol)
+      {
+        SyntaxAnalyzer::reportSyntaxError(out, (TokenCodes)symbol, nextToken, currentLine);
+      }
+      advance();
+    }
+    else if (isNonterminal(symbol))
+    {
+      int nonterminal = symbol - FIRST_NONTERMINAL;
+      int production = PARSE_TABLE.entry[nonterminal][nextTokenCode];
+      if (production < 0)
+      {
+        production = PARSE_TABLE.fallback[nonterminal];
+        if (production < 0)
+        {
+          SyntaxAnalyzer::reportSyntaxError(out, NONTERMINAL_INFO[nonterminal].errorToken, nextToken,
+                                            currentLine);
+        }
+      }
+      const uint8_t *rhs = REVERSED.symbols[production];
+      stack.insert(stack.end(), rhs, rhs + REVERSED.length[production]);
+    }
+    else
+    {
+      performAction(symbol);
+    }
+  }
+}
+
+// The semantic calls the recursive descent parser makes, at the same points
+void TableParser::performAction(int action)
+{
+  switch (action)
+  {
+  case SAVE_RETURN_TYPE:
+    returnType = previousToken->getTokenCode();
+    break;
+  case SAVE_FUNCTION_NAME:
+    functionName = semanticAnalyzer->internName(previousToken->getLexemeString());
+    break;
+  case SAVE_TYPE:
+    type = previousToken->getTokenCode();
+    break;
+  case SAVE_NAME:
+    name = semanticAnalyzer->internName(previousToken->getLexemeString());
+    break;
+  case ENTER_SCOPE:
+    semanticAnalyzer->enterScope();
+    break;
+  case EXIT_SCOPE:
+    semanticAnalyzer->exitScope();
+    break;
+  case DECLARE_FUNCTION:
+    semanticAnalyzer->declareFunction(functionName, returnType, parameters, currentLine);
+    parameters.clear();
+    break;
+  case DECLARE_PARAMETER:
+    semanticAnalyzer->declareParameter(name, type, dimensions, currentLine);
+    parameters.push_back({type, dimensions});
+    dimensions.clear();
+    sizedAtRunTime = false;
+    break;
+  case DECLARE_VARIABLE:
+    declared = semanticAnalyzer->declareVariable(name, type, currentLine);
+    break;
+  case PARSE_ARRAY_SIZE:
+    if (nextToken->getLiteralType() != DataType::INT || nextToken->isOutOfRange())
+      SyntaxAnalyzer::reportInvalidArraySize(out, nextToken->getLexemeString(), currentLine);
+    dimensions.push_back(nextToken->getIntValue());
+    break;
+  case UNSIZED_EXTENT:
+    dimensions.push_back(0);
+    sizedAtRunTime = true;
+    arrayLength = StringInterner::EMPTY;
+    break;
+  case SAVE_LENGTH:
+    dimensions.push_back(0);
+    sizedAtRunTime = true;
+    arrayLength = semanticAnalyzer->internName(previousToken->getLexemeString());
+    break;
+  case CHECK_LITERAL:
+    semanticAnalyzer->checkLiteral(nextToken->getLexemeString(), nextToken->getLiteralType(),
+                                   nextToken->isOutOfRange(), currentLine);
+    break;
+  case DECLARE_ARRAY:
+    if (sizedAtRunTime)
+      declared = semanticAnalyzer->declareDynamicArray(name, type, dimensions, arrayLength, currentLine);
+    else
+      declared = semanticAnalyzer->declareArray(name, type, dimensions, currentLine);
+    dimensions.clear();
+    sizedAtRunTime = false;
+    break;
+  case CHECK_VARIABLE:
+    operands.push_back(semanticAnalyzer->checkVariableUsage(name, currentLine));
+    break;
+  case CHECK_ARRAY:
+    semanticAnalyzer->checkArrayAccess(name, currentLine);
+    accesses.push_back({name, 0});
+    break;
+  case ADD_SUBSCRIPT:
+    accesses.back().second++;
+    operands.pop_back();
+    break;
+  case CHECK_SUBSCRIPTS:
+    operands.push_back(
+        semanticAnalyzer->checkSubscripts(accesses.back().first, accesses.back().second, currentLine));
+    accesses.pop_back();
+    break;
+  case START_CALL:
+    calls.push_back({name, {}, 0});
+    break;
+  case START_ARGUMENT:
+    calls.back().argumentStart = tokensRead;
+    break;
+  case ADD_ARGUMENT:
+  {
+    // One token, an identifier: a lone name that may pass an array
+    uint32_t argument = StringInterner::EMPTY;
+    if (tokensRead == calls.back().argumentStart + 1 && previousToken->getTokenCode() == IDENT)
+      argument = semanticAnalyzer->internName(previousToken->getLexemeString());
+    calls.back().arguments.push_back({argument, operands.back()});
+    operands.pop_back();
+    break;
+  }
+  case CHECK_CALL:
+    operands.push_back(semanticAnalyzer->checkFunctionCall(calls.back().function, calls.back().arguments,
+                                                           currentLine));
+    calls.pop_back();
+    break;
+  case SAVE_OPERAND:
+    operands.push_back(previousToken->getTokenCode() == NUMLIT ? previousToken->getLiteralType()
+                                                                : DataType::BOOL);
+    break;
+  case SAVE_OPERATOR:
+    operators.push_back(previousToken->getTokenCode());
+    break;
+  case APPLY_OPERATOR:
+  {
+    DataType right = operands.back();
+    operands.pop_back();
+    if (operators.back() == NOT)
+    {
+      operands.push_back(semanticAnalyzer->operationType(right, NOT));
+    }
+    else
+    {
+      operands.back() = semanticAnalyzer->operationType(operands.back(), right, operators.back());
+    }
+    operators.pop_back();
+    break;
+  }
+  case DROP_OPERANDS:
+    operands.clear();
+    break;
+  case START_GLOBAL:
+    type = returnType;
+    name = functionName;
+    initialValues.clear();
+    break;
+  case DEFINE_GLOBAL:
+    if (declared)
+      semanticAnalyzer->defineGlobal(name, initialValues, currentLine);
+    initialValues.clear();
+    break;
+  case NEGATE:
+    negate = true;
+    break;
+  case ADD_CONSTANT:
+    if (nextTokenCode == NUMLIT)
+    {
+      DataType literalType = nextToken->getLiteralType();
+      double value = literalType == DataType::FLOAT ? nextToken->getFloatValue() : nextToken->getIntValue();
+      initialValues.push_back({literalType, negate ? -value : value});
+    }
+    else
+    {
+      initialValues.push_back({DataType::BOOL, nextTokenCode == TRUESYM ? 1.0 : 0.0});
+    }
+    negate = false;
+    break;
+  case NEST:
+    if (++nestingDepth > SyntaxAnalyzer::maxNesting)
+      SyntaxAnalyzer::reportNestingError(out, currentLine);
+    break;
+  case UNNEST:
+    nestingDepth--;
+    break;
+  }
+}
+
+SemanticAnalyzer* TableParser::getSemanticAnalyzer() const
+{
+  return semanticAnalyzer;
+}
@@ -0,0 +1,72 @@
+#include "TinyC.h"
+#include "Driver.h"
+#include "LexicalAnalyzer.h"
+#include "Preprocessor.h"
+#include "SyntaxAnalyzer.h"
+#include "TableParser.h"
+#include "TokenPipeline.h"
+
+#include <sstream>
+#include <streambuf>
+
+namespace {
+    // Lets the lexer read the caller's buffer in place
+    class ViewBuffer : public streambuf {
+    public:
+        explicit ViewBuffer(string_view text) {
+            char* begin = const_cast<char*>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    };
+}
+
+namespace TinyC {
+    CompileOptions::CompileOptions()
+        : tableParser(false), dfaLexer(false), pipelined(false), maxNesting(SyntaxAnalyzer::DEFAULT_MAX_NESTING),
+          preprocess(false) {}
+
+    CompileOptions CompileOptions::current() {
+        CompileOptions options;
+        options.tableParser = TableParser::enabled;
+        options.dfaLexer = LexicalAnalyzer::useDfa;
+        options.pipelined = PipelinedLexer::enabled;
+        options.maxNesting = SyntaxAnalyzer::maxNesting;
+        options.diagnostics = DiagnosticEngine::options;
+        options.imports = SymbolTable::imports;
+        options.preprocess = Preprocessor::enabled;
+        options.includePaths = Preprocessor::includePaths;
+        return options;
+    }
+
+    void CompileOptions::apply() const {
+        TableParser::enabled = tableParser;
+        LexicalAnalyzer::useDfa = dfaLexer;
+        PipelinedLexer::enabled = pipelined;
+        SyntaxAnalyzer::maxNesting = maxNesting;
+        DiagnosticEngine::options = diagnostics;
+        SymbolTable::imports = imports;
+        Preprocessor::enabled = preprocess;
+        Preprocessor::includePaths = includePaths;
+    }
+
+    ScopedOptions::ScopedOptions(const CompileOptions& options) : saved(CompileOptions::current()) {
+        options.apply();
+    }
+
+    ScopedOptions::~ScopedOptions() {
+        saved.apply();
+    }
+
+    CompileResult compile(string_view source, const CompileOptions& options) {
+        ScopedOptions scope(options);
+        ViewBuffer buffer(source);
+        istream input(&buffer);
+        ostringstream output;
+
+        CompileResult result;
+        result.status = compileSource(input, output, nullptr, &result.diagnostics, &result.globals,
+                                      &result.data);
+        result.output = output.str();
+        return result;
+    }
+}
@@ -6,16 +6,19 @@
 
 using namespace std;
 
-Token::Token()
+Token::Token() : literalType(DataType::UNKNOWN), intValue(0), floatValue(0), outOfRange(false)
 {
   setTokenCode(NAL);
   setLexemeString("");
+  setLineNumber(0);
 }
 
 Token::Token(TokenCodes tc, string ls)
+    : literalType(DataType::UNKNOWN), intValue(0), floatValue(0), outOfRange(false)
 {
   setTokenCode(tc);
   setLexemeString(ls);
+  setLineNumber(0);
 }
 
 string Token::getLexemeString()
@@ -38,6 +41,50 @@ void Token::setTokenCode(TokenCodes tc)
   tokenCode = tc;
 }
 
+int Token::getLineNumber()
+{
+  return lineNumber;
+}
+
+void Token::setLineNumber(int ln)
+{
+  lineNumber = ln;
+}
+
+DataType Token::getLiteralType()
+{
+  return literalType;
+}
+
+int Token::getIntValue()
+{
+  return intValue;
+}
+
+double Token::getFloatValue()
+{
+  return floatValue;
+}
+
+bool Token::isOutOfRange()
+{
+  return outOfRange;
+}
+
+void Token::setIntValue(int value, bool tooLarge)
+{
+  literalType = DataType::INT;
+  intValue = value;
+  outOfRange = tooLarge;
+}
+
+void Token::setFloatValue(double value, bool tooLarge)
+{
+  literalType = DataType::FLOAT;
+  floatValue = value;
+  outOfRange = tooLarge;
+}
+
 ostream& operator<<(ostream& os, const Token& t)
 {
   string tcs[] =
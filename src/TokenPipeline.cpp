@@ -0,0 +1,198 @@
+#include "TokenPipeline.h"
+
+#include <chrono>
+
+thread_local bool PipelinedLexer::enabled = false;
+
+namespace {
+    // Waits a little longer on each call: a few spins for a peer on
+    // another core, then yields and sleeps for one that needs this core
+    void backOff(int& attempt) {
+        if (attempt < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else if (attempt < 1024) {
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(chrono::microseconds(50));
+        }
+        attempt++;
+    }
+}
+
+TokenQueue::TokenQueue()
+    : head(0), cachedTail(0), consumerWaits(0), tail(0), cachedHead(0), producerWaits(0), abandoned(false) {}
+
+TokenBatch* TokenQueue::reserve() {
+    size_t position = tail.load(memory_order_relaxed);
+    if (position - cachedHead == SLOTS) {
+        cachedHead = head.load(memory_order_acquire);
+        if (position - cachedHead == SLOTS) {
+            producerWaits++;
+            int attempt = 0;
+            while (position - cachedHead == SLOTS) {
+                if (abandoned.load(memory_order_relaxed)) return nullptr;
+                backOff(attempt);
+                cachedHead = head.load(memory_order_acquire);
+            }
+        }
+    }
+    if (abandoned.load(memory_order_relaxed)) return nullptr;
+    return &slots[position % SLOTS];
+}
+
+void TokenQueue::publish() {
+    tail.store(tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+TokenBatch* TokenQueue::front() {
+    size_t position = head.load(memory_order_relaxed);
+    if (position == cachedTail) {
+        cachedTail = tail.load(memory_order_acquire);
+        if (position == cachedTail) {
+            consumerWaits++;
+            int attempt = 0;
+            while (position == cachedTail) {
+                backOff(attempt);
+                cachedTail = tail.load(memory_order_acquire);
+            }
+        }
+    }
+    return &slots[position % SLOTS];
+}
+
+void TokenQueue::pop() {
+    head.store(head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void TokenQueue::abandon() {
+    abandoned.store(true, memory_order_relaxed);
+}
+
+size_t TokenQueue::pending() const {
+    return tail.load(memory_order_acquire) - head.load(memory_order_relaxed);
+}
+
+TokenBatch* TokenQueue::pendingAt(size_t offset) {
+    return &slots[(head.load(memory_order_relaxed) + offset) % SLOTS];
+}
+
+uint64_t TokenQueue::getProducerWaits() const {
+    return producerWaits;
+}
+
+uint64_t TokenQueue::getConsumerWaits() const {
+    return consumerWaits;
+}
+
+uint64_t TokenQueue::getBatches() const {
+    return tail.load(memory_order_acquire);
+}
+
+PipelinedLexer::PipelinedLexer(istream* source, ostream& output)
+    : LexicalAnalyzer(source, output), discard(nullptr), scanner(source, discard), echo(output), current(nullptr),
+      nextIndex(0), finished(false), lastLine(1) {
+    producer = thread(&PipelinedLexer::produce, this, LexicalAnalyzer::useDfa, CompileStatistics::enabled);
+}
+
+// Frees whatever the parser did not take: after a syntax error, the rest
+// of the batch in hand and any batches scanned ahead
+PipelinedLexer::~PipelinedLexer() {
+    if (!finished) {
+        queue.abandon();
+        producer.join();
+    }
+    if (current) {
+        for (int i = nextIndex; i < current->count; i++) delete current->tokens[i];
+        queue.pop();
+    }
+    for (size_t i = 0, count = queue.pending(); i < count; i++) {
+        TokenBatch* batch = queue.pendingAt(i);
+        for (int j = 0; j < batch->count; j++) delete batch->tokens[j];
+    }
+}
+
+// Runs on the scanning thread until end of input, or until the consumer
+// abandons the queue. An empty batch tells the consumer scanning failed.
+void PipelinedLexer::produce(bool dfa, bool collectStatistics) {
+    LexicalAnalyzer::useDfa = dfa;
+    if (collectStatistics) CompileStatistics::current().beginCompile();
+
+    TokenBatch* batch = nullptr;
+    try {
+        bool done = false;
+        while (!done && (batch = queue.reserve())) {
+            batch->count = 0;
+            while (batch->count < TokenBatch::CAPACITY && !done) {
+                Token* token = scanner.getNextToken();
+                batch->tokens[batch->count++] = token;
+                done = token->getTokenCode() == EOI;
+            }
+            queue.publish();
+            batch = nullptr;
+        }
+    } catch (...) {
+        failure = current_exception();
+        if (batch || (batch = queue.reserve())) {
+            for (int i = 0; i < batch->count; i++) delete batch->tokens[i];
+            batch->count = 0;
+            queue.publish();
+        }
+    }
+
+    if (collectStatistics) {
+        CompileStatistics::current().endCompile();
+        scanStatistics = CompileStatistics::current();
+    }
+}
+
+// Called on the consumer once end of input has been handed out
+void PipelinedLexer::finish() {
+    finished = true;
+    producer.join();
+    if (CompileStatistics::enabled) {
+        CompileStatistics::current().merge(scanStatistics);
+    }
+    TINYC_COUNT(Counter::QUEUE_BATCHES, queue.getBatches());
+    TINYC_COUNT(Counter::QUEUE_PRODUCER_WAITS, queue.getProducerWaits());
+    TINYC_COUNT(Counter::QUEUE_CONSUMER_WAITS, queue.getConsumerWaits());
+}
+
+Token* PipelinedLexer::getNextToken() {
+    if (finished) {
+        // Asked past the end, as LexicalAnalyzer keeps answering
+        Token* token = new Token();
+        token->setLexemeString("end of file");
+        token->setTokenCode(TokenCodes::EOI);
+        token->setLineNumber(lastLine);
+        return token;
+    }
+
+    if (!current) {
+        current = queue.front();
+        nextIndex = 0;
+    }
+    if (current->count == 0) {
+        finish();
+        rethrow_exception(failure);
+    }
+
+    Token* token = current->tokens[nextIndex++];
+    if (nextIndex == current->count) {
+        queue.pop();
+        current = nullptr;
+    }
+
+    if (token->getTokenCode() == EOI) {
+        lastLine = token->getLineNumber();
+        finish();
+    } else {
+        echo << token->getLexemeString() << " ";
+    }
+    return token;
+}
+
+const TokenQueue& PipelinedLexer::getQueue() const {
+    return queue;
+}
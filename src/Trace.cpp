@@ -0,0 +1,126 @@
+#include "Trace.h"
+#include "Json.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    typedef chrono::steady_clock Clock;
+
+    Clock::time_point epoch;
+    uint64_t bufferCapacity = Tracer::DEFAULT_CAPACITY;
+    string outputPath;
+
+    // Registration happens once per thread; recording never takes this lock
+    mutex registryMutex;
+    vector<TraceBuffer*> registry;
+
+    thread_local TraceBuffer* threadBuffer = nullptr;
+
+    TraceBuffer* registerThread() {
+        TraceBuffer* buffer = new TraceBuffer();
+        buffer->events = new TraceEvent[bufferCapacity];
+        buffer->capacity = bufferCapacity;
+        buffer->written = 0;
+        buffer->threadId = syscall(SYS_gettid);
+
+        lock_guard<mutex> lock(registryMutex);
+        registry.push_back(buffer);
+        return buffer;
+    }
+
+    void writeAtExit() {
+        if (!Tracer::writeChromeTrace(outputPath)) {
+            fprintf(stderr, "Warning: cannot write trace file %s\n", outputPath.c_str());
+        }
+    }
+
+    void appendMicroseconds(string& out, uint64_t nanos) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%llu.%03llu", (unsigned long long)(nanos / 1000),
+                 (unsigned long long)(nanos % 1000));
+        out += buffer;
+    }
+}
+
+bool Tracer::enabled = false;
+
+void Tracer::start(const string& path, uint64_t capacityPerThread) {
+    // Round up to a power of two so the ring index is a mask
+    uint64_t capacity = 1;
+    while (capacity < capacityPerThread) capacity <<= 1;
+    bufferCapacity = capacity;
+
+    outputPath = path;
+    epoch = Clock::now();
+    enabled = true;
+    atexit(writeAtExit);
+}
+
+uint64_t Tracer::now() {
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+void Tracer::record(const char* name, uint64_t start, int line, const char* detail) {
+    TraceBuffer* buffer = threadBuffer;
+    if (!buffer) {
+        buffer = threadBuffer = registerThread();
+    }
+
+    TraceEvent& event = buffer->events[buffer->written & (buffer->capacity - 1)];
+    event.name = name;
+    event.startNanos = start;
+    event.durationNanos = now() - start;
+    event.line = line;
+    strcpy(event.detail, detail);
+    buffer->written++;
+}
+
+bool Tracer::writeChromeTrace(const string& path) {
+    enabled = false;
+    lock_guard<mutex> lock(registryMutex);
+
+    int pid = getpid();
+    uint64_t dropped = 0;
+    string out = "{\"traceEvents\":[";
+    bool first = true;
+    for (TraceBuffer* buffer : registry) {
+        string thread = "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + to_string(pid) +
+                        ",\"tid\":" + to_string(buffer->threadId) + ",\"args\":{\"name\":\"" +
+                        (buffer->threadId == pid ? string("main") : "worker " + to_string(buffer->threadId)) +
+                        "\"}}";
+        out += (first ? "\n" : ",\n") + thread;
+        first = false;
+
+        uint64_t kept = buffer->written < buffer->capacity ? buffer->written : buffer->capacity;
+        dropped += buffer->written - kept;
+        for (uint64_t i = buffer->written - kept; i < buffer->written; i++) {
+            const TraceEvent& event = buffer->events[i & (buffer->capacity - 1)];
+            out += ",\n{\"ph\":\"X\",\"name\":";
+            JsonValue::appendQuoted(out, event.name);
+            out += ",\"pid\":" + to_string(pid) + ",\"tid\":" + to_string(buffer->threadId) + ",\"ts\":";
+            appendMicroseconds(out, event.startNanos);
+            out += ",\"dur\":";
+            appendMicroseconds(out, event.durationNanos);
+            out += ",\"args\":{\"line\":" + to_string(event.line);
+            if (event.detail[0]) {
+                out += ",\"name\":";
+                JsonValue::appendQuoted(out, event.detail);
+            }
+            out += "}}";
+        }
+    }
+    out += "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" + to_string(dropped) + "}}\n";
+
+    ofstream file(path, ios::out | ios::binary | ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(out.data(), out.size());
+    return file.good();
+}
@@ -1,73 +1,571 @@
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
+#include <unistd.h>
+
+#include "AllocationTracker.h"
+#include "ChunkedInput.h"
+#include "CompileCache.h"
+#include "CompileServer.h"
+#include "Diagnostics.h"
+#include "Driver.h"
+#include "IncrementalCompiler.h"
+#include "LanguageServer.h"
 #include "LexicalAnalyzer.h"
+#include "ModuleInterface.h"
+#include "Preprocessor.h"
+#include "Statistics.h"
 #include "SyntaxAnalyzer.h"
-#include "SemanticAnalyzer.h"
+#include "TableParser.h"
+#include "TokenPipeline.h"
+#include "Trace.h"
 
 using namespace std;
 
-int main(int argc, char *argv[])
+struct DriverOptions
 {
-  ifstream sourceCodeFile;
-  LexicalAnalyzer *la = nullptr;
-  SyntaxAnalyzer *parser = nullptr;
+  string sourcePath;
+  bool useCache;
+  bool showCacheStats;
+  bool incremental;
+  bool languageServer;
+  bool dumpTokens;
+  bool timeReport;
+  bool showStats;
+  bool reportJson;
+  string tracePath;
+  string diagnosticsFormat;
+  string diagnosticsPath;
+  string cacheDirectory;
+  uint64_t cacheMaxBytes;
+  string serverSocket;
+  string connectSocket;
+  int serverWorkers;
+  vector<string> importPaths;
+  string interfacePath;
+  string dataPath;
+
+  DriverOptions() : useCache(false), showCacheStats(false), incremental(false), languageServer(false),
+                    dumpTokens(false), timeReport(false), showStats(false), reportJson(false),
+                    cacheMaxBytes(CompileCache::DEFAULT_MAX_BYTES), serverWorkers(0) {}
+};
+
+static void printUsage(const char *program)
+{
+  cout << "Usage: " << program << " [options] <source_file>" << endl;
+  cout << "Example: " << program << " test1.c" << endl;
+  cout << "A source file of - compiles standard input as it arrives (e.g. from a pipe)" << endl;
+  cout << endl;
+  cout << "Options:" << endl;
+  cout << "  --cache               Reuse results from the compilation cache" << endl;
+  cout << "  --cache-dir=DIR       Cache location (default: $TINYC_CACHE_DIR or .tinyc-cache)" << endl;
+  cout << "  --cache-max-size=N    Evict least recently used entries beyond N bytes (K/M/G suffixes)" << endl;
+  cout << "  --cache-stats         Print cache hit/miss statistics" << endl;
+  cout << "  --incremental         Re-analyze only functions changed since the last run" << endl;
+  cout << "  --server=SOCKET       Run as a compile server listening on a Unix socket" << endl;
+  cout << "  --workers=N           Worker threads for --server (default: one per core)" << endl;
+  cout << "  --connect=SOCKET      Forward the compilation to a server (default: $TINYC_SERVER)" << endl;
+  cout << "  --lsp                 Serve the Language Server Protocol on stdin/stdout" << endl;
+  cout << "  --time-report[=json]  Print time spent in each compiler phase to stderr" << endl;
+  cout << "  --stats[=json]        Print token, scope, lookup, diagnostic and memory counts to stderr" << endl;
+  cout << "  --trace=FILE          Write Chrome trace events (chrome://tracing, Perfetto) at exit" << endl;
+  cout << "  --max-nesting=N       Reject blocks and parentheses nested deeper than N (default "
+       << SyntaxAnalyzer::DEFAULT_MAX_NESTING << ")" << endl;
+  cout << "  --parser=ENGINE       Parse with 'recursive' descent (default) or the LL(1) 'table'" << endl;
+  cout << "  --lexer=ENGINE        Scan with the 'hand'-written lexer (default) or the generated 'dfa'" << endl;
+  cout << "  --pipeline            Lex on a separate thread, a queue of tokens ahead of the parser" << endl;
+  cout << "  --tokens              Print the token stream (line, offset, code, lexeme, value) without parsing" << endl;
+  cout << "  --diagnostics=FORMAT  Also write diagnostics as 'json' or 'sarif' (SARIF 2.1.0) to stderr" << endl;
+  cout << "  --diagnostics-output=FILE  Write the --diagnostics report to FILE instead" << endl;
+  cout << "  --suppress=CODE[,...] Do not report diagnostics with these codes (e.g. undeclared-variable)" << endl;
+  cout << "  --max-errors=N        Print the first N errors and only count the rest" << endl;
+  cout << "  --keep-duplicates     Report a diagnostic again when it repeats on the same line" << endl;
+  cout << "  --emit-interface=FILE Write the file's global declarations as a binary module interface" << endl;
+  cout << "  --import=FILE         Declare everything in a module interface (repeatable)" << endl;
+  cout << "  --emit-data=FILE      Write the static data layout of the globals as assembler source" << endl;
+  cout << "  --preprocess          Apply #include, #define, #ifdef and #pragma once before lexing" << endl;
+  cout << "  --include-path=DIR    Search DIR for #include files, after the source's directory (repeatable)" << endl;
+}
+
+static bool parseSize(const string &text, uint64_t &bytes)
+{
+  char *end = nullptr;
+  unsigned long long value = strtoull(text.c_str(), &end, 10);
+  if (end == text.c_str())
+    return false;
+
+  string suffix(end);
+  if (suffix == "K" || suffix == "k") value <<= 10;
+  else if (suffix == "M" || suffix == "m") value <<= 20;
+  else if (suffix == "G" || suffix == "g") value <<= 30;
+  else if (!suffix.empty()) return false;
+
+  bytes = value;
+  return true;
+}
+
+static bool parseArguments(int argc, char *argv[], DriverOptions &options)
+{
+  const char *environmentDirectory = getenv("TINYC_CACHE_DIR");
+  options.cacheDirectory = environmentDirectory ? environmentDirectory : ".tinyc-cache";
+  const char *environmentServer = getenv("TINYC_SERVER");
+  options.connectSocket = environmentServer ? environmentServer : "";
+
+  for (int i = 1; i < argc; i++)
+  {
+    string argument = argv[i];
+    if (argument == "--cache")
+      options.useCache = true;
+    else if (argument == "--cache-stats")
+      options.showCacheStats = true;
+    else if (argument == "--incremental")
+      options.incremental = true;
+    else if (argument == "--lsp")
+      options.languageServer = true;
+    else if (argument == "--tokens")
+      options.dumpTokens = true;
+    else if (argument == "--time-report" || argument == "--time-report=json")
+    {
+      options.timeReport = true;
+      options.reportJson = options.reportJson || argument != "--time-report";
+    }
+    else if (argument == "--stats" || argument == "--stats=json")
+    {
+      options.showStats = true;
+      options.reportJson = options.reportJson || argument != "--stats";
+    }
+    else if (argument == "--diagnostics=json" || argument == "--diagnostics=sarif")
+      options.diagnosticsFormat = argument.substr(14);
+    else if (argument.compare(0, 21, "--diagnostics-output=") == 0)
+      options.diagnosticsPath = argument.substr(21);
+    else if (argument.compare(0, 11, "--suppress=") == 0)
+    {
+      stringstream codes(argument.substr(11));
+      string id;
+      while (getline(codes, id, ','))
+      {
+        DiagnosticCode code;
+        if (!DiagnosticEngine::findCode(id, code) || code == DiagnosticCode::SYNTAX_ERROR)
+        {
+          cout << "ERROR - unknown diagnostic code: " << id << endl;
+          return false;
+        }
+        DiagnosticEngine::options.suppressed.set((int)code);
+      }
+    }
+    else if (argument.compare(0, 13, "--max-errors=") == 0)
+    {
+      DiagnosticEngine::options.maxErrors = atoi(argument.substr(13).c_str());
+      if (DiagnosticEngine::options.maxErrors < 1)
+      {
+        cout << "ERROR - invalid error limit: " << argument.substr(13) << endl;
+        return false;
+      }
+    }
+    else if (argument == "--keep-duplicates")
+      DiagnosticEngine::options.deduplicate = false;
+    else if (argument.compare(0, 8, "--trace=") == 0)
+      options.tracePath = argument.substr(8);
+    else if (argument.compare(0, 9, "--server=") == 0)
+      options.serverSocket = argument.substr(9);
+    else if (argument.compare(0, 10, "--connect=") == 0)
+      options.connectSocket = argument.substr(10);
+    else if (argument.compare(0, 10, "--workers=") == 0)
+      options.serverWorkers = atoi(argument.substr(10).c_str());
+    else if (argument.compare(0, 14, "--max-nesting=") == 0)
+    {
+      SyntaxAnalyzer::maxNesting = atoi(argument.substr(14).c_str());
+      if (SyntaxAnalyzer::maxNesting < 1)
+      {
+        cout << "ERROR - invalid nesting limit: " << argument.substr(14) << endl;
+        return false;
+      }
+    }
+    else if (argument == "--parser=table" || argument == "--parser=recursive")
+      TableParser::enabled = argument == "--parser=table";
+    else if (argument == "--lexer=dfa" || argument == "--lexer=hand")
+      LexicalAnalyzer::useDfa = argument == "--lexer=dfa";
+    else if (argument == "--pipeline")
+      PipelinedLexer::enabled = true;
+    else if (argument == "--preprocess")
+      Preprocessor::enabled = true;
+    else if (argument.compare(0, 15, "--include-path=") == 0 && argument.size() > 15)
+      Preprocessor::includePaths.push_back(argument.substr(15));
+    else if (argument.compare(0, 9, "--import=") == 0 && argument.size() > 9)
+      options.importPaths.push_back(argument.substr(9));
+    else if (argument.compare(0, 17, "--emit-interface=") == 0 && argument.size() > 17)
+      options.interfacePath = argument.substr(17);
+    else if (argument.compare(0, 12, "--emit-data=") == 0 && argument.size() > 12)
+      options.dataPath = argument.substr(12);
+    else if (argument.compare(0, 12, "--cache-dir=") == 0)
+      options.cacheDirectory = argument.substr(12);
+    else if (argument.compare(0, 17, "--cache-max-size=") == 0)
+    {
+      if (!parseSize(argument.substr(17), options.cacheMaxBytes))
+      {
+        cout << "ERROR - invalid cache size: " << argument.substr(17) << endl;
+        return false;
+      }
+    }
+    else if (argument.size() > 1 && argument[0] == '-')
+    {
+      cout << "ERROR - unknown option: " << argument << endl;
+      return false;
+    }
+    else if (options.sourcePath.empty())
+      options.sourcePath = argument;
+    else
+    {
+      cout << "ERROR - more than one source file given" << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Cache payloads hold the exit status followed by the captured output
+static string encodeResult(int status, const string &output)
+{
+  return to_string(status) + "\n" + output;
+}
 
-  if (argc < 2)
+static bool decodeResult(const string &payload, int &status, string &output)
+{
+  size_t newline = payload.find('\n');
+  if (newline == string::npos)
+    return false;
+  status = atoi(payload.substr(0, newline).c_str());
+  output = payload.substr(newline + 1);
+  return true;
+}
+
+static int compileWithCache(istream &sourceCodeFile, CompileCache &cache, IncrementalCompiler *incremental)
+{
+  string source((istreambuf_iterator<char>(sourceCodeFile)), istreambuf_iterator<char>());
+
+  // Every option that changes the output must take part in the key
+  string outputOptions = incremental ? "incremental" : "";
+  if (SyntaxAnalyzer::maxNesting != SyntaxAnalyzer::DEFAULT_MAX_NESTING)
+    outputOptions += " max-nesting=" + to_string(SyntaxAnalyzer::maxNesting);
+  outputOptions += DiagnosticEngine::optionsKey();
+  outputOptions += SymbolTable::importsKey();
+  uint64_t key = CompileCache::computeKey(source, outputOptions);
+
+  int status = 0;
+  string output;
+  string payload;
+  if (cache.lookup(key, payload) && decodeResult(payload, status, output))
   {
-    cout << "Usage: " << argv[0] << " <source_file>" << endl;
-    cout << "Example: " << argv[0] << " test1.c" << endl;
+    cout << output;
+    return status;
+  }
+
+  ostringstream captured;
+  istringstream sourceStream(source);
+  status = compileSource(sourceStream, captured, incremental);
+  output = captured.str();
+  cout << output;
+
+  cache.store(key, encodeResult(status, output));
+  return status;
+}
+
+// One line per token, for comparing the two scanners
+static int dumpTokenStream(istream &source)
+{
+  // The lexer's own echo of each lexeme is not wanted here
+  ostream discard(nullptr);
+  LexicalAnalyzer lexer(&source, discard);
+  while (true)
+  {
+    Token *token = lexer.getNextToken();
+    bool done = token->getTokenCode() == EOI;
+    cout << token->getLineNumber() << ":" << lexer.getCurrentTokenPosition() << " " << token->getTokenCode()
+         << " " << token->getLexemeString();
+    if (token->isOutOfRange())
+      cout << " out-of-range";
+    else if (token->getLiteralType() == DataType::INT)
+      cout << " int " << token->getIntValue();
+    else if (token->getLiteralType() == DataType::FLOAT)
+      cout << " float " << token->getFloatValue();
+    cout << endl;
+    delete token;
+    if (done)
+      return 0;
+  }
+}
+
+// The server may run in another directory
+static string absolutePath(const string &path)
+{
+  if (!path.empty() && path[0] == '/')
+    return path;
+  char buffer[4096];
+  if (!getcwd(buffer, sizeof(buffer)))
+    return path;
+  return string(buffer) + "/" + path;
+}
+
+// Sends the compilation, with this process's options, to a running server.
+// Returns false when no server answers, in which case the caller compiles
+// locally instead.
+static bool compileRemotely(ifstream &sourceCodeFile, const DriverOptions &options, int &status)
+{
+  CompileClient client;
+  if (!client.connectTo(options.connectSocket))
+    return false;
+
+  CompileRequest request;
+  request.path = options.sourcePath;
+  request.source.assign(istreambuf_iterator<char>(sourceCodeFile), istreambuf_iterator<char>());
+  request.hasSource = true;
+  request.incremental = options.incremental;
+  request.options = TinyC::CompileOptions::current();
+  for (string &path : request.options.includePaths)
+    path = absolutePath(path);
+  for (const string &path : options.importPaths)
+    request.importPaths.push_back(absolutePath(path));
+
+  CompileResponse response;
+  if (!client.send(request, response))
+  {
+    // Rewind so the local fallback sees the whole file
+    sourceCodeFile.clear();
+    sourceCodeFile.seekg(0);
+    return false;
+  }
+
+  cout << response.output;
+  status = response.status;
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  DriverOptions options;
+  if (!parseArguments(argc, argv, options))
+  {
+    printUsage(argv[0]);
     return 1;
   }
 
-  sourceCodeFile.open(argv[1], ifstream::in);
-  if (!sourceCodeFile.is_open())
+  // Functions are reused by their own text, which a header or macro
+  // changed elsewhere would not alter
+  if (Preprocessor::enabled && options.incremental)
   {
-    cout << "ERROR - cannot open input file: " << argv[1] << endl;
-    cout << "Please check if the file exists and is readable." << endl;
+    cout << "ERROR - --preprocess cannot be combined with --incremental" << endl;
+    return 1;
+  }
+  // Replayed functions carry their symbols but not their initializers
+  if (!options.dataPath.empty() && options.incremental)
+  {
+    cout << "ERROR - --emit-data cannot be combined with --incremental" << endl;
     return 1;
   }
 
-  try
-  {
-    la = new LexicalAnalyzer(&sourceCodeFile);
-    parser = new SyntaxAnalyzer(la);
-    
-    cout << "Parsing file: " << argv[1] << endl;
-    cout << "Tokens: ";
-    
-    parser->Program();
-    
-    // Check for semantic errors
-    if (parser->getSemanticAnalyzer()->hasErrors()) {
-      cout << endl << "Compilation failed due to semantic errors!" << endl;
-      delete la;
-      delete parser;
-      sourceCodeFile.close();
+  if (!options.tracePath.empty())
+    Tracer::start(options.tracePath);
+
+  // Interfaces are mapped once, before any fallback to a local compile; a
+  // compile server maps the ones each request names instead
+  for (const string &path : options.importPaths)
+  {
+    string error;
+    shared_ptr<const ModuleInterface> module = ModuleInterface::open(path, error);
+    if (!module)
+    {
+      cout << "ERROR - " << error << endl;
       return 1;
     }
-    
-    cout << endl << "Parsing and semantic analysis completed successfully!" << endl;
+    SymbolTable::imports.push_back(module);
   }
-  catch (const exception& e)
+
+  if (!options.serverSocket.empty())
   {
-    cout << endl << "Parsing failed with exception: " << e.what() << endl;
-    delete la;
-    delete parser;
-    sourceCodeFile.close();
+    CompileServer server(options.serverSocket, options.serverWorkers);
+    return server.run();
+  }
+
+  if (options.languageServer)
+  {
+    LanguageServer server(cin, cout);
+    return server.run();
+  }
+
+  CompileCache *cache = nullptr;
+  if (options.useCache || options.showCacheStats || options.incremental)
+  {
+    cache = new CompileCache(options.cacheDirectory, options.cacheMaxBytes);
+    if (!cache->isUsable())
+    {
+      cout << "Warning: cannot use cache directory " << options.cacheDirectory
+           << ", compiling without cache" << endl;
+      delete cache;
+      cache = nullptr;
+    }
+  }
+
+  if (options.sourcePath.empty())
+  {
+    if (options.showCacheStats && cache)
+    {
+      cache->printStatistics(cout);
+      delete cache;
+      return 0;
+    }
+    printUsage(argv[0]);
+    delete cache;
     return 1;
   }
-  catch (...)
+
+  // Standard input is read in chunks as the compiler consumes it, so a
+  // generator can pipe a program of any size straight in
+  bool streaming = options.sourcePath == "-";
+  ChunkedInputBuffer standardInput(STDIN_FILENO);
+  istream streamedSource(&standardInput);
+  ifstream sourceCodeFile;
+  if (!streaming)
+    sourceCodeFile.open(options.sourcePath, ifstream::in);
+  istream &source = streaming ? streamedSource : sourceCodeFile;
+  if (!streaming && !sourceCodeFile.is_open())
   {
-    cout << endl << "Parsing failed with unknown error!" << endl;
-    delete la;
-    delete parser;
-    sourceCodeFile.close();
+    cout << "ERROR - cannot open input file: " << options.sourcePath << endl;
+    cout << "Please check if the file exists and is readable." << endl;
+    delete cache;
     return 1;
   }
-  
-  delete la;
-  delete parser;
+
+  // Quoted includes are found beside the source first
+  if (Preprocessor::enabled && !streaming)
+  {
+    size_t slash = options.sourcePath.rfind('/');
+    Preprocessor::includePaths.insert(Preprocessor::includePaths.begin(),
+                                      slash == string::npos ? "." : options.sourcePath.substr(0, slash + 1));
+  }
+
+  if (options.dumpTokens)
+  {
+    delete cache;
+    return dumpTokenStream(source);
+  }
+
+  cout << "Parsing file: " << (streaming ? "<stdin>" : options.sourcePath) << endl;
+  cout << "Tokens: ";
+
+  // Function results persist in the cache directory between runs
+  IncrementalCompiler *incremental = nullptr;
+  if (options.incremental)
+    incremental = new IncrementalCompiler(cache);
+
+  bool collectStatistics = options.timeReport || options.showStats;
+  if (collectStatistics)
+  {
+    CompileStatistics::enabled = true;
+    CompileStatistics::current().beginCompile();
+    AllocationTracker::reset();
+  }
+
+  bool wantReport = !options.diagnosticsFormat.empty();
+  bool wantInterface = !options.interfacePath.empty();
+  bool wantData = !options.dataPath.empty();
+  // Neither the server nor the cache keep diagnostics records, symbols
+  // or data
+  bool compileHere = wantReport || wantInterface || wantData ||
+                     // Standard input cannot be rewound for a local fallback
+                     streaming ||
+                     // These describe the compile in this process
+                     collectStatistics || !options.tracePath.empty();
+  DiagnosticEngine diagnostics;
+  vector<SymbolInfo> globals;
+  DataLayout data;
+
+  int status;
+  if (!compileHere && !options.connectSocket.empty() && compileRemotely(sourceCodeFile, options, status))
+  {
+    // Served by the compile server
+  }
+  else if (cache && options.useCache && !wantReport && !wantInterface && !wantData &&
+           // A cached result would not notice a changed header
+           !Preprocessor::enabled)
+    status = compileWithCache(source, *cache, incremental);
+  else
+    status = compileSource(source, cout, incremental, wantReport ? &diagnostics : nullptr,
+                           wantInterface ? &globals : nullptr, wantData ? &data : nullptr);
+
+  if (standardInput.readFailed())
+  {
+    cout << "ERROR - cannot read standard input" << endl;
+    status = 1;
+  }
+
+  // Only a file that compiled cleanly is worth importing
+  if (wantInterface && status == 0)
+  {
+    string error;
+    if (!ModuleInterface::write(options.interfacePath, globals, error))
+    {
+      cout << "ERROR - " << error << endl;
+      status = 1;
+    }
+  }
+  else if (wantInterface)
+    cerr << "Warning: " << options.interfacePath << " not written, the compilation failed" << endl;
+
+  if (wantData && status == 0)
+  {
+    ofstream file(options.dataPath, ios::out | ios::trunc);
+    data.writeAssembly(file, streaming ? "<stdin>" : options.sourcePath);
+    file.close();
+    if (!file)
+    {
+      cout << "ERROR - cannot write " << options.dataPath << endl;
+      status = 1;
+    }
+  }
+  else if (wantData)
+    cerr << "Warning: " << options.dataPath << " not written, the compilation failed" << endl;
+
+  if (wantReport)
+  {
+    string report = options.diagnosticsFormat == "sarif" ? diagnostics.toSarif(streaming ? "stdin" : options.sourcePath)
+                                                         : diagnostics.toJson();
+    if (options.diagnosticsPath.empty())
+      cerr << report << endl;
+    else
+    {
+      ofstream file(options.diagnosticsPath);
+      file << report << endl;
+      if (!file)
+        cerr << "Warning: cannot write diagnostics to " << options.diagnosticsPath << endl;
+    }
+  }
+
+  // Reports go to stderr so they never mix with (or get cached as) output
+  if (collectStatistics)
+  {
+    CompileStatistics &statistics = CompileStatistics::current();
+    statistics.endCompile();
+#ifdef TINYC_NO_STATS
+    cerr << "Note: phase timers and counters were compiled out (TINYC_NO_STATS)" << endl;
+#endif
+    if (options.timeReport)
+      statistics.printTimeReport(cerr, options.reportJson);
+    if (options.showStats)
+      statistics.printCounters(cerr, options.reportJson);
+    if (options.showStats && AllocationTracker::compiledIn())
+      AllocationTracker::printReport(cerr, options.reportJson, statistics);
+  }
+
+  if (cache && options.showCacheStats)
+    cache->printStatistics(cout);
+  if (incremental && options.showCacheStats)
+    incremental->printStatistics(cout);
+
+  delete incremental;
+  delete cache;
   sourceCodeFile.close();
-  return 0;
+  return status;
 }
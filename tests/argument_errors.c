@@ -0,0 +1,40 @@
+int sum(int values[], int count)
+{
+    return values[0] + count;
+}
+
+float trace(float m[][4])
+{
+    return m[0][0];
+}
+
+float blend(float w[4], float x)
+{
+    return w[0] * x;
+}
+
+int twice(int x)
+{
+    return x * 2;
+}
+
+int main()
+{
+    int data[10];
+    float scores[10];
+    float wide[4][5];
+    float pair[2];
+    int x;
+
+    x = 1;
+    x = sum(x, 1);
+    x = twice(data);
+    x = sum(scores, 10);
+    trace(wide);
+    blend(pair, 1.0);
+    x = sum(data);
+    x = missing(1);
+    x = x(1);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+int count;
+int table[count];
+int pool[];
+
+int fill(int values[], int n)
+{
+    allocate(values, n);
+    return n;
+}
+
+int main()
+{
+    float f;
+    int fixed[4], n;
+    int a[f], b[fixed], c[missing], d[main], e[n][0];
+    int ok[];
+
+    n = 10;
+    allocate(fixed, 4);
+    allocate(n, 4);
+    allocate(ok, fixed);
+    allocate(ok, f);
+    allocate(ok, main);
+    allocate(ok, 1.5 * n);
+    allocate(ok, true);
+    allocate(ok, n < 4);
+    allocate(ok, (n + 1) * fixed[0]);
+    allocate(ok);
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+int small[2] = {1, 2, 3};
+bool flag = 5;
+void nothing;
+int table[0];
+int total = 2147483648;
+
+int main()
+{
+    return small[0];
+}
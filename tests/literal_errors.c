@@ -0,0 +1,12 @@
+int main()
+{
+    int i;
+    float f;
+
+    i = 2147483648;
+    i = 0x100000000;
+    i = 040000000000;
+    f = 1e39;
+    f = 1e999;
+    return i;
+}
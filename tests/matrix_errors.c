@@ -0,0 +1,17 @@
+int grid[4][0];
+int huge[65536][65536];
+
+int main()
+{
+    int m[3][3];
+    int row[3];
+    int x;
+
+    m[1] = 2;
+    x = m[0][1][2];
+    x = row[1][1];
+    x[0][0] = 1;
+    m[1][1] = 2;
+
+    return 0;
+}
@@ -0,0 +1,9 @@
+int main()
+{
+    int i;
+
+    x = x + x;
+    i = 1;
+    y = y * y - y;
+    return i;
+}
@@ -0,0 +1,55 @@
+float weights[4] = {0.5, 0.25, 0.125, 0.125};
+
+int sum(int values[], int count)
+{
+    int i, total;
+    total = 0;
+    i = 0;
+    while (i < count) {
+        total = total + values[i];
+        i = i + 1;
+    }
+    return total;
+}
+
+int fill(int values[], int count, int value)
+{
+    int i;
+    i = 0;
+    while (i < count) {
+        values[i] = value;
+        i = i + 1;
+    }
+    return count;
+}
+
+float trace(float m[][4])
+{
+    return m[0][0] + m[1][1] + m[2][2] + m[3][3];
+}
+
+float blend(float w[4], float x)
+{
+    return w[0] * x + w[1] * x + w[2] * x + w[3] * x;
+}
+
+int twice(int x)
+{
+    return x * 2;
+}
+
+int main()
+{
+    int data[100];
+    float grid[4][4];
+    float tall[8][4];
+    int total;
+
+    fill(data, 100, 1);
+    total = sum(data, 100) + sum(data, 10);
+    total = twice(twice(total)) + twice(data[3] + 1);
+    grid[1][1] = blend(weights, trace(grid));
+    tall[0][0] = trace(tall);
+
+    return total;
+}
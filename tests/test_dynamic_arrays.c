@@ -0,0 +1,41 @@
+int sum(int values[], int count)
+{
+    int i, total;
+    total = 0;
+    i = 0;
+    while (i < count) {
+        total = total + values[i];
+        i = i + 1;
+    }
+    return total;
+}
+
+int histogram(int n, int buckets)
+{
+    int i;
+    int samples[n], counts[buckets];
+    float rows[n][4];
+    float scratch[];
+
+    i = 0;
+    while (i < n) {
+        samples[i] = i * 7 % buckets;
+        counts[samples[i]] = counts[samples[i]] + 1;
+        rows[i][0] = samples[i];
+        i = i + 1;
+    }
+
+    allocate(scratch, n * 2);
+    scratch[0] = rows[0][0];
+    allocate(scratch, buckets);
+    scratch[buckets - 1] = 0.5;
+
+    return sum(counts, buckets) + sum(samples, n);
+}
+
+int main()
+{
+    int total;
+    total = histogram(1000, 16);
+    return total;
+}
@@ -0,0 +1,15 @@
+int main()
+{
+    int a, b, c;
+    bool done;
+    a = 1;
+    b = 2;
+    c = a + b * c - a / b % 3;
+    done = a < b && b <= c || !done;
+    done = (a + b) * (c - a) == b * b != done;
+    c = a + b + c + a + b + c + a + b + c + a + b + c + a + b + c + a + b + c;
+    a == b;
+    a + b * c;
+    c;
+    return c;
+}
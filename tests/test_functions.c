@@ -0,0 +1,22 @@
+int square(int n)
+{
+    int result;
+    result = n * n;
+    return result;
+}
+
+float average(float a, float b)
+{
+    float sum;
+    sum = a + b;
+    return sum / 2;
+}
+
+int main()
+{
+    int x;
+    float y;
+    x = 4;
+    y = 2.5;
+    return 0;
+}
@@ -0,0 +1,20 @@
+int squares[8] = {0, 1, 4, 9, 16, 25, 36, 49};
+float weights[4] = {0.5, -1.25, 2.0};
+bool enabled[2] = {true, false};
+int count, limit = 100;
+float scale = -2.5;
+int scratch[1000];
+
+int lookup(int i)
+{
+    return squares[i] + limit;
+}
+
+int main()
+{
+    int limit;
+    limit = 3;
+    count = squares[limit] * scale;
+    scratch[count] = squares[limit];
+    return count;
+}
@@ -0,0 +1,13 @@
+int main()
+{
+    int table[0x10];
+    int octal[010];
+    int i;
+    float scale;
+
+    i = 0x7fffffff;
+    i = 017 + 0XfF + 0;
+    scale = 1.5e3 + 2E-3 + 1. + 0.25 + 6e+2;
+    table[0xF] = octal[07] + i;
+    return table[15];
+}
@@ -0,0 +1,51 @@
+float identity[3][3] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+int cube[4][4][4];
+
+int trace()
+{
+    int i;
+    float sum;
+    sum = 0;
+    i = 0;
+    while (i < 3) {
+        sum = sum + identity[i][i];
+        i = i + 1;
+    }
+    return sum;
+}
+
+int main()
+{
+    int a[8][8], b[8][8], c[8][8];
+    int i, j, k, sum;
+
+    i = 0;
+    while (i < 8) {
+        j = 0;
+        while (j < 8) {
+            a[i][j] = i + j;
+            b[i][j] = i - j;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+
+    i = 0;
+    while (i < 8) {
+        j = 0;
+        while (j < 8) {
+            sum = 0;
+            k = 0;
+            while (k < 8) {
+                sum = sum + a[i][k] * b[k][j];
+                k = k + 1;
+            }
+            c[i][j] = sum;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+
+    cube[1][2][3] = c[a[1][1]][7];
+    return cube[1][2][3] + identity[2][2];
+}
@@ -0,0 +1,42 @@
+int count(int n, bool verbose)
+{
+    int i, total;
+    int values[8];
+    total = 0;
+    for (i; i < n; i + 1)
+    {
+        values[i % 8] = i;
+        total = total + values[i % 8];
+    }
+    while (total > 100)
+        total = total - 100;
+    do
+    {
+        total = total + 1;
+    } while (total < 10);
+    if (verbose)
+        printf();
+    else if (total == 0)
+    {
+        scanf();
+    }
+    else
+        total = 0 - total;
+    return total;
+}
+
+void main()
+{
+    int result;
+    bool flag;
+    flag = true;
+    if (flag) {
+        result = 1;
+    }
+    while (!flag)
+    {
+        float ratio;
+        ratio = 2;
+    }
+    return result;
+}